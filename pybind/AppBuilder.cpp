@@ -27,6 +27,7 @@ QNNContext::QNNContext(const std::string& model_name,
     m_model_name = model_name;
 
     g_LibAppBuilder.ModelInitialize(model_name, model_path, backend_lib_path, system_lib_path, async, input_data_type, output_data_type, deviceID, coreIdsStr);
+    cacheTensorDescriptors(input_data_type, output_data_type);
 }
 
 QNNContext::QNNContext(const std::string& model_name, const std::string& proc_name,
@@ -36,6 +37,7 @@ QNNContext::QNNContext(const std::string& model_name, const std::string& proc_na
     m_proc_name = proc_name;
 
     g_LibAppBuilder.ModelInitialize(model_name, proc_name, model_path, backend_lib_path, system_lib_path, async, input_data_type, output_data_type, deviceID, coreIdsStr);
+    cacheTensorDescriptors(input_data_type, output_data_type);
 }
 
 QNNContext::QNNContext(const std::string& model_name,
@@ -47,6 +49,23 @@ QNNContext::QNNContext(const std::string& model_name,
     m_lora_adapters = lora_adapters;
 
     g_LibAppBuilder.ModelInitialize(model_name, model_path, backend_lib_path, system_lib_path, m_lora_adapters, async, input_data_type, output_data_type, deviceID, coreIdsStr);
+    cacheTensorDescriptors(input_data_type, output_data_type);
+}
+
+// The constructors run without the GIL. The descriptors hold numpy dtypes, so they are built and, if one
+// of them throws, destroyed with the GIL held; the members only take them over once both lists are complete,
+// which swaps the vectors and touches no Python object.
+void QNNContext::cacheTensorDescriptors(const std::string& input_data_type, const std::string& output_data_type) {
+    std::vector<std::vector<size_t>> inShapes = m_proc_name.empty() ? getInputShapes() : getInputShapes(m_proc_name);
+    std::vector<std::string> inDtypes = m_proc_name.empty() ? getInputDataType() : getInputDataType(m_proc_name);
+    std::vector<std::vector<size_t>> outShapes = m_proc_name.empty() ? getOutputShapes() : getOutputShapes(m_proc_name);
+    std::vector<std::string> outDtypes = m_proc_name.empty() ? getOutputDataType() : getOutputDataType(m_proc_name);
+
+    py::gil_scoped_acquire acquire;
+    std::vector<TensorDescriptor> inputs = makeTensorDescriptors(inShapes, inDtypes, input_data_type);
+    std::vector<TensorDescriptor> outputs = makeTensorDescriptors(outShapes, outDtypes, output_data_type);
+    m_inputs.swap(inputs);
+    m_outputs.swap(outputs);
 }
 
 // issue#24
@@ -117,7 +136,16 @@ uint64_t QNNContext::getProfilingEvent(uint32_t eventType){
     return g_LibAppBuilder.getProfilingEvent(m_model_name, eventType);
 }
 
+size_t QNNContext::ReleaseIdleTensors(){
+    return g_LibAppBuilder.ModelReleaseIdleTensors(m_model_name);
+}
+
+std::vector<size_t> QNNContext::getGraphResidentBytes(){
+    return g_LibAppBuilder.getGraphResidentBytes(m_model_name);
+}
+
 QNNContext::~QNNContext() {
+    py::gil_scoped_release release;
     if (m_proc_name.empty())
         g_LibAppBuilder.ModelDestroy(m_model_name);
     else
@@ -127,12 +155,65 @@ QNNContext::~QNNContext() {
 
 std::vector<py::array> 
 QNNContext::Inference(const std::vector<py::array>& input, const std::string& perf_profile, size_t graphIndex, const std::string& input_data_type, const std::string& output_data_type) {
-    return inference(m_model_name, input, perf_profile, graphIndex, input_data_type, output_data_type);
+    return inferenceWith(m_outputs, m_model_name, input, perf_profile, graphIndex, input_data_type, output_data_type);
 }
 
 std::vector<py::array> 
 QNNContext::Inference(const ShareMemory& share_memory, const std::vector<py::array>& input, const std::string& perf_profile, size_t graphIndex, const std::string& input_data_type, const std::string& output_data_type) {
-    return inference_P(m_model_name, m_proc_name, share_memory.m_share_memory_name, input, perf_profile, graphIndex, input_data_type, output_data_type);
+    return inferenceWith_P(m_outputs, m_model_name, m_proc_name, share_memory.m_share_memory_name, input, perf_profile, graphIndex, input_data_type, output_data_type);
+}
+
+// Run the model on caller memory: every input and output is any object with the buffer protocol or DLPack
+// (numpy arrays, torch CPU tensors, ...), C-contiguous, with the dtype the model was initialized for
+// (float32 for data_type float, the native dtype for native). The outputs are written in place, so a
+// pipeline which reuses its arrays allocates no tensor memory per call. The descriptors describe graph 0;
+// for every graph QnnSampleApp checks the input and output capacities against that graph's tensors.
+void QNNContext::InferenceInto(const std::vector<py::object>& input, const std::vector<py::object>& output,
+                               const std::string& perf_profile, size_t graphIndex) {
+    if (!m_proc_name.empty()) {
+        throw std::runtime_error("InferenceInto is not supported for a model running in another process");
+    }
+    const bool checkDescriptors = (graphIndex == 0);
+    if (checkDescriptors && (input.size() != m_inputs.size() || output.size() != m_outputs.size())) {
+        throw std::invalid_argument("model " + m_model_name + " has " + std::to_string(m_inputs.size()) + " inputs and " +
+                                    std::to_string(m_outputs.size()) + " outputs");
+    }
+
+    std::vector<BorrowedTensor> borrowed;
+    borrowed.reserve(input.size() + output.size());
+    std::vector<uint8_t*> inputBuffers;
+    std::vector<size_t> inputSize;
+    std::vector<uint8_t*> outputBuffers;
+    std::vector<size_t> outputSize;
+
+    for (size_t i = 0; i < input.size(); i++) {
+        const std::string what = "input " + std::to_string(i);
+        borrowed.push_back(borrowTensor(input[i], false, what));
+        if (checkDescriptors) {
+            checkTensor(borrowed.back(), m_inputs[i], what);
+        }
+        inputBuffers.push_back(borrowed.back().data);
+        inputSize.push_back(borrowed.back().count * borrowed.back().itemsize);
+    }
+    for (size_t i = 0; i < output.size(); i++) {
+        const std::string what = "output " + std::to_string(i);
+        borrowed.push_back(borrowTensor(output[i], true, what));
+        if (checkDescriptors) {
+            checkTensor(borrowed.back(), m_outputs[i], what);
+        }
+        outputBuffers.push_back(borrowed.back().data);
+        outputSize.push_back(borrowed.back().count * borrowed.back().itemsize);
+    }
+
+    bool success = false;
+    {
+        py::gil_scoped_release release;
+        std::string perfProfile = perf_profile;
+        success = g_LibAppBuilder.ModelInferenceInto(m_model_name, inputBuffers, inputSize, outputBuffers, outputSize, perfProfile, graphIndex);
+    }
+    if (!success) {
+        throw std::runtime_error("InferenceInto failed for model: " + m_model_name);
+    }
 }
 
 bool QNNContext::ApplyBinaryUpdate(const std::vector<LoraAdapter>& lora_adapters) {
@@ -154,6 +235,9 @@ PYBIND11_MODULE(appbuilder, m) {
             memory_delete
             set_log_level
             set_profiling_level
+            set_tensor_sets
+            set_lazy_graphs
+            set_context_cache
             set_perf_profile
             rel_perf_profile
             )pbdoc";
@@ -163,10 +247,11 @@ PYBIND11_MODULE(appbuilder, m) {
     m.attr("__author__") = "quic-zhanweiw";
     m.attr("__license__") = "BSD-3-Clause";
 
-    m.def("model_initialize", &initialize, "Initialize models.");
+    // Loading and destroying a model take long and touch no Python object, other threads run meanwhile.
+    m.def("model_initialize", &initialize, "Initialize models.", py::call_guard<py::gil_scoped_release>());
 
 #ifdef _WIN32
-    m.def("model_initialize", &initialize_P, "Initialize models.");
+    m.def("model_initialize", &initialize_P, "Initialize models.", py::call_guard<py::gil_scoped_release>());
 #endif
 
     m.def("model_inference", &inference, "Inference models.");
@@ -176,19 +261,23 @@ PYBIND11_MODULE(appbuilder, m) {
 #endif
 
 #ifdef _WIN32
-    m.def("model_destroy", &destroy, "Destroy models.");
+    m.def("model_destroy", &destroy, "Destroy models.", py::call_guard<py::gil_scoped_release>());
 #else
-    m.def("model_destroy", static_cast<int(*)(std::string)>(&destroy), "Destroy models.");
+    m.def("model_destroy", static_cast<int(*)(std::string)>(&destroy), "Destroy models.", py::call_guard<py::gil_scoped_release>());
 #endif
 
 #ifdef _WIN32
-    m.def("model_destroy", &destroy_P, "Destroy models.");
+    m.def("model_destroy", &destroy_P, "Destroy models.", py::call_guard<py::gil_scoped_release>());
 #endif
 
     m.def("memory_create", &create_memory, "Create share memory.");
     m.def("memory_delete", &delete_memory, "Delete share memory.");
     m.def("set_log_level", &set_log_level, "Set QNN log level.");
     m.def("set_profiling_level", &set_profiling_level, "Set QNN profiling level.");
+    m.def("set_tensor_sets", &set_tensor_sets, "Set the I/O tensor sets per graph of the models initialized from now on.");
+    m.def("set_lazy_graphs", &set_lazy_graphs, "Create the context and graph I/O tensors of the models initialized from now on at first use.");
+    m.def("set_context_cache", &set_context_cache, "Set the directory and size limit of the compiled context cache of DLC models.",
+          py::arg("cache_dir"), py::arg("max_bytes") = 0);
     m.def("set_perf_profile", &set_perf_profile, "Set HTP perf profile.");
     m.def("rel_perf_profile", &rel_perf_profile, "Release HTP perf profile.");
 
@@ -197,12 +286,14 @@ PYBIND11_MODULE(appbuilder, m) {
         .def(py::init<const std::string&, const size_t>());
 
     py::class_<QNNContext>(m, "QNNContext")
-        .def(py::init<const std::string&, const std::string&, const std::string&, const std::string&, bool, const std::string&, const std::string&, uint32_t, std::string>())
-        .def(py::init<const std::string&, const std::string&, const std::string&, const std::string&, const std::vector<LoraAdapter>&, bool, const std::string&, const std::string&, uint32_t, std::string>())
-        .def(py::init<const std::string&, const std::string&, const std::string&, const std::string&, const std::string&, bool, const std::string&, const std::string&, uint32_t, std::string>())
+        .def(py::init<const std::string&, const std::string&, const std::string&, const std::string&, bool, const std::string&, const std::string&, uint32_t, std::string>(), py::call_guard<py::gil_scoped_release>())
+        .def(py::init<const std::string&, const std::string&, const std::string&, const std::string&, const std::vector<LoraAdapter>&, bool, const std::string&, const std::string&, uint32_t, std::string>(), py::call_guard<py::gil_scoped_release>())
+        .def(py::init<const std::string&, const std::string&, const std::string&, const std::string&, const std::string&, bool, const std::string&, const std::string&, uint32_t, std::string>(), py::call_guard<py::gil_scoped_release>())
         .def("Inference", py::overload_cast<const std::vector<py::array>&, const std::string&, size_t, const std::string&, const std::string&>(&QNNContext::Inference))
         .def("Inference", py::overload_cast<const ShareMemory&, const std::vector<py::array>&, const std::string&, size_t, const std::string&, const std::string&>(&QNNContext::Inference))
-        .def("ApplyBinaryUpdate", &QNNContext::ApplyBinaryUpdate, "Apply Lora binary update")
+        .def("InferenceInto", &QNNContext::InferenceInto, "Inference into preallocated outputs",
+             py::arg("input"), py::arg("output"), py::arg("perf_profile") = "default", py::arg("graphIndex") = 0)
+        .def("ApplyBinaryUpdate", &QNNContext::ApplyBinaryUpdate, "Apply Lora binary update", py::call_guard<py::gil_scoped_release>())
         .def("getInputShapes", py::overload_cast<>(&QNNContext::getInputShapes)) 
         .def("getInputDataType", py::overload_cast<>(&QNNContext::getInputDataType)) 
         .def("getOutputShapes", py::overload_cast<>(&QNNContext::getOutputShapes)) 
@@ -217,7 +308,9 @@ PYBIND11_MODULE(appbuilder, m) {
         .def("getInputName", py::overload_cast<const std::string&>(&QNNContext::getInputName))
         .def("getOutputName", py::overload_cast<const std::string&>(&QNNContext::getOutputName))
         .def("getGraphName", py::overload_cast<const std::string&>(&QNNContext::getGraphName))
-        .def("getProfilingEvent", py::overload_cast<uint32_t>(&QNNContext::getProfilingEvent));
+        .def("getProfilingEvent", py::overload_cast<uint32_t>(&QNNContext::getProfilingEvent))
+        .def("ReleaseIdleTensors", &QNNContext::ReleaseIdleTensors, "Free the I/O tensors of the graphs not running", py::call_guard<py::gil_scoped_release>())
+        .def("getGraphResidentBytes", &QNNContext::getGraphResidentBytes);
 
     py::class_<LoraAdapter>(m, "LoraAdapter")
         .def(py::init<const std::string &, const std::vector<std::string> &>());
@@ -20,6 +20,8 @@
 #include <mutex>
 #include <algorithm>
 #include <cctype>
+#include <functional>
+#include <memory>
 
 #include "LibAppBuilder.hpp"
 #include "Lora.hpp"
@@ -64,6 +66,19 @@ static inline py::dtype dtypeFromString(const std::string& dtypeStr) {
         return py::dtype::of<double>();
     } else if (t == "bool" || t == "bool_" || t == "bool8") {
         return py::dtype::of<bool>();
+    } else if (t == "sfp8") {
+        // quantized tensors, the raw integers
+        return py::dtype::of<int8_t>();
+    } else if (t == "ufp8") {
+        return py::dtype::of<uint8_t>();
+    } else if (t == "sfp16") {
+        return py::dtype::of<int16_t>();
+    } else if (t == "ufp16") {
+        return py::dtype::of<uint16_t>();
+    } else if (t == "sfp32") {
+        return py::dtype::of<int32_t>();
+    } else if (t == "ufp32") {
+        return py::dtype::of<uint32_t>();
     }
 
     // Fallback: treat as raw bytes
@@ -167,6 +182,250 @@ static inline py::dtype inferOutputNumpyDtype(size_t outputSizeBytes,
     return fallback;
 }
 
+// ---------------------------------------------------------------------------
+// Tensor descriptor: how to view one input/output buffer of a model as a numpy array.
+// Built once per QNNContext, so an inference does no model lookup and no string work per tensor.
+// ---------------------------------------------------------------------------
+struct TensorDescriptor {
+    py::dtype dtype;
+    std::vector<py::ssize_t> shape;
+    std::vector<py::ssize_t> strides;   // C order, in bytes
+    size_t nbytes = 0;
+    bool isFloat32 = false;
+};
+
+// ---------------------------------------------------------------------------
+// Helper: descriptors from the input or output shapes/dtypes of graph 0.
+// - QnnSampleApp takes/returns float32 buffers when the model was initialized with data_type float,
+//   and the native buffers otherwise (a float32 tensor is float32 either way).
+// - getInputShapes()/getOutputShapes() skip tensors without dimensions; if the lists don't line up, return none.
+// ---------------------------------------------------------------------------
+static inline std::vector<TensorDescriptor> makeTensorDescriptors(const std::vector<std::vector<size_t>>& shapes,
+                                                                  const std::vector<std::string>& dtypes,
+                                                                  const std::string& data_type) {
+    std::vector<TensorDescriptor> descriptors;
+    if (shapes.empty() || shapes.size() != dtypes.size()) {
+        return descriptors;
+    }
+
+    const bool floatData = isFloat32Request(data_type);
+    for (size_t i = 0; i < shapes.size(); i++) {
+        TensorDescriptor d;
+        d.isFloat32 = floatData || dtypes[i] == "float32";
+        d.dtype = d.isFloat32 ? py::dtype::of<float>() : dtypeFromString(dtypes[i]);
+
+        const size_t rank = shapes[i].size();
+        d.shape.resize(rank);
+        d.strides.resize(rank);
+        py::ssize_t stride = d.dtype.itemsize();
+        for (size_t k = rank; k-- > 0;) {
+            d.shape[k] = static_cast<py::ssize_t>(shapes[i][k]);
+            d.strides[k] = stride;
+            stride *= d.shape[k];
+        }
+        d.nbytes = static_cast<size_t>(stride);
+        descriptors.push_back(std::move(d));
+    }
+    return descriptors;
+}
+
+// ---------------------------------------------------------------------------
+// Helper: wrap the output buffers of one inference as numpy arrays, without copying them.
+// - An output whose buffer size matches its descriptor gets the model's shape and dtype.
+// - Any other (no descriptors, or a graph other than graph 0 with different outputs) falls back to a
+//   flat array with the dtype inferred from the buffer size; getInfo() then fetches shapes/dtypes once.
+// - freeBuffers: the buffers are malloc'ed by QnnSampleApp and owned by the arrays, else shared memory.
+// ---------------------------------------------------------------------------
+using OutputInfoGetter = std::function<void(std::vector<std::string>&, std::vector<std::vector<size_t>>&)>;
+
+static inline std::vector<py::array> wrapOutputs(const std::vector<uint8_t*>& outputBuffers, const std::vector<size_t>& outputSize,
+                                                 const std::vector<TensorDescriptor>& descriptors,
+                                                 bool floatOutMode, bool freeBuffers, const OutputInfoGetter& getInfo) {
+    std::vector<py::array> output;
+    output.reserve(outputBuffers.size());
+
+    bool haveInfo = false;
+    std::vector<std::string> outDtypes;
+    std::vector<std::vector<size_t>> outShapes;
+
+    for (size_t i = 0; i < outputBuffers.size(); i++) {
+        const size_t bytes = (i < outputSize.size()) ? outputSize[i] : 0;
+
+        // https://github.com/pybind/pybind11/issues/1042#issuecomment-325941022
+        // Avoid memory copy for saving time. 'py::capsule' for freeing the memory.
+        py::capsule free_data = freeBuffers ? py::capsule(outputBuffers[i], [](void* f) {free(f);})
+                                            : py::capsule(outputBuffers[i], [](void* f) {});  // share memory, not freed
+
+        py::array result;
+        bool isFloat32 = false;
+        if (i < descriptors.size() && descriptors[i].nbytes == bytes) {
+            const TensorDescriptor& d = descriptors[i];
+            result = py::array(d.dtype, d.shape, d.strides, outputBuffers[i], free_data);
+            isFloat32 = d.isFloat32;
+        } else {
+            if (!haveInfo) {
+                getInfo(outDtypes, outShapes);
+                haveInfo = true;
+            }
+            std::string dtypeStr = (i < outDtypes.size()) ? outDtypes[i] : std::string("uint8");
+            const std::vector<size_t> shape = (i < outShapes.size()) ? outShapes[i] : std::vector<size_t>{};
+
+            // infer real dtype from outputSize & outputShape to support FLOAT_ONLY outputs
+            py::dtype dt = inferOutputNumpyDtype(bytes, shape, dtypeStr);
+
+            // element count: prefer shape product (stable for both native & float)
+            size_t elemCount = 0;
+            if (!shape.empty()) {
+                elemCount = productDims(shape);
+            } else {
+                // fallback to old method if shape unavailable
+                const size_t itemBytes = static_cast<size_t>(dt.itemsize());
+                if (itemBytes > 0 && (bytes % itemBytes) == 0) {
+                    elemCount = bytes / itemBytes;
+                } else {
+                    dt = py::dtype::of<uint8_t>();
+                    elemCount = bytes;
+                }
+            }
+
+            result = py::array(dt,
+                               { static_cast<py::ssize_t>(elemCount) },
+                               { static_cast<py::ssize_t>(dt.itemsize()) },
+                               outputBuffers[i],
+                               free_data);
+            isFloat32 = isNumpyFloat32Dtype(dt);
+        }
+
+        // If user requests float output, cast to float32 before returning.
+        // IMPORTANT: do NOT reinterpret the raw buffer as float32 (size may not match).
+        // Only a model initialized with native outputs gets here; the cast keeps the shape.
+        if (floatOutMode && !isFloat32) {
+            py::array_t<float, py::array::c_style | py::array::forcecast> farr(result);
+            output.push_back(py::array(farr));
+        } else {
+            output.push_back(result);
+        }
+    }
+
+    return output;
+}
+
+// ---------------------------------------------------------------------------
+// DLPack (https://github.com/dmlc/dlpack): the ABI stable structs every producer (torch, numpy, ...)
+// exports from __dlpack__(), declared here so tensors can be borrowed without linking the producer.
+// ---------------------------------------------------------------------------
+struct DLDevice { int32_t device_type; int32_t device_id; };
+struct DLDataType { uint8_t code; uint8_t bits; uint16_t lanes; };
+struct DLTensor {
+    void* data;
+    DLDevice device;
+    int32_t ndim;
+    DLDataType dtype;
+    int64_t* shape;
+    int64_t* strides;   // in elements, nullptr for compact row-major
+    uint64_t byte_offset;
+};
+struct DLManagedTensor {
+    DLTensor dl_tensor;
+    void* manager_ctx;
+    void (*deleter)(DLManagedTensor* self);
+};
+
+// ---------------------------------------------------------------------------
+// Helper: the memory of a Python tensor, borrowed for one call.
+// - Objects with the buffer protocol (numpy, bytearray, memoryview, ...) are requested through it,
+//   anything else through __dlpack__() (torch CPU tensors).
+// - Only C-contiguous CPU memory is accepted; nothing is copied or converted.
+// - buffer/keepAlive hold the memory; an unconsumed "dltensor" capsule calls the producer's deleter
+//   when it is released, which hands the tensor back to its owner.
+// ---------------------------------------------------------------------------
+struct BorrowedTensor {
+    uint8_t* data = nullptr;
+    size_t count = 0;       // elements
+    char kind = 0;          // numpy kind: 'f', 'i', 'u', 'b'
+    size_t itemsize = 0;
+    std::unique_ptr<py::buffer_info> buffer;
+    py::object keepAlive;
+};
+
+static inline bool isCContiguous(const std::vector<py::ssize_t>& shape, const std::vector<py::ssize_t>& strides, py::ssize_t unit) {
+    py::ssize_t expected = unit;
+    for (size_t k = shape.size(); k-- > 0;) {
+        if (shape[k] != 1 && strides[k] != expected) {
+            return false;
+        }
+        expected *= shape[k];
+    }
+    return true;
+}
+
+static inline BorrowedTensor borrowTensor(const py::handle& obj, bool writable, const std::string& what) {
+    BorrowedTensor t;
+
+    if (PyObject_CheckBuffer(obj.ptr())) {
+        t.buffer.reset(new py::buffer_info(py::reinterpret_borrow<py::buffer>(obj).request(writable)));
+        const py::buffer_info& info = *t.buffer;
+        if (!isCContiguous(info.shape, info.strides, info.itemsize)) {
+            throw std::invalid_argument(what + " is not C-contiguous");
+        }
+        t.data = static_cast<uint8_t*>(info.ptr);
+        t.count = static_cast<size_t>(info.size);
+        t.itemsize = static_cast<size_t>(info.itemsize);
+        t.kind = py::dtype(info).kind();
+        return t;
+    }
+
+    if (!py::hasattr(obj, "__dlpack__")) {
+        throw std::invalid_argument(what + " supports neither the buffer protocol nor DLPack");
+    }
+    t.keepAlive = obj.attr("__dlpack__")();
+    auto* managed = static_cast<DLManagedTensor*>(PyCapsule_GetPointer(t.keepAlive.ptr(), "dltensor"));
+    if (nullptr == managed) {
+        throw py::error_already_set();
+    }
+    const DLTensor& dl = managed->dl_tensor;
+    if (dl.device.device_type != 1) {   // kDLCPU
+        throw std::invalid_argument(what + " is not in CPU memory");
+    }
+    if (dl.dtype.lanes != 1 || dl.dtype.bits % 8 != 0) {
+        throw std::invalid_argument(what + " has a vector or sub-byte dtype");
+    }
+    switch (dl.dtype.code) {
+        case 0: t.kind = 'i'; break;    // kDLInt
+        case 1: t.kind = 'u'; break;    // kDLUInt
+        case 2: t.kind = 'f'; break;    // kDLFloat
+        case 6: t.kind = 'b'; break;    // kDLBool
+        default: throw std::invalid_argument(what + " has an unsupported DLPack dtype code " + std::to_string(dl.dtype.code));
+    }
+    t.itemsize = dl.dtype.bits / 8;
+
+    std::vector<py::ssize_t> shape(dl.shape, dl.shape + dl.ndim);
+    t.count = 1;
+    for (py::ssize_t d : shape) {
+        t.count *= static_cast<size_t>(d);
+    }
+    if (dl.strides != nullptr && !isCContiguous(shape, std::vector<py::ssize_t>(dl.strides, dl.strides + dl.ndim), 1)) {
+        throw std::invalid_argument(what + " is not C-contiguous");
+    }
+    t.data = static_cast<uint8_t*>(dl.data) + dl.byte_offset;
+    return t;
+}
+
+// ---------------------------------------------------------------------------
+// Helper: a borrowed tensor must have the dtype and the element count of the model tensor.
+// ---------------------------------------------------------------------------
+static inline void checkTensor(const BorrowedTensor& t, const TensorDescriptor& d, const std::string& what) {
+    const size_t itemsize = static_cast<size_t>(d.dtype.itemsize());
+    if (t.kind != d.dtype.kind() || t.itemsize != itemsize) {
+        throw std::invalid_argument(what + " has dtype " + std::string(1, t.kind) + std::to_string(t.itemsize) +
+                                    ", the model expects " + std::string(1, d.dtype.kind()) + std::to_string(itemsize));
+    }
+    if (t.count != d.nbytes / itemsize) {
+        throw std::invalid_argument(what + " has " + std::to_string(t.count) + " elements, the model expects " +
+                                    std::to_string(d.nbytes / itemsize));
+    }
+}
+
 ModelInfo_t getModelInfo_P(std::string model_name, std::string proc_name, 
                            std::string input, size_t graphIndex = 0) {
 
@@ -196,6 +455,18 @@ int set_profiling_level(int32_t log_level) {
     return SetProfilingLevel(log_level);
 }
 
+int set_tensor_sets(int32_t tensor_sets) {
+    return SetTensorSets(tensor_sets);
+}
+
+int set_lazy_graphs(bool lazy_graphs) {
+    return SetLazyGraphs(lazy_graphs);
+}
+
+int set_context_cache(const std::string& cache_dir, uint64_t max_bytes) {
+    return SetContextCache(cache_dir, max_bytes);
+}
+
 int set_perf_profile(const std::string& perf_profile) {
     return SetPerfProfileGlobal(perf_profile);
 }
@@ -224,9 +495,10 @@ int destroy_P(std::string model_name, std::string proc_name) {
     return g_LibAppBuilder.ModelDestroy(model_name, proc_name);
 }
 
-std::vector<py::array> inference(std::string model_name, const std::vector<py::array>& input, 
-                                 std::string perf_profile, size_t graphIndex = 0, 
-                                 const std::string& input_data_type="float", const std::string& output_data_type="float") {
+std::vector<py::array> inferenceWith(const std::vector<TensorDescriptor>& descriptors,
+                                     std::string model_name, const std::vector<py::array>& input,
+                                     std::string perf_profile, size_t graphIndex,
+                                     const std::string& input_data_type, const std::string& output_data_type) {
     std::vector<uint8_t*> inputBuffers;
     std::vector<uint8_t*> outputBuffers;
     std::vector<size_t> outputSize;
@@ -257,67 +529,36 @@ std::vector<py::array> inference(std::string model_name, const std::vector<py::a
         }
     }
 
-    g_LibAppBuilder.ModelInference(model_name, inputBuffers, outputBuffers, outputSize, perf_profile, graphIndex);
+    // The inputs are pinned by keepAlive, so the graph runs without the GIL and other Python threads,
+    // e.g. ones driving other QNNContexts, keep running meanwhile. The outputs are wrapped after it.
+    {
+        py::gil_scoped_release release;
+        g_LibAppBuilder.ModelInference(model_name, inputBuffers, outputBuffers, outputSize, perf_profile, graphIndex);
+    }
 
     //QNN_INF("inference::inference output vector length: %d\n", outputBuffers.size());
 
-    // dtype list like: ['float16', 'float16', ...]
-    std::vector<std::string> outDtypes = g_LibAppBuilder.getOutputDataType(model_name);
-    // output shapes for robust element count & float/native dtype inference
-    std::vector<std::vector<size_t>> outShapes = g_LibAppBuilder.getOutputShapes(model_name);
-
-    std::vector<py::array> output;
-
     //start_time();
-    for (auto i = 0; i < outputBuffers.size(); i++) {
-        std::string dtypeStr = (i < outDtypes.size()) ? outDtypes[i] : std::string("uint8");
-        const std::vector<size_t> shape = (i < outShapes.size()) ? outShapes[i] : std::vector<size_t>{};
-
-        // infer real dtype from outputSize & outputShape to support FLOAT_ONLY outputs
-        py::dtype dt = inferOutputNumpyDtype((i < outputSize.size()) ? outputSize[i] : 0, shape, dtypeStr);
-
-        // element count: prefer shape product (stable for both native & float)
-        size_t elemCount = 0;
-        if (!shape.empty()) {
-            elemCount = productDims(shape);
-        } else {
-            // fallback to old method if shape unavailable
-            const size_t itemBytes = static_cast<size_t>(dt.itemsize());
-            if (itemBytes > 0 && i < outputSize.size() && (outputSize[i] % itemBytes) == 0) {
-                elemCount = outputSize[i] / itemBytes;
-            } else if (i < outputSize.size()) {
-                dt = py::dtype::of<uint8_t>();
-                elemCount = outputSize[i];
-            }
-        }
-
-        // https://github.com/pybind/pybind11/issues/1042#issuecomment-325941022
-        // Avoid memory copy for saving time. 'py::capsule' for freeing the memory.
-        py::capsule free_data(outputBuffers[i], [](void* f) {free(f);});
-        py::array result(dt,
-                        { static_cast<py::ssize_t>(elemCount) },
-                        { static_cast<py::ssize_t>(dt.itemsize()) },
-                        outputBuffers[i],
-                        free_data);
-
-        // If user requests float output, cast to float32 before returning.
-        // IMPORTANT: do NOT reinterpret the raw buffer as float32 (size may not match).
-        // We first create 'result' using the inferred real dtype, then cast (copy) if needed.
-        if (floatOutMode && !isNumpyFloat32Dtype(dt)) {
-            py::array_t<float, py::array::c_style | py::array::forcecast> farr(result);
-            output.push_back(py::array(farr));
-        } else {
-            output.push_back(result);
-        }
-    }
+    std::vector<py::array> output = wrapOutputs(outputBuffers, outputSize, descriptors, floatOutMode, true,
+        [&](std::vector<std::string>& dtypes, std::vector<std::vector<size_t>>& shapes) {
+            dtypes = g_LibAppBuilder.getOutputDataType(model_name);
+            shapes = g_LibAppBuilder.getOutputShapes(model_name);
+        });
     //print_time("convert Data To ArrayV");
 
     return output;
 }
 
-std::vector<py::array> inference_P(std::string model_name, std::string proc_name, std::string share_memory_name,
-                                   const std::vector<py::array>& input, std::string perf_profile, size_t graphIndex = 0, 
-                                   const std::string& input_data_type="float", const std::string& output_data_type="float") {
+std::vector<py::array> inference(std::string model_name, const std::vector<py::array>& input, 
+                                 std::string perf_profile, size_t graphIndex = 0, 
+                                 const std::string& input_data_type="float", const std::string& output_data_type="float") {
+    return inferenceWith({}, model_name, input, perf_profile, graphIndex, input_data_type, output_data_type);
+}
+
+std::vector<py::array> inferenceWith_P(const std::vector<TensorDescriptor>& descriptors,
+                                       std::string model_name, std::string proc_name, std::string share_memory_name,
+                                       const std::vector<py::array>& input, std::string perf_profile, size_t graphIndex,
+                                       const std::string& input_data_type, const std::string& output_data_type) {
     std::vector<uint8_t*> inputBuffers;
     std::vector<size_t> inputSize;
     std::vector<uint8_t*> outputBuffers;
@@ -351,7 +592,11 @@ std::vector<py::array> inference_P(std::string model_name, std::string proc_name
         }
     }
 
-    bool success = g_LibAppBuilder.ModelInference(model_name, proc_name, share_memory_name, inputBuffers, inputSize, outputBuffers, outputSize, perf_profile, graphIndex);
+    bool success = false;
+    {
+        py::gil_scoped_release release;
+        success = g_LibAppBuilder.ModelInference(model_name, proc_name, share_memory_name, inputBuffers, inputSize, outputBuffers, outputSize, perf_profile, graphIndex);
+    }
     if (!success) {
         QNN_ERR("ModelInference failed for model: %s, proc: %s", model_name.c_str(), proc_name.c_str());
         return {};
@@ -359,55 +604,24 @@ std::vector<py::array> inference_P(std::string model_name, std::string proc_name
 
     //QNN_INF("inference_P::inference output vector length: %d\n", outputBuffers.size());
 
-    // dtype list like: ['float16', 'float16', ...]
-    std::vector<std::string> outDtypes = g_LibAppBuilder.getOutputDataType(model_name, proc_name);
-    std::vector<std::vector<size_t>> outShapes = g_LibAppBuilder.getOutputShapes(model_name, proc_name);
-
-    std::vector<py::array> output;
-
+    // For shared memory outputs, a float cast creates a float32 copy (shared memory remains untouched).
     //start_time();
-    for (auto i = 0; i < outputBuffers.size(); i++) {
-        std::string dtypeStr = (i < outDtypes.size()) ? outDtypes[i] : std::string("uint8");
-        const std::vector<size_t> shape = (i < outShapes.size()) ? outShapes[i] : std::vector<size_t>{};
-
-        py::dtype dt = inferOutputNumpyDtype((i < outputSize.size()) ? outputSize[i] : 0, shape, dtypeStr);
-
-        size_t elemCount = 0;
-        if (!shape.empty()) {
-            elemCount = productDims(shape);
-        } else {
-            const size_t itemBytes = static_cast<size_t>(dt.itemsize());
-            if (itemBytes > 0 && i < outputSize.size() && (outputSize[i] % itemBytes) == 0) {
-                elemCount = outputSize[i] / itemBytes;
-            } else if (i < outputSize.size()) {
-                dt = py::dtype::of<uint8_t>();
-                elemCount = outputSize[i];
-            }
-        }
-
-        // https://github.com/pybind/pybind11/issues/1042#issuecomment-325941022
-        // Avoid memory copy for saving time. 'py::capsule' for freeing the memory.
-        py::capsule free_data(outputBuffers[i], [](void* f) {});  // Not free this memory since it's share memory.
-        py::array result(dt,
-                        { static_cast<py::ssize_t>(elemCount) },
-                        { static_cast<py::ssize_t>(dt.itemsize()) },
-                        outputBuffers[i],
-                        free_data);
-
-        // If user requests float output, cast to float32 before returning.
-        // For shared memory outputs, this will create a float32 copy (shared memory remains untouched).
-        if (floatOutMode && !isNumpyFloat32Dtype(dt)) {
-            py::array_t<float, py::array::c_style | py::array::forcecast> farr(result);
-            output.push_back(py::array(farr));
-        } else {
-            output.push_back(result);
-        }
-    }
+    std::vector<py::array> output = wrapOutputs(outputBuffers, outputSize, descriptors, floatOutMode, false,
+        [&](std::vector<std::string>& dtypes, std::vector<std::vector<size_t>>& shapes) {
+            dtypes = g_LibAppBuilder.getOutputDataType(model_name, proc_name);
+            shapes = g_LibAppBuilder.getOutputShapes(model_name, proc_name);
+        });
     //print_time("convert Data To ArrayV");
 
     return output;
 }
 
+std::vector<py::array> inference_P(std::string model_name, std::string proc_name, std::string share_memory_name,
+                                   const std::vector<py::array>& input, std::string perf_profile, size_t graphIndex = 0, 
+                                   const std::string& input_data_type="float", const std::string& output_data_type="float") {
+    return inferenceWith_P({}, model_name, proc_name, share_memory_name, input, perf_profile, graphIndex, input_data_type, output_data_type);
+}
+
 bool ApplyBinaryUpdate(const std::vector<LoraAdapter>& lora_adapters);
 
 int create_memory(std::string share_memory_name, size_t share_memory_size) {
@@ -465,6 +679,18 @@ public:
     std::vector<std::string>  getInputName(const std::string& proc_name);
     std::vector<std::string>  getOutputName(const std::string& proc_name);
     uint64_t getProfilingEvent(uint32_t eventType);
+    size_t ReleaseIdleTensors();
+    std::vector<size_t> getGraphResidentBytes();
+
+    // Writes the outputs into the caller's arrays/tensors, see InferenceInto in AppBuilder.cpp.
+    void InferenceInto(const std::vector<py::object>& input, const std::vector<py::object>& output,
+                       const std::string& perf_profile = "default", size_t graphIndex = 0);
+
+    // Input and output descriptors of graph 0, cached at construction. They hold numpy dtypes, so they are
+    // only built and destroyed with the GIL held; ~QNNContext gives the GIL back before its members go.
+    std::vector<TensorDescriptor> m_inputs;
+    std::vector<TensorDescriptor> m_outputs;
+    void cacheTensorDescriptors(const std::string& input_data_type, const std::string& output_data_type);
 
     typedef struct ModelInfo {
         std::vector<std::vector<size_t>> inputShapes;
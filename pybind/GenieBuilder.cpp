@@ -9,6 +9,7 @@
 #include <fstream>
 #include <iostream>
 #include "GenieBuilder.h"
+#include "EmbeddingTable.hpp"
 
 // #define GENIE_BUILDER_DEBUG 1
 #define CONTENT_LENGTH 4096  // TODO. need to calculate.
@@ -16,8 +17,8 @@
 static int g_CurLength = 0;
 static int g_MaxLength = CONTENT_LENGTH;
 
-size_t g_embeddingLutSize{0};
-std::shared_ptr<void> g_embeddingLut{};
+// Mapped read-only, so processes which load the same table share its pages.
+EmbeddingTable g_embeddingLut;
 
 // Forward declaration for allocator used in tokenizer decode
 void MyAllocCallback(const size_t size, const char **allocatedData);
@@ -52,12 +53,7 @@ void tokenToEmbedCallback(int32_t token,
                           void* embedding,
                           uint32_t embeddingSize,
                           const void* /*userData*/) {
-  size_t lutIndex = static_cast<size_t>(token) * embeddingSize;
-  if ((lutIndex + embeddingSize) <= g_embeddingLutSize) {
-    int8_t* embeddingSrc = static_cast<int8_t*>(g_embeddingLut.get()) + lutIndex;
-    int8_t* embeddingDst = static_cast<int8_t*>(embedding);
-    std::copy(embeddingSrc, embeddingSrc + embeddingSize, embeddingDst);
-  } else {
+  if (!g_embeddingLut.lookup(token, embedding, embeddingSize)) {
     std::cerr << "Error: T2E conversion overflow." << std::endl;
   }
 }
@@ -171,26 +167,13 @@ void GenieContext::embedding_inference_thread() {
     }
 }
 
-bool GenieContext::SetEmbeddingTable(const std::string table_path)
+// The table is a raw LUT in the model's embedding type, or an fp16/int8 table written by
+// EmbeddingTable::compress(), dequantized per row for models which take float32 embeddings.
+bool GenieContext::SetEmbeddingTable(const std::string table_path, bool prefetch)
 {
-    std::ifstream infile(table_path, std::ios::binary | std::ios::ate);
-    if (!infile) {
-        std::cerr << "Failed to open embedding table file: " << table_path << "\n";
-        return false;
-    }
-
-    std::streamsize size = infile.tellg();
-    infile.seekg(0, std::ios::beg);
-
-    g_embeddingLutSize = static_cast<size_t>(size);
-    g_embeddingLut.reset(malloc(g_embeddingLutSize), free);
-    if (!g_embeddingLut) {
-        std::cerr << "Failed to allocate memory for embedding LUT.\n";
-        return false;
-    }
-
-    if (!infile.read(static_cast<char*>(g_embeddingLut.get()), size)) {
-        std::cerr << "Failed to read embedding LUT data from file.\n";
+    std::string error;
+    if (!g_embeddingLut.open(table_path, error, prefetch)) {
+        std::cerr << error << "\n";
         return false;
     }
 
@@ -601,7 +584,7 @@ PYBIND11_MODULE(geniebuilder, m) {
         .def(py::init<const std::string&, bool>())
         .def("Query", &GenieContext::Query)
         .def("QueryByEmbedding", &GenieContext::QueryByEmbedding)
-        .def("SetEmbeddingTable", &GenieContext::SetEmbeddingTable)
+        .def("SetEmbeddingTable", &GenieContext::SetEmbeddingTable, py::arg("table_path"), py::arg("prefetch") = false)
         .def("SetParams", &GenieContext::SetParams)
         .def("GetProfile", &GenieContext::GetProfile)
         .def("TokenLength", &GenieContext::TokenLength)
@@ -52,7 +52,7 @@ class GenieContext {
                      
 
         std::string QueryByEmbedding(const std::vector<float>& embedding, const Callback callback);
-        bool SetEmbeddingTable(const std::string table_path);
+        bool SetEmbeddingTable(const std::string table_path, bool prefetch = false);
         std::string DecodeTokens(const uint32_t* token_ids, uint32_t numTokens);
 
     public:
@@ -11,6 +11,7 @@
 #include <log.h>
 #include <fstream>
 #include <filesystem>
+#include <chrono>
 #include <base64.h>
 #include <curl/curl.h>
 #include <nlohmann/json.hpp>
@@ -29,6 +30,7 @@ public:
     std::string model{"IBM-Granite-v3.1-8B"};
     std::string raw_file_;
     bool stream{false};
+    bool audio_stream_{false};
     std::string host{"127.0.0.1:8910"};
     std::string key_;
     std::string bench_;
@@ -86,6 +88,8 @@ void CLI::Init(int argc, CharT **argv)
             cli_info.picture_path_ = ArgToString(argv[++i]);
         else if (ArgToString(arg) == "--audio" && i + 1 < argc)
             cli_info.audio_path_ = ArgToString(argv[++i]);
+        else if (ArgToString(arg) == "--audio_stream")
+            cli_info.audio_stream_ = true;
         else if (ArgToString(arg) == "--host")
             cli_info.host = ArgToString(argv[++i]);
         else if (ArgToString(arg) == "--key")
@@ -103,6 +107,33 @@ std::string message;
 std::string response_chunk;
 bool stop_loop{false};
 
+// per connection throughput of the stream response
+static struct StreamStats
+{
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point first_event;
+    size_t events{0};
+    size_t bytes{0};
+    size_t content_bytes{0};
+
+    void Reset()
+    {
+        *this = {};
+        start = std::chrono::steady_clock::now();
+    }
+
+    void Print() const
+    {
+        using ms = std::chrono::duration<double, std::milli>;
+        double total = ms(std::chrono::steady_clock::now() - start).count();
+        double first = events ? ms(first_event - start).count() : 0;
+        My_Log{} << "stream stats: " << events << " events, " << bytes << " bytes, "
+                 << content_bytes << " content bytes, first event: " << first << " ms, total: " << total << " ms, "
+                 << (total > 0 ? events * 1000 / total : 0) << " events/s, "
+                 << (total > 0 ? bytes / total : 0) << " KB/s\n";
+    }
+} stream_stats;
+
 size_t write_callback_stream(char *ptr, size_t size, size_t nmemb, void *userdata)
 {
     size_t total_size = size * nmemb;
@@ -112,6 +143,7 @@ size_t write_callback_stream(char *ptr, size_t size, size_t nmemb, void *userdat
     }
     std::string chunk(ptr, total_size);
     message += chunk;
+    stream_stats.bytes += total_size;
 
     std::istringstream stream(chunk);
     std::string line;
@@ -124,6 +156,10 @@ size_t write_callback_stream(char *ptr, size_t size, size_t nmemb, void *userdat
             process = true;
             if (line.rfind("data: ", 0) == 0)
             {
+                if (!stream_stats.events++)
+                {
+                    stream_stats.first_event = std::chrono::steady_clock::now();
+                }
                 std::string jsonStr = line.substr(6);
                 if (jsonStr == "[DONE]")
                 {
@@ -138,6 +174,7 @@ size_t write_callback_stream(char *ptr, size_t size, size_t nmemb, void *userdat
                     auto part = j["choices"][0]["delta"]["content"].get<std::string>();
                     My_Log{}.original(true) << part;
                     response_chunk += part;
+                    stream_stats.content_bytes += part.size();
                     if (!cli_info.bench_.empty() && response_chunk.size() > 500)
                     {
                         My_Log{My_Log::Level::kError} << "force stop!\n";
@@ -222,6 +259,7 @@ std::string Do(const std::string &body)
     std::string full_response;
 
     My_Log{} << "Response: \n";
+    stream_stats.Reset();
     if ((res = curl_easy_perform(curl)) != CURLE_OK)
     {
         My_Log{} << "curl_easy_perform() failed: " << curl_easy_strerror(res) << std::endl;
@@ -236,6 +274,12 @@ std::string Do(const std::string &body)
         goto clean;
     }
 
+    if (cli_info.stream)
+    {
+        My_Log{}.original(true) << "\n";
+        stream_stats.Print();
+    }
+
     if (!cli_info.stream && !message.empty())
     {
         try
@@ -294,6 +338,71 @@ std::string EncodeBinary(const std::string &path)
     return out;
 }
 
+static size_t read_callback_file(char *buffer, size_t size, size_t nitems, void *userdata)
+{
+    auto *in = static_cast<std::ifstream *>(userdata);
+    in->read(buffer, static_cast<std::streamsize>(size * nitems));
+    return static_cast<size_t>(in->gcount());
+}
+
+/*
+ * Upload the wav in chunks to the audio stream route, the service featurizes it while it arrives.
+ * Returns the audio id the chat request refers to the audio by.
+ */
+std::string StreamAudio(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in.good())
+    {
+        throw std::runtime_error("open file path:" + path + " failed\n");
+    }
+
+    curl_global_init(CURL_GLOBAL_ALL);
+    CURL *curl = curl_easy_init();
+    if (!curl)
+    {
+        curl_global_cleanup();
+        return "";
+    }
+
+    char *model = curl_easy_escape(curl, cli_info.model.c_str(), 0);
+    std::string url = std::string{"http://"} + cli_info.host + "/v1/audio/stream?model=" + model;
+    curl_free(model);
+
+    struct curl_slist *headers = nullptr;
+    headers = curl_slist_append(headers, "Content-Type: audio/wav");
+    headers = curl_slist_append(headers, "Transfer-Encoding: chunked");
+
+    std::string response;
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_READFUNCTION, read_callback_file);
+    curl_easy_setopt(curl, CURLOPT_READDATA, &in);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+
+    std::string audio_id;
+    long response_code = 0;
+    CURLcode res = curl_easy_perform(curl);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+    if (res != CURLE_OK || response_code != 200)
+    {
+        My_Log{My_Log::Level::kError} << "audio stream upload failed: " << curl_easy_strerror(res) << ", "
+                                      << response_code << ", " << response << "\n";
+    }
+    else
+    {
+        My_Log{} << "audio stream: " << response << "\n";
+        audio_id = json::parse(response).value("audio_id", "");
+    }
+
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+    curl_global_cleanup();
+    return audio_id;
+}
+
 json BuildUserContentV1(const std::string &question, const std::string &img_path, const std::string &audio_path)
 {
     json j_user;
@@ -421,6 +530,19 @@ MAIN
         }
 
 
+        if (cli_info.audio_stream_ && !cli_info.audio_path_.empty())
+        {
+            json j_audio;
+            j_audio["question"] = cli_info.prompt;
+            j_audio["audio_id"] = StreamAudio(cli_info.audio_path_);
+            if (j_audio["audio_id"].get_ref<const std::string &>().empty())
+            {
+                return 1;
+            }
+            req_body = build_request_body(cli_info.model, j_audio, cli_info.system, cli_info.stream);
+            goto ahead;
+        }
+
         BuildUserContentV2(j_system, j_user);
         req_body = build_request_body(cli_info.model, j_user, j_system, cli_info.stream);
 //        req_body = build_request_body(cli_info.model, BuildUserContentV1(cli_info.prompt,
@@ -10,6 +10,8 @@ import argparse
 import base64
 import requests
 import os
+import time
+from concurrent.futures import ThreadPoolExecutor
 from openai import OpenAI
 
 IP_ADDR = "127.0.0.1:8910"
@@ -47,6 +49,12 @@ parser.add_argument("--model",
                     type=str,
                     help="The model will be loaded. It's should located at ./models/xxxx",
                     default="127.0.0.1")
+
+parser.add_argument("--sessions",
+                    type=int,
+                    help="Ask from this many sessions at once and print the total rate of streamed chunks, "
+                         "one chunk per token unless the service coalesces them (--stream_flush_ms). Default is 1",
+                    default=1)
 args = parser.parse_args()
 
 
@@ -102,30 +110,53 @@ body = {
     "messages": custom_messages
 }
 
-# send the request
-try:
+
+def ask(session=None):
+    """Send the request, a session has its own chat history in the service. Returns the streamed chunks."""
+    quiet = session is not None
+    headers = {"X-Session-Id": session} if session else None
+    chunks = 0
     if args.stream:
         response = client.chat.completions.create(
             model=args.model,
             stream=args.stream,
             messages="",
-            extra_body=body
+            extra_body=body,
+            extra_headers=headers
         )
         for chunk in response:
             if chunk.choices:
                 content = chunk.choices[0].delta.content
                 if content is not None:
-                    print(content, end="", flush=True)
-        print()
+                    chunks += 1
+                    if not quiet:
+                        print(content, end="", flush=True)
+        if not quiet:
+            print()
     else:
         response = client.chat.completions.create(
             model=args.model,
             stream=args.stream,
             messages="",
-            extra_body=body
+            extra_body=body,
+            extra_headers=headers
         )
-        if response.choices:
+        if response.choices and not quiet:
             print(response.choices[0].message.content)
+    return chunks
+
+
+# send the request
+try:
+    if args.sessions > 1:
+        start = time.time()
+        with ThreadPoolExecutor(args.sessions) as pool:
+            counts = list(pool.map(lambda i: ask(f"session-{i}"), range(args.sessions)))
+        elapsed = time.time() - start
+        print(f"{args.sessions} sessions, {sum(counts)} chunks in {elapsed:.2f} s, "
+              f"{sum(counts) / elapsed:.2f} chunks/s")
+    else:
+        ask()
 
 except Exception as e:
     print(f"\nRequest failed: {e}")
@@ -0,0 +1,98 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+/*
+ * Measure the attachment decoding of the service on 1 - 50 MB payloads.
+ *   copy + scalar: the request string is copied, a new zero filled buffer is decoded by Base64Decode.
+ *   scalar:        Base64Decode into the reused, not zero filled buffer.
+ *   fast:          Base64DecodeFast into the reused buffer, what IEmbedding::Decode does now.
+ * Every decoder must give the same bytes as the scalar one.
+ * usage: base64_bench [rounds=10]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "base64.h"
+#include "byte_buffer.h"
+
+template<typename Func>
+static double BestSeconds(int rounds, Func &&func)
+{
+    double best = 1e30;
+    for (int i = 0; i < rounds; ++i)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        func();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - begin).count());
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    const int rounds = argc > 1 ? std::max(1, std::atoi(argv[1])) : 10;
+    const size_t sizes_mb[]{1, 5, 10, 25, 50};
+
+    std::mt19937 rng{42};
+    ByteBuffer reused;
+    bool ok = true;
+
+    std::cout << "payload(MB)  copy+scalar(MB/s)  scalar(MB/s)  fast(MB/s)\n";
+    for (size_t mb: sizes_mb)
+    {
+        // an odd size, so the encoded string ends with padding.
+        std::vector<char> binary(mb * 1024 * 1024 + 1);
+        for (auto &c: binary)
+        {
+            c = static_cast<char>(rng());
+        }
+        std::string encoded(BASE64_ENCODE_OUT_SIZE(binary.size()), '\0');
+        encoded.resize(Base64Encode(binary.data(), binary.size(), encoded.data()));
+
+        size_t size = 0;
+        std::vector<uint8_t> expected;
+        const double copy_scalar = BestSeconds(rounds, [&]
+        {
+            std::string request = encoded;
+            std::vector<uint8_t> decoded(BASE64_DECODE_OUT_SIZE(request.size()));
+            size = Base64Decode(request.data(), request.size(), decoded.data());
+            expected = std::move(decoded);
+        });
+        ok &= size == binary.size() && std::memcmp(expected.data(), binary.data(), size) == 0;
+
+        const double scalar = BestSeconds(rounds, [&]
+        {
+            reused.resize(BASE64_DECODE_OUT_SIZE(encoded.size()));
+            reused.resize(Base64Decode(encoded.data(), encoded.size(), reused.data()));
+        });
+        ok &= reused.size() == size && std::memcmp(reused.data(), expected.data(), size) == 0;
+
+        const double fast = BestSeconds(rounds, [&]
+        {
+            reused.resize(BASE64_DECODE_OUT_SIZE(encoded.size()));
+            reused.resize(Base64DecodeFast(encoded.data(), encoded.size(), reused.data()));
+        });
+        ok &= reused.size() == size && std::memcmp(reused.data(), expected.data(), size) == 0;
+
+        const double encoded_mb = static_cast<double>(encoded.size()) / (1024 * 1024);
+        std::cout << mb << "\t\t" << encoded_mb / copy_scalar
+                  << "\t\t" << encoded_mb / scalar
+                  << "\t\t" << encoded_mb / fast << "\n";
+    }
+
+    std::cout << (ok ? "outputs match\n" : "OUTPUT MISMATCH\n");
+    return ok ? 0 : 1;
+}
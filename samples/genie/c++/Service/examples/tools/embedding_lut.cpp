@@ -0,0 +1,64 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+/*
+ * Compress a float32 token -> embedding LUT into the fp16 or int8 format of EmbeddingTable.
+ * The service and GenieContext.SetEmbeddingTable() take the output in place of the raw file.
+ * usage: embedding_lut <float32 lut> <output> <fp16|int8> <embedding dim>
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "EmbeddingTable.hpp"
+
+int main(int argc, char **argv)
+{
+    if (argc != 5)
+    {
+        std::cerr << "usage: " << argv[0] << " <float32 lut> <output> <fp16|int8> <embedding dim>\n";
+        return 1;
+    }
+
+    const std::string format{argv[3]};
+    if (format != "fp16" && format != "int8")
+    {
+        std::cerr << "format must be fp16 or int8\n";
+        return 1;
+    }
+    const size_t cols = std::strtoull(argv[4], nullptr, 10);
+
+    std::ifstream in(argv[1], std::ios::binary | std::ios::ate);
+    if (!in)
+    {
+        std::cerr << "failed to open " << argv[1] << "\n";
+        return 1;
+    }
+    const size_t bytes = static_cast<size_t>(in.tellg());
+    if (cols == 0 || bytes % (cols * sizeof(float)) != 0)
+    {
+        std::cerr << argv[1] << " is not a float32 table of " << cols << " wide rows\n";
+        return 1;
+    }
+    std::vector<float> table(bytes / sizeof(float));
+    in.seekg(0);
+    in.read(reinterpret_cast<char *>(table.data()), bytes);
+
+    std::string error;
+    const auto type = format == "fp16" ? EmbeddingTable::Format::Float16 : EmbeddingTable::Format::Int8;
+    if (!EmbeddingTable::compress(table.data(), table.size() / cols, cols, type, argv[2], error))
+    {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    std::cout << table.size() / cols << " rows written to " << argv[2] << "\n";
+    return 0;
+}
@@ -0,0 +1,181 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+/*
+ * Prompt embedding throughput of the token -> embedding LUT:
+ *   heap:  the file read into a vector and the rows copied out, as the service did before EmbeddingTable.
+ *   raw:   the same file mapped, rows copied out of the mapping.
+ *   fp16:  the compressed table, rows dequantized on lookup.
+ *   int8:  the same with one scale per row.
+ * load is the time to get a table ready, heap the private memory it costs every process.
+ * usage: embedding_lut_bench [rows=151936] [cols=1536] [prompt_tokens=4096] [rounds=5]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "EmbeddingTable.hpp"
+
+namespace fs = std::filesystem;
+
+using Clock = std::chrono::steady_clock;
+
+static double Seconds(Clock::time_point begin)
+{
+    return std::chrono::duration<double>(Clock::now() - begin).count();
+}
+
+struct Result
+{
+    double load = 0;
+    double seconds = 1e30;
+    size_t heap = 0;
+    float max_error = 0;
+};
+
+template<typename Lookup>
+static void Run(Result &result,
+                int rounds,
+                const std::vector<int32_t> &prompt,
+                size_t cols,
+                const std::vector<float> &table,
+                Lookup &&lookup)
+{
+    std::vector<float> embedded(prompt.size() * cols);
+    for (int r = 0; r < rounds; ++r)
+    {
+        auto begin = Clock::now();
+        for (size_t i = 0; i < prompt.size(); ++i)
+        {
+            if (!lookup(prompt[i], &embedded[i * cols]))
+            {
+                std::cerr << "lookup of token " << prompt[i] << " failed\n";
+                std::exit(1);
+            }
+        }
+        result.seconds = std::min(result.seconds, Seconds(begin));
+    }
+
+    for (size_t i = 0; i < prompt.size(); ++i)
+    {
+        const float *expected = &table[prompt[i] * cols];
+        for (size_t c = 0; c < cols; ++c)
+        {
+            result.max_error = std::max(result.max_error, std::fabs(embedded[i * cols + c] - expected[c]));
+        }
+    }
+}
+
+static void Print(const char *name, const Result &result, size_t tokens, size_t file_bytes)
+{
+    std::cout << name << ": load " << result.load * 1000 << " ms, "
+              << tokens / result.seconds / 1e6 << " M tokens/s, "
+              << "file " << file_bytes / (1024.0 * 1024) << " MB, "
+              << "heap " << result.heap / (1024.0 * 1024) << " MB, "
+              << "max error " << result.max_error << "\n";
+}
+
+int main(int argc, char **argv)
+{
+    const size_t rows = argc > 1 ? std::max(1, std::atoi(argv[1])) : 151936;
+    const size_t cols = argc > 2 ? std::max(1, std::atoi(argv[2])) : 1536;
+    const size_t tokens = argc > 3 ? std::max(1, std::atoi(argv[3])) : 4096;
+    const int rounds = argc > 4 ? std::max(1, std::atoi(argv[4])) : 5;
+
+    // the rows of a real table differ in magnitude, so do these.
+    std::mt19937 rng{7};
+    std::normal_distribution<float> normal{0.0f, 1.0f};
+    std::uniform_real_distribution<float> magnitude{0.005f, 0.1f};
+    std::vector<float> table(rows * cols);
+    for (size_t r = 0; r < rows; ++r)
+    {
+        const float scale = magnitude(rng);
+        for (size_t c = 0; c < cols; ++c)
+        {
+            table[r * cols + c] = normal(rng) * scale;
+        }
+    }
+    std::uniform_int_distribution<int32_t> token{0, static_cast<int32_t>(rows - 1)};
+    std::vector<int32_t> prompt(tokens);
+    for (auto &t: prompt)
+    {
+        t = token(rng);
+    }
+
+    const fs::path dir = fs::temp_directory_path();
+    const std::string raw_path = (dir / "embedding_lut_bench.raw").string();
+    const std::string fp16_path = (dir / "embedding_lut_bench.fp16").string();
+    const std::string int8_path = (dir / "embedding_lut_bench.int8").string();
+    {
+        std::ofstream out(raw_path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(table.data()), table.size() * sizeof(float));
+    }
+    std::string error;
+    if (!EmbeddingTable::compress(table.data(), rows, cols, EmbeddingTable::Format::Float16, fp16_path, error) ||
+        !EmbeddingTable::compress(table.data(), rows, cols, EmbeddingTable::Format::Int8, int8_path, error))
+    {
+        std::cerr << error << "\n";
+        return 1;
+    }
+
+    const size_t row_bytes = cols * sizeof(float);
+    std::cout << rows << " x " << cols << " table, " << tokens << " prompt tokens, " << rounds << " rounds\n";
+
+    {
+        Result result;
+        auto begin = Clock::now();
+        std::ifstream in(raw_path, std::ios::binary | std::ios::ate);
+        std::vector<uint8_t> heap(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        in.read(reinterpret_cast<char *>(heap.data()), heap.size());
+        result.load = Seconds(begin);
+        result.heap = heap.size();
+        Run(result, rounds, prompt, cols, table, [&](int32_t t, float *dst)
+        {
+            if ((t + 1) * row_bytes > heap.size())
+            {
+                return false;
+            }
+            std::copy(heap.data() + t * row_bytes, heap.data() + (t + 1) * row_bytes, reinterpret_cast<uint8_t *>(dst));
+            return true;
+        });
+        Print("heap", result, tokens, heap.size());
+    }
+
+    const std::pair<const char *, std::string> mapped[] = {{"raw ", raw_path}, {"fp16", fp16_path}, {"int8", int8_path}};
+    for (const auto &[name, path]: mapped)
+    {
+        Result result;
+        EmbeddingTable lut;
+        auto begin = Clock::now();
+        if (!lut.open(path, error))
+        {
+            std::cerr << error << "\n";
+            return 1;
+        }
+        result.load = Seconds(begin);
+        Run(result, rounds, prompt, cols, table, [&](int32_t t, float *dst)
+        {
+            return lut.lookup(t, dst, row_bytes);
+        });
+        Print(name, result, tokens, lut.mappedBytes());
+    }
+
+    fs::remove(raw_path);
+    fs::remove(fp16_path);
+    fs::remove(int8_path);
+    return 0;
+}
@@ -0,0 +1,298 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+/*
+ * Check the fused vision preprocessing against the unfused reference chains, bit for bit, and time both.
+ * usage: image_preprocess_check [image_file] [rounds=5]
+ * without an image file, synthetic 3840x2160 RGB / RGBA / gray / gray+alpha images are used.
+ */
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#define STB_IMAGE_RESIZE2_IMPLEMENTATION
+
+#include <stb_image.h>
+#include <stb_image_resize2.h>
+#include <stb_image_write.h>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "qwen2_5/qwen25_image_processor.hpp"
+#include "torch_helper/shape_6d.h"
+#include "torch_helper/shape_5d.h"
+#include "torch_helper/shape_4d.h"
+#include "torch_helper/shape_3d.h"
+#include "torch_helper/img.h"
+#include "torch_helper/img_preprocess.h"
+
+using Clock = std::chrono::steady_clock;
+
+static double Ms(Clock::time_point begin)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+template<typename T>
+static bool Same(const std::vector<T> &a, const std::vector<T> &b)
+{
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+static void AppendPng(void *context, void *data, int size)
+{
+    auto *out = static_cast<std::vector<uint8_t> *>(context);
+    out->insert(out->end(), static_cast<uint8_t *>(data), static_cast<uint8_t *>(data) + size);
+}
+
+static std::vector<uint8_t> SyntheticPng(int w, int h, int channels)
+{
+    std::vector<uint8_t> pixels(static_cast<size_t>(w) * h * channels);
+    uint32_t seed = 12345;
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < w; ++x)
+        {
+            for (int c = 0; c < channels; ++c)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                int v = (x * (c + 1) + y * (3 - c)) / 7 + static_cast<int>(seed >> 28);
+                pixels[(static_cast<size_t>(y) * w + x) * channels + c] = static_cast<uint8_t>(v);
+            }
+        }
+    }
+
+    std::vector<uint8_t> png;
+    stbi_write_png_to_func(AppendPng, &png, w, h, channels, pixels.data(), w * channels);
+    return png;
+}
+
+// ---- the PHI4 reference chain, as it was before the fused passes ----
+static Image ReferencePad(const Image &in, int pad_right, int pad_bottom)
+{
+    const std::vector<float> fill = {255.0f, 255.0f, 255.0f};
+    int dst_w = in.w + pad_right, dst_h = in.h + pad_bottom, channels = in.c;
+    int size = dst_w * dst_h * channels;
+    float *dst = new float[size];
+    for (int y = 0; y < dst_h; ++y)
+    {
+        for (int x = 0; x < dst_w; ++x)
+        {
+            size_t base = (static_cast<size_t>(y) * dst_w + x) * channels;
+            for (int c = 0; c < channels; ++c)
+            {
+                dst[base + c] = fill[c];
+            }
+        }
+    }
+    for (int y = 0; y < in.h; ++y)
+    {
+        for (int x = 0; x < in.w; ++x)
+        {
+            std::memcpy(&dst[(static_cast<size_t>(y) * dst_w + x) * channels],
+                        &in.point[(static_cast<size_t>(y) * in.w + x) * channels],
+                        static_cast<size_t>(channels) * sizeof(float));
+        }
+    }
+    return {dst_w, dst_h, 3, dst, size};
+}
+
+static Shape_3D<float> ReferenceToTensor(const Image &img)
+{
+    size_t np = static_cast<size_t>(img.w) * img.h;
+    std::vector<float> chw(3 * np);
+    for (size_t i = 0; i < np; ++i)
+    {
+        chw[0 * np + i] = img.point[i * 3 + 0];
+        chw[1 * np + i] = img.point[i * 3 + 1];
+        chw[2 * np + i] = img.point[i * 3 + 2];
+    }
+    return Shape_3D<float>{3, img.h, img.w, chw};
+}
+
+static Image Resize(const float *pixels, int w, int h, int tar_w, int tar_h)
+{
+    Image out{tar_w, tar_h, 3, new float[tar_w * tar_h * 3], tar_w * tar_h * 3};
+    if (!stbir_quick_resize_helper(pixels, w, h, 0, out.point, tar_w, tar_h, 0,
+                                   STBIR_RGB, STBIR_TYPE_FLOAT, STBIR_EDGE_REFLECT, STBIR_FILTER_MITCHELL))
+    {
+        throw std::runtime_error("resize img failed");
+    }
+    return out;
+}
+
+static bool CheckQwen(const std::vector<uint8_t> &png, int rounds)
+{
+    qwen2_5::Qwen25ImageProcessor proc;
+    std::vector<float> ref, fused;
+    int ref_rows = 0, ref_cols = 0, rows = 0, cols = 0;
+    auto *data = const_cast<uint8_t *>(png.data());
+
+    auto begin = Clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        proc.ProcessToBufferReference(data, png.size(), 640, 640, ref, ref_rows, ref_cols);
+    }
+    double ref_ms = Ms(begin) / rounds;
+
+    begin = Clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        proc.ProcessToBuffer(data, png.size(), 640, 640, fused, rows, cols);
+    }
+    double fused_ms = Ms(begin) / rounds;
+
+    bool same = rows == ref_rows && cols == ref_cols && Same(ref, fused);
+    std::cout << "  qwen2.5-vl: reference " << ref_ms << " ms, fused " << fused_ms << " ms, "
+              << (same ? "identical" : "MISMATCH") << "\n";
+
+    // where the fused time goes, the resize of a large image dominates once decode is excluded.
+    double decode_ms = 0, resize_ms = 0, patchify_ms = 0;
+    std::vector<uint8_t> rgb_arena, resized;
+    auto [rh, rw] = qwen2_5::Qwen25ImageProcessor::SmartResizeOnly(640, 640);
+    for (int r = 0; r < rounds; ++r)
+    {
+        begin = Clock::now();
+        img_preprocess::DecodedRGB rgb{png.data(), png.size(), rgb_arena};
+        decode_ms += Ms(begin);
+
+        begin = Clock::now();
+        resized.resize(static_cast<size_t>(rw) * rh * 3);
+        stbir_resize_uint8_linear(rgb.data(), rgb.w, rgb.h, 0, resized.data(), rw, rh, 0, STBIR_RGB);
+        resize_ms += Ms(begin);
+
+        begin = Clock::now();
+        img_preprocess::NormalizePatchify(resized.data(), rh, rw, qwen2_5::Qwen25ImageProcessor::MEAN,
+                                          qwen2_5::Qwen25ImageProcessor::STD,
+                                          qwen2_5::Qwen25ImageProcessor::PATCH_SIZE,
+                                          qwen2_5::Qwen25ImageProcessor::MERGE_SIZE,
+                                          qwen2_5::Qwen25ImageProcessor::TEMPORAL_PATCH_SIZE,
+                                          fused, rows, cols);
+        patchify_ms += Ms(begin);
+    }
+    std::cout << "    fused stages: decode " << decode_ms / rounds << " ms, resize to " << rw << "x" << rh << " "
+              << resize_ms / rounds << " ms, normalize + patchify " << patchify_ms / rounds << " ms\n";
+    return same;
+}
+
+static bool CheckPhi4(const std::vector<uint8_t> &png, int rounds)
+{
+    const int kSize = 448;
+    stbi_ldr_to_hdr_gamma(1.0f);
+    int w = 0, h = 0, comp = 0;
+    float *pixels = stbi_loadf_from_memory(png.data(), static_cast<int>(png.size()), &w, &h, &comp, STBIR_RGB);
+    if (!pixels)
+    {
+        std::cout << "  phi4: decode failed\n";
+        return false;
+    }
+
+    // a crop grid of up to 3x3 with the letterbox of PHI4Embedding::DynamicPreprocess.
+    int crop_w = std::min(3, (w + kSize - 1) / kSize);
+    int crop_h = std::min(3, (h + kSize - 1) / kSize);
+    int tar_w = kSize * crop_w, tar_h = kSize * crop_h;
+    float ratio_w = float(tar_w) / w, ratio_h = float(tar_h) / h;
+    int new_w = ratio_w < ratio_h ? tar_w : int(w * ratio_h);
+    int new_h = ratio_w < ratio_h ? int(h * ratio_w) : tar_h;
+    Image resized = Resize(pixels, w, h, new_w, new_h);
+    stbi_image_free(pixels);
+
+    Shape_4D<float> ref;
+    auto begin = Clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        Image padded = ReferencePad(resized, tar_w - new_w, tar_h - new_h);
+        Shape_3D<float> hd = ReferenceToTensor(padded);
+        Image global = Resize(padded.point, padded.w, padded.h, kSize, kSize);
+        Shape_3D<float> global3 = ReferenceToTensor(global);
+        Shape_4D<float> global4{1, global3.d0, global3.d1, global3.d2, global3.buf};
+        Shape_6D<float> hd6 = reshape_3d_to_6d(hd, 1, 3, crop_h, kSize, crop_w, kSize);
+        hd6 = permute_shape6d(hd6, {0, 2, 4, 1, 3, 5});
+        ref = concat_shape4d(global4, reshape_6d_to_4d(hd6, -1, 3, kSize, kSize), 0);
+        delete[] padded.point;
+        delete[] global.point;
+    }
+    double ref_ms = Ms(begin) / rounds;
+
+    Shape_4D<float> fused;
+    begin = Clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        Image padded{tar_w, tar_h, 3, new float[tar_w * tar_h * 3], tar_w * tar_h * 3};
+        img_preprocess::PadHWC(resized.point, new_w, new_h, 3, tar_w - new_w, tar_h - new_h, 255.0f, padded.point);
+        const size_t plane = 3 * static_cast<size_t>(kSize) * kSize;
+        const int crops = 1 + crop_h * crop_w;
+        fused = {crops, 3, kSize, kSize, std::vector<float>(plane * crops)};
+        Image global = Resize(padded.point, padded.w, padded.h, kSize, kSize);
+        img_preprocess::RegionToCHW(global.point, kSize, 0, 0, kSize, kSize, fused.buf.data());
+        for (int cy = 0; cy < crop_h; ++cy)
+        {
+            for (int cx = 0; cx < crop_w; ++cx)
+            {
+                img_preprocess::RegionToCHW(padded.point, tar_w, cx * kSize, cy * kSize, kSize, kSize,
+                                            fused.buf.data() + (1 + cy * crop_w + cx) * plane);
+            }
+        }
+        delete[] padded.point;
+        delete[] global.point;
+    }
+    double fused_ms = Ms(begin) / rounds;
+    delete[] resized.point;
+
+    bool same = ref.d0 == fused.d0 && Same(ref.buf, fused.buf);
+    std::cout << "  phi4 " << crop_w << "x" << crop_h << " crops: reference " << ref_ms << " ms, fused "
+              << fused_ms << " ms (after the shared decode and resize), " << (same ? "identical" : "MISMATCH") << "\n";
+    return same;
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 2 ? std::stoi(argv[2]) : 5;
+    if (rounds <= 0)
+    {
+        std::cout << "rounds must be positive\n";
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> images;
+    if (argc > 1)
+    {
+        std::ifstream in(argv[1], std::ios::binary);
+        if (!in.good())
+        {
+            std::cout << "open " << argv[1] << " failed\n";
+            return -1;
+        }
+        std::stringstream ss;
+        ss << in.rdbuf();
+        auto content = ss.str();
+        images.emplace_back(argv[1], std::vector<uint8_t>(content.begin(), content.end()));
+    }
+    else
+    {
+        images.emplace_back("3840x2160 rgb", SyntheticPng(3840, 2160, 3));
+        images.emplace_back("3840x2160 rgba", SyntheticPng(3840, 2160, 4));
+        images.emplace_back("1000x700 gray", SyntheticPng(1000, 700, 1));
+        images.emplace_back("1000x700 gray+alpha", SyntheticPng(1000, 700, 2));
+    }
+
+    bool ok = true;
+    for (const auto &[name, png]: images)
+    {
+        std::cout << name << ":\n";
+        ok = CheckQwen(png, rounds) && ok;
+        ok = CheckPhi4(png, rounds) && ok;
+    }
+    std::cout << (ok ? "all identical\n" : "MISMATCH found\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+/*
+ * Check the log-mel front end of the Qwen2.5-Omni audio input against the librosa based chain it replaced,
+ * and time both.
+ * usage: log_mel_check [padded_samples=4800000] [tolerance=1e-3]
+ */
+
+#include <librosa/librosa.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "log_mel.h"
+
+using Clock = std::chrono::steady_clock;
+
+static const int kSampleRate = 16000;
+static const int kFft = 400;
+static const int kHop = 160;
+static const int kMel = 128;
+static const size_t kChunk = 200;
+static const size_t kMaxChunks = 10;
+
+static double Ms(Clock::time_point begin)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+// ---- the chain Qwen2_5OMINI::BuildAudioInferredInput ran before, flattened ----
+static std::vector<float> Reference(std::vector<float> samples, size_t padded_size, size_t &stride)
+{
+    size_t size = samples.size();
+    samples.resize(padded_size);
+    for (size_t i = size - 1; i < samples.size(); ++i)
+    {
+        samples[i] = 0;
+    }
+
+    std::vector<int> mask;
+    for (size_t i = 0; i < samples.size(); i += kHop)
+    {
+        mask.push_back(i < size);
+    }
+
+    auto mel_spec = librosa::Feature::melspectrogram(samples, kSampleRate, kFft, kHop, "hann", true, "reflect",
+                                                     2.0f, kMel, 0, 8000);
+    mel_spec.pop_back();
+
+    float gmax = -std::numeric_limits<float>::infinity();
+    for (auto &row: mel_spec)
+    {
+        for (float &v: row)
+        {
+            if (!std::isfinite(v) || v < 1e-10f)
+                v = 1e-10f;
+            v = std::log10(v);
+            if (std::isfinite(v) && v > gmax)
+                gmax = v;
+        }
+    }
+    for (auto &row: mel_spec)
+    {
+        for (float &v: row)
+        {
+            if (std::isfinite(gmax) && (!std::isfinite(v) || v < gmax - 8.0f))
+                v = gmax - 8.0f;
+            v = (v + 4.0f) / 4.0f;
+        }
+    }
+
+    // keep the masked frames, mel major, split into chunks of 200 padded to the first chunk length
+    std::vector<std::vector<float>> features(kMel);
+    for (size_t t = 0; t < mel_spec.size(); ++t)
+    {
+        if (!mask[t])
+            continue;
+        for (int m = 0; m < kMel; ++m)
+            features[m].push_back(mel_spec[t][m]);
+    }
+    size_t frames = features[0].size();
+    size_t chunks = (frames + kChunk - 1) / kChunk;
+    if (chunks > kMaxChunks)
+        throw std::runtime_error("N > max_len_channels; cannot fit");
+    stride = std::min(frames, kChunk);
+
+    std::vector<float> out(kMaxChunks * kMel * stride, 0.0f);
+    for (size_t t = 0; t < frames; ++t)
+    {
+        for (int m = 0; m < kMel; ++m)
+            out[((t / kChunk) * kMel + m) * stride + t % kChunk] = features[m][t];
+    }
+    return out;
+}
+
+static std::vector<float> Speech(double seconds, uint32_t seed)
+{
+    std::mt19937 rng{seed};
+    std::normal_distribution<float> noise{0.0f, 0.02f};
+    std::vector<float> samples(static_cast<size_t>(seconds * kSampleRate));
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        double t = static_cast<double>(i) / kSampleRate;
+        double envelope = 0.5 + 0.5 * std::sin(2 * M_PI * 3.0 * t);
+        double voiced = 0.3 * std::sin(2 * M_PI * 180.0 * t) + 0.15 * std::sin(2 * M_PI * 720.0 * t)
+                        + 0.05 * std::sin(2 * M_PI * 3100.0 * t);
+        samples[i] = static_cast<float>(envelope * voiced) + noise(rng);
+    }
+    return samples;
+}
+
+int main(int argc, char **argv)
+{
+    size_t padded_size = argc > 1 ? std::stoul(argv[1]) : 4800000;
+    float tolerance = argc > 2 ? std::stof(argv[2]) : 1e-3f;
+
+    std::vector<std::pair<std::string, std::vector<float>>> inputs;
+    inputs.emplace_back("1.3 s speech", Speech(1.3, 1));
+    inputs.emplace_back("7.25 s speech", Speech(7.25, 2));
+    inputs.emplace_back("19.9 s speech", Speech(19.9, 3));
+    inputs.emplace_back("4 s silence", std::vector<float>(4 * kSampleRate, 0.0f));
+
+    LogMelSpectrogram front_end{kSampleRate, kFft, kHop, kMel, 0, 8000};
+    bool ok = true;
+    for (auto &[name, samples]: inputs)
+    {
+        size_t stride = 0;
+        auto begin = Clock::now();
+        auto ref = Reference(samples, padded_size, stride);
+        double ref_ms = Ms(begin);
+
+        begin = Clock::now();
+        std::vector<float> audio = samples;
+        audio.back() = 0;
+        std::vector<float> out(kMaxChunks * kMel * kChunk, 0.0f);
+        size_t frames = front_end.Compute(audio.data(), audio.size(), padded_size, {kChunk, stride}, out.data());
+        double ms = Ms(begin);
+
+        float diff = 0.0f;
+        for (size_t i = 0; i < ref.size(); ++i)
+        {
+            diff = std::max(diff, std::abs(ref[i] - out[i]));
+        }
+        for (size_t i = ref.size(); i < out.size(); ++i)
+        {
+            diff = std::max(diff, std::abs(out[i]));
+        }
+
+        bool pass = diff <= tolerance;
+        ok = ok && pass;
+        std::cout << name << ": " << frames << " frames, reference " << ref_ms << " ms, front end " << ms
+                  << " ms, max abs diff " << diff << (pass ? "" : "  FAILED") << "\n";
+    }
+    std::cout << (ok ? "all within tolerance\n" : "parity check failed\n");
+    return ok ? 0 : 1;
+}
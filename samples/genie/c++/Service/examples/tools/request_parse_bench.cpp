@@ -0,0 +1,131 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+/*
+ * Compare the two ways of taking the image out of a /v1/chat/completions body:
+ *   dom:  json::parse of the whole body, the data URL copied out of the DOM, cut after the comma and
+ *         copied again into the dispatcher, as the service did before ChatRequest.
+ *   view: ChatRequest::Parse, the payload is a view into the body.
+ * The peak is the heap in use on top of the body while the request is handled.
+ * usage: request_parse_bench [image_mb=20] [rounds=5]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+
+#include "chat_request.h"
+
+static size_t g_in_use = 0;
+static size_t g_peak = 0;
+
+void *operator new(size_t size)
+{
+    auto *p = static_cast<size_t *>(std::malloc(size + sizeof(std::max_align_t)));
+    if (!p)
+    {
+        throw std::bad_alloc{};
+    }
+    *p = size;
+    g_in_use += size;
+    g_peak = std::max(g_peak, g_in_use);
+    return reinterpret_cast<char *>(p) + sizeof(std::max_align_t);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (!ptr)
+    {
+        return;
+    }
+    auto *p = reinterpret_cast<size_t *>(static_cast<char *>(ptr) - sizeof(std::max_align_t));
+    g_in_use -= *p;
+    std::free(p);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+struct Measure
+{
+    double seconds = 1e30;
+    size_t peak = 0;
+};
+
+template<typename Func>
+static Measure Run(int rounds, Func &&func)
+{
+    Measure m;
+    for (int i = 0; i < rounds; ++i)
+    {
+        const size_t base = g_in_use;
+        g_peak = base;
+        auto begin = std::chrono::steady_clock::now();
+        func();
+        auto end = std::chrono::steady_clock::now();
+        m.seconds = std::min(m.seconds, std::chrono::duration<double>(end - begin).count());
+        m.peak = std::max(m.peak, g_peak - base);
+    }
+    return m;
+}
+
+int main(int argc, char **argv)
+{
+    const size_t image_mb = argc > 1 ? std::max(1, std::atoi(argv[1])) : 20;
+    const int rounds = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::mt19937 rng{7};
+    std::string payload(image_mb * 1024 * 1024, '\0');
+    for (auto &c: payload)
+    {
+        c = alphabet[rng() % 64];
+    }
+
+    const std::string body = R"({"model": "qwen2.5vl3b", "stream": true, "temperature": 0.7, "messages": [)"
+                             R"({"role": "system", "content": "You are a helpful assistant."},)"
+                             R"({"role": "user", "content": [{"type": "text", "text": "What is in the image?"},)"
+                             R"({"type": "image_url", "image_url": {"url": "data:image/png;base64,)" + payload +
+                             R"("}}]}]})";
+
+    size_t dom_size = 0;
+    const Measure dom = Run(rounds, [&]
+    {
+        json data = json::parse(body, nullptr, false);
+        auto img = data["messages"][1]["content"][1]["image_url"]["url"].get<std::string>();
+        std::string image = img.substr(img.find(',') + 1);
+        std::string dispatched = image;
+        dom_size = dispatched.size();
+    });
+
+    size_t view_size = 0;
+    const Measure view = Run(rounds, [&]
+    {
+        ChatRequest request;
+        request.Parse(body);
+        std::string_view url;
+        if (request.Payload(request.data["messages"][1]["content"][1]["image_url"]["url"], url))
+        {
+            view_size = url.substr(url.find(',') + 1).size();
+        }
+    });
+
+    std::cout << "body " << body.size() / (1024.0 * 1024) << " MB, " << rounds << " rounds\n"
+              << "dom:  " << dom.seconds * 1000 << " ms, peak " << dom.peak / (1024.0 * 1024) << " MB\n"
+              << "view: " << view.seconds * 1000 << " ms, peak " << view.peak / 1024.0 << " KB\n";
+
+    const bool ok = dom_size == payload.size() && view_size == payload.size();
+    std::cout << (ok ? "payloads match\n" : "PAYLOAD MISMATCH\n");
+    return ok ? 0 : 1;
+}
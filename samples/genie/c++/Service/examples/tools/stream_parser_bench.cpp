@@ -0,0 +1,119 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+/*
+ * Replay a recorded model output through the stream processors, the same way ResponseDispatcher does,
+ * and report the throughput.
+ * usage: stream_parser_bench [recorded_output.txt] [chunk_bytes=4] [rounds=20]
+ * without a recorded file, a long synthetic harmony / tool call stream is used.
+ */
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "harmony.h"
+#include "general.h"
+
+static std::string SyntheticHarmony(size_t reasoning_bytes)
+{
+    std::string sentence = "Let me think about the <b>problem</b> step by step, x < y and y > z. ";
+    std::string out = "<|start|>assistant<|channel|>analysis<|message|>";
+    while (out.size() < reasoning_bytes)
+    {
+        out += sentence;
+    }
+    out += "<|end|><|start|>assistant<|channel|>final<|message|>";
+    for (int i = 0; i < 64; ++i)
+    {
+        out += sentence;
+    }
+    out += "<|return|>";
+    return out;
+}
+
+static std::string SyntheticGeneral(size_t reasoning_bytes)
+{
+    std::string sentence = "The value of a < b is checked before <tool call> is issued. ";
+    std::string out;
+    while (out.size() < reasoning_bytes)
+    {
+        out += sentence;
+    }
+    out += R"(<tool_call>{"name": "get_weather", "arguments": {"city": "Beijing"}}</tool_call>)";
+    return out;
+}
+
+template<typename Processor>
+static void Replay(const char *name, const std::string &stream, size_t chunk_bytes, int rounds)
+{
+    Processor proc;
+    size_t output_bytes = 0;
+    bool tool = false;
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r)
+    {
+        proc.Clean();
+        std::string toolResponse;
+        bool isToolResponse = false;
+        for (size_t pos = 0; pos < stream.size(); pos += chunk_bytes)
+        {
+            std::string chunk = stream.substr(pos, chunk_bytes);
+            auto result = proc.PreProcessStream(chunk, isToolResponse, toolResponse);
+            isToolResponse = std::get<0>(result);
+            output_bytes += std::get<1>(result).size();
+        }
+        output_bytes += proc.Flush().size();
+        tool = isToolResponse;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    double mb = static_cast<double>(stream.size()) * rounds / (1024.0 * 1024.0);
+    std::cout << name << ": " << mb / seconds << " MB/s, "
+              << seconds * 1000 / rounds << " ms per stream, "
+              << output_bytes / rounds << " bytes out, tool call: " << (tool ? "yes" : "no") << "\n";
+}
+
+int main(int argc, char **argv)
+{
+    size_t chunk_bytes = argc > 2 ? std::stoul(argv[2]) : 4;
+    int rounds = argc > 3 ? std::stoi(argv[3]) : 20;
+    if (!chunk_bytes || rounds <= 0)
+    {
+        std::cout << "chunk_bytes and rounds must be positive\n";
+        return 1;
+    }
+
+    std::string harmony_stream, general_stream;
+    if (argc > 1)
+    {
+        std::ifstream in(argv[1], std::ios::binary);
+        if (!in.good())
+        {
+            std::cout << "open " << argv[1] << " failed\n";
+            return -1;
+        }
+        std::stringstream ss;
+        ss << in.rdbuf();
+        harmony_stream = general_stream = ss.str();
+    }
+    else
+    {
+        harmony_stream = SyntheticHarmony(4 * 1024 * 1024);
+        general_stream = SyntheticGeneral(4 * 1024 * 1024);
+    }
+
+    std::cout << "chunk: " << chunk_bytes << " bytes, rounds: " << rounds << "\n";
+    Replay<HarmonyProcessor>("harmony", harmony_stream, chunk_bytes, rounds);
+    Replay<GeneralProcessor>("general", general_stream, chunk_bytes, rounds);
+    return 0;
+}
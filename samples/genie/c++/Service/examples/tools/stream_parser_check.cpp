@@ -0,0 +1,108 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+/*
+ * Feed model outputs through the stream processors in 1 to 8 byte chunks, the way ResponseDispatcher does,
+ * and check the forwarded text and the tool call match what a single chunk gives.
+ * usage: stream_parser_check
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "harmony.h"
+#include "general.h"
+
+struct Output
+{
+    std::string text;
+    std::string tool;
+    bool is_tool{};
+};
+
+template<typename Processor>
+static Output Feed(const std::string &stream, size_t chunk_bytes)
+{
+    Processor proc;
+    Output out;
+    for (size_t pos = 0; pos < stream.size(); pos += chunk_bytes)
+    {
+        std::string chunk = stream.substr(pos, chunk_bytes);
+        auto result = proc.PreProcessStream(chunk, out.is_tool, out.tool);
+        out.is_tool = std::get<0>(result);
+        out.text += std::get<1>(result);
+    }
+    out.text += proc.Flush();
+    return out;
+}
+
+template<typename Processor>
+static bool Check(const char *name, const std::string &stream, const Output *expected)
+{
+    Output reference = Feed<Processor>(stream, stream.size());
+    if (expected && (reference.text != expected->text || reference.tool != expected->tool ||
+                     reference.is_tool != expected->is_tool))
+    {
+        std::cout << name << ": single chunk  FAILED\n  text: " << reference.text << "\n  tool: " << reference.tool
+                  << "\n";
+        return false;
+    }
+
+    for (size_t chunk_bytes = 1; chunk_bytes <= 8; ++chunk_bytes)
+    {
+        Output out = Feed<Processor>(stream, chunk_bytes);
+        if (out.text != reference.text || out.tool != reference.tool || out.is_tool != reference.is_tool)
+        {
+            std::cout << name << ": " << chunk_bytes << " byte chunks  FAILED\n  text: " << out.text
+                      << "\n  tool: " << out.tool << "\n";
+            return false;
+        }
+    }
+    std::cout << name << ": ok\n";
+    return true;
+}
+
+int main()
+{
+    const std::string call = R"(<tool_call>{"name": "get_weather", "arguments": {"city": "Beijing"}}</tool_call>)";
+    const std::vector<std::pair<const char *, std::string>> plain = {
+            {"general plain", "The value of a < b is checked before <tool call> is issued, <tool_cal"},
+            {"general empty", ""},
+    };
+    const std::vector<std::pair<const char *, std::string>> tools = {
+            {"general tool call", "Checking a < b first. " + call},
+            {"general tool call only", call},
+            {"general tool call prefix", "<<tool_<tool_call>" + call.substr(11)},
+            {"general tool call twice", "x" + call + "\n" + call},
+    };
+
+    bool ok = true;
+    for (auto &[name, stream]: plain)
+    {
+        Output expected{stream, "", false};
+        ok = Check<GeneralProcessor>(name, stream, &expected) && ok;
+    }
+    for (auto &[name, stream]: tools)
+    {
+        // the whole stream is forwarded, the tool call is everything from the first tag on.
+        Output expected{stream, stream.substr(stream.find("<tool_call>")), true};
+        ok = Check<GeneralProcessor>(name, stream, &expected) && ok;
+    }
+
+    const std::string harmony = "<|start|>assistant<|channel|>analysis<|message|>x < y and <|e ok<|end|>"
+                                "<|start|>assistant<|channel|>final<|message|>The answer is <b>42</b>.<|return|>";
+    const std::string harmony_call = "<|start|>assistant<|channel|>analysis<|message|>need the weather<|end|>"
+                                     "<|start|>functions.get_weather<|channel|>commentary json<|message|>"
+                                     R"({"city": "Beijing"}<|call|>)";
+    ok = Check<HarmonyProcessor>("harmony", harmony, nullptr) && ok;
+    ok = Check<HarmonyProcessor>("harmony tool call", harmony_call, nullptr) && ok;
+
+    std::cout << (ok ? "all chunkings agree\n" : "stream check failed\n");
+    return ok ? 0 : 1;
+}
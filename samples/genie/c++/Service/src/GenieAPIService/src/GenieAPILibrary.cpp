@@ -16,6 +16,7 @@
 #include "utils.h"
 #include <thread>
 #include <mutex>
+#include <shared_mutex>
 #include <sstream>
 #include <ctime>
 #include <filesystem>
@@ -36,7 +37,7 @@ public:
     std::unique_ptr<std::thread> load_thread_;
     std::string last_error;
     std::mutex mutex;
-    std::mutex inference_mutex;
+    std::shared_mutex inference_mutex;
     std::mutex load_mutex;
     std::condition_variable load_cv;
     bool load_done = false;
@@ -54,8 +55,6 @@ public:
     // Model management components
     std::unique_ptr<ModelManager> model_manager;
     std::unique_ptr<ChatHistory> chat_history;
-    std::unique_ptr<ResponseDispatcher> response_dispatcher;
-    std::unique_ptr<ModelInputBuilder> input_builder;
     
     // Configuration
     std::string config_file;
@@ -103,15 +102,9 @@ public:
             // We'll set the necessary fields directly
             model_manager->config_file_ = config_file;
             
-            // Create chat history
+            // Create chat history, each generation builds its input and dispatches its response on its own
             chat_history = std::make_unique<ChatHistory>(*model_manager);
             
-            // Create response dispatcher
-            response_dispatcher = std::make_unique<ResponseDispatcher>(*model_manager, *chat_history);
-            
-            // Create input builder
-            input_builder = std::make_unique<ModelInputBuilder>(*chat_history, *model_manager);
-            
             return true;
             
         } catch (const std::exception& e) {
@@ -119,6 +112,23 @@ public:
             return false;
         }
     }
+
+    /*
+     * A context batching concurrent queries (llama.cpp) is queried beside the other generations under the shared
+     * lock, any other one under the exclusive lock.
+     */
+    std::shared_ptr<ContextBase> LockForGeneration(std::shared_lock<std::shared_mutex>& shared,
+                                                   std::unique_lock<std::shared_mutex>& exclusive) {
+        shared = std::shared_lock<std::shared_mutex>(inference_mutex);
+        auto handle = model_manager->get_genie_model_handle().lock();
+        if (handle && handle->SupportConcurrentQuery()) {
+            return handle;
+        }
+        handle = nullptr;
+        shared.unlock();
+        exclusive = std::unique_lock<std::shared_mutex>(inference_mutex);
+        return model_manager->get_genie_model_handle().lock();
+    }
 };
 
 // api_interface implementation
@@ -161,7 +171,7 @@ bool api_interface::api_loadmodel(const std::string& model_path, std::vector<std
     }
     
     try {
-        std::lock_guard<std::mutex> lock(impl_->inference_mutex);
+        std::lock_guard<std::shared_mutex> lock(impl_->inference_mutex);
         status = loading;
         impl_->current_status = loading;
         
@@ -192,9 +202,7 @@ bool api_interface::api_loadmodel(const std::string& model_path, std::vector<std
                 return false;
             }
             
-            if (impl_->response_dispatcher) {
-                impl_->response_dispatcher->ResetProcessor();
-            }
+            impl_->chat_history->Clear();
         } else {
             // Using file path config - call LoadModelByName
             bool first_load = false;
@@ -207,8 +215,8 @@ bool api_interface::api_loadmodel(const std::string& model_path, std::vector<std
                 return false;
             }
             
-            if (first_load && impl_->response_dispatcher) {
-                impl_->response_dispatcher->ResetProcessor();
+            if (first_load) {
+                impl_->chat_history->Clear();
             }
         }
         
@@ -255,12 +263,12 @@ bool api_interface::api_loadmodel_async(const std::string& model_path, std::vect
     impl_->load_thread_ = std::make_unique<std::thread>([this, mp, hw]() {
         bool result = false;
         try {
-            std::lock_guard<std::mutex> lock(impl_->inference_mutex);
+            std::lock_guard<std::shared_mutex> lock(impl_->inference_mutex);
             bool first_load = false;
             result = impl_->model_manager->LoadModelByName(mp, first_load);
             if (result) {
-                if (first_load && impl_->response_dispatcher) {
-                    impl_->response_dispatcher->ResetProcessor();
+                if (first_load) {
+                    impl_->chat_history->Clear();
                 }
                 impl_->model_loaded = true;
                 this->status = ::loaded;
@@ -342,7 +350,7 @@ bool api_interface::api_unloadmodel() {
     }
     
     try {
-        std::lock_guard<std::mutex> lock(impl_->inference_mutex);
+        std::lock_guard<std::shared_mutex> lock(impl_->inference_mutex);
         
         impl_->model_manager->UnloadModel();
         impl_->model_loaded = false;
@@ -371,33 +379,30 @@ std::string api_interface::api_Generate(const std::string& prompt) {
     }
     
     try {
-        std::lock_guard<std::mutex> lock(impl_->inference_mutex);
+        std::shared_lock<std::shared_mutex> shared_lock;
+        std::unique_lock<std::shared_mutex> lock;
+        auto model_handle = impl_->LockForGeneration(shared_lock, lock);
         
         status = inference;
         impl_->current_status = inference;
         impl_->generate_status = generating;
         
-        auto model_handle = impl_->model_manager->get_genie_model_handle().lock();
         if (!model_handle) {
             impl_->last_error = "Model context unavailable";
             impl_->generate_status = failed;
             return build_response_json("", prompt, false, false);
         }
         
-        // Build JSON request
-        json request_data;
+        // Build JSON request, the attachments of a JSON prompt stay in `prompt`
+        ChatRequest request;
+        json& request_data = request.data;
         
         // Try to parse prompt as JSON first
-        bool parsed_json = false;
-        try {
-            request_data = json::parse(prompt);
-            parsed_json = true;
-        } catch (...) {
-            // Prompt is not JSON, will build request from plain text
-        }
+        bool parsed_json = request.Parse(prompt);
         
         // If not JSON, build request from plain text
         if (!parsed_json) {
+            request_data = json::object();
             request_data["messages"] = json::array();
             json message;
             message["role"] = "user";
@@ -413,20 +418,24 @@ std::string api_interface::api_Generate(const std::string& prompt) {
         
         request_data["stream"] = false;
         
-        // Set parameters
-        model_handle->SetParamsByConfig(request_data);
+        // Set parameters, the sampler config is shared by the generations beside each other
+        if (lock.owns_lock()) {
+            model_handle->SetParamsByConfig(request_data);
+        }
         
         // Build model input
         bool is_tool = false;
-        auto& model_input = impl_->input_builder->Build(request_data, is_tool);
+        ModelInputBuilder input_builder(*impl_->chat_history, *impl_->model_manager);
+        auto& model_input = input_builder.Build(request, is_tool);
         
         // Prepare response dispatcher
         httplib::Request dummy_req;
-        impl_->response_dispatcher->Prepare(model_input, is_tool, false, dummy_req, true);
+        ResponseDispatcher response_dispatcher(*impl_->model_manager, *impl_->chat_history);
+        response_dispatcher.Prepare(model_input, is_tool, false, dummy_req, true);
         
         // Perform inference
         httplib::Response dummy_res;
-        if (!impl_->response_dispatcher->SendResponse(0, nullptr, &dummy_res)) {
+        if (!response_dispatcher.SendResponse(0, nullptr, &dummy_res)) {
             impl_->last_error = "Inference failed";
             impl_->generate_status = failed;
             status = loaded;
@@ -457,33 +466,32 @@ std::string api_interface::api_Generate(const std::string& prompt, std::function
     }
     
     try {
-        std::lock_guard<std::mutex> lock(impl_->inference_mutex);
+        std::shared_lock<std::shared_mutex> shared_lock;
+        std::unique_lock<std::shared_mutex> lock;
+        auto model_handle = impl_->LockForGeneration(shared_lock, lock);
         status = inference;
         impl_->current_status = inference;
         impl_->generate_status = generating;
-        impl_->stream_callback = callback;
+        if (lock.owns_lock()) {
+            impl_->stream_callback = callback;
+        }
         
-        auto model_handle = impl_->model_manager->get_genie_model_handle().lock();
         if (!model_handle) {
             impl_->last_error = "Model context unavailable";
             impl_->generate_status = failed;
             return build_response_json("", prompt, false, true);
         }
         
-        // Build JSON request
-        json request_data;
+        // Build JSON request, the attachments of a JSON prompt stay in `prompt`
+        ChatRequest request;
+        json& request_data = request.data;
         
         // Try to parse prompt as JSON first
-        bool parsed_json = false;
-        try {
-            request_data = json::parse(prompt);
-            parsed_json = true;
-        } catch (...) {
-            // Prompt is not JSON, will build request from plain text
-        }
+        bool parsed_json = request.Parse(prompt);
         
         // If not JSON, build request from plain text
         if (!parsed_json) {
+            request_data = json::object();
             request_data["messages"] = json::array();
             json message;
             message["role"] = "user";
@@ -497,13 +505,17 @@ std::string api_interface::api_Generate(const std::string& prompt, std::function
         
         request_data["stream"] = true;
         
-        model_handle->SetParamsByConfig(request_data);
+        if (lock.owns_lock()) {
+            model_handle->SetParamsByConfig(request_data);
+        }
         
         bool is_tool = false;
-        auto& model_input = impl_->input_builder->Build(request_data, is_tool);
+        ModelInputBuilder input_builder(*impl_->chat_history, *impl_->model_manager);
+        auto& model_input = input_builder.Build(request, is_tool);
         
         httplib::Request dummy_req;
-        impl_->response_dispatcher->Prepare(model_input, is_tool, true, dummy_req, true);
+        ResponseDispatcher response_dispatcher(*impl_->model_manager, *impl_->chat_history);
+        response_dispatcher.Prepare(model_input, is_tool, true, dummy_req, true);
         
         httplib::DataSink sink;
         sink.write = [callback](const char* data, size_t data_len) -> bool {
@@ -512,7 +524,7 @@ std::string api_interface::api_Generate(const std::string& prompt, std::function
         sink.is_writable = []() -> bool { return true; };
         sink.done = []() {};
         
-        impl_->response_dispatcher->SendResponse(0, &sink, nullptr);
+        response_dispatcher.SendResponse(0, &sink, nullptr);
         
         impl_->generate_status = completed;
         status = loaded;
@@ -535,7 +547,7 @@ void api_interface::api_Reset() {
     }
     
     try {
-        std::lock_guard<std::mutex> lock(impl_->inference_mutex);
+        std::lock_guard<std::shared_mutex> lock(impl_->inference_mutex);
         impl_->chat_history->Clear();
         status = loaded;
         impl_->current_status = loaded;
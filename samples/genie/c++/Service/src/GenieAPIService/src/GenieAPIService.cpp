@@ -26,6 +26,13 @@ public:
             func_{func},
             http_block_check_{http_block_check} {}
 
+    // the body is handed to the handler while it arrives, e.g. a chunked upload.
+    Route(bool http_block_check,
+          void (ChatRequestHandler::*func)(const httplib::Request &req, httplib::Response &res,
+                                           const httplib::ContentReader &content_reader)) :
+            reader_func_{func},
+            http_block_check_{http_block_check} {}
+
     ~Route() = default;
 
     static void CreateGetRoute(const std::vector<std::string> &path,
@@ -36,11 +43,20 @@ public:
                                 void (ChatRequestHandler::*func)(const httplib::Request &req, httplib::Response &res),
                                 bool http_block_check = true);
 
+    static void CreateUploadRoute(const std::vector<std::string> &path,
+                                  void (ChatRequestHandler::*func)(const httplib::Request &req,
+                                                                   httplib::Response &res,
+                                                                   const httplib::ContentReader &content_reader),
+                                  bool http_block_check = true);
+
 protected:
     httplib::Server &(httplib::Server::*action_func_)(const std::string &, httplib::Server::Handler){};
 
 private:
-    void (ChatRequestHandler::*func_)(const httplib::Request &req, httplib::Response &res);
+    void (ChatRequestHandler::*func_)(const httplib::Request &req, httplib::Response &res){};
+
+    void (ChatRequestHandler::*reader_func_)(const httplib::Request &req, httplib::Response &res,
+                                             const httplib::ContentReader &content_reader){};
 
     bool http_block_check_{};
 
@@ -57,53 +73,73 @@ private:
         auto route = self_->routes_.back().get();
         for (auto &path: paths)
         {
-            (self_->svr.*action_func_)(path, [route, this](const httplib::Request &req, httplib::Response &res)
+            if (reader_func_)
             {
-                My_Log{} << "---------------------------------------------------\n"
-                         << "Time: " << My_Log::GetTimeString() << "\n"
-                         << "Path: " << req.path << std::endl;
-
-                My_Log{My_Log::Level::kInfo} << req.body << "\n";
-                if (!route->http_block_check_)
-                    goto ahead;
-
-                if (http_busy_)
-                {
-                    My_Log{} << "An other request has been blocked." << std::endl;
-                    res.set_content(R"({"error": "genie services is busy"})", ResponseDispatcher::MIMETYPE_JSON);
-                    res.set_header("X-Skip", "1");
-                    res.status = 429;
-                    return;
-                }
-                http_busy_ = true;
-
-                ahead:
-                ErrorHandle error_handle;
-                try
-                {
-                    ((*self_->requestHandler).*func_)(req, res);
-                    return;
-                }
-                catch (const ReportError &e)
-                {
-                    error_handle = {R"({"error": "invalid operation"})", 400, e.what()};
-                }
-                catch (const json::exception &e)
+                self_->svr.Post(path, [route](const httplib::Request &req, httplib::Response &res,
+                                              const httplib::ContentReader &content_reader)
                 {
-                    error_handle = {R"({"error": "invalid json"})", 400, e.what()};
-                }
-                catch (const std::exception &e)
+                    route->Handle(req, res, [&]()
+                    {
+                        ((*self_->requestHandler).*(route->reader_func_))(req, res, content_reader);
+                    });
+                });
+                continue;
+            }
+
+            (self_->svr.*action_func_)(path, [route](const httplib::Request &req, httplib::Response &res)
+            {
+                route->Handle(req, res, [&]()
                 {
-                    error_handle = {R"({"error": "services error"})", 500, e.what()};
-                }
-                My_Log{My_Log::Level::kError}
-                        << "raise the exception: " << error_handle.internal_msg_ << "\n"
-                        << "the request body: " << req.body << "\n";
-                res.set_content(error_handle.msg_, ResponseDispatcher::MIMETYPE_JSON);
-                res.status = error_handle.status_;
+                    ((*self_->requestHandler).*(route->func_))(req, res);
+                });
             });
         }
     }
+
+    void Handle(const httplib::Request &req, httplib::Response &res, const std::function<void()> &handle)
+    {
+        My_Log{} << "---------------------------------------------------\n"
+                 << "Time: " << My_Log::GetTimeString() << "\n"
+                 << "Path: " << req.path << std::endl;
+
+        My_Log{My_Log::Level::kInfo} << req.body << "\n";
+        if (!http_block_check_)
+            goto ahead;
+
+        if (!AcquireHttpBusy())
+        {
+            My_Log{} << "An other request has been blocked." << std::endl;
+            res.set_content(R"({"error": "genie services is busy"})", ResponseDispatcher::MIMETYPE_JSON);
+            res.set_header("X-Skip", "1");
+            res.status = 429;
+            return;
+        }
+
+        ahead:
+        ErrorHandle error_handle;
+        try
+        {
+            handle();
+            return;
+        }
+        catch (const ReportError &e)
+        {
+            error_handle = {R"({"error": "invalid operation"})", 400, e.what()};
+        }
+        catch (const json::exception &e)
+        {
+            error_handle = {R"({"error": "invalid json"})", 400, e.what()};
+        }
+        catch (const std::exception &e)
+        {
+            error_handle = {R"({"error": "services error"})", 500, e.what()};
+        }
+        My_Log{My_Log::Level::kError}
+                << "raise the exception: " << error_handle.internal_msg_ << "\n"
+                << "the request body: " << req.body << "\n";
+        res.set_content(error_handle.msg_, ResponseDispatcher::MIMETYPE_JSON);
+        res.status = error_handle.status_;
+    }
 };
 
 struct GetRoute : GenieService::Route
@@ -120,6 +156,14 @@ struct PostRoute : GenieService::Route
             Route(global_block, func) { action_func_ = &httplib::Server::Post; }
 };
 
+struct UploadRoute : GenieService::Route
+{
+    UploadRoute(bool global_block,
+                void (ChatRequestHandler::*func)(const httplib::Request &req, httplib::Response &res,
+                                                 const httplib::ContentReader &content_reader)) :
+            Route(global_block, func) {}
+};
+
 void GenieService::Route::CreateGetRoute(const std::vector<std::string> &path,
                                          void (ChatRequestHandler::*func)(const httplib::Request &req,
                                                                           httplib::Response &res),
@@ -136,6 +180,15 @@ void GenieService::Route::CreatePostRoute(const std::vector<std::string> &path,
     std::make_shared<PostRoute>(http_block_check, func)->Registry(path);
 }
 
+void GenieService::Route::CreateUploadRoute(const std::vector<std::string> &path,
+                                            void (ChatRequestHandler::*func)(const httplib::Request &req,
+                                                                             httplib::Response &res,
+                                                                             const httplib::ContentReader &content_reader),
+                                            bool http_block_check)
+{
+    std::make_shared<UploadRoute>(http_block_check, func)->Registry(path);
+}
+
 void GenieService::run(int argc, char *argv[])
 {
     self_ = this;
@@ -207,18 +260,21 @@ void GenieService::setupHttpServer()
                        {
                            My_Log{} << req.path << " handling is done";
                            My_Log{}.original(true) << "\n\n";
-                           http_busy_ = false;
                        }
+                       ReleaseHttpBusy();
                    });
 
     Route::CreateGetRoute({"/"}, &ChatRequestHandler::HandleWelcome, false);
 
+    // the handler takes the busy gate itself, completions of a model batching concurrent queries run beside each other.
     Route::CreatePostRoute({"/completions", "/v1/completions", "/chat/completions", "/v1/chat/completions"},
-                           &ChatRequestHandler::ChatCompletions);
+                           &ChatRequestHandler::ChatCompletions, false);
 
     Route::CreatePostRoute({"/textsplitter", "/v1/textsplitter"}, &ChatRequestHandler::TextSplitter);
 
-    Route::CreateGetRoute({"/models", "/v1/models"}, &ChatRequestHandler::FetchModelList);
+    Route::CreateUploadRoute({"/audio/stream", "/v1/audio/stream"}, &ChatRequestHandler::AudioStream);
+
+    Route::CreateGetRoute({"/models", "/v1/models"}, &ChatRequestHandler::FetchModelList, false);
 
     Route::CreateGetRoute({"/profile"}, &ChatRequestHandler::FetchProfile);
 
@@ -240,6 +296,8 @@ void GenieService::setupHttpServer()
 
     Route::CreatePostRoute({"/unload"}, &ChatRequestHandler::UnloadModel, false);
 
+    Route::CreatePostRoute({"/preload"}, &ChatRequestHandler::PreloadModel, false);
+
     My_Log("GenieService::setupHttpServer end\n");
 }
 
@@ -7,6 +7,8 @@
 //==============================================================================
 
 #include "chat_history.h"
+#include <mutex>
+#include <unordered_map>
 #include "log.h"
 #include "utils.h"
 #include "../context/context_base.h"
@@ -14,10 +16,21 @@
 class ChatHistory::Impl
 {
 public:
+    // token ids (or only the token count when the context takes text) of a prompt piece,
+    // it is encoded once and reused until another model is loaded.
+    struct TokenCache
+    {
+        std::vector<int32_t> tokens;
+        size_t length{};
+        bool ready{false};
+    };
+
     struct GenieChatMessage
     {
         std::string role; // role："user", "assistant", "tool"
         std::string content; // message content
+        std::string formatted; // content applied with the role template
+        TokenCache cache;
     };
 
     explicit Impl(IModelConfig &model_config) : model_config_{model_config}
@@ -35,14 +48,10 @@ public:
         return history;
     }
 
-    std::string GetUserMessage(const std::string &prompt_system,
-                               const std::string &prompt_start)
+    std::vector<GenieChatMessage *> select_messages()
     {
         auto num_response = model_config_.get_num_response();
-        int contextSize = std::max(model_config_.context_size() - model_config_.getminOutputNum(),
-                                   model_config_.context_size() / 2);
-        std::string res;
-        std::vector<GenieChatMessage> user_message_vector;
+        std::vector<GenieChatMessage *> user_message_vector;
 
         // Ensure the tool calls are proceeding normally.
         size_t keep_content_num = 2 * num_response + 1;
@@ -54,17 +63,43 @@ public:
         size_t count = history.size();
         for (size_t i = 0; i < count && i < keep_content_num; i++)
         {
-            user_message_vector.push_back(get_message(count - i - 1));
+            user_message_vector.push_back(&history.at(count - i - 1));
         }
+        return user_message_vector;
+    }
+
+    int context_budget() const
+    {
+        return std::max(model_config_.context_size() - model_config_.getminOutputNum(),
+                        model_config_.context_size() / 2);
+    }
 
-        return data_process_strategy(user_message_vector, prompt_system, prompt_start, contextSize);
+    std::string GetUserMessage(const std::string &prompt_system,
+                               const std::string &prompt_start)
+    {
+        auto user_message_vector = select_messages();
+        return data_process_strategy(user_message_vector, prompt_system, prompt_start, context_budget());
     }
 
-    std::string data_process_strategy(std::vector<GenieChatMessage> &user_message_vector,
+    bool GetUserTokens(const std::string &prompt_system,
+                       const std::string &prompt_start,
+                       std::vector<int32_t> &tokens)
+    {
+        auto user_message_vector = select_messages();
+        return token_process_strategy(user_message_vector, prompt_system, prompt_start, context_budget(), tokens);
+    }
+
+    std::string data_process_strategy(std::vector<GenieChatMessage *> &user_message_vector,
                                       const std::string &prompt_system,
                                       const std::string &prompt_start,
                                       int contextSize);
 
+    bool token_process_strategy(std::vector<GenieChatMessage *> &user_message_vector,
+                                const std::string &prompt_system,
+                                const std::string &prompt_start,
+                                int contextSize,
+                                std::vector<int32_t> &tokens);
+
     void add_message(const std::string &role, const std::string &content)
     {
         history.emplace_back(GenieChatMessage{role, content});
@@ -92,48 +127,122 @@ public:
     IModelConfig &model_config_;
 
     std::vector<GenieChatMessage> history;
+
+    // concurrent completions of a session share the history, each call of ChatHistory holds it.
+    mutable std::mutex mutex_;
+
+private:
+    // how many messages can be in the window is limited by select_messages(),
+    // so the fragments only hold system / start prompts which rarely change.
+    static constexpr size_t kMaxFragmentCache = 32;
+
+    std::shared_ptr<ContextBase> acquire_context()
+    {
+        auto handle = model_config_.get_genie_model_handle().lock();
+        if (!handle)
+        {
+            throw ReportError{"model is not loaded"};
+        }
+
+        if (handle->Generation() != cache_owner_)
+        {
+            // the template and tokenizer belong to the model, drop everything encoded by the previous one.
+            for (auto &msg: history)
+            {
+                msg.formatted.clear();
+                msg.cache = TokenCache{};
+            }
+            fragments_.clear();
+            cache_owner_ = handle->Generation();
+            token_input_ = handle->SupportTokenInput();
+        }
+        return handle;
+    }
+
+    bool encode(ContextBase &handle, const std::string &text, TokenCache &cache) const
+    {
+        if (cache.ready)
+        {
+            return true;
+        }
+
+        if (token_input_)
+        {
+            if (!handle.Tokenize(text, cache.tokens))
+            {
+                My_Log{My_Log::Level::kError} << "tokenize prompt failed\n";
+                return false;
+            }
+            cache.length = cache.tokens.size();
+        }
+        else
+        {
+            cache.length = handle.TokenLength(text);
+        }
+        cache.ready = true;
+        return true;
+    }
+
+    const TokenCache *encode_fragment(ContextBase &handle, const std::string &text)
+    {
+        if (fragments_.size() >= kMaxFragmentCache && !fragments_.count(text))
+        {
+            fragments_.clear();
+        }
+
+        auto &cache = fragments_[text];
+        return encode(handle, text, cache) ? &cache : nullptr;
+    }
+
+    const TokenCache *encode_message(ContextBase &handle, GenieChatMessage &msg)
+    {
+        if (msg.formatted.empty())
+        {
+            auto &j = model_config_.get_prompt_template();
+            if (msg.role == "tool" || msg.role == "user" || msg.role == "assistant")
+            {
+                msg.formatted = str_replace(j[msg.role], "string", msg.content);
+            }
+        }
+        return encode(handle, msg.formatted, msg.cache) ? &msg.cache : nullptr;
+    }
+
+    // generation of the context the caches were encoded with, 0 before the first one.
+    uint64_t cache_owner_{};
+    bool token_input_{false};
+    std::unordered_map<std::string, TokenCache> fragments_;
 };
 
-std::string ChatHistory::Impl::data_process_strategy(std::vector<GenieChatMessage> &user_message_vector,
+std::string ChatHistory::Impl::data_process_strategy(std::vector<GenieChatMessage *> &user_message_vector,
                                                      const std::string &prompt_system,
                                                      const std::string &prompt_start,
                                                      int contextSize)
 {
-    std::vector<std::string> messages;
-    std::string format_content;
-    auto handle = model_config_.get_genie_model_handle().lock();
-    size_t string_length = handle->TokenLength(prompt_system) + handle->TokenLength(prompt_start);
-
-    if (string_length <= contextSize)
+    std::vector<const std::string *> messages;
+    auto handle = acquire_context();
+    const TokenCache *system_cache = encode_fragment(*handle, prompt_system);
+    const TokenCache *start_cache = encode_fragment(*handle, prompt_start);
+    if (!system_cache || !start_cache)
     {
-        messages.push_back(prompt_system);
-        messages.push_back(prompt_start);
+        return "";
     }
 
+    size_t string_length = system_cache->length + start_cache->length;
+    bool with_head = string_length <= contextSize;
+
     size_t vector_length = user_message_vector.size();
-    auto &j = model_config_.get_prompt_template();
     for (size_t i = 0; i < vector_length; i++)
     {
-        std::string role = user_message_vector[i].role;
-        std::string content = user_message_vector[i].content;
-        if (role == "tool")
+        const TokenCache *cache = encode_message(*handle, *user_message_vector[i]);
+        if (!cache)
         {
-            format_content = str_replace(j["tool"], "string", content);
+            return "";
         }
-        else
-            if (role == "user")
-            {
-                format_content = str_replace(j["user"], "string", content);
-            }
-            else
-                if (role == "assistant")
-                {
-                    format_content = str_replace(j["assistant"], "string", content);
-                }
-        string_length += handle->TokenLength(format_content);
+
+        string_length += cache->length;
         if (string_length <= contextSize)
         {
-            messages.insert(messages.begin() + 1, format_content);
+            messages.push_back(&user_message_vector[i]->formatted);
         }
         else
         {
@@ -150,7 +259,152 @@ std::string ChatHistory::Impl::data_process_strategy(std::vector<GenieChatMessag
         }
     }
 
-    return std::accumulate(messages.begin(), messages.end(), std::string{});
+    // messages are collected from the newest one, lay them out in chronological order.
+    std::string res;
+    if (with_head)
+    {
+        res += prompt_system;
+    }
+    for (auto it = messages.rbegin(); it != messages.rend(); ++it)
+    {
+        res += **it;
+    }
+    if (with_head)
+    {
+        res += prompt_start;
+    }
+    return res;
+}
+
+bool ChatHistory::Impl::token_process_strategy(std::vector<GenieChatMessage *> &user_message_vector,
+                                               const std::string &prompt_system,
+                                               const std::string &prompt_start,
+                                               int contextSize,
+                                               std::vector<int32_t> &tokens)
+{
+    std::vector<const GenieChatMessage *> messages;
+    auto handle = acquire_context();
+    if (!token_input_)
+    {
+        return false;
+    }
+
+    const TokenCache *system_cache = encode_fragment(*handle, prompt_system);
+    const TokenCache *start_cache = encode_fragment(*handle, prompt_start);
+    if (!system_cache || !start_cache)
+    {
+        return false;
+    }
+
+    size_t token_length = system_cache->length + start_cache->length;
+    bool with_head = token_length <= contextSize;
+
+    size_t vector_length = user_message_vector.size();
+    for (size_t i = 0; i < vector_length; i++)
+    {
+        const TokenCache *cache = encode_message(*handle, *user_message_vector[i]);
+        if (!cache)
+        {
+            return false;
+        }
+
+        token_length += cache->length;
+        if (token_length <= contextSize)
+        {
+            messages.push_back(user_message_vector[i]);
+        }
+        else
+        {
+            My_Log{} << "Message is too long, skipping: " << std::endl;
+            My_Log{} << "Total message number: " << vector_length << std::endl;
+            My_Log{} << "Current message number: " << i + 1 << std::endl;
+
+            if (i == 0)
+            {
+                My_Log{} << "The first message is too long." << std::endl;
+                return false;
+            }
+            break;
+        }
+    }
+
+    // the pieces in prompt order, messages are collected from the newest one.
+    std::vector<std::pair<const std::string *, const TokenCache *>> pieces;
+    if (with_head)
+    {
+        pieces.emplace_back(&prompt_system, system_cache);
+    }
+    for (auto it = messages.rbegin(); it != messages.rend(); ++it)
+    {
+        pieces.emplace_back(&(*it)->formatted, &(*it)->cache);
+    }
+    if (with_head)
+    {
+        pieces.emplace_back(&prompt_start, start_cache);
+    }
+
+    /*
+     * The cached tokens of two pieces only join into the tokens of the whole prompt when a special token
+     * sits at the boundary: the tokenizer splits the text there and tokenizes either side on its own.
+     * Otherwise the merges may cross the boundary, e.g. around the newlines of the template, so such a run
+     * of pieces is tokenized again as one text.
+     */
+    tokens.clear();
+    std::string run;
+    const TokenCache *run_cache = nullptr;
+    auto flush = [&]() -> bool
+    {
+        if (run_cache)
+        {
+            tokens.insert(tokens.end(), run_cache->tokens.begin(), run_cache->tokens.end());
+        }
+        else if (!run.empty())
+        {
+            std::vector<int32_t> run_tokens;
+            if (!handle->Tokenize(run, run_tokens))
+            {
+                My_Log{My_Log::Level::kError} << "tokenize prompt failed\n";
+                return false;
+            }
+            tokens.insert(tokens.end(), run_tokens.begin(), run_tokens.end());
+        }
+        run.clear();
+        run_cache = nullptr;
+        return true;
+    };
+
+    const TokenCache *prev = nullptr;
+    for (auto &piece: pieces)
+    {
+        const TokenCache *cache = piece.second;
+        if (cache->tokens.empty())
+        {
+            continue;
+        }
+
+        bool split = !prev
+                     || handle->IsSpecialToken(prev->tokens.back())
+                     || handle->IsSpecialToken(cache->tokens.front());
+        if (split)
+        {
+            if (!flush())
+            {
+                return false;
+            }
+            run_cache = cache;
+        }
+        else
+        {
+            run_cache = nullptr;
+        }
+        run += *piece.first;
+        prev = cache;
+    }
+    if (!flush())
+    {
+        return false;
+    }
+    return !tokens.empty();
 }
 
 ChatHistory::ChatHistory(IModelConfig &model_config)
@@ -166,6 +420,7 @@ ChatHistory::~ChatHistory()
 
 void ChatHistory::AddMessage(const std::string &role, const std::string &content)
 {
+    std::lock_guard<std::mutex> lock{impl_->mutex_};
     impl_->add_message(role, content);
 }
 
@@ -201,6 +456,7 @@ bool ChatHistory::import_from_json(const json &j)
         }
 
         // Successfully parsed and replaced the current history.
+        std::lock_guard<std::mutex> lock{impl_->mutex_};
         impl_->history = std::move(new_history);
         return true;
     }
@@ -215,6 +471,7 @@ json ChatHistory::export_to_json() const
 {
     nlohmann::json j;
     j["history"] = nlohmann::json::array();
+    std::lock_guard<std::mutex> lock{impl_->mutex_};
     for (const auto &msg: impl_->history)
     {
         j["history"].push_back({
@@ -227,6 +484,7 @@ json ChatHistory::export_to_json() const
 
 void ChatHistory::Print() const
 {
+    std::lock_guard<std::mutex> lock{impl_->mutex_};
     for (const auto &msg: impl_->history)
     {
         My_Log{} << "[" << msg.role << "]: " << msg.content << std::endl;
@@ -235,6 +493,7 @@ void ChatHistory::Print() const
 
 void ChatHistory::Limit(size_t max_size)
 {
+    std::lock_guard<std::mutex> lock{impl_->mutex_};
     auto &history = impl_->history;
     if (history.size() > max_size)
     {
@@ -244,10 +503,20 @@ void ChatHistory::Limit(size_t max_size)
 
 void ChatHistory::Clear()
 {
+    std::lock_guard<std::mutex> lock{impl_->mutex_};
     impl_->history.clear();
 }
 
 std::string ChatHistory::GetUserMessage(const std::string &prompt_system, const std::string &prompt_start)
 {
+    std::lock_guard<std::mutex> lock{impl_->mutex_};
     return impl_->GetUserMessage(prompt_system, prompt_start);
 }
+
+bool ChatHistory::GetUserTokens(const std::string &prompt_system,
+                                const std::string &prompt_start,
+                                std::vector<int32_t> &tokens)
+{
+    std::lock_guard<std::mutex> lock{impl_->mutex_};
+    return impl_->GetUserTokens(prompt_system, prompt_start, tokens);
+}
@@ -10,6 +10,7 @@
 #define CHAT_HISTORY_H
 
 #include <string>
+#include <vector>
 #include "nlohmann/json.hpp"
 
 using json = nlohmann::ordered_json;
@@ -26,6 +27,12 @@ public:
     std::string GetUserMessage(const std::string &prompt_system,
                                const std::string &prompt_start);
 
+    // same window as GetUserMessage as token ids, the cached ids of each piece are reused where a special
+    // token separates it from its neighbours, so the result equals tokenizing the whole prompt.
+    bool GetUserTokens(const std::string &prompt_system,
+                       const std::string &prompt_start,
+                       std::vector<int32_t> &tokens);
+
     void AddMessage(const std::string &role, const std::string &content);
 
     void Print() const;
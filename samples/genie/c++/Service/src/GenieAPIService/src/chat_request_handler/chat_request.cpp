@@ -0,0 +1,159 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#include "chat_request.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// a string no client sends, "\u0000" in the JSON text.
+static const std::string kPlaceholder{"\0attachment:", 12};
+
+/*
+ * The end of the string which starts at body[begin], the closing quote, or npos if it is not closed.
+ * escaped is set if the string has an escape sequence, the view of it is not the value then.
+ */
+static size_t StringEnd(std::string_view body, size_t begin, bool &escaped)
+{
+    size_t end = begin;
+    while (true)
+    {
+        auto quote = static_cast<const char *>(std::memchr(body.data() + end, '"', body.size() - end));
+        if (!quote)
+        {
+            return std::string_view::npos;
+        }
+        end = quote - body.data();
+
+        size_t backslashes = 0;
+        while (end - backslashes > begin && body[end - backslashes - 1] == '\\')
+        {
+            ++backslashes;
+        }
+        if (backslashes % 2 == 0)
+        {
+            break;
+        }
+        ++end;
+    }
+    escaped = std::memchr(body.data() + begin, '\\', end - begin) != nullptr;
+    return end;
+}
+
+static bool IsAttachment(std::string_view key, std::string_view parent)
+{
+    if (key == "image" || key == "audio")
+    {
+        return parent == "content";
+    }
+    return (key == "url" && parent == "image_url") || (key == "data" && parent == "input_audio");
+}
+
+bool ChatRequest::Parse(std::string_view body)
+{
+    attachments.clear();
+
+    std::string skeleton;
+    std::vector<std::string_view> parents;  // the key each open object or array is the value of
+    std::string_view key;
+    bool value_of_key = false;
+    size_t copied = 0;  // body[0, copied) is in the skeleton
+
+    for (size_t i = 0; i < body.size(); ++i)
+    {
+        switch (body[i])
+        {
+            case '{':
+            case '[':
+                parents.push_back(value_of_key ? key : std::string_view{});
+                value_of_key = false;
+                break;
+            case '}':
+            case ']':
+                if (!parents.empty())
+                {
+                    parents.pop_back();
+                }
+                value_of_key = false;
+                break;
+            case ':':
+                value_of_key = true;
+                break;
+            case ',':
+                value_of_key = false;
+                break;
+            case '"':
+            {
+                bool escaped;
+                const size_t begin = i + 1;
+                const size_t end = StringEnd(body, begin, escaped);
+                if (end == std::string_view::npos)
+                {
+                    // not closed, json::parse reports it.
+                    goto done;
+                }
+                i = end;
+
+                std::string_view str = body.substr(begin, end - begin);
+                if (!value_of_key)
+                {
+                    // a key, or an element of an array which no ':' follows.
+                    key = str;
+                    break;
+                }
+
+                value_of_key = false;
+                if (escaped || !IsAttachment(key, parents.empty() ? std::string_view{} : parents.back()))
+                {
+                    break;
+                }
+
+                skeleton.append(body.data() + copied, begin - copied);
+                skeleton += "\\u0000attachment:" + std::to_string(attachments.size());
+                attachments.push_back(str);
+                copied = end;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    done:
+    if (copied == 0)
+    {
+        data = json::parse(body.begin(), body.end(), nullptr, false);
+        return data.is_object();
+    }
+
+    skeleton.append(body.data() + copied, body.size() - copied);
+    data = json::parse(skeleton, nullptr, false);
+    return data.is_object();
+}
+
+bool ChatRequest::Payload(const json &value, std::string_view &payload) const
+{
+    if (!value.is_string())
+    {
+        return false;
+    }
+
+    const std::string &str = value.get_ref<const std::string &>();
+    if (str.size() <= kPlaceholder.size() || str.compare(0, kPlaceholder.size(), kPlaceholder) != 0)
+    {
+        return false;
+    }
+
+    const size_t index = std::strtoull(str.c_str() + kPlaceholder.size(), nullptr, 10);
+    if (index >= attachments.size())
+    {
+        return false;
+    }
+    payload = attachments[index];
+    return true;
+}
@@ -0,0 +1,38 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#ifndef CHAT_REQUEST_H
+#define CHAT_REQUEST_H
+
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::ordered_json;
+
+/*
+ * A /v1/chat/completions request whose attachments stay in the body.
+ * One pass over the body finds the base64 payloads (content.image, content.audio, image_url.url and
+ * input_audio.data) and keeps them as views, the rest of the request, a few KB, is parsed into `data` where
+ * every payload is replaced by a placeholder. So a 20 MB image is neither copied into the DOM nor walked by
+ * the JSON lexer. The body must outlive the ModelInput built from the request, httplib keeps it until the
+ * response, streamed or not, is written.
+ */
+struct ChatRequest
+{
+    json data;
+    std::vector<std::string_view> attachments;
+
+    // false if the body is not a JSON object.
+    bool Parse(std::string_view body);
+
+    // the payload `value` is the placeholder of, false if it is a plain string, e.g. an escaped payload.
+    bool Payload(const json &value, std::string_view &payload) const;
+};
+
+#endif //CHAT_REQUEST_H
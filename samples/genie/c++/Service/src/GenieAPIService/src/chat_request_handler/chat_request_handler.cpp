@@ -13,15 +13,97 @@
 #include "text_splitter.h"
 #include "../GenieAPIService.h"
 #include "../response/response_dispatcher.h"
+#include <unordered_map>
+
+/*
+ * The chat history of every session, a request names its session with the X-Session-Id header.
+ * The requests without it share the default session, the only history the service had before.
+ */
+class ChatRequestHandler::Sessions
+{
+public:
+    explicit Sessions(ModelManager &model_manager) : model_manager_{model_manager} {}
+
+    std::shared_ptr<ChatHistory> Get(const httplib::Request &req)
+    {
+        std::string id = req.get_header_value("X-Session-Id");
+        std::lock_guard<std::mutex> lock{mutex_};
+        auto &session = sessions_[id];
+        session.last_used = ++clock_;
+        if (!session.history)
+        {
+            session.history = std::make_shared<ChatHistory>(model_manager_);
+            Evict();
+        }
+        return session.history;
+    }
+
+    // a new model is loaded, the messages were formatted with the templates of the previous one.
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        for (auto &session: sessions_)
+        {
+            session.second.history->Clear();
+        }
+    }
+
+private:
+    static constexpr size_t kMaxSessions = 64;
+
+    // the least recently used sessions but the default one, a request in flight keeps its history.
+    void Evict()
+    {
+        while (sessions_.size() > kMaxSessions)
+        {
+            auto victim = sessions_.end();
+            for (auto it = sessions_.begin(); it != sessions_.end(); ++it)
+            {
+                if (!it->first.empty() && (victim == sessions_.end() || it->second.last_used < victim->second.last_used))
+                {
+                    victim = it;
+                }
+            }
+            sessions_.erase(victim);
+        }
+    }
+
+    struct Session
+    {
+        std::shared_ptr<ChatHistory> history;
+        uint64_t last_used{};
+    };
+
+    ModelManager &model_manager_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, Session> sessions_;
+    uint64_t clock_{0};
+};
+
+// one chat completion, a streamed response keeps it until its last chunk has been written.
+struct ChatRequestHandler::Completion
+{
+    Completion(ModelManager &model_manager, std::shared_ptr<ChatHistory> &&chat_history) :
+            history{std::move(chat_history)},
+            input_builder{*history, model_manager},
+            dispatcher{model_manager, *history} {}
+
+    // released after the members below are gone.
+    std::shared_lock<std::shared_mutex> shared_model;
+    std::unique_lock<std::shared_mutex> exclusive_model;
+
+    std::shared_ptr<ChatHistory> history;
+    ChatRequest request;
+    ModelInputBuilder input_builder;
+    ResponseDispatcher dispatcher;
+};
 
 ChatRequestHandler::ChatRequestHandler(GenieService *srv) :
         model_manager(*srv->modelManager),
-        chatHistory(std::make_unique < ChatHistory > (model_manager)),
-        dispatcherPtr_{std::make_unique < ResponseDispatcher > (model_manager, *chatHistory)},
-        input_builder_{new ModelInputBuilder(*chatHistory, model_manager)},
+        sessions_{std::make_unique<Sessions>(model_manager)},
         srv_{srv} {}
 
-ChatRequestHandler::~ChatRequestHandler() { delete input_builder_; }
+ChatRequestHandler::~ChatRequestHandler() = default;
 
 void ChatRequestHandler::FetchModelList(const httplib::Request &req, httplib::Response &res)
 {
@@ -55,8 +137,12 @@ void ChatRequestHandler::ModelStop(const httplib::Request &req, httplib::Respons
     std::string text = data.value("text", "");
     if (text == "stop")
     {
+        // the queries of the caller's session, a batching context keeps the other sessions generating.
         auto handle = model_manager.get_genie_model_handle().lock();
-        handle->Stop();
+        if (handle)
+        {
+            handle->StopSession(req.get_header_value("X-Session-Id"));
+        }
     }
     res.set_content("", ResponseDispatcher::MIMETYPE_JSON);
     res.status = 200;
@@ -68,7 +154,7 @@ void ChatRequestHandler::ClearMessage(const httplib::Request &req, httplib::Resp
     std::string text = data.value("text", "");
     if (text == "clear")
     {
-        chatHistory->Clear();
+        sessions_->Get(req)->Clear();
     }
     My_Log{} << RED << "history message have been delete!" << RESET << std::endl;
     res.set_content("", ResponseDispatcher::MIMETYPE_JSON);
@@ -78,7 +164,7 @@ void ChatRequestHandler::ClearMessage(const httplib::Request &req, httplib::Resp
 void ChatRequestHandler::ReloadMessage(const httplib::Request &req, httplib::Response &res)
 {
     auto j = json::parse(req.body, nullptr, false);
-    if (chatHistory->import_from_json(j))
+    if (sessions_->Get(req)->import_from_json(j))
     {
         res.set_content("{\"status\": \"success\"}", "application/json");
     }
@@ -92,7 +178,7 @@ void ChatRequestHandler::ReloadMessage(const httplib::Request &req, httplib::Res
 void ChatRequestHandler::FetchMessage(const httplib::Request &req, httplib::Response &res)
 {
     res.status = 200;
-    res.set_content(json_to_str(chatHistory->export_to_json()), ResponseDispatcher::MIMETYPE_JSON);
+    res.set_content(json_to_str(sessions_->Get(req)->export_to_json()), ResponseDispatcher::MIMETYPE_JSON);
 }
 
 void ChatRequestHandler::TextSplitter(const httplib::Request &req, httplib::Response &res)
@@ -143,17 +229,118 @@ void ChatRequestHandler::TextSplitter(const httplib::Request &req, httplib::Resp
     res.status = 200;
 }
 
+/*
+ * A completion of the active model runs beside the other ones when the context batches concurrent queries
+ * (llama.cpp), it holds the model lock shared. Any other completion, e.g. one loading a model, takes the busy
+ * gate and the model lock exclusively, so it waits for the running ones and the new ones are refused meanwhile.
+ */
 void ChatRequestHandler::ChatCompletions(const httplib::Request &req, httplib::Response &res)
 {
-    json data = json::parse(req.body, nullptr, false);
-    if (!data.is_object())
+    auto completion = std::make_shared<Completion>(model_manager, sessions_->Get(req));
+    ChatRequest &request = completion->request;
+    if (!request.Parse(req.body))
     {
         res.status = 400;
         res.set_content(R"({"error": "Invalid JSON."})", ResponseDispatcher::MIMETYPE_JSON);
         return;
     }
 
+    json &data = request.data;
     std::string modelName = data.value("model", "");
+    std::shared_ptr<ContextBase> handle;
+    bool concurrent = false;
+    if (!http_busy_ && modelName.find("lora") == std::string::npos)
+    {
+        completion->shared_model = std::shared_lock<std::shared_mutex>{model_lock_, std::try_to_lock};
+        if (completion->shared_model.owns_lock() && model_manager.IsActive(modelName))
+        {
+            handle = model_manager.get_genie_model_handle().lock();
+            concurrent = handle && handle->SupportConcurrentQuery();
+        }
+        if (!concurrent)
+        {
+            handle = nullptr;
+            completion->shared_model = {};
+        }
+    }
+
+    if (!concurrent)
+    {
+        if (!AcquireHttpBusy())
+        {
+            My_Log{} << "An other request has been blocked." << std::endl;
+            res.set_content(R"({"error": "genie services is busy"})", ResponseDispatcher::MIMETYPE_JSON);
+            res.set_header("X-Skip", "1");
+            res.status = 429;
+            return;
+        }
+        completion->exclusive_model = std::unique_lock<std::shared_mutex>{model_lock_};
+
+        bool new_model;
+        if (!model_manager.LoadModelByName(modelName, new_model))
+        {
+            res.status = 500;
+            res.set_content(R"({"error": "Model load failed."})", ResponseDispatcher::MIMETYPE_JSON);
+            return;
+        }
+
+        if (new_model)
+            sessions_->Clear();
+
+        handle = model_manager.get_genie_model_handle().lock();
+        if (!handle)
+        {
+            res.status = 500;
+            res.set_content(R"({"error": "Model context unavailable."})", ResponseDispatcher::MIMETYPE_JSON);
+            return;
+        }
+
+        handle->Reset();
+
+        if (modelName.find("lora") != std::string::npos)
+        {
+            std::unordered_map<std::string, float> loraAlphaValue
+                    {
+                            {"lora_alpha", model_manager.getloraAlpha()}
+                    };
+            const char *engineRole{"primary"};
+            handle->applyLora(engineRole, model_manager.getloraAdapter());
+            handle->setLoraStrength(engineRole, loraAlphaValue);
+        }
+    }
+
+    bool is_tool;
+    auto &model_input = completion->input_builder.Build(request, is_tool);
+    model_input.session_ = req.get_header_value("X-Session-Id");
+    bool is_stream = get_json_value(data, "stream", false);
+    completion->dispatcher.Prepare(model_input, is_tool, is_stream, req);
+    if (!concurrent)
+    {
+        // the sampler config is shared by the completions of the model, the engine samples each one on its own.
+        handle->SetParamsByConfig(data);
+    }
+
+    is_stream
+    ? res.set_chunked_content_provider(
+            "text/event-stream",
+            [completion](size_t offset, httplib::DataSink &sink)
+            {
+                return completion->dispatcher.SendResponse(offset, &sink, nullptr);
+            },
+            nullptr
+    )
+    : static_cast<void>(completion->dispatcher.SendResponse(0, nullptr, &res));
+}
+
+/*
+ * The body is a WAV, usually a chunked upload from a recorder, which the context featurizes chunk by chunk while
+ * it arrives. The returned audio_id stands for the audio in the "audio_id" key of the following chat requests.
+ */
+void ChatRequestHandler::AudioStream(const httplib::Request &req, httplib::Response &res,
+                                     const httplib::ContentReader &content_reader)
+{
+    std::string modelName = req.get_param_value("model");
+    std::unique_lock<std::shared_mutex> model_lock{model_lock_};
     bool new_model;
     if (!model_manager.LoadModelByName(modelName, new_model))
     {
@@ -163,7 +350,7 @@ void ChatRequestHandler::ChatCompletions(const httplib::Request &req, httplib::R
     }
 
     if (new_model)
-        dispatcherPtr_->ResetProcessor();
+        sessions_->Clear();
 
     auto handle = model_manager.get_genie_model_handle().lock();
     if (!handle)
@@ -173,32 +360,35 @@ void ChatRequestHandler::ChatCompletions(const httplib::Request &req, httplib::R
         return;
     }
 
-    handle->Reset();
-
-    if (modelName.find("lora") != std::string::npos)
+    handle->BeginAudioStream();
+    std::string error;
+    bool received = content_reader([&handle, &error](const char *data, size_t data_length)
+                                   {
+                                       try
+                                       {
+                                           handle->AppendAudio(data, data_length);
+                                       }
+                                       catch (const std::exception &e)
+                                       {
+                                           error = e.what();
+                                           return false;
+                                       }
+                                       return true;
+                                   });
+    if (!received)
     {
-        std::unordered_map<std::string, float> loraAlphaValue
-                {
-                        {"lora_alpha", model_manager.getloraAlpha()}
-                };
-        const char *engineRole{"primary"};
-        handle->applyLora(engineRole, model_manager.getloraAdapter());
-        handle->setLoraStrength(engineRole, loraAlphaValue);
+        // a broken upload or a bad WAV, the partial audio is dropped instead of encoded.
+        handle->AbortAudioStream();
+        My_Log{My_Log::Level::kError} << "audio stream failed: " << (error.empty() ? "upload broken off" : error)
+                                      << std::endl;
+        res.status = 400;
+        res.set_content(json{{"error", error.empty() ? "Audio upload incomplete." : error}}.dump(),
+                        ResponseDispatcher::MIMETYPE_JSON);
+        return;
     }
-
-    bool is_tool;
-    auto &model_input = input_builder_->Build(data, is_tool);
-    bool is_stream = get_json_value(data, "stream", false);
-    dispatcherPtr_->Prepare(model_input, is_tool, is_stream, req);
-    handle->SetParamsByConfig(data);
-
-    is_stream
-    ? res.set_chunked_content_provider(
-            "text/event-stream",
-            [this](size_t offset, httplib::DataSink &sink) { return dispatcherPtr_->SendResponse(offset, &sink, nullptr); },
-            nullptr
-    )
-    : static_cast<void>(dispatcherPtr_->SendResponse(0, nullptr, &res));
+    json result = handle->EndAudioStream();
+    res.set_content(result.dump(), ResponseDispatcher::MIMETYPE_JSON);
+    res.status = 200;
 }
 
 void ChatRequestHandler::FetchProfile(const httplib::Request &req, httplib::Response &res)
@@ -255,3 +445,17 @@ void ChatRequestHandler::UnloadModel(const httplib::Request &req, httplib::Respo
     res.set_content("", ResponseDispatcher::MIMETYPE_JSON);
     res.status = 200;
 }
+
+void ChatRequestHandler::PreloadModel(const httplib::Request &req, httplib::Response &res)
+{
+    json data = json::parse(req.body, nullptr, false);
+    std::string modelName = data.is_object() ? data.value("model", "") : "";
+    if (modelName.empty() || !model_manager.PreloadModel(modelName))
+    {
+        res.status = 400;
+        res.set_content(R"({"error": "Model preload failed."})", ResponseDispatcher::MIMETYPE_JSON);
+        return;
+    }
+    res.set_content(R"({"status": "loading"})", ResponseDispatcher::MIMETYPE_JSON);
+    res.status = 200;
+}
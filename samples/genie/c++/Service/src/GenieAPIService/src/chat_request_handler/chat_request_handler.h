@@ -10,12 +10,10 @@
 #define CHAT_REQUEST_HANDLER_H
 
 #include <httplib.h>
+#include <shared_mutex>
 
 class GenieService;
 class ModelManager;
-class ChatHistory;
-class ResponseDispatcher;
-class ModelInputBuilder;
 
 class ChatRequestHandler
 {
@@ -30,6 +28,9 @@ public:
 
     void ChatCompletions(const httplib::Request &req, httplib::Response &res);
 
+    void AudioStream(const httplib::Request &req, httplib::Response &res,
+                     const httplib::ContentReader &content_reader);
+
     void FetchModelList(const httplib::Request &req, httplib::Response &res);
 
     void TextSplitter(const httplib::Request &req, httplib::Response &res);
@@ -52,11 +53,17 @@ public:
 
     void UnloadModel(const httplib::Request &req, httplib::Response &res);
 
+    void PreloadModel(const httplib::Request &req, httplib::Response &res);
+
 private:
+    class Sessions;
+
+    struct Completion;
+
     ModelManager &model_manager;
-    std::unique_ptr<ChatHistory> chatHistory;
-    std::unique_ptr<ResponseDispatcher> dispatcherPtr_;
-    ModelInputBuilder* input_builder_;
+    std::unique_ptr<Sessions> sessions_;
+    // the active model, completions sharing its context hold it shared, loading a model holds it exclusively.
+    std::shared_mutex model_lock_;
     GenieService *srv_;
 };
 
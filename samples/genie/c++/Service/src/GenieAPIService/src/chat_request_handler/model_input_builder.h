@@ -11,6 +11,7 @@
 
 #include "../context/context_base.h"
 #include "../chat_history/chat_history.h"
+#include "chat_request.h"
 #include <utils.h>
 #include "log.h"
 #include <nlohmann/json.hpp>
@@ -24,10 +25,12 @@ public:
                                                                                model_config_{model_config} {}
 // TODO: bad impl!
 
-    ModelInput &Build(json &data, bool &is_tool)
+    ModelInput &Build(ChatRequest &request, bool &is_tool)
     {
         Reset();
-        for (auto e: data["messages"])
+        request_ = &request;
+        json &data = request.data;
+        for (auto &e: data["messages"])
         {
             if (e["role"] == "user")
             {
@@ -91,13 +94,12 @@ public:
             model_input_.text_ = "What is this img or audio describe?";
         }
 
-        if (!model_input_.image_.empty() || !model_input_.audio_.empty())
+        if (!model_input_.image_.empty() || !model_input_.audio_.empty() || !model_input_.audio_id_.empty())
         {
             goto done;
         }
 
-        model_input_.text_ = BuildPrompt(data, is_tool);
-        if (model_input_.text_.empty())
+        if (!BuildPrompt(data, is_tool))
         {
             throw ReportError{"build prompt failed"};
         }
@@ -107,7 +109,7 @@ public:
     }
 
 private:
-    void ProcessArray(const json &user_content)
+    void ProcessArray(json &user_content)
     {
         static auto check_key{
                 [](const json &content, const char *key, bool is_object = false) -> bool
@@ -131,7 +133,7 @@ private:
                 }
         };
 
-        for (const auto &element: user_content)
+        for (auto &element: user_content)
         {
             if (!check_key(element, "type"))
             {
@@ -160,18 +162,62 @@ private:
                     continue;
                 }
 
-                auto img = j_image_url["url"].get<std::string>();
-                int pos;
-                if ((pos = img.find(',')) != std::string::npos)
+                // IEmbedding::Decode skips the header of a data URL, other URLs are cut after the comma.
+                auto &j_url = j_image_url["url"];
+                std::string_view url = Payload(j_url);
+                size_t pos;
+                if ((pos = url.find(',')) == std::string_view::npos)
+                {
+                    continue;
+                }
+                if (url.compare(0, 5, "data:") != 0)
+                {
+                    model_input_.image_.Own(std::string{url.substr(pos + 1)});
+                    continue;
+                }
+                SetAttachment(model_input_.image_, j_url);
+            }
+
+            if (strcmp(element["type"].get_ref<const std::string &>().c_str(), "input_audio") == 0)
+            {
+                if (!check_key(element, "input_audio", true))
+                {
+                    continue;
+                }
+
+                auto &j_input_audio = element["input_audio"];
+                if (!check_key(j_input_audio, "data"))
                 {
-                    ++pos;
-                    model_input_.image_ = img.substr(pos, img.size() - pos);
+                    continue;
                 }
+                SetAttachment(model_input_.audio_, j_input_audio["data"]);
             }
         }
     }
 
-    void ProcessObject(const json &user_content)
+    // the payload of an attachment value, in the request body or in the DOM when it was escaped.
+    std::string_view Payload(const json &value) const
+    {
+        std::string_view payload;
+        if (request_->Payload(value, payload))
+        {
+            return payload;
+        }
+        return value.get_ref<const std::string &>();
+    }
+
+    void SetAttachment(Attachment &attachment, json &value)
+    {
+        std::string_view payload;
+        if (request_->Payload(value, payload))
+        {
+            attachment.Refer(payload);
+            return;
+        }
+        attachment.Own(std::move(value.get_ref<std::string &>()));
+    }
+
+    void ProcessObject(json &user_content)
     {
         static auto get_value{
                 [](const json &content, const char *key) -> std::string
@@ -191,12 +237,34 @@ private:
                 }
         };
 
+        auto get_attachment{
+                [&](const char *key, Attachment &attachment)
+                {
+                    if (!user_content.contains(key))
+                    {
+                        My_Log{} << "msg does not contain " << key << " key\n";
+                        return;
+                    }
+
+                    if (!user_content[key].is_string())
+                    {
+                        throw ReportError{std::string{key} + " key is invalid"};
+                    }
+
+                    SetAttachment(attachment, user_content[key]);
+                }
+        };
+
         model_input_.text_ = get_value(user_content, "question");
-        model_input_.image_ = get_value(user_content, "image");
-        model_input_.audio_ = get_value(user_content, "audio");
+        get_attachment("image", model_input_.image_);
+        get_attachment("audio", model_input_.audio_);
+        if (user_content.contains("audio_id"))
+        {
+            model_input_.audio_id_ = get_value(user_content, "audio_id");
+        }
     }
 
-    std::string BuildPrompt(json &data, bool &is_tool)
+    bool BuildPrompt(json &data, bool &is_tool)
     {
         is_tool = false;
         // if we use ref here, once the tools key is empty. it will modify the memory and make msg bad ref
@@ -278,10 +346,18 @@ private:
         // build model input
         auto &j = model_config_.get_prompt_template();
         /* @formatter:off */
-        std::string modelInputContent = chat_history_.GetUserMessage(str_replace(j["system"].get_ref<const std::string&>(), "string", systemDefaultPrompt),
-                                                                     j["start"].get_ref<const std::string&>() + startDefaultPrompt);
+        std::string promptSystem = str_replace(j["system"].get_ref<const std::string&>(), "string", systemDefaultPrompt);
+        std::string promptStart = j["start"].get_ref<const std::string&>() + startDefaultPrompt;
         /* @formatter:on */
-        return modelInputContent;
+
+        // the context takes token ids, hand it the cached tokens instead of the whole prompt string.
+        if (handle->SupportTokenInput())
+        {
+            return chat_history_.GetUserTokens(promptSystem, promptStart, model_input_.tokens_);
+        }
+
+        model_input_.text_ = chat_history_.GetUserMessage(promptSystem, promptStart);
+        return !model_input_.text_.empty();
     }
 
     std::string trim_empty_lines(const std::string &input)
@@ -298,6 +374,8 @@ private:
         model_input_.system_.clear();
         model_input_.image_.clear();
         model_input_.audio_.clear();
+        model_input_.audio_id_.clear();
+        model_input_.tokens_.clear();
     }
 
     static inline const std::string FILL_THINK = "<think>\n\n</think>\n\n";
@@ -319,6 +397,7 @@ private:
     ChatHistory &chat_history_;
     IModelConfig &model_config_;
     ModelInput model_input_;
+    const ChatRequest *request_{};
 };
 
 #endif //PROMPT_H
@@ -77,6 +77,16 @@ inline bool Config::Process()
     app.add_option("-f,--logfile", log_path, "log file path, it's a option");
     app.add_option("--lora_alpha", model_config_.loraAlpha, "lora Alpha Value");
     app.add_option("-p,--port", port_, "Port used for running");
+    app.add_option("--stream_flush_ms", model_config_.streamFlushMs,
+                   "Coalesce the streamed tokens produced within this interval (ms) into one event, 0: per token");
+    app.add_option("--model_budget_mb", model_config_.modelBudgetMb,
+                   "Memory budget (MB) to keep several models resident, 0: only the current model is resident");
+    app.add_option("--embedding_cache_mb", model_config_.embeddingCacheMb,
+                   "Memory budget (MB) to cache the image / audio embeddings across turns, 0: disable");
+    app.add_option("--embedding_cache_dir", model_config_.embeddingCacheDir,
+                   "Directory to spill the evicted image / audio embeddings, optional");
+    app.add_option("--embedding_cache_dir_mb", model_config_.embeddingCacheDirMb,
+                   "Size cap (MB) of the embedding spill directory, the oldest files are removed beyond it, 0: no cap");
 
     try
     {
@@ -7,7 +7,15 @@
 //==============================================================================
 
 #include "context_base.h"
+#include <atomic>
 #include "log.h"
+#include "utils.h"
+
+uint64_t ContextBase::NextGeneration()
+{
+    static std::atomic<uint64_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
 
 bool ContextBase::Stop()
 {
@@ -15,6 +23,11 @@ bool ContextBase::Stop()
     return true;
 }
 
+bool ContextBase::StopSession(const std::string &)
+{
+    return Stop();
+}
+
 bool ContextBase::SetParamsByConfig(const json &j)
 {
     if (j.empty())
@@ -115,6 +128,26 @@ size_t ContextBase::TokenLength(const std::string &text)
     return text.size();
 }
 
+bool ContextBase::Tokenize(const std::string &text, std::vector<int32_t> &tokens)
+{
+    return false;
+}
+
+bool ContextBase::SupportTokenInput() const
+{
+    return false;
+}
+
+bool ContextBase::IsSpecialToken(int32_t token) const
+{
+    return false;
+}
+
+bool ContextBase::SupportConcurrentQuery() const
+{
+    return false;
+}
+
 void ContextBase::applyLora(const std::string &engineRole, const std::string &loraAdapterName)
 {
     My_Log("BuilderBase::applyLora called\n");
@@ -148,3 +181,21 @@ void ContextBase::Reset()
     My_Log("BuilderBase::Reset called\n");
 }
 
+void ContextBase::BeginAudioStream()
+{
+    throw ReportError{"the model does not support audio stream"};
+}
+
+void ContextBase::AppendAudio(const char *data, size_t size)
+{
+    throw ReportError{"the model does not support audio stream"};
+}
+
+json ContextBase::EndAudioStream()
+{
+    throw ReportError{"the model does not support audio stream"};
+}
+
+void ContextBase::AbortAudioStream()
+{
+}
@@ -18,14 +18,21 @@ class ContextBase
 public:
     using Callback = std::function<bool(std::string &)>;
 
-    explicit ContextBase(const IModelConfig &info) : model_config_{info} {};
+    explicit ContextBase(const IModelConfig &info) : model_config_{info}, generation_{NextGeneration()} {};
 
     virtual ~ContextBase();
 
+    // unique per created context, unlike the address which a reloaded context can get again.
+    uint64_t Generation() const
+    { return generation_; }
+
     virtual bool Query(const ModelInput &, const Callback &) = 0;
 
     virtual bool Stop();
 
+    // the queries of one session (X-Session-Id), a context running one query at a time stops that one.
+    virtual bool StopSession(const std::string &session);
+
     bool SetParamsByConfig(const json &j);
 
     virtual json HandleProfile() = 0;
@@ -34,8 +41,28 @@ public:
 
     virtual size_t TokenLength(const std::string &text);
 
+    virtual bool Tokenize(const std::string &text, std::vector<int32_t> &tokens);
+
+    virtual bool SupportTokenInput() const;
+
+    // the tokenizer splits the text at this token, the text on either side of it is tokenized on its own.
+    virtual bool IsSpecialToken(int32_t token) const;
+
+    // Query may be called from several threads at once, e.g. the queries are batched by the context.
+    virtual bool SupportConcurrentQuery() const;
+
     virtual void Reset();
 
+    // streaming audio input, the WAV is fed in chunks while it is uploaded, see the /audio/stream route.
+    virtual void BeginAudioStream();
+
+    virtual void AppendAudio(const char *data, size_t size);
+
+    virtual json EndAudioStream();
+
+    // drop the stream in progress without encoding it, e.g. the upload broke off.
+    virtual void AbortAudioStream();
+
     virtual void applyLora(const std::string &engineRole, const std::string &loraAdapterName);
 
     virtual void setLoraStrength(const std::string &engineRole,
@@ -47,6 +74,11 @@ protected:
     virtual int ApplyParams();
 
     const IModelConfig &model_config_;
+
+private:
+    static uint64_t NextGeneration();
+
+    const uint64_t generation_;
 };
 
 #endif
\ No newline at end of file
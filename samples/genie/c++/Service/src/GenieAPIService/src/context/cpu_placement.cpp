@@ -0,0 +1,221 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#include "cpu_placement.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace CpuPlacement
+{
+#if defined(_WIN32)
+
+    std::vector<Cpu> Topology()
+    {
+        DWORD length = 0;
+        GetLogicalProcessorInformationEx(RelationAll, nullptr, &length);
+        std::vector<uint8_t> buffer(length);
+        auto *info = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *>(buffer.data());
+        if (length == 0 || !GetLogicalProcessorInformationEx(RelationAll, info, &length))
+        {
+            return {};
+        }
+
+        auto for_each_cpu = [](const GROUP_AFFINITY &affinity, auto &&fn)
+        {
+            for (int bit = 0; bit < 64; ++bit)
+            {
+                if (affinity.Mask & (KAFFINITY{1} << bit))
+                {
+                    fn(affinity.Group * 64 + bit);
+                }
+            }
+        };
+
+        std::vector<Cpu> cpus;
+        std::vector<std::pair<GROUP_AFFINITY, int>> nodes;
+        for (DWORD offset = 0; offset < length;)
+        {
+            auto *entry = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX *>(buffer.data() + offset);
+            if (entry->Relationship == RelationProcessorCore)
+            {
+                for (WORD g = 0; g < entry->Processor.GroupCount; ++g)
+                {
+                    for_each_cpu(entry->Processor.GroupMask[g], [&](int index)
+                    {
+                        cpus.push_back({index, entry->Processor.EfficiencyClass, 0});
+                    });
+                }
+            }
+            else if (entry->Relationship == RelationNumaNode)
+            {
+                nodes.emplace_back(entry->NumaNode.GroupMask, static_cast<int>(entry->NumaNode.NodeNumber));
+            }
+            offset += entry->Size;
+        }
+
+        for (const auto &[affinity, node]: nodes)
+        {
+            for_each_cpu(affinity, [&](int index)
+            {
+                for (auto &cpu: cpus)
+                {
+                    if (cpu.index == index)
+                    {
+                        cpu.numa_node = node;
+                    }
+                }
+            });
+        }
+        std::sort(cpus.begin(), cpus.end(), [](const Cpu &a, const Cpu &b) { return a.index < b.index; });
+        return cpus;
+    }
+
+#else
+
+    // Linux / Android: the core capacity of big.LITTLE and the node of every CPU are in sysfs.
+    std::vector<Cpu> Topology()
+    {
+        namespace fs = std::filesystem;
+        std::vector<Cpu> cpus;
+        const int count = static_cast<int>(std::thread::hardware_concurrency());
+        for (int i = 0; i < count; ++i)
+        {
+            const fs::path dir = "/sys/devices/system/cpu/cpu" + std::to_string(i);
+            Cpu cpu{i, 0, 0};
+            std::ifstream capacity(dir / "cpu_capacity");
+            capacity >> cpu.efficiency_class;
+
+            std::error_code ec;
+            for (const auto &entry: fs::directory_iterator(dir, ec))
+            {
+                const std::string name = entry.path().filename().string();
+                if (name.rfind("node", 0) == 0 && name.size() > 4 && std::isdigit(static_cast<unsigned char>(name[4])))
+                {
+                    cpu.numa_node = std::stoi(name.substr(4));
+                }
+            }
+            cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+
+#endif
+
+    std::vector<int> Parse(const std::string &spec, const std::vector<Cpu> &topology)
+    {
+        if (topology.empty())
+        {
+            throw std::invalid_argument("the CPU topology is unknown");
+        }
+
+        int fastest = topology.front().efficiency_class;
+        int slowest = fastest;
+        for (const auto &cpu: topology)
+        {
+            fastest = std::max(fastest, cpu.efficiency_class);
+            slowest = std::min(slowest, cpu.efficiency_class);
+        }
+
+        std::set<int> out;
+        auto select = [&](auto &&pred)
+        {
+            for (const auto &cpu: topology)
+            {
+                if (pred(cpu))
+                {
+                    out.insert(cpu.index);
+                }
+            }
+        };
+
+        size_t begin = 0;
+        while (begin <= spec.size())
+        {
+            size_t end = spec.find(',', begin);
+            if (end == std::string::npos)
+            {
+                end = spec.size();
+            }
+            std::string item = spec.substr(begin, end - begin);
+            item.erase(0, item.find_first_not_of(' '));
+            item.erase(item.find_last_not_of(' ') + 1);
+            begin = end + 1;
+
+            try
+            {
+                if (item == "all")
+                {
+                    select([](const Cpu &) { return true; });
+                }
+                else if (item == "performance")
+                {
+                    select([&](const Cpu &cpu) { return cpu.efficiency_class == fastest; });
+                }
+                else if (item == "efficiency")
+                {
+                    select([&](const Cpu &cpu) { return cpu.efficiency_class == slowest; });
+                }
+                else if (item.rfind("node:", 0) == 0)
+                {
+                    const int node = std::stoi(item.substr(5));
+                    select([&](const Cpu &cpu) { return cpu.numa_node == node; });
+                }
+                else
+                {
+                    const size_t dash = item.find('-');
+                    const int first = std::stoi(item.substr(0, dash));
+                    const int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+                    select([&](const Cpu &cpu) { return cpu.index >= first && cpu.index <= last; });
+                }
+            }
+            catch (const std::logic_error &)
+            {
+                throw std::invalid_argument("invalid CPU set item \"" + item + "\" in \"" + spec + "\"");
+            }
+        }
+
+        if (out.empty())
+        {
+            throw std::invalid_argument("CPU set \"" + spec + "\" has no CPU of this machine");
+        }
+        return {out.begin(), out.end()};
+    }
+
+    std::string ToString(const std::vector<int> &cpus)
+    {
+        std::string out;
+        for (size_t i = 0; i < cpus.size();)
+        {
+            size_t j = i;
+            while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+            {
+                ++j;
+            }
+            if (!out.empty())
+            {
+                out += ",";
+            }
+            out += std::to_string(cpus[i]);
+            if (j > i)
+            {
+                out += "-" + std::to_string(cpus[j]);
+            }
+            i = j + 1;
+        }
+        return out;
+    }
+}
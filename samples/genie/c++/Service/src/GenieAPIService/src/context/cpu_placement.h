@@ -0,0 +1,40 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#ifndef CPU_PLACEMENT_H
+#define CPU_PLACEMENT_H
+
+#include <string>
+#include <vector>
+
+/*
+ * The logical CPUs a llama.cpp threadpool is pinned to. A set is written as a comma separated list of
+ *   "performance" / "efficiency": the CPUs of the fastest / slowest cores, P-cores / E-cores on a hybrid CPU,
+ *   "node:N": the CPUs of NUMA node N,
+ *   "all", a CPU index or a range of them, e.g. "0-3,8".
+ */
+namespace CpuPlacement
+{
+    struct Cpu
+    {
+        int index;
+        int efficiency_class;  // higher is faster, 0 when all cores are the same
+        int numa_node;
+    };
+
+    // the logical CPUs of the machine, sorted by index.
+    std::vector<Cpu> Topology();
+
+    // the sorted CPU indices of a set, throws std::invalid_argument if the set is malformed or empty.
+    std::vector<int> Parse(const std::string &spec, const std::vector<Cpu> &topology);
+
+    // "0-3,8"
+    std::string ToString(const std::vector<int> &cpus);
+}
+
+#endif //CPU_PLACEMENT_H
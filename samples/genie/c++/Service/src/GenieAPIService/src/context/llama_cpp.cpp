@@ -7,21 +7,106 @@
 //==============================================================================
 
 #include "llama_cpp.h"
+#include "cpu_placement.h"
 #include <llama.h>
 #include <arg.h>
+#include <common.h>
 #include <ggml-backend.h>
 #include <sampling.h>
 #include "log.h"
+#include "utils.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <list>
+#include <numeric>
+#include <sstream>
+#include <thread>
 
 namespace fs = std::filesystem;
 
 #define LLAMA_BUILDER_DEBUG
 
+/*
+ * The context runs a continuous batching engine: every Query() is a request which is admitted into
+ * one of n_parallel slots, each slot owns a sequence id in the shared llama_context. The engine thread
+ * merges the prompt chunks and the next-token decodes of all active slots into one llama_batch per step,
+ * new requests are admitted and finished ones are evicted between steps.
+ *
+ * With a draft model (speculative decoding) every generating slot first gets up to draft_max tokens proposed
+ * by the draft model, which keeps its own sequence per slot. The step then verifies the sampled token and the
+ * drafts of all slots in the same target llama_decode, the accepted prefix is streamed at once and the kv of
+ * the rejected drafts is removed.
+ *
+ * Decode (one token per slot) and prefill (batches of prompt tokens) run on their own threadpools, which the
+ * config can pin to CPU sets. A batch gets one prefill thread per prefill_tokens_per_thread tokens, so a short
+ * prompt does not wake every prefill thread.
+ */
 class LLAMACppBuilder::Impl
 {
 public:
-    explicit Impl(common_params &&params) : params_{std::move(params)}
+    struct Request
+    {
+        std::vector<llama_token> prompt;
+        std::string session;  // Stop(session) cancels the requests of one session only
+
+        // filled by the engine thread, drained by the query thread.
+        std::string pending;
+        bool finished{false};
+        bool succeed{true};
+        std::atomic<bool> cancel{false};
+        std::mutex lock;
+        std::condition_variable cond;
+
+        // profile, written by the engine thread.
+        std::chrono::steady_clock::time_point admitted;
+        std::chrono::steady_clock::time_point first_token;
+        int n_prompt{};
+        int n_drafted{};
+        int n_accepted{};
+    };
+
+    // the numbers of the last finished request, HandleProfile reports them.
+    struct Profile
+    {
+        double prompt_ms{};
+        double generation_ms{};
+        int n_prompt{};
+        int n_generated{};
+        int n_drafted{};
+        int n_accepted{};
+    };
+
+    struct Slot
+    {
+        llama_seq_id id{};
+        common_sampler *smpl{};
+        std::shared_ptr<Request> request;
+
+        // tokens whose kv is stored in this sequence, kept after the request is done for prefix reuse.
+        std::vector<llama_token> cache;
+        uint64_t last_used{};  // when the slot last finished a request, the idle caches are evicted oldest first
+        llama_token sampled{LLAMA_TOKEN_NULL};
+        bool generating{false};
+        int i_batch{-1};
+        int n_decoded{};
+
+        // speculative decoding: the tokens whose kv is stored in the draft sequence and the drafts of this step.
+        std::vector<llama_token> draft_cache;
+        std::vector<llama_token> draft;
+        int draft_room{};
+        int i_draft{-1};
+    };
+
+    Impl(common_params &&params, int prefill_tokens_per_thread) :
+            params_{std::move(params)}, prefill_tokens_per_thread_{prefill_tokens_per_thread}
     {
         params_.warmup = false;
         RegisterLogAdapter();
@@ -36,6 +121,13 @@ public:
             params_.n_ctx = 8;
         }
 
+        if (params_.n_parallel < 1)
+        {
+            params_.n_parallel = 1;
+        }
+        // all sequences share the whole kv cache, so a single long session still gets n_ctx.
+        params_.kv_unified = true;
+
         llama_backend_init();
         llama_numa_init(params_.numa);
         llama_init = common_init_from_params(params_);
@@ -84,178 +176,802 @@ public:
         }
 
         llama_attach_threadpool(ctx, threadpool, threadpool_batch);
-        params_.conversation_mode = COMMON_CONVERSATION_MODE_ENABLED;
 
         if (!llama_model_has_encoder(model))
         {
             GGML_ASSERT(!llama_vocab_get_add_eos(vocab));
         }
 
-        params_.interactive_first = true;
-        params_.interactive = true;
-
         auto &sparams = params_.sampling;
         sparams.temp = 0.8;
         sparams.top_k = 40;
         sparams.top_p = 0.95;
-        smpl = common_sampler_init(model, sparams);
-        if (!smpl)
+
+        n_ctx_ = llama_n_ctx(ctx);
+        n_batch_ = llama_n_batch(ctx);
+        slots_.resize(params_.n_parallel);
+        for (int i = 0; i < params_.n_parallel; ++i)
         {
-            throw std::runtime_error("failed to initialize sampling subsystem");
+            slots_[i].id = i;
+            slots_[i].smpl = common_sampler_init(model, sparams);
+            if (!slots_[i].smpl)
+            {
+                throw std::runtime_error("failed to initialize sampling subsystem");
+            }
         }
+        batch_ = llama_batch_init(n_batch_, 0, params_.n_parallel);
+
+        if (!params_.speculative.model.path.empty())
+        {
+            InitDraft();
+        }
+
+        My_Log{} << "llama.cpp context: n_ctx: " << n_ctx_ << ", "
+                 << "n_batch: " << n_batch_ << ", "
+                 << "n_parallel: " << params_.n_parallel << ", "
+                 << "decode threads: " << params_.cpuparams.n_threads << ", "
+                 << "prefill threads: " << params_.cpuparams_batch.n_threads << ", "
+                 << "speculative: " << (Speculative() ? "on" : "off") << "\n";
+
+        engine_thread_ = std::thread(&Impl::EngineLoop, this);
     }
 
-    bool Query(const std::string &prompt, const std::function<bool(std::string &)> &callback)
+    bool Query(const std::string &prompt,
+               const std::vector<llama_token> &tokens,
+               const std::string &session,
+               const std::function<bool(std::string &)> &callback)
     {
+        auto request = std::make_shared<Request>();
+        request->session = session;
+        const auto line_inp = tokens.empty() ? common_tokenize(vocab, prompt, false, true) : tokens;
+        if (line_inp.empty())
         {
-            std::lock_guard<std::mutex> lk(m);
-            is_interacting = true;
-            done = false;
+            My_Log{My_Log::Level::kError} << "prompt is empty\n";
+            return false;
         }
 
-        llama_context *ctx = llama_init.context.get();
-        const int n_ctx = llama_n_ctx(ctx);
-        bool input_echo = true;
-        bool waiting_for_first_input = true;
+        // the prompt follows an end of turn token, as it did in the interactive loop.
+        llama_token eot = llama_vocab_eot(vocab);
+        request->prompt.reserve(line_inp.size() + 1);
+        request->prompt.push_back(eot == LLAMA_TOKEN_NULL ? llama_vocab_eos(vocab) : eot);
+        request->prompt.insert(request->prompt.end(), line_inp.begin(), line_inp.end());
 
+        if ((int) request->prompt.size() >= n_ctx_ - 4)
+        {
+            My_Log{My_Log::Level::kError} << "prompt is too long: " << request->prompt.size() << ", "
+                                          << "n_ctx: " << n_ctx_ << "\n";
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lk(queue_lock_);
+            waiting_.push_back(request);
+            requests_.push_back(request);
+        }
+        queue_cond_.notify_one();
+
+        std::string response;
+        bool accepted = true;
         while (true)
         {
-            int max_embd_size = n_ctx - 4;
-            if ((int) embd.size() > max_embd_size)
+            std::unique_lock<std::mutex> lk(request->lock);
+            request->cond.wait(lk, [&request] { return !request->pending.empty() || request->finished; });
+            response.swap(request->pending);
+            request->pending.clear();
+            bool finished = request->finished;
+            lk.unlock();
+
+            if (!response.empty() && accepted && !callback(response))
             {
-                embd.resize(max_embd_size);
+                // keep draining until the engine evicts the slot.
+                accepted = false;
+                request->cancel = true;
             }
 
-            if (n_past + (int) embd.size() >= n_ctx)
+            if (finished)
             {
-                llama_memory_t mem = llama_get_memory(ctx);
-                const int n_left = n_past - params_.n_keep;
-                const int n_discard = n_left / 2;
-                llama_memory_seq_rm(mem, 0, params_.n_keep, params_.n_keep + n_discard);
-                llama_memory_seq_add(mem, 0, params_.n_keep + n_discard, n_past, -n_discard);
-                n_past -= n_discard;
+                break;
             }
+        }
+
+        {
+            std::lock_guard<std::mutex> lk(queue_lock_);
+            requests_.remove(request);
+        }
+        return request->succeed;
+    }
+
+    // the requests of one session, the other sessions keep generating.
+    void Stop(const std::string &session)
+    {
+        std::lock_guard<std::mutex> lk(queue_lock_);
+        for (auto &request: requests_)
+        {
+            if (request->session == session)
+            {
+                request->cancel = true;
+            }
+        }
+    }
+
+    ~Impl()
+    {
+        {
+            std::lock_guard<std::mutex> lk(queue_lock_);
+            exit_ = true;
+        }
+        queue_cond_.notify_one();
+        if (engine_thread_.joinable())
+        {
+            engine_thread_.join();
+        }
+
+        llama_batch_free(batch_);
+        if (Speculative())
+        {
+            llama_batch_free(draft_batch_);
+        }
+        for (auto &slot: slots_)
+        {
+            common_sampler_free(slot.smpl);
+        }
+        llama_backend_free();
+        ggml_threadpool_free_fn(threadpool);
+        ggml_threadpool_free_fn(threadpool_batch);
+    }
+
+    json GetProfile()
+    {
+        std::lock_guard<std::mutex> lk(profile_lock_);
+        const Profile &p = last_profile_;
+        if (p.n_generated == 0)
+        {
+            return {};
+        }
+
+        auto fixed = [](double value)
+        {
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(2) << value;
+            return oss.str();
+        };
+
+        json result;
+        result["time_to_first_token"] = fixed(p.prompt_ms);
+        result["token_generation_time"] = fixed(p.generation_ms);
+        result["prompt_processing_rate"] = fixed(p.prompt_ms > 0 ? p.n_prompt * 1000.0 / p.prompt_ms : 0.0);
+        // the tokens after the first one, with drafts several of them come out of one step.
+        result["token_generation_rate"] = fixed(p.generation_ms > 0 ? (p.n_generated - 1) * 1000.0 / p.generation_ms : 0.0);
+        result["num_prompt_tokens"] = p.n_prompt;
+        result["num_generated_tokens"] = p.n_generated;
+        if (Speculative())
+        {
+            result["num_draft_tokens"] = p.n_drafted;
+            result["num_accepted_draft_tokens"] = p.n_accepted;
+            result["draft_acceptance_rate"] = fixed(p.n_drafted > 0 ? 100.0 * p.n_accepted / p.n_drafted : 0.0);
+        }
+
+        // the engine, all slots together, since the last profile.
+        result["engine_prefill_rate"] = fixed(prefill_phase_.ms > 0 ? prefill_phase_.tokens * 1000.0 / prefill_phase_.ms : 0.0);
+        result["engine_decode_rate"] = fixed(decode_phase_.ms > 0 ? decode_phase_.tokens * 1000.0 / decode_phase_.ms : 0.0);
+        result["prefill_threads"] = last_prefill_threads_;
+        result["decode_threads"] = params_.cpuparams.n_threads;
+        prefill_phase_ = {};
+        decode_phase_ = {};
+        return result;
+    }
 
-            for (int i = 0; i < (int) embd.size(); i += params_.n_batch)
+    common_params params_;
+    common_init_result llama_init;
+
+    ggml_threadpool *(*ggml_threadpool_new_fn)(ggml_threadpool_params *){};
+
+    void (*ggml_threadpool_free_fn)(ggml_threadpool *){};
+
+    const llama_vocab *vocab = nullptr;
+    ggml_threadpool *threadpool_batch{};
+    ggml_threadpool *threadpool{};
+
+private:
+    void EngineLoop()
+    {
+        while (true)
+        {
             {
-                int n_eval = (int) embd.size() - i;
-                if (n_eval > params_.n_batch)
+                std::unique_lock<std::mutex> lk(queue_lock_);
+                queue_cond_.wait(lk, [this] { return exit_ || !waiting_.empty() || n_active_ > 0; });
+                if (exit_)
                 {
-                    n_eval = params_.n_batch;
+                    break;
                 }
+            }
+            Step();
+        }
+
+        for (auto &slot: slots_)
+        {
+            if (slot.request)
+            {
+                Finish(slot, false);
+            }
+        }
+
+        std::lock_guard<std::mutex> lk(queue_lock_);
+        for (auto &request: waiting_)
+        {
+            {
+                std::lock_guard<std::mutex> request_lk(request->lock);
+                request->finished = true;
+                request->succeed = false;
+            }
+            request->cond.notify_one();
+        }
+        waiting_.clear();
+    }
+
+    void Step()
+    {
+        llama_context *ctx = llama_init.context.get();
+        llama_memory_t mem = llama_get_memory(ctx);
+
+        for (auto &slot: slots_)
+        {
+            if (slot.request && slot.request->cancel)
+            {
+                Finish(slot, true);
+            }
+        }
+        Admit(mem);
+
+        const auto step_begin = std::chrono::steady_clock::now();
+        if (Speculative())
+        {
+            Draft();
+        }
+
+        common_batch_clear(batch_);
+        std::vector<size_t> rollback(slots_.size());
+        for (auto &slot: slots_)
+        {
+            rollback[slot.id] = slot.cache.size();
+            if (!slot.request || !slot.generating)
+            {
+                continue;
+            }
+            slot.i_batch = batch_.n_tokens;
+            common_batch_add(batch_, slot.sampled, (llama_pos) slot.cache.size(), {slot.id}, true);
+            slot.cache.push_back(slot.sampled);
+            for (auto token: slot.draft)
+            {
+                common_batch_add(batch_, token, (llama_pos) slot.cache.size(), {slot.id}, true);
+                slot.cache.push_back(token);
+            }
+        }
 
-                if (llama_decode(ctx, llama_batch_get_one(&embd[i], n_eval)))
+        // prompts are prefilled in chunks with whatever room is left in this step.
+        int n_prompt_tokens = 0;
+        for (auto &slot: slots_)
+        {
+            if (!slot.request || slot.generating)
+            {
+                continue;
+            }
+            auto &prompt = slot.request->prompt;
+            while (batch_.n_tokens < n_batch_ && slot.cache.size() < prompt.size())
+            {
+                size_t pos = slot.cache.size();
+                bool last = pos + 1 == prompt.size();
+                if (last)
                 {
-                    My_Log{My_Log::Level::kError} << "decode failed\n";
-                    return false;
+                    slot.i_batch = batch_.n_tokens;
                 }
+                common_batch_add(batch_, prompt[pos], (llama_pos) pos, {slot.id}, last);
+                slot.cache.push_back(prompt[pos]);
+                ++n_prompt_tokens;
+            }
+        }
 
-                n_past += n_eval;
+        if (batch_.n_tokens == 0)
+        {
+            return;
+        }
+
+        SetBatchThreads(ctx, batch_.n_tokens, n_threads_batch_);
+        int ret = llama_decode(ctx, batch_);
+        if (ret != 0)
+        {
+            for (auto &slot: slots_)
+            {
+                if (slot.cache.size() > rollback[slot.id])
+                {
+                    llama_memory_seq_rm(mem, slot.id, (llama_pos) rollback[slot.id], -1);
+                    slot.cache.resize(rollback[slot.id]);
+                }
+                slot.i_batch = -1;
             }
 
-            embd.clear();
+            if (ret != 1)
+            {
+                My_Log{My_Log::Level::kError} << "decode failed: " << ret << "\n";
+                for (auto &slot: slots_)
+                {
+                    if (slot.request)
+                    {
+                        Finish(slot, false);
+                    }
+                }
+                return;
+            }
 
-            if ((int) embd_inp.size() <= n_consumed && !is_interacting)
+            /*
+             * No room in the kv cache, free a sequence and retry on the next step. The prefix caches of the idle
+             * slots go first, least recently used first, a request is only ended when no idle slot holds cells;
+             * then the longest sequence is.
+             */
+            Slot *victim = nullptr;
+            for (auto &slot: slots_)
+            {
+                if (!slot.request && !slot.cache.empty() && (!victim || slot.last_used < victim->last_used))
+                {
+                    victim = &slot;
+                }
+            }
+            if (victim)
             {
-                const llama_token id = common_sampler_sample(smpl, ctx, -1);
-                common_sampler_accept(smpl, id, true);
-                embd.push_back(id);
-                input_echo = true;
+                My_Log{My_Log::Level::kWarning} << "kv cache is full, drop the prefix cache of sequence: "
+                                                << victim->id << "\n";
             }
             else
             {
-                while ((int) embd_inp.size() > n_consumed)
+                for (auto &slot: slots_)
                 {
-                    embd.push_back(embd_inp[n_consumed]);
-                    common_sampler_accept(smpl, embd_inp[n_consumed], false);
-                    ++n_consumed;
-                    if ((int) embd.size() >= params_.n_batch)
+                    if (slot.request && (!victim || slot.cache.size() > victim->cache.size()))
                     {
-                        break;
+                        victim = &slot;
                     }
                 }
+                if (victim)
+                {
+                    My_Log{My_Log::Level::kWarning} << "kv cache is full, evict sequence: " << victim->id << "\n";
+                    Finish(*victim, victim->generating);
+                }
+            }
+            if (victim)
+            {
+                llama_memory_seq_rm(mem, victim->id, -1, -1);
+                victim->cache.clear();
+            }
+            return;
+        }
+
+        int n_generated = 0;
+        for (auto &slot: slots_)
+        {
+            if (!slot.request || slot.i_batch < 0)
+            {
+                continue;
             }
 
-            if (input_echo)
+            std::vector<llama_token> ids;
+            if (slot.draft.empty())
+            {
+                ids.push_back(common_sampler_sample(slot.smpl, ctx, slot.i_batch));
+                common_sampler_accept(slot.smpl, ids.back(), true);
+            }
+            else
             {
-                for (auto id: embd)
+                // the drafts are accepted up to the first one the target samples differently, then the token it
+                // sampled there follows. The kv of the rejected drafts is removed.
+                std::vector<int> idxs(slot.draft.size() + 1);
+                std::iota(idxs.begin(), idxs.end(), slot.i_batch);
+                ids = common_sampler_sample_and_accept_n(slot.smpl, ctx, idxs, slot.draft);
+
+                const size_t keep = slot.cache.size() - slot.draft.size() + ids.size() - 1;
+                llama_memory_seq_rm(mem, slot.id, (llama_pos) keep, -1);
+                slot.cache.resize(keep);
+                slot.request->n_drafted += (int) slot.draft.size();
+                slot.request->n_accepted += (int) ids.size() - 1;
+                slot.draft.clear();
+            }
+            slot.i_batch = -1;
+            slot.generating = true;
+            if (slot.n_decoded == 0)
+            {
+                slot.request->first_token = std::chrono::steady_clock::now();
+            }
+
+            std::string piece;
+            bool done = false;
+            for (auto id: ids)
+            {
+                ++slot.n_decoded;
+                ++n_generated;
+                if (llama_vocab_is_eog(vocab, id))
                 {
-                    std::string token_str = common_token_to_piece(ctx, id, params_.special);
-                    callback(token_str);
+                    done = true;
+                    break;
+                }
+
+                piece += common_token_to_piece(ctx, id, params_.special);
+                slot.sampled = id;
+
+                if ((int) slot.cache.size() + 1 >= n_ctx_
+                    || (params_.n_predict > 0 && slot.n_decoded >= params_.n_predict))
+                {
+                    done = true;
+                    break;
                 }
             }
 
-            if ((int) embd_inp.size() <= n_consumed)
+            if (!piece.empty())
             {
-                if (!waiting_for_first_input && llama_vocab_is_eog(vocab, common_sampler_last(smpl)))
                 {
-                    is_interacting = true;
+                    std::lock_guard<std::mutex> lk(slot.request->lock);
+                    slot.request->pending += piece;
                 }
+                slot.request->cond.notify_one();
+            }
+
+            if (done)
+            {
+                Finish(slot, true);
+            }
+        }
+
+        // a step with prompt tokens is a prefill step, its time is mostly theirs.
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - step_begin).count();
+        std::lock_guard<std::mutex> lk(profile_lock_);
+        Phase &phase = n_prompt_tokens > 0 ? prefill_phase_ : decode_phase_;
+        phase.ms += ms;
+        phase.tokens += n_prompt_tokens > 0 ? n_prompt_tokens : n_generated;
+        if (n_prompt_tokens > 0)
+        {
+            last_prefill_threads_ = n_threads_batch_;
+        }
+    }
+
+    // one prefill thread per prefill_tokens_per_thread tokens of the batch, from the decode threads up to the
+    // prefill threads. llama.cpp runs a batch of more than one token on the prefill threadpool.
+    void SetBatchThreads(llama_context *ctx, int n_tokens, int &current)
+    {
+        const int decode = params_.cpuparams.n_threads;
+        const int prefill = params_.cpuparams_batch.n_threads;
+        int threads = prefill;
+        if (prefill_tokens_per_thread_ > 0)
+        {
+            threads = std::clamp((n_tokens + prefill_tokens_per_thread_ - 1) / prefill_tokens_per_thread_,
+                                 std::min(decode, prefill), prefill);
+        }
+        if (threads != current)
+        {
+            llama_set_n_threads(ctx, decode, threads);
+            current = threads;
+        }
+    }
+
+    // the draft model of speculative decoding, without a usable one the context decodes as before.
+    void InitDraft()
+    {
+        common_params params_dft = params_;
+        params_dft.model = params_.speculative.model;
+        params_dft.n_ctx = n_ctx_;
+        draft_init_ = common_init_from_params(params_dft);
+
+        llama_model *model_dft = draft_init_.model.get();
+        llama_context *ctx_dft = draft_init_.context.get();
+        if (!model_dft || !ctx_dft)
+        {
+            My_Log{My_Log::Level::kError} << "unable to load draft model: " << params_.speculative.model.path << "\n";
+            draft_init_ = {};
+            return;
+        }
+
+        const llama_vocab *vocab_dft = llama_model_get_vocab(model_dft);
+        if (!DraftVocabCompatible(vocab_dft))
+        {
+            My_Log{My_Log::Level::kError} << "draft model does not share the vocab of the model: "
+                                          << params_.speculative.model.path << "\n";
+            draft_init_ = {};
+            return;
+        }
 
-                if ((n_past > 0 || waiting_for_first_input) && is_interacting)
+        llama_attach_threadpool(ctx_dft, threadpool, threadpool_batch);
+        n_vocab_ = std::min(llama_vocab_n_tokens(vocab), llama_vocab_n_tokens(vocab_dft));
+        draft_batch_ = llama_batch_init(n_batch_, 0, params_.n_parallel);
+
+        My_Log{} << "draft model: " << params_.speculative.model.path << ", "
+                 << "draft_max: " << params_.speculative.n_max << ", "
+                 << "draft_min: " << params_.speculative.n_min << ", "
+                 << "draft_p_min: " << params_.speculative.p_min << "\n";
+    }
+
+    /*
+     * The same rules as llama.cpp's speculative example: the sizes of the vocabs of one family may differ by the
+     * padding at the end, e.g. Qwen2.5 0.5B 151936 and 7B 152064, the tokens they share must be the same.
+     */
+    bool DraftVocabCompatible(const llama_vocab *vocab_dft) const
+    {
+        static constexpr int kMaxSizeDifference = 128;
+        static constexpr int kCheckStart = 5;
+
+        if (llama_vocab_type(vocab_dft) != llama_vocab_type(vocab)
+            || llama_vocab_get_add_bos(vocab_dft) != llama_vocab_get_add_bos(vocab)
+            || llama_vocab_get_add_eos(vocab_dft) != llama_vocab_get_add_eos(vocab)
+            || (llama_vocab_get_add_bos(vocab) && llama_vocab_bos(vocab_dft) != llama_vocab_bos(vocab))
+            || (llama_vocab_get_add_eos(vocab) && llama_vocab_eos(vocab_dft) != llama_vocab_eos(vocab)))
+        {
+            return false;
+        }
+
+        const int n_tgt = llama_vocab_n_tokens(vocab);
+        const int n_dft = llama_vocab_n_tokens(vocab_dft);
+        if (std::abs(n_tgt - n_dft) > kMaxSizeDifference)
+        {
+            return false;
+        }
+        for (int t = kCheckStart; t < std::min(n_tgt, n_dft); ++t)
+        {
+            if (std::strcmp(llama_vocab_get_text(vocab, t), llama_vocab_get_text(vocab_dft, t)) != 0)
+            {
+                My_Log{My_Log::Level::kError} << "draft vocab differs at token " << t << "\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Speculative() const
+    {
+        return draft_init_.context != nullptr;
+    }
+
+    // the i-th token of cache + sampled + drafts.
+    static llama_token DraftInput(const Slot &slot, size_t i)
+    {
+        if (i < slot.cache.size())
+        {
+            return slot.cache[i];
+        }
+        return i == slot.cache.size() ? slot.sampled : slot.draft[i - slot.cache.size() - 1];
+    }
+
+    // the most likely next token and its probability, over the tokens the draft and the target vocabs share.
+    llama_token Greedy(llama_context *ctx, int i, float &p) const
+    {
+        const float *logits = llama_get_logits_ith(ctx, i);
+        const int best = (int) (std::max_element(logits, logits + n_vocab_) - logits);
+        double sum = 0.0;
+        for (int t = 0; t < n_vocab_; ++t)
+        {
+            sum += std::exp((double) logits[t] - logits[best]);
+        }
+        p = (float) (1.0 / sum);
+        return best;
+    }
+
+    /*
+     * The draft model proposes up to draft_max tokens for every generating slot. The slots are drafted together,
+     * one batched decode per drafted position, after the draft sequence of a slot has caught up with its cache.
+     * A slot stops at the first token the draft model is not sure of, p < draft_p_min, a draft shorter than
+     * draft_min is not verified.
+     */
+    void Draft()
+    {
+        llama_context *ctx_dft = draft_init_.context.get();
+        llama_memory_t mem_dft = llama_get_memory(ctx_dft);
+        const auto &spec = params_.speculative;
+
+        // every generating slot puts its sampled token and its drafts into the target batch.
+        int budget = n_batch_;
+        for (auto &slot: slots_)
+        {
+            budget -= (slot.request && slot.generating) ? 1 : 0;
+        }
+
+        std::vector<Slot *> drafting;
+        for (auto &slot: slots_)
+        {
+            slot.draft.clear();
+            if (!slot.request || !slot.generating)
+            {
+                continue;
+            }
+
+            int room = std::min({spec.n_max, budget, n_ctx_ - 2 - (int) slot.cache.size()});
+            if (params_.n_predict > 0)
+            {
+                room = std::min(room, params_.n_predict - slot.n_decoded - 1);
+            }
+            if (room < std::max(spec.n_min, 1))
+            {
+                continue;
+            }
+            budget -= room;
+
+            // keep the prefix shared with cache + sampled, the last of them is evaluated again for its logits.
+            size_t keep = 0;
+            const size_t limit = std::min(slot.draft_cache.size(), slot.cache.size());
+            while (keep < limit && slot.draft_cache[keep] == slot.cache[keep])
+            {
+                ++keep;
+            }
+            llama_memory_seq_rm(mem_dft, slot.id, (llama_pos) keep, -1);
+            slot.draft_cache.resize(keep);
+            slot.draft_room = room;
+            drafting.push_back(&slot);
+        }
+
+        while (!drafting.empty())
+        {
+            common_batch_clear(draft_batch_);
+            for (auto *slot: drafting)
+            {
+                const size_t n = slot->cache.size() + 1 + slot->draft.size();
+                slot->i_draft = -1;
+                while (draft_batch_.n_tokens < n_batch_ && slot->draft_cache.size() < n)
                 {
-                    if (!waiting_for_first_input)
+                    const size_t pos = slot->draft_cache.size();
+                    const bool last = pos + 1 == n;
+                    if (last)
                     {
-                        break;
+                        slot->i_draft = draft_batch_.n_tokens;
                     }
+                    const llama_token token = DraftInput(*slot, pos);
+                    common_batch_add(draft_batch_, token, (llama_pos) pos, {slot->id}, last);
+                    slot->draft_cache.push_back(token);
+                }
+            }
 
-                    const auto line_inp = common_tokenize(ctx, prompt, false, true);
-                    llama_token eot = llama_vocab_eot(vocab);
-                    embd_inp.push_back(eot == LLAMA_TOKEN_NULL ? llama_vocab_eos(vocab) : eot);
-                    embd_inp.insert(embd_inp.end(), line_inp.begin(), line_inp.end());
-                    input_echo = false;
+            SetBatchThreads(ctx_dft, draft_batch_.n_tokens, n_threads_draft_batch_);
+            if (llama_decode(ctx_dft, draft_batch_) != 0)
+            {
+                My_Log{My_Log::Level::kWarning} << "draft decode failed, decode without drafts\n";
+                for (auto &slot: slots_)
+                {
+                    llama_memory_seq_rm(mem_dft, slot.id, -1, -1);
+                    slot.draft_cache.clear();
+                    slot.draft.clear();
                 }
+                return;
+            }
 
-                if (n_past > 0 || waiting_for_first_input)
+            std::vector<Slot *> next;
+            for (auto *slot: drafting)
+            {
+                if (slot->i_draft < 0)
                 {
-                    if (is_interacting)
+                    // still catching up with the cache.
+                    next.push_back(slot);
+                    continue;
+                }
+
+                float p;
+                const llama_token token = Greedy(ctx_dft, slot->i_draft, p);
+                if (p >= spec.p_min)
+                {
+                    slot->draft.push_back(token);
+                    if ((int) slot->draft.size() < slot->draft_room)
                     {
-                        common_sampler_reset(smpl);
+                        next.push_back(slot);
+                        continue;
                     }
-                    is_interacting = false;
-                    waiting_for_first_input = false;
+                }
+
+                if ((int) slot->draft.size() < spec.n_min)
+                {
+                    slot->draft.clear();
                 }
             }
+            drafting.swap(next);
         }
-
-        std::lock_guard<std::mutex> lk(m);
-        done = true;
-        cv.notify_one();
-        return true;
     }
 
-    ~Impl()
+    // move waiting requests into free slots, the slot sharing the longest prefix wins.
+    void Admit(llama_memory_t mem)
     {
-        common_sampler_free(smpl);
-        llama_backend_free();
-        ggml_threadpool_free_fn(threadpool);
-        ggml_threadpool_free_fn(threadpool_batch);
-    }
+        std::lock_guard<std::mutex> lk(queue_lock_);
+        while (!waiting_.empty())
+        {
+            auto &request = waiting_.front();
+            if (request->cancel)
+            {
+                {
+                    std::lock_guard<std::mutex> request_lk(request->lock);
+                    request->finished = true;
+                }
+                request->cond.notify_one();
+                waiting_.pop_front();
+                continue;
+            }
 
-    common_params params_;
-    common_init_result llama_init;
+            Slot *best = nullptr;
+            size_t best_prefix = 0;
+            for (auto &slot: slots_)
+            {
+                if (slot.request)
+                {
+                    continue;
+                }
 
-    ggml_threadpool *(*ggml_threadpool_new_fn)(ggml_threadpool_params *){};
+                size_t prefix = 0;
+                size_t limit = std::min(slot.cache.size(), request->prompt.size());
+                while (prefix < limit && slot.cache[prefix] == request->prompt[prefix])
+                {
+                    ++prefix;
+                }
 
-    void (*ggml_threadpool_free_fn)(ggml_threadpool *){};
+                if (!best || prefix > best_prefix)
+                {
+                    best = &slot;
+                    best_prefix = prefix;
+                }
+            }
 
-    const llama_vocab *vocab = nullptr;
-    common_sampler *smpl = nullptr;
-    ggml_threadpool *threadpool_batch{};
-    ggml_threadpool *threadpool{};
+            if (!best)
+            {
+                break;
+            }
+
+            // the last prompt token is always evaluated, its logits start the generation.
+            if (best_prefix == request->prompt.size())
+            {
+                --best_prefix;
+            }
+            llama_memory_seq_rm(mem, best->id, (llama_pos) best_prefix, -1);
+            best->cache.resize(best_prefix);
 
-    int n_past = 0;
-    int n_consumed = 0;
+            common_sampler_reset(best->smpl);
+            for (auto token: request->prompt)
+            {
+                common_sampler_accept(best->smpl, token, false);
+            }
 
-    std::vector<llama_token> embd;
-    std::vector<llama_token> embd_inp;
+            best->request = std::move(request);
+            best->request->admitted = std::chrono::steady_clock::now();
+            best->request->n_prompt = (int) (best->request->prompt.size() - best_prefix);
+            best->generating = false;
+            best->i_batch = -1;
+            best->n_decoded = 0;
+            waiting_.pop_front();
+            ++n_active_;
 
-    std::mutex m;
-    std::condition_variable cv;
-    bool is_interacting = true;
-    bool done{false};
+#ifdef LLAMA_BUILDER_DEBUG
+            My_Log{} << "admit request into sequence: " << best->id << ", "
+                     << "prompt tokens: " << best->request->prompt.size() << ", "
+                     << "reused tokens: " << best_prefix << "\n";
+#endif
+        }
+    }
+
+    void Finish(Slot &slot, bool succeed)
+    {
+        if (slot.n_decoded > 0)
+        {
+            using ms = std::chrono::duration<double, std::milli>;
+            const auto &request = *slot.request;
+            std::lock_guard<std::mutex> lk(profile_lock_);
+            last_profile_.prompt_ms = ms(request.first_token - request.admitted).count();
+            last_profile_.generation_ms = ms(std::chrono::steady_clock::now() - request.first_token).count();
+            last_profile_.n_prompt = request.n_prompt;
+            last_profile_.n_generated = slot.n_decoded;
+            last_profile_.n_drafted = request.n_drafted;
+            last_profile_.n_accepted = request.n_accepted;
+        }
+
+        {
+            std::lock_guard<std::mutex> lk(slot.request->lock);
+            slot.request->finished = true;
+            slot.request->succeed = succeed;
+        }
+        slot.request->cond.notify_one();
+        slot.request = nullptr;
+        slot.last_used = ++use_clock_;
+        slot.generating = false;
+        slot.i_batch = -1;
+        slot.draft.clear();
+        --n_active_;
+    }
 
-private:
     static void RegisterLogAdapter()
     {
         llama_log_set([](ggml_log_level level, const char *text, void * /*user_data*/)
@@ -278,40 +994,185 @@ private:
                           My_Log{my_level} << text;
                       }, nullptr);
     }
+
+    int n_ctx_{};
+    int n_batch_{};
+    llama_batch batch_{};
+    std::vector<Slot> slots_;
+    int n_active_{};
+    uint64_t use_clock_{};
+
+    std::mutex queue_lock_;
+    std::condition_variable queue_cond_;
+    std::deque<std::shared_ptr<Request>> waiting_;
+    std::list<std::shared_ptr<Request>> requests_;
+    bool exit_{false};
+    std::thread engine_thread_;
+
+    common_init_result draft_init_;
+    llama_batch draft_batch_{};
+    int n_vocab_{};
+
+    int prefill_tokens_per_thread_{};
+    int n_threads_batch_{};
+    int n_threads_draft_batch_{};
+
+    struct Phase
+    {
+        double ms{};
+        int64_t tokens{};
+    };
+
+    std::mutex profile_lock_;
+    Profile last_profile_;
+    Phase prefill_phase_;
+    Phase decode_phase_;
+    int last_prefill_threads_{};
 };
 
-LLAMACppBuilder::LLAMACppBuilder(const IModelConfig &info) :
-        ContextBase{info}
+// pin the threads of a phase to a CPU set of the "llama_cpp" config, threads <= 0 keeps the count.
+static void PlaceThreads(cpu_params &cpu, const std::string &phase, const std::string &spec, int threads,
+                         const std::vector<CpuPlacement::Cpu> &topology)
 {
-    std::string gguf_path;
-    for (const auto &entry: fs::directory_iterator(model_config_.get_model_path()))
+    if (!spec.empty())
     {
-        if (entry.is_regular_file() && entry.path().extension() == ".gguf")
+        try
+        {
+            const auto cpus = CpuPlacement::Parse(spec, topology);
+            std::fill(std::begin(cpu.cpumask), std::end(cpu.cpumask), false);
+            for (int index: cpus)
+            {
+                if (index < (int) std::size(cpu.cpumask))
+                {
+                    cpu.cpumask[index] = true;
+                }
+            }
+            cpu.mask_valid = true;
+            // each thread on the next CPU of the set, so the threads of the phases do not move onto each other.
+            cpu.strict_cpu = true;
+            threads = threads > 0 ? std::min(threads, (int) cpus.size()) : (int) cpus.size();
+            My_Log{} << phase << " threads on CPUs: " << CpuPlacement::ToString(cpus) << "\n";
+        }
+        catch (const std::invalid_argument &e)
         {
-            gguf_path = entry.path().string();
+            My_Log{My_Log::Level::kWarning} << phase << " CPU set is ignored: " << e.what() << "\n";
         }
     }
 
+    if (threads > 0)
+    {
+        cpu.n_threads = threads;
+    }
+}
+
+LLAMACppBuilder::LLAMACppBuilder(const IModelConfig &info) :
+        ContextBase{info}
+{
     common_params params;
     char *name[3]{"GenieService.exe", "--model" ,"gguf"};
     if (!common_params_parse(3, name, params, LLAMA_EXAMPLE_COMPLETION, nullptr))
     {
         throw std::runtime_error("common param parse failed");
     }
-    params.model.path = gguf_path;
-    impl_ = new Impl{std::move(params)};
+
+    // optional "llama_cpp" section in the model config.json, e.g. {"llama_cpp": {"n_parallel": 4}}
+    json options;
+    auto &config_path = model_config_.get_config_path();
+    if (File::IsFileExist(config_path) && !File::IsFileEmpty(config_path))
+    {
+        try
+        {
+            std::ifstream file(config_path);
+            json j;
+            file >> j;
+            if (j.contains("llama_cpp") && j["llama_cpp"].is_object())
+            {
+                options = j["llama_cpp"];
+            }
+        }
+        catch (const std::exception &e)
+        {
+            My_Log{My_Log::Level::kWarning} << "config file is invalid, use default llama.cpp options: "
+                                            << e.what() << "\n";
+        }
+    }
+    params.n_parallel = get_json_value(options, "n_parallel", 4);
+    params.n_ctx = get_json_value(options, "n_ctx", (int) params.n_ctx);
+
+    // speculative decoding with a small draft model of the same vocab, a file in the model folder or a path, e.g.
+    // {"llama_cpp": {"draft_model": "qwen2.5-0.5b-instruct-q8_0.gguf", "draft_max": 8, "draft_min": 2, "draft_p_min": 0.75}}
+    fs::path draft_path{get_json_value(options, "draft_model", std::string{})};
+    if (!draft_path.empty())
+    {
+        if (draft_path.is_relative())
+        {
+            draft_path = fs::path{model_config_.get_model_path()} / draft_path;
+        }
+        params.speculative.model.path = draft_path.string();
+        params.speculative.n_max = get_json_value(options, "draft_max", params.speculative.n_max);
+        params.speculative.n_min = get_json_value(options, "draft_min", params.speculative.n_min);
+        params.speculative.p_min = (float) get_json_value(options, "draft_p_min", (double) params.speculative.p_min);
+    }
+
+    /*
+     * CPU placement, e.g. decode on the P-cores and prefill on all cores, a prefill thread per 32 prompt tokens:
+     * {"llama_cpp": {"decode_cpus": "performance", "prefill_cpus": "all", "decode_threads": 4, "prefill_threads": 12,
+     *                "prefill_tokens_per_thread": 32, "numa": "distribute"}}
+     * A CPU set is "performance", "efficiency", "node:N", "all" or CPU indices and ranges, see cpu_placement.h.
+     */
+    const auto decode_cpus = get_json_value(options, "decode_cpus", std::string{});
+    const auto prefill_cpus = get_json_value(options, "prefill_cpus", std::string{});
+    if (!decode_cpus.empty() || !prefill_cpus.empty())
+    {
+        const auto topology = CpuPlacement::Topology();
+        PlaceThreads(params.cpuparams, "decode", decode_cpus, get_json_value(options, "decode_threads", 0), topology);
+        PlaceThreads(params.cpuparams_batch, "prefill", prefill_cpus, get_json_value(options, "prefill_threads", 0), topology);
+    }
+    else
+    {
+        params.cpuparams.n_threads = get_json_value(options, "decode_threads", (int) params.cpuparams.n_threads);
+        params.cpuparams_batch.n_threads = get_json_value(options, "prefill_threads", (int) params.cpuparams_batch.n_threads);
+    }
+    const int prefill_tokens_per_thread = get_json_value(options, "prefill_tokens_per_thread", 32);
+
+    const auto numa = get_json_value(options, "numa", std::string{});
+    if (numa == "distribute")
+    {
+        params.numa = GGML_NUMA_STRATEGY_DISTRIBUTE;
+    }
+    else if (numa == "isolate")
+    {
+        params.numa = GGML_NUMA_STRATEGY_ISOLATE;
+    }
+    else if (numa == "numactl")
+    {
+        params.numa = GGML_NUMA_STRATEGY_NUMACTL;
+    }
+
+    for (const auto &entry: fs::directory_iterator(model_config_.get_model_path()))
+    {
+        std::error_code ec;
+        if (entry.is_regular_file() && entry.path().extension() == ".gguf"
+            && !(!draft_path.empty() && fs::equivalent(entry.path(), draft_path, ec)))
+        {
+            params.model.path = entry.path().string();
+        }
+    }
+
+    impl_ = new Impl{std::move(params), prefill_tokens_per_thread};
 }
 
-bool LLAMACppBuilder::Query(const ModelInput &model_input, const Callback& callback)
+bool LLAMACppBuilder::Query(const ModelInput &model_input, const Callback &callback)
 {
     auto &prompt = model_input.text_;
 #ifdef LLAMA_BUILDER_DEBUG
     My_Log{} << "\n[Prompt]:\n"
-             << prompt << "\n------------\n\n"
+             << (model_input.tokens_.empty() ? prompt : std::to_string(model_input.tokens_.size()) + " tokens")
+             << "\n------------\n\n"
              << "[Response]:\n";
 #endif
 
-    return impl_->Query(prompt, callback);
+    return impl_->Query(prompt, model_input.tokens_, model_input.session_, callback);
 }
 
 LLAMACppBuilder::~LLAMACppBuilder()
@@ -320,21 +1181,51 @@ LLAMACppBuilder::~LLAMACppBuilder()
     impl_ = nullptr;
 }
 
+// the queries of the default session, i.e. the ones without X-Session-Id.
 bool LLAMACppBuilder::Stop()
 {
-    std::unique_lock<std::mutex> lk(impl_->m);
-    impl_->is_interacting = false;
-    impl_->cv.wait(lk, [this]
-    { return impl_->done; });
+    impl_->Stop({});
+    return true;
+}
+
+bool LLAMACppBuilder::StopSession(const std::string &session)
+{
+    impl_->Stop(session);
     return true;
 }
 
 json LLAMACppBuilder::HandleProfile()
 {
-    return {};
+    return impl_->GetProfile();
 }
 
 size_t LLAMACppBuilder::TokenLength(const std::string &text)
 {
-    return impl_->embd_inp.size();
+    return common_tokenize(impl_->vocab, text, false, true).size();
+}
+
+bool LLAMACppBuilder::Tokenize(const std::string &text, std::vector<int32_t> &tokens)
+{
+    tokens = common_tokenize(impl_->vocab, text, false, true);
+    return true;
+}
+
+bool LLAMACppBuilder::SupportTokenInput() const
+{
+    return true;
+}
+
+// llama.cpp partitions the text at control and user defined tokens before tokenizing the pieces,
+// unless the token also eats the whitespace next to it.
+bool LLAMACppBuilder::IsSpecialToken(int32_t token) const
+{
+    auto attr = llama_vocab_get_attr(impl_->vocab, token);
+    return (attr & (LLAMA_TOKEN_ATTR_CONTROL | LLAMA_TOKEN_ATTR_USER_DEFINED))
+           && !(attr & (LLAMA_TOKEN_ATTR_LSTRIP | LLAMA_TOKEN_ATTR_RSTRIP));
+}
+
+// every query is a request of the batching engine.
+bool LLAMACppBuilder::SupportConcurrentQuery() const
+{
+    return true;
 }
@@ -22,8 +22,18 @@ public:
 
     bool Stop() override;
 
+    bool StopSession(const std::string &session) override;
+
     size_t TokenLength(const std::string &text) override;
 
+    bool Tokenize(const std::string &text, std::vector<int32_t> &tokens) override;
+
+    bool SupportTokenInput() const override;
+
+    bool IsSpecialToken(int32_t token) const override;
+
+    bool SupportConcurrentQuery() const override;
+
     json HandleProfile() override;
 
 private:
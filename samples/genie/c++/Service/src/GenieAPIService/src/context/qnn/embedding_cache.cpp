@@ -0,0 +1,401 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#include "embedding_cache.h"
+#include "log.h"
+
+#include <Utils/Hash.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+constexpr uint32_t kSpillMagic = 0x324D4547;  // "GEM2", the header carries the whole key
+constexpr uint64_t kCheckSeed = 0x5BD1E9955BD1E995ULL;
+
+template<typename T>
+void WritePod(std::ofstream &out, const T &v)
+{
+    out.write(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+template<typename T>
+bool ReadPod(std::ifstream &in, T &v)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&v), sizeof(T)));
+}
+}
+
+EmbeddingCache::EmbeddingCache(size_t budget_bytes, const std::string &spill_dir, size_t spill_cap_bytes,
+                               const std::string &model_identity) :
+        budget_{budget_bytes}, spill_root_{spill_dir}, spill_cap_{spill_cap_bytes}
+{
+    if (!enabled() || spill_root_.empty())
+    {
+        return;
+    }
+
+    char name[17];
+    uint64_t model = Hash(reinterpret_cast<const uint8_t *>(model_identity.data()), model_identity.size());
+    snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(model));
+    spill_dir_ = (fs::path{spill_root_} / name).string();
+
+    std::error_code ec;
+    fs::create_directories(spill_dir_, ec);
+    if (ec)
+    {
+        My_Log{My_Log::Level::kError} << "create embedding cache dir " << spill_dir_ << " failed: "
+                                      << ec.message() << "\n";
+        spill_dir_.clear();
+        return;
+    }
+    TrimSpillDir();
+}
+
+// the shared xxHash64 style hash of LibAppBuilder, a decoded image of a few MB is hashed at memory speed.
+uint64_t EmbeddingCache::Hash(const uint8_t *data, size_t size, uint64_t seed)
+{
+    return qnn::tools::hashBytes(data, size, seed);
+}
+
+EmbeddingCache::Key EmbeddingCache::MakeKey(const uint8_t *data, size_t size, uint64_t seed)
+{
+    return Key{Hash(data, size, seed), Hash(data, size, seed ^ kCheckSeed), size};
+}
+
+bool EmbeddingCache::Get(const Key &key, Entry &entry)
+{
+    if (!enabled())
+    {
+        return false;
+    }
+
+    std::unique_lock lock(mutex_);
+    auto it = index_.find(key.hash);
+    if (it != index_.end())
+    {
+        if (it->second->key != key)
+        {
+            ++misses_;
+            My_Log{} << "embedding cache hash collision, treated as a miss\n";
+            return false;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second);
+        entry = it->second->entry;
+        ++hits_;
+        My_Log{} << "embedding cache hit, hits: " << hits_ << ", misses: " << misses_
+                 << ", resident: " << used_ / (1024 * 1024) << " MB\n";
+        return true;
+    }
+    lock.unlock();
+
+    std::vector<Node> spilled;
+    bool reloaded = Reload(key, entry);
+
+    lock.lock();
+    if (reloaded)
+    {
+        if (!index_.count(key.hash))
+        {
+            Insert(key, entry, spilled);
+        }
+        ++hits_;
+        My_Log{} << "embedding cache hit on disk, hits: " << hits_ << ", misses: " << misses_
+                 << ", resident: " << used_ / (1024 * 1024) << " MB\n";
+    }
+    else
+    {
+        ++misses_;
+        My_Log{} << "embedding cache miss, hits: " << hits_ << ", misses: " << misses_ << "\n";
+    }
+    lock.unlock();
+
+    for (const auto &node: spilled)
+    {
+        Spill(node);
+    }
+    return reloaded;
+}
+
+void EmbeddingCache::Put(const Key &key, const Entry &entry)
+{
+    if (!enabled())
+    {
+        return;
+    }
+
+    std::vector<Node> spilled;
+    {
+        std::lock_guard guard(mutex_);
+        auto it = index_.find(key.hash);
+        if (it != index_.end())
+        {
+            if (it->second->key == key)
+            {
+                return;
+            }
+            // a colliding input, the newer one takes the slot.
+            used_ -= it->second->bytes;
+            lru_.erase(it->second);
+            index_.erase(it);
+        }
+        Insert(key, entry, spilled);
+    }
+
+    for (const auto &node: spilled)
+    {
+        Spill(node);
+    }
+}
+
+void EmbeddingCache::Insert(const Key &key, Entry entry, std::vector<Node> &spilled)
+{
+    const size_t bytes = SizeOf(entry);
+    if (bytes > budget_)
+    {
+        spilled.push_back(Node{key, std::move(entry), bytes});
+        return;
+    }
+
+    while (used_ + bytes > budget_ && !lru_.empty())
+    {
+        used_ -= lru_.back().bytes;
+        index_.erase(lru_.back().key.hash);
+        spilled.push_back(std::move(lru_.back()));
+        lru_.pop_back();
+    }
+
+    lru_.push_front(Node{key, std::move(entry), bytes});
+    index_[key.hash] = lru_.begin();
+    used_ += bytes;
+}
+
+size_t EmbeddingCache::SizeOf(const Entry &entry)
+{
+    size_t bytes = entry.state.size() * sizeof(int);
+    for (const auto &buffer: entry.buffers)
+    {
+        bytes += buffer.size();
+    }
+    return bytes;
+}
+
+std::string EmbeddingCache::SpillPath(uint64_t hash) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.emb", static_cast<unsigned long long>(hash));
+    return (fs::path{spill_dir_} / name).string();
+}
+
+void EmbeddingCache::Spill(const Node &node)
+{
+    if (spill_dir_.empty())
+    {
+        return;
+    }
+
+    // the content is addressed by the key, an existing file already holds the same entry or a colliding one.
+    auto path = SpillPath(node.key.hash);
+    std::error_code ec;
+    if (fs::exists(path, ec))
+    {
+        return;
+    }
+
+    // concurrent spills of the same key each write their own temporary file, the rename is atomic.
+    auto tmp = path + "." + std::to_string(spill_seq_.fetch_add(1)) + ".tmp";
+    uint64_t written;
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        if (!out.good())
+        {
+            My_Log{My_Log::Level::kError} << "open " << tmp << " failed\n";
+            return;
+        }
+
+        WritePod(out, kSpillMagic);
+        WritePod(out, node.key.check);
+        WritePod(out, node.key.size);
+        WritePod(out, static_cast<uint32_t>(node.entry.state.size()));
+        for (int v: node.entry.state)
+        {
+            WritePod(out, static_cast<int32_t>(v));
+        }
+        WritePod(out, static_cast<uint32_t>(node.entry.buffers.size()));
+        for (const auto &buffer: node.entry.buffers)
+        {
+            WritePod(out, static_cast<uint64_t>(buffer.size()));
+            out.write(reinterpret_cast<const char *>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        }
+        written = static_cast<uint64_t>(out.tellp());
+        if (!out.good())
+        {
+            My_Log{My_Log::Level::kError} << "write " << tmp << " failed\n";
+            out.close();
+            fs::remove(tmp, ec);
+            return;
+        }
+    }
+    fs::rename(tmp, path, ec);
+    if (ec)
+    {
+        fs::remove(tmp, ec);
+        return;
+    }
+
+    bool trim;
+    {
+        std::lock_guard guard(spill_mutex_);
+        spill_bytes_ += written;
+        trim = spill_cap_ && spill_bytes_ > spill_cap_;
+    }
+    if (trim)
+    {
+        TrimSpillDir();
+    }
+}
+
+/*
+ * count the whole spill root, the other models and processes sharing it included,
+ * and remove the least recently written files until it is back within 3/4 of the cap.
+ */
+void EmbeddingCache::TrimSpillDir()
+{
+    std::lock_guard guard(spill_mutex_);
+    struct File
+    {
+        fs::path path;
+        uint64_t size;
+        fs::file_time_type time;
+    };
+    std::vector<File> files;
+    size_t total{0};
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(spill_root_, ec);
+         !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        std::error_code file_ec;
+        if (!it->is_regular_file(file_ec) || it->path().extension() != ".emb")
+        {
+            continue;
+        }
+        File file{it->path(), it->file_size(file_ec), it->last_write_time(file_ec)};
+        if (!file_ec)
+        {
+            total += file.size;
+            files.push_back(std::move(file));
+        }
+    }
+
+    if (spill_cap_ && total > spill_cap_)
+    {
+        std::sort(files.begin(), files.end(), [](const File &a, const File &b) { return a.time < b.time; });
+        const size_t target = spill_cap_ / 4 * 3;
+        size_t removed{0};
+        for (const auto &file: files)
+        {
+            if (total <= target)
+            {
+                break;
+            }
+            if (fs::remove(file.path, ec))
+            {
+                total -= file.size;
+                ++removed;
+            }
+        }
+        My_Log{} << "embedding cache dir trimmed by " << removed << " files, " << total / (1024 * 1024)
+                 << " MB left\n";
+    }
+    spill_bytes_ = total;
+}
+
+bool EmbeddingCache::Reload(const Key &key, Entry &entry) const
+{
+    if (spill_dir_.empty())
+    {
+        return false;
+    }
+
+    const auto path = SpillPath(key.hash);
+    std::error_code ec;
+    const uint64_t file_size = fs::file_size(path, ec);
+    if (ec)
+    {
+        return false;
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in.good())
+    {
+        return false;
+    }
+
+    // every count and size read from the file is bounded by the bytes left, a truncated or corrupted file
+    // fails the reload instead of a huge allocation.
+    uint64_t remaining = file_size;
+    auto take = [&remaining](uint64_t bytes)
+    {
+        if (bytes > remaining)
+        {
+            return false;
+        }
+        remaining -= bytes;
+        return true;
+    };
+
+    uint32_t magic{}, count{};
+    Key stored{key.hash};
+    if (!take(sizeof(magic) + sizeof(stored.check) + sizeof(stored.size) + sizeof(count)) ||
+        !ReadPod(in, magic) || magic != kSpillMagic ||
+        !ReadPod(in, stored.check) || !ReadPod(in, stored.size) || stored != key ||
+        !ReadPod(in, count) || !take(static_cast<uint64_t>(count) * sizeof(int32_t)))
+    {
+        return false;
+    }
+
+    Entry loaded;
+    loaded.state.resize(count);
+    for (auto &v: loaded.state)
+    {
+        int32_t value{};
+        if (!ReadPod(in, value))
+        {
+            return false;
+        }
+        v = value;
+    }
+
+    if (!take(sizeof(count)) || !ReadPod(in, count) || !take(static_cast<uint64_t>(count) * sizeof(uint64_t)))
+    {
+        return false;
+    }
+    loaded.buffers.resize(count);
+    for (auto &buffer: loaded.buffers)
+    {
+        uint64_t size{};
+        if (!ReadPod(in, size) || !take(size))
+        {
+            return false;
+        }
+        buffer.resize(size);
+        if (!in.read(reinterpret_cast<char *>(buffer.data()), static_cast<std::streamsize>(size)))
+        {
+            return false;
+        }
+    }
+
+    // keep the reloaded file young, the directory is trimmed by the write time.
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    entry = std::move(loaded);
+    return true;
+}
@@ -0,0 +1,118 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#ifndef EMBEDDING_CACHE_H
+#define EMBEDDING_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Content addressed cache of the vision / audio encoder outputs.
+ * A chat client resends the same image or audio on every turn, the key is a hash of the decoded bytes plus
+ * the preprocessing parameters, so a follow-up turn reuses the encoder outputs instead of running the
+ * preprocessing and the encoder again.
+ * The entries are evicted in LRU order to stay within the memory budget, with a spill directory the evicted
+ * entries are written to disk and reloaded on the next hit.
+ * The spill directory may be shared by several models, each model spills into a subdirectory named by the hash
+ * of its identity, and the oldest spilled files are removed once the directory exceeds its cap.
+ */
+class EmbeddingCache
+{
+public:
+    struct Entry
+    {
+        std::vector<int> state;                     // the preprocessing results needed to merge, e.g. token count
+        std::vector<std::vector<uint8_t>> buffers;  // the encoder outputs
+    };
+
+    /*
+     * hash addresses the entry, a hit also needs the input size and a second hash with another seed to match,
+     * so a 64-bit collision is not taken for the same input.
+     */
+    struct Key
+    {
+        uint64_t hash{};
+        uint64_t check{};
+        uint64_t size{};
+
+        bool operator==(const Key &other) const
+        {
+            return hash == other.hash && check == other.check && size == other.size;
+        }
+
+        bool operator!=(const Key &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    /*
+     * model_identity tells apart the models sharing spill_dir, e.g. the model path plus the graph configuration.
+     * spill_cap_bytes bounds the whole spill directory, 0: unbounded.
+     */
+    EmbeddingCache(size_t budget_bytes, const std::string &spill_dir, size_t spill_cap_bytes,
+                   const std::string &model_identity);
+
+    bool enabled() const { return budget_ > 0; }
+
+    // qnn::tools::hashBytes of LibAppBuilder, see Utils/Hash.hpp.
+    static uint64_t Hash(const uint8_t *data, size_t size, uint64_t seed = 0);
+
+    // the key of the input bytes, seed covers the preprocessing parameters.
+    static Key MakeKey(const uint8_t *data, size_t size, uint64_t seed);
+
+    // copy the entry out, the caller may modify the buffers while merging.
+    bool Get(const Key &key, Entry &entry);
+
+    void Put(const Key &key, const Entry &entry);
+
+private:
+    struct Node
+    {
+        Key key;
+        Entry entry;
+        size_t bytes;
+    };
+
+    static size_t SizeOf(const Entry &entry);
+
+    std::string SpillPath(uint64_t hash) const;
+
+    // the file I/O below runs without mutex_ held.
+    void Spill(const Node &node);
+
+    bool Reload(const Key &key, Entry &entry) const;
+
+    void TrimSpillDir();
+
+    // insert under mutex_, the evicted nodes are moved to `spilled` for the caller to write after unlocking.
+    void Insert(const Key &key, Entry entry, std::vector<Node> &spilled);
+
+    std::mutex mutex_;
+    std::list<Node> lru_;  // the most recently used at the front
+    std::unordered_map<uint64_t, std::list<Node>::iterator> index_;
+    size_t budget_;
+    size_t used_{};
+    size_t hits_{};
+    size_t misses_{};
+
+    std::string spill_root_;
+    std::string spill_dir_;
+    size_t spill_cap_;
+    std::mutex spill_mutex_;   // guards spill_bytes_ and the trimming
+    size_t spill_bytes_{};     // the size of spill_root_, recounted on every trim
+    std::atomic<uint64_t> spill_seq_{};
+};
+
+#endif //EMBEDDING_CACHE_H
@@ -91,6 +91,39 @@ void GenieContext::Reset()
     inf_impl_->inf_->cur_length_ = 0;
 }
 
+static IAudioEmbedding *AudioInterface(QInterfaceImpl *impl)
+{
+    auto *audio = impl ? dynamic_cast<IAudioEmbedding *>(impl->inf_) : nullptr;
+    if (!audio)
+    {
+        throw ReportError{"the model does not support audio stream"};
+    }
+    return audio;
+}
+
+void GenieContext::BeginAudioStream()
+{
+    AudioInterface(inf_impl_)->BeginAudioStream();
+}
+
+void GenieContext::AppendAudio(const char *data, size_t size)
+{
+    AudioInterface(inf_impl_)->AppendAudio(reinterpret_cast<const uint8_t *>(data), size);
+}
+
+json GenieContext::EndAudioStream()
+{
+    return AudioInterface(inf_impl_)->EndAudioStream();
+}
+
+void GenieContext::AbortAudioStream()
+{
+    if (auto *audio = inf_impl_ ? dynamic_cast<IAudioEmbedding *>(inf_impl_->inf_) : nullptr)
+    {
+        audio->AbortAudioStream();
+    }
+}
+
 bool GenieContext::Query(const ModelInput &model_input, const Callback &callback)
 {
     Genie_Status_t status = 0;
@@ -359,6 +392,28 @@ size_t GenieContext::TokenLength(const std::string &text)
     return len;
 }
 
+bool GenieContext::Tokenize(const std::string &text, std::vector<int32_t> &tokens)
+{
+    const int32_t *buf;
+    uint32_t len;
+    if (!GenerateTextToken(text, buf, len))
+    {
+        return false;
+    }
+
+    tokens.assign(buf, buf + len);
+    free((void *) buf);
+    return true;
+}
+
+bool GenieContext::SupportTokenInput() const
+{
+    // only the embedding dialog is fed by the token to embedding LUT, the general one takes text.
+    auto &qnn_embedding = model_config_.get_qnn_embedding();
+    auto model_type = qnn_embedding.model_types_;
+    return qnn_embedding.embedding_type_ != QNNEmbeddingType::None && (model_type & ModelType::Text);
+}
+
 void GenieContext::applyLora(const std::string &engineRole, const std::string &loraAdapterName)
 {
     int32_t status = GenieDialog_applyLora(m_DialogHandle, engineRole.c_str(), loraAdapterName.c_str());
@@ -44,6 +44,10 @@ public:
 
     size_t TokenLength(const std::string &text) override;
 
+    bool Tokenize(const std::string &text, std::vector<int32_t> &tokens) override;
+
+    bool SupportTokenInput() const override;
+
     bool SetStopSequence(const std::string &stop_sequences) override;
 
     void applyLora(const std::string &engineRole,
@@ -54,6 +58,14 @@ public:
 
     void Reset() override;
 
+    void BeginAudioStream() override;
+
+    void AppendAudio(const char *data, size_t size) override;
+
+    json EndAudioStream() override;
+
+    void AbortAudioStream() override;
+
     struct QInterfaceImpl;
 
     class ConfigFixer;
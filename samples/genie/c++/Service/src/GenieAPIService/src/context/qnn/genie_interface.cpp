@@ -12,18 +12,77 @@
 #include "utils.h"
 #include "base64.h"
 #include <LibAppBuilder.hpp>
+#include <EmbeddingTable.hpp>
+#include <filesystem>
+#include <future>
+#include <map>
 
 #include "phi4mm/phi4mm.h"
 #include "qwen2_5/qwen_2_5.h"
 #include "qwen2_5_omini/qwen_2_5_omini.h"
 
+// the model path and the graph configuration of the encoders, the models sharing a spill dir are told apart by it.
+static std::string EmbeddingIdentity(const IModelConfig &config)
+{
+    std::error_code ec;
+    auto path = std::filesystem::weakly_canonical(config.get_model_path(), ec);
+    std::string identity = (ec ? std::filesystem::path{config.get_model_path()} : path).generic_string();
+
+    const auto &embedding = config.get_qnn_embedding();
+    identity += "|" + std::string{embedding.embedding_type_.to_string()};
+    std::map<int, const QNNEmbedding::InferResource *> resources;
+    for (const auto &resource: embedding.infer_resources_)
+    {
+        resources.emplace(int(resource.first), &resource.second);
+    }
+    for (const auto &[type, resource]: resources)
+    {
+        identity += "|" + std::to_string(type) + ":" + resource->tag_ + ":" + std::to_string(resource->batch_);
+        for (auto bytes: resource->input_row_bytes_)
+        {
+            identity += "," + std::to_string(bytes);
+        }
+        for (const auto &bin: resource->bin_stacks_)
+        {
+            identity += ";" + std::to_string(bin.size());
+        }
+    }
+    return identity;
+}
+
 IEmbedding::IEmbedding(GenieContext *context) :
         QInterface(context),
-        qnn_embedding_info_{context->model_config_.get_qnn_embedding()} {}
+        qnn_embedding_info_{context->model_config_.get_qnn_embedding()},
+        cache_{static_cast<size_t>(context->model_config_.getEmbeddingCacheMb()) * 1024 * 1024,
+               context->model_config_.getEmbeddingCacheDir(),
+               static_cast<size_t>(context->model_config_.getEmbeddingCacheDirMb()) * 1024 * 1024,
+               EmbeddingIdentity(context->model_config_)} {}
+
+EmbeddingCache::Key IEmbedding::CacheKey(const ByteBuffer &decoded_buf,
+                                         ModelType model_type,
+                                         int width,
+                                         int height) const
+{
+    // the model itself is told apart by the cache instance and its spill subdirectory, only the preprocessing here.
+    const int32_t params[]{static_cast<int32_t>(int(qnn_embedding_info_.embedding_type_)),
+                           static_cast<int32_t>(int(model_type)),
+                           width,
+                           height,
+                           cols_};
+    uint64_t seed = EmbeddingCache::Hash(reinterpret_cast<const uint8_t *>(params), sizeof(params));
+    return EmbeddingCache::MakeKey(decoded_buf.data(), decoded_buf.size(), seed);
+}
 
 void QInterface::OutPutText(ModelInput &model_input)
 {
 #ifdef GENIE_BUILDER_DEBUG
+    if (!model_input.tokens_.empty())
+    {
+        My_Log{} << "\n[Prompt]:\n"
+                 << model_input.tokens_.size() << " tokens\n------------\n\n"
+                 << "[Response]:\n";
+        return;
+    }
     My_Log{} << "\n[Prompt]:\n"
              << model_input.text_ << "\n------------\n\n"
              << "[Response]:\n";
@@ -72,13 +131,23 @@ IEmbedding *IEmbedding::CreateInterface(GenieContext *context)
 bool IEmbedding::set_content(ModelInput &model_input)
 {
     auto model_type = qnn_embedding_info_.model_types_;
-    if (model_input.image_.empty() && model_input.audio_.empty())
+    const bool has_audio = !model_input.audio_.empty() || !model_input.audio_id_.empty();
+    if (model_input.image_.empty() && !has_audio)
     {
         if (model_type & ModelType::Text)
         {
             OutPutText(model_input);
-            this->BuildTextEmbedding(model_input.text_)
-                .MergeEmbedding();
+            if (!model_input.tokens_.empty())
+            {
+                // the prompt is assembled from cached token ids, skip the re-encoding.
+                this->BuildTextEmbedding(model_input.tokens_)
+                    .MergeEmbedding();
+            }
+            else
+            {
+                this->BuildTextEmbedding(model_input.text_)
+                    .MergeEmbedding();
+            }
             goto ahead;
         }
         else
@@ -95,7 +164,7 @@ bool IEmbedding::set_content(ModelInput &model_input)
         }
     }
 
-    if (!model_input.audio_.empty())
+    if (has_audio)
     {
         if (!(model_type & ModelType::Audio))
         {
@@ -128,20 +197,21 @@ void IEmbedding::TokenToEmbedCallback(const int32_t token,
                                       const void *userData)
 {
     auto *self = static_cast<IEmbedding *>(const_cast<void *>(userData));
-    const size_t lutIndex = token * embeddingSize;
-    if (lutIndex + embeddingSize <= self->qnn_embedding_info_
-                                        .embedded_raw_buf_
-                                        .size())
+    const auto &table = self->qnn_embedding_info_.embedding_table_;
+    if (!table || !table->lookup(token, embedding, embeddingSize))
     {
-        const int8_t *embeddingSrc = reinterpret_cast<const int8_t *>(self->qnn_embedding_info_
-                                                                          .embedded_raw_buf_
-                                                                          .data()) + lutIndex;
-        auto *embeddingDst = static_cast<int8_t *>(embedding);
-        std::copy(embeddingSrc, embeddingSrc + embeddingSize, embeddingDst);
+        My_Log{My_Log::Level::kError} << "Error: T2E conversion overflow.\n";
     }
-    else
+}
+
+void IEmbedding::EmbedToken(int32_t token, float *dst, size_t cols) const
+{
+    const auto &table = qnn_embedding_info_.embedding_table_;
+    if (!table || !table->lookup(token, dst, cols * sizeof(float)))
     {
-        My_Log{My_Log::Level::kError} << "Error: T2E conversion overflow.\n";
+        throw std::runtime_error("token id " + std::to_string(token) + " is out of the embedding table, "
+                                 + "row width: " + std::to_string(cols) + ", table bytes: "
+                                 + std::to_string(table ? table->mappedBytes() : 0));
     }
 }
 
@@ -162,43 +232,164 @@ std::string QInterfaceImpl::IEmbedding::GeneratePaddingPrompt(const std::string
     return prompt;
 }
 
-IEmbedding &QInterfaceImpl::IEmbedding::Decode(std::string &encode_buf, std::vector<uint8_t> &decoded_buf)
+/*
+ * Decode the attachment straight into decoded_buf, which is reused across requests and not zero filled,
+ * a data URL ("data:image/png;base64,...") is decoded from its payload on.
+ * decoded_buf is cut to the decoded size, so the padding does not take part in the cache key.
+ */
+IEmbedding &QInterfaceImpl::IEmbedding::Decode(Attachment &encoded, ByteBuffer &decoded_buf)
 {
-    decoded_buf.resize(BASE64_DECODE_OUT_SIZE(encode_buf.size()));
-    if (Base64Decode(encode_buf.data(), encode_buf.size(), decoded_buf.data()) == 0)
+    std::string_view payload = encoded.view();
+    if (payload.compare(0, 5, "data:") == 0)
+    {
+        const size_t pos = payload.find(',');
+        payload.remove_prefix(pos == std::string_view::npos ? payload.size() : pos + 1);
+    }
+
+    decoded_buf.resize(BASE64_DECODE_OUT_SIZE(payload.size()));
+    const size_t size = Base64DecodeFast(payload.data(), payload.size(), decoded_buf.data());
+    encoded.clear();
+    if (size == 0)
     {
-        encode_buf.clear();
         throw std::runtime_error("decode to binrary failed");
     }
-    encode_buf.clear();
+    decoded_buf.resize(size);
     return *this;
 }
 
+/*
+ * Run the encoder over every crop, inferred_buffers[i] receives the output of input_buffers[i].
+ * When the graph takes several crops per execution they are packed into one, and with more than one
+ * execution the work is pipelined: execution k runs on a worker while the inputs of k + 1 are packed
+ * and the outputs of k - 1 are copied into their slots.
+ */
 IEmbedding &IEmbedding::BuildInferredBuffer(const QNNEmbedding::InferResource *infer_resource,
                                             std::vector<std::vector<uint8_t *>> &input_buffers,
                                             std::vector<std::vector<uint8_t>> &inferred_buffers)
 {
     static std::string perfProfile = "burst";
     auto app_builder = infer_resource->app_builder_;
-    std::vector<uint8_t *> outputBuffers;
-    std::vector<size_t> outputSize;
+    const size_t count = input_buffers.size();
+    const size_t batch = infer_resource->batch_;
+    inferred_buffers.resize(count);
+    if (!count)
+    {
+        return *this;
+    }
+
+    // a batched graph reads `batch` rows of every input, the caller's one-crop buffers are never handed to it.
+    for (const auto &inputs: input_buffers)
+    {
+        if (batch > 1 && inputs.size() != infer_resource->input_row_bytes_.size())
+        {
+            throw std::runtime_error("the crop has " + std::to_string(inputs.size()) + " inputs, the " +
+                                     infer_resource->tag_ + " encoder takes " +
+                                     std::to_string(infer_resource->input_row_bytes_.size()));
+        }
+    }
+
+    struct Execution
+    {
+        size_t first{};
+        size_t rows{};
+        std::vector<uint8_t *> inputs;
+        std::vector<uint8_t *> outputs;
+        std::vector<size_t> sizes;
+    };
+    Execution executions[2];
+    std::vector<std::vector<uint8_t>> staging[2];
+
+    auto pack = [&](Execution &exec, std::vector<std::vector<uint8_t>> &stage, size_t first)
+    {
+        exec.first = first;
+        exec.rows = std::min(batch, count - first);
+        if (batch == 1)
+        {
+            exec.inputs = input_buffers[first];
+            return;
+        }
+
+        const auto &row_bytes = infer_resource->input_row_bytes_;
+        stage.resize(row_bytes.size());
+        exec.inputs.resize(row_bytes.size());
+        for (size_t in = 0; in < row_bytes.size(); ++in)
+        {
+            stage[in].resize(batch * row_bytes[in]);
+            for (size_t r = 0; r < exec.rows; ++r)
+            {
+                std::memcpy(stage[in].data() + r * row_bytes[in], input_buffers[first + r][in], row_bytes[in]);
+            }
+            // a partial batch is zero padded, those rows of the output are dropped.
+            std::memset(stage[in].data() + exec.rows * row_bytes[in], 0, (batch - exec.rows) * row_bytes[in]);
+            exec.inputs[in] = stage[in].data();
+        }
+    };
+
+    auto run = [&](Execution &exec)
+    {
+        exec.outputs.clear();
+        exec.sizes.clear();
+        return app_builder->ModelInference(infer_resource->tag_, exec.inputs, exec.outputs, exec.sizes, perfProfile);
+    };
 
-    inferred_buffers.resize(input_buffers.size());
-    for (auto i = 0; i < input_buffers.size(); ++i)
+    auto release = [](Execution &exec)
     {
-        if (!app_builder->ModelInference(infer_resource->tag_,
-                                         input_buffers[i],
-                                         outputBuffers,
-                                         outputSize,
-                                         perfProfile))
+        for (auto *output: exec.outputs)
         {
+            free(output);
+        }
+        exec.outputs.clear();
+    };
+
+    auto collect = [&](Execution &exec)
+    {
+        const size_t row_size = exec.sizes.at(0) / batch;
+        for (size_t r = 0; r < exec.rows; ++r)
+        {
+            const uint8_t *row = exec.outputs[0] + r * row_size;
+            inferred_buffers[exec.first + r].assign(row, row + row_size);
+        }
+        release(exec);
+    };
+
+    if (count <= batch)
+    {
+        pack(executions[0], staging[0], 0);
+        if (!run(executions[0]))
+        {
+            release(executions[0]);
             throw std::runtime_error("call model inference failed");
         }
-        inferred_buffers[i].assign(outputBuffers.at(0), outputBuffers.at(0) + outputSize.at(0));
-        free(outputBuffers[0]);
-        outputSize.clear();
-        outputBuffers.clear();
+        collect(executions[0]);
+        return *this;
     }
+
+    std::future<bool> running;
+    Execution *previous = nullptr;
+    for (size_t first = 0, slot = 0; first < count; first += batch, slot ^= 1)
+    {
+        Execution &exec = executions[slot];
+        pack(exec, staging[slot], first);
+
+        if (previous && !running.get())
+        {
+            release(*previous);
+            throw std::runtime_error("call model inference failed");
+        }
+        running = std::async(std::launch::async, run, std::ref(exec));
+        if (previous)
+        {
+            collect(*previous);
+        }
+        previous = &exec;
+    }
+
+    if (!running.get())
+    {
+        release(*previous);
+        throw std::runtime_error("call model inference failed");
+    }
+    collect(*previous);
     return *this;
 }
 
@@ -216,31 +407,159 @@ std::string QInterfaceImpl::IEmbedding::BuildPrompt(const std::string &system,
 
 IEmbedding &QInterfaceImpl::IVisionEmbedding::CustomBuild(ModelInput &model_input)
 {
-    dynamic_cast<IVisionEmbedding &>(Decode(model_input.image_, img_buf_))
-            .BuildImgPixel()
+    Decode(model_input.image_, img_buf_);
+
+    EmbeddingCache::Entry entry;
+    const auto key = cache_.enabled() ? CacheKey(img_buf_, ModelType{ModelType::Vision}, kWidth, kHeight)
+                                      : EmbeddingCache::Key{};
+    if (cache_.Get(key, entry))
+    {
+        // the same image was encoded before, skip the preprocessing and the encoder.
+        img_buf_.clear();
+        RestoreVisionState(entry.state);
+        img_inferred_buffers_ = std::move(entry.buffers);
+        PaddingVisionPrompt();
+        return *this;
+    }
+
+    BuildImgPixel()
             .PaddingVisionPrompt()
             .BuildVisionInferredInput()
             .BuildInferredBuffer(infer_resource_,
                                  input_buffers_,
                                  img_inferred_buffers_);
+    cache_.Put(key, {SaveVisionState(), img_inferred_buffers_});
     return *this;
 }
 
 IEmbedding &QInterfaceImpl::IAudioEmbedding::CustomBuild(ModelInput &model_input)
 {
-    dynamic_cast<IAudioEmbedding &>(Decode(model_input.audio_, audio_buf_))
-            .BuildAudioSamples()
+    EmbeddingCache::Entry entry;
+    if (!model_input.audio_id_.empty())
+    {
+        // the audio was uploaded as a stream and encoded when the upload ended.
+        if (!TakeStreamedAudio(model_input.audio_id_, entry))
+        {
+            throw std::runtime_error("audio_id " + model_input.audio_id_ + " is unknown or expired");
+        }
+        token_index_ = entry.state.at(0);
+        audio_inferred_buf_ = std::move(entry.buffers);
+        PaddingAudioPrompt();
+        return *this;
+    }
+
+    Decode(model_input.audio_, audio_buf_);
+
+    const auto key = cache_.enabled() ? CacheKey(audio_buf_, ModelType{ModelType::Audio}, 0, 0) : EmbeddingCache::Key{};
+    if (cache_.Get(key, entry))
+    {
+        audio_buf_.clear();
+        token_index_ = entry.state.at(0);
+        audio_inferred_buf_ = std::move(entry.buffers);
+        PaddingAudioPrompt();
+        return *this;
+    }
+
+    BuildAudioSamples()
             .PaddingAudioPrompt()
             .BuildAudioInferredInput()
             .BuildInferredBuffer(infer_resource_,
                                  input_buffers_,
                                  audio_inferred_buf_);
+    cache_.Put(key, {{token_index_}, audio_inferred_buf_});
     return *this;
 }
 
+void QInterfaceImpl::IAudioEmbedding::BeginAudioStream()
+{
+    throw ReportError{"the model does not support audio stream"};
+}
+
+void QInterfaceImpl::IAudioEmbedding::AppendAudio(const uint8_t *, size_t)
+{
+    throw ReportError{"the model does not support audio stream"};
+}
+
+IAudioEmbedding &QInterfaceImpl::IAudioEmbedding::FinishAudioStream()
+{
+    throw ReportError{"the model does not support audio stream"};
+}
+
+json QInterfaceImpl::IAudioEmbedding::EndAudioStream()
+{
+    json result;
+    try
+    {
+        FinishAudioStream();
+        // keyed by the WAV bytes, the same file sent in one piece later hits the same cache entry.
+        const auto key = CacheKey(audio_buf_, ModelType{ModelType::Audio}, 0, 0);
+        result["samples"] = audio_sample_buf_.size();
+        result["duration"] = static_cast<double>(audio_sample_buf_.size()) / 16000;
+
+        streamed_key_ = key;
+        if (!cache_.Get(key, streamed_))
+        {
+            BuildAudioInferredInput()
+                    .BuildInferredBuffer(infer_resource_,
+                                         input_buffers_,
+                                         audio_inferred_buf_);
+            streamed_ = {{token_index_}, std::move(audio_inferred_buf_)};
+            cache_.Put(key, streamed_);
+        }
+
+        // the id carries the whole key, hash, check and size in hex.
+        char id[64];
+        snprintf(id, sizeof(id), "%016llx%016llx%llx", static_cast<unsigned long long>(key.hash),
+                 static_cast<unsigned long long>(key.check), static_cast<unsigned long long>(key.size));
+        result["audio_id"] = id;
+        result["tokens"] = streamed_.state.at(0);
+    }
+    catch (...)
+    {
+        IAudioEmbedding::CustomClean();
+        throw;
+    }
+    IAudioEmbedding::CustomClean();
+    return result;
+}
+
+bool QInterfaceImpl::IAudioEmbedding::TakeStreamedAudio(const std::string &audio_id, EmbeddingCache::Entry &entry)
+{
+    // the whole field must be hex digits, stoull alone would accept a sign or stop early.
+    auto parse = [](const std::string &hex, uint64_t &value)
+    {
+        if (hex.empty() || hex.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+        {
+            return false;
+        }
+        value = std::stoull(hex, nullptr, 16);
+        return true;
+    };
+
+    EmbeddingCache::Key key;
+    if (audio_id.size() <= 32 || audio_id.size() > 48 ||
+        !parse(audio_id.substr(0, 16), key.hash) ||
+        !parse(audio_id.substr(16, 16), key.check) ||
+        !parse(audio_id.substr(32), key.size))
+    {
+        return false;
+    }
+
+    if (cache_.Get(key, entry))
+    {
+        return true;
+    }
+    if (key != streamed_key_ || streamed_.buffers.empty())
+    {
+        return false;
+    }
+    entry = streamed_;
+    return true;
+}
+
 IEmbedding &IMultiModal::CustomBuild(ModelInput &model_input)
 {
-    if (!model_input.audio_.empty())
+    if (!model_input.audio_.empty() || !model_input.audio_id_.empty())
     {
         IAudioEmbedding::CustomBuild(model_input);
     }
@@ -10,6 +10,8 @@
 #define GENIE_IMPL_H
 
 #include "genie.h"
+#include "embedding_cache.h"
+#include "byte_buffer.h"
 
 #define GENIE_BUILDER_DEBUG 1
 
@@ -142,6 +144,9 @@ struct GenieContext::QInterfaceImpl
         std::vector<float> embedded_bin_;
         const QNNEmbedding &qnn_embedding_info_;
         int cols_{};
+        EmbeddingCache cache_;
+
+        EmbeddingCache::Key CacheKey(const ByteBuffer &decoded_buf, ModelType model_type, int width, int height) const;
 
         const QNNEmbedding::InferResource *get_infer_resource(ModelType mode_type)
         {
@@ -155,7 +160,10 @@ struct GenieContext::QInterfaceImpl
                                                  int times);
 
 
-        IEmbedding &Decode(std::string &encode_buf, std::vector<uint8_t> &decoded_buf);
+        // the float32 embedding of token, cols wide, from the LUT; throws if the token is not in it.
+        void EmbedToken(int32_t token, float *dst, size_t cols) const;
+
+        IEmbedding &Decode(Attachment &encoded, ByteBuffer &decoded_buf);
 
         IEmbedding &BuildInferredBuffer(const QNNEmbedding::InferResource *infer_resource,
                                         std::vector<std::vector<uint8_t *>> &input_buffers,
@@ -185,6 +193,22 @@ struct GenieContext::QInterfaceImpl
                                          uint32_t embeddingSize,
                                          const void *userData);
 
+        IEmbedding &BuildTextEmbedding(const std::vector<int32_t> &tokens)
+        {
+            if (prompt_token_)
+            {
+                free(prompt_token_);
+            }
+            prompt_token_ = static_cast<int32_t *>(malloc(tokens.size() * sizeof(int32_t)));
+            if (!prompt_token_)
+            {
+                throw std::runtime_error("alloc prompt token failed");
+            }
+            std::copy(tokens.begin(), tokens.end(), prompt_token_);
+            prompt_token_size_ = tokens.size();
+            return *this;
+        }
+
         IEmbedding &BuildTextEmbedding(const std::string &completed_prompt)
         {
             if (!context_->GenerateTextToken(completed_prompt,
@@ -244,13 +268,24 @@ struct GenieContext::QInterfaceImpl
 
         virtual IVisionEmbedding &Clean() { return *this; }
 
+        // the preprocessing results MergeEmbedding needs besides the encoder outputs, kept in the cache entry.
+        virtual std::vector<int> SaveVisionState() const
+        {
+            return {token_index_};
+        }
+
+        virtual void RestoreVisionState(const std::vector<int> &state)
+        {
+            token_index_ = state.at(0);
+        }
+
     protected:
         int kWidth{};
         int kHeight{};
 
         int token_index_{};
         std::string kPaddedList_;
-        std::vector<uint8_t> img_buf_{};
+        ByteBuffer img_buf_{};
         std::vector<float> img_pixel_buf_{};
         std::vector<std::vector<uint8_t *>> input_buffers_{};
         std::vector<std::vector<uint8_t>> img_inferred_buffers_{};
@@ -285,8 +320,31 @@ struct GenieContext::QInterfaceImpl
 
         virtual IAudioEmbedding &PaddingAudioPrompt() = 0;
 
+        /*
+         * Streaming input: the WAV is fed in chunks while it is recorded and featurized as it arrives, the encoder
+         * runs when the upload ends. The returned audio id refers to the outputs in the following queries.
+         */
+        virtual void BeginAudioStream();
+
+        virtual void AppendAudio(const uint8_t *data, size_t size);
+
+        json EndAudioStream();
+
+        virtual void AbortAudioStream() {}
+
+    protected:
+        // fill audio_buf_, audio_sample_buf_ and token_index_ from the finished stream.
+        virtual IAudioEmbedding &FinishAudioStream();
+
+        bool TakeStreamedAudio(const std::string &audio_id, EmbeddingCache::Entry &entry);
+
+        // the last finished stream, kept in case the cache is disabled or has evicted it.
+        EmbeddingCache::Key streamed_key_{};
+        EmbeddingCache::Entry streamed_;
+
+    public:
         int token_index_{};
-        std::vector<uint8_t> audio_buf_;
+        ByteBuffer audio_buf_;
         std::vector<float> audio_sample_buf_;
         std::vector<std::vector<uint8_t *>> input_buffers_{};
         std::vector<std::vector<uint8_t>> audio_inferred_buf_;
@@ -10,10 +10,9 @@
 #define PHI_4_EMBEDDING_H
 
 #include "../../torch_helper/base.h"
+#include "../../torch_helper/view.h"
 #include "../genie_interface.h"
 
-Shape_4D<float> repeat_shape4d(const Shape_4D_View<float> &in, int r0, int r1, int r2, int r3);
-
 class Image;
 
 class QInterface::PHI4Embedding : public IVisionEmbedding
@@ -28,12 +27,10 @@ public:
         kHeight = 448;
 
         FloatBufferView view{infer_resource_->tails_bin_stacks_[0]};
-        std::vector<float> buf{view.pointer_, view.pointer_ + view.size_};
-        glb_gn_ = {1, 1, C, buf};
+        glb_gn_ = View<const float, 1>::Contiguous(view.pointer_, {C});
 
         FloatBufferView view1{infer_resource_->tails_bin_stacks_[1]};
-        sub_gn_ = {1, 1, 1, C, view1.pointer_, static_cast<int>(view1.size_)};
-        glb_gn_repeat_ = repeat_shape4d(sub_gn_, 1, H, 1, 1);
+        sub_gn_ = View<const float, 1>::Contiguous(view1.pointer_, {C});
         cols_ = 8192;
     }
 
@@ -55,15 +52,29 @@ public:
         input_buffers_.reserve(valid_crops_);
         for (auto i = 0; i < valid_crops_; ++i)
         {
-            input_buffers_.push_back({reinterpret_cast<uint8_t *>(crop_pixels_[i].buf.data()),
-                                      reinterpret_cast<uint8_t *>(crop_position_ids_[i].buf.data()),
-                                      reinterpret_cast<uint8_t *>(crop_attention_mask_[i].buf.data())});
+            input_buffers_.push_back({reinterpret_cast<uint8_t *>(crop_pixels_.Select(0, i).data),
+                                      reinterpret_cast<uint8_t *>(crop_position_ids_.Select(0, i).data),
+                                      reinterpret_cast<uint8_t *>(crop_attention_mask_.Select(0, i).data)});
         }
         return *this;
     }
 
     IVisionEmbedding &MergeEmbedding() final;
 
+    std::vector<int> SaveVisionState() const final
+    {
+        return {token_index_, crop_h_, crop_w_, useful_height_, useful_width_};
+    }
+
+    void RestoreVisionState(const std::vector<int> &state) final
+    {
+        token_index_ = state.at(0);
+        crop_h_ = state.at(1);
+        crop_w_ = state.at(2);
+        useful_height_ = state.at(3);
+        useful_width_ = state.at(4);
+    }
+
     IVisionEmbedding &Clean() final
     {
         crop_h_ = 0;
@@ -74,10 +85,11 @@ public:
 
         token_index_ = 0;
         valid_crops_ = 0;
-        crop_pixels_.clear();
-        crop_position_ids_.clear();
-        crop_attention_mask_.clear();
+        crop_pixels_ = {};
+        crop_position_ids_ = {};
+        crop_attention_mask_ = {};
         input_buffers_.clear();
+        arena_.Reset();
         return *this;
     }
 
@@ -86,13 +98,11 @@ private:
 
     std::vector<std::pair<int, int>> GenerateTargetRatios();
 
-    Shape_4D<float> GenerateGlobalImg(const Image &img);
+    void GenerateGlobalImg(const Image &img, float *chw);
 
-    Shape_2D<int64_t> compute_position_ids(
-            const Shape_4D<float> &image_transformed,
-            const Shape_3D<uint8_t> &patch_attention_mask);
+    void ComputePositionIds(const View<const float, 3> &image_attention_mask);
 
-    Shape_3D<float> Compose();
+    View<const float, 2> Compose();
 
     const int C = 3072;
     const int DynamicHD = 9;
@@ -107,12 +117,14 @@ private:
     int useful_height_{};
     int useful_width_{};
 
-    Shape_3D<float> glb_gn_;
-    Shape_4D_View<float> sub_gn_;
-    Shape_4D<float> glb_gn_repeat_;
-    std::vector<Shape_4D<float>> crop_pixels_;
-    std::vector<Shape_4D<float>> crop_attention_mask_;
-    std::vector<Shape_2D<float>> crop_position_ids_;
+    View<const float, 1> glb_gn_;
+    View<const float, 1> sub_gn_;
+
+    // the tensors of the request in flight are views into the arena, Clean() resets it and keeps the memory.
+    Arena arena_;
+    View<float, 4> crop_pixels_{};          // the global image and the crops, [valid_crops_, 3, kHeight, kWidth]
+    View<float, 3> crop_attention_mask_{};  // [valid_crops_, L, L], L = kMaskSize * kMaskSize patches
+    View<float, 2> crop_position_ids_{};    // [valid_crops_, L]
 };
 
 #endif //PHI_4_EMBEDDING_H
@@ -37,6 +37,10 @@
 //#include <stb_image_write.h>
 
 // stb headers（注意：需在某个.cpp里先#define STB_*_IMPLEMENTATION）
+#include <stb_image.h>
+#include <stb_image_resize2.h>
+
+#include "../../torch_helper/img_preprocess.h"
 
 namespace qwen2_5
 {
@@ -102,12 +106,36 @@ namespace qwen2_5
             GeneratePixelValuesToBuffer(rgb_resized, out, rows, cols);
         }
 
+        // 融合路径：解码后直接白底合成到复用缓冲，缩放后一次完成归一化与patch展开，结果与 ProcessToBufferReference 逐位一致。
         void ProcessToBuffer(uint8_t *png_bin_buf,
                              unsigned long dwLen,
                              int request_h,
                              int request_w,
                              std::vector<float> &out,
-                             int &rows, int &cols) const
+                             int &rows, int &cols)
+        {
+            img_preprocess::DecodedRGB rgb{png_bin_buf, dwLen, rgb_arena_};
+            auto [rh, rw] = smart_resize(request_h, request_w, PATCH_FACTOR);
+            resized_arena_.resize(static_cast<size_t>(rw) * rh * 3);
+            if (!stbir_resize_uint8_linear(
+                    rgb.data(), rgb.w, rgb.h, 0,
+                    resized_arena_.data(), rw, rh, 0,
+                    STBIR_RGB))
+            {
+                throw std::runtime_error("stb_image_resize: resize failed");
+            }
+            img_preprocess::NormalizePatchify(resized_arena_.data(), rh, rw, MEAN, STD,
+                                              PATCH_SIZE, MERGE_SIZE, TEMPORAL_PATCH_SIZE,
+                                              out, rows, cols);
+        }
+
+        // 未融合的原始流程，保留用于逐位一致性校验（examples/tools/image_preprocess_check）。
+        void ProcessToBufferReference(uint8_t *png_bin_buf,
+                                      unsigned long dwLen,
+                                      int request_h,
+                                      int request_w,
+                                      std::vector<float> &out,
+                                      int &rows, int &cols) const
         {
             ImageU8 img = LoadImage_STB(png_bin_buf, dwLen);
             ImageU8 rgb = ToRGBWhiteBackground(img);
@@ -124,6 +152,10 @@ namespace qwen2_5
         }
 
     private:
+        // 跨请求复用的中间缓冲
+        std::vector<uint8_t> rgb_arena_;
+        std::vector<uint8_t> resized_arena_;
+
         // --- 工具函数（与原始实现一致） ---
         static inline int round_by_factor(int number, int factor)
         {
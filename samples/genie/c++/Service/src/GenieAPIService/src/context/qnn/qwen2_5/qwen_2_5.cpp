@@ -6,19 +6,13 @@
 //
 //==============================================================================
 
-#include <stb_image.h>
-#include <stb_image_resize2.h>
-
 #include "qwen_2_5.h"
-#include "qwen25_image_processor.hpp"
 #include "../../torch_helper/base.h"
 
 IVisionEmbedding &QInterface::Qwen2_5::BuildImgPixel()
 {
-    using namespace qwen2_5;
     int rows = 0, cols = 0;
-    Qwen25ImageProcessor proc;
-    proc.ProcessToBuffer(img_buf_.data(), img_buf_.size(), kHeight, kWidth, img_pixel_buf_, rows, cols);
+    image_processor_.ProcessToBuffer(img_buf_.data(), img_buf_.size(), kHeight, kWidth, img_pixel_buf_, rows, cols);
     img_buf_.clear();
     return *this;
 }
@@ -27,16 +21,11 @@ IVisionEmbedding &QInterface::Qwen2_5::MergeEmbedding()
 {
     static const int32_t rows{151655};
     const unsigned long token_count = prompt_token_size_;
-    FloatBufferView tmp_raw_fbuf{qnn_embedding_info_.embedded_raw_buf_};
-
     std::vector<float> embedded_raw_fbuf;
     embedded_raw_fbuf.resize(token_count * cols_);
-    float *dest_ptr;
     for (uint32_t i = 0; i < prompt_token_size_; ++i)
     {
-        dest_ptr = &embedded_raw_fbuf[i * cols_];
-        float *src_ptr = &tmp_raw_fbuf.pointer_[prompt_token_[i] * cols_];
-        std::memcpy(dest_ptr, src_ptr, cols_ * sizeof(float));
+        EmbedToken(prompt_token_[i], &embedded_raw_fbuf[i * cols_], cols_);
     }
 
     if (img_inferred_buffers_.empty())
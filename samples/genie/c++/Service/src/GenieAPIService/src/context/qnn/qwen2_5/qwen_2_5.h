@@ -10,6 +10,7 @@
 #define QWEN_2_5_H
 
 #include "../genie_interface.h"
+#include "qwen25_image_processor.hpp"
 #include "utils.h"
 
 class QInterface::Qwen2_5 : public IVisionEmbedding
@@ -47,6 +48,10 @@ public:
     IVisionEmbedding &BuildImgPixel() final;
 
     IVisionEmbedding &MergeEmbedding() override;
+
+private:
+    // kept across requests, its decode / resize arenas are reused.
+    qwen2_5::Qwen25ImageProcessor image_processor_;
 };
 
 #endif //QWEN_2_5_H
@@ -0,0 +1,293 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#include "audio_stream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+static const uint16_t kFormatPcm = 1;
+static const uint16_t kFormatFloat = 3;
+static const uint16_t kFormatExtensible = 0xFFFE;
+
+static uint16_t Read16(const uint8_t *p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t Read32(const uint8_t *p)
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8)
+           | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// the sample conversions of drwav_*_to_f32, so the samples match drwav_open_memory_and_read_pcm_frames_f32.
+static float ToFloat(const uint8_t *p, uint16_t format, uint16_t bits)
+{
+    if (format == kFormatFloat)
+    {
+        if (bits == 64)
+        {
+            double v;
+            std::memcpy(&v, p, sizeof(v));
+            return static_cast<float>(v);
+        }
+        float v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    switch (bits)
+    {
+        case 8:
+            return p[0] * 0.00784313725490196078f - 1;
+        case 16:
+            return static_cast<int16_t>(Read16(p)) * 0.000030517578125f;
+        case 24:
+        {
+            const auto a = (static_cast<uint32_t>(p[0]) << 8) | (static_cast<uint32_t>(p[1]) << 16)
+                           | (static_cast<uint32_t>(p[2]) << 24);
+            const auto x = static_cast<double>(static_cast<int32_t>(a) >> 8);
+            return static_cast<float>(x * 0.00000011920928955078125);
+        }
+        default:
+            return static_cast<float>(static_cast<int32_t>(Read32(p)) / 2147483648.0);
+    }
+}
+
+AudioStream::AudioStream(const LogMelSpectrogram &front_end, int sample_rate, size_t padded_size,
+                         size_t chunk, size_t max_chunks) :
+        front_end_{front_end},
+        sample_rate_{sample_rate},
+        padded_size_{padded_size},
+        chunk_{chunk},
+        max_chunks_{max_chunks},
+        features_(max_chunks * front_end.n_mels() * chunk, 0.0f) {}
+
+AudioStream::~AudioStream()
+{
+    if (src_)
+    {
+        src_delete(src_);
+    }
+}
+
+void AudioStream::Append(const uint8_t *data, size_t size)
+{
+    bytes_.insert(bytes_.end(), data, data + size);
+    if (!header_ && !ParseHeader())
+    {
+        return;
+    }
+
+    Decode();
+    Resample(false);
+    Featurize();
+}
+
+size_t AudioStream::Finish(std::vector<float> &features)
+{
+    if (!header_)
+    {
+        throw std::runtime_error("open wav file buffer failed");
+    }
+    Decode();
+    Resample(true);
+
+    // the one piece path sizes the output from the input frames, src_simple stops there or leaves zeros after it.
+    const auto size = static_cast<size_t>(std::ceil(frames_ * ratio_));
+    if (padded_size_ <= size)
+    {
+        throw std::runtime_error(std::to_string(size) + "  is bigger then kPaddingMaxLength");
+    }
+    if (size == 0)
+    {
+        throw std::runtime_error("audio has no samples");
+    }
+    samples_.resize(size);
+    samples_.back() = 0;
+
+    const size_t hop = front_end_.hop();
+    const size_t half = front_end_.n_fft() / 2;
+    if (windows_ && (windows_ * chunk_ - 1) * hop + half >= size)
+    {
+        // the resampler gave more samples than that, the windows reaching past the cut are computed again.
+        windows_ = 0;
+        max_ = -std::numeric_limits<float>::infinity();
+        std::fill(features_.begin(), features_.end(), 0.0f);
+    }
+
+    const size_t frames = (size + hop - 1) / hop;
+    if ((frames + chunk_ - 1) / chunk_ > max_chunks_)
+    {
+        throw std::runtime_error("N > max_len_channels; cannot fit");
+    }
+
+    // a finished window implies a full first chunk, so the stride of the streamed windows is always right.
+    const LogMelSpectrogram::Layout layout{chunk_, std::min(frames, chunk_)};
+    front_end_.Compute(samples_.data(), size, padded_size_, layout, features_.data(), windows_ * chunk_, max_);
+    features = std::move(features_);
+    return frames;
+}
+
+bool AudioStream::ParseHeader()
+{
+    if (bytes_.size() < 12)
+    {
+        return false;
+    }
+    if (std::memcmp(bytes_.data(), "RIFF", 4) != 0 || std::memcmp(bytes_.data() + 8, "WAVE", 4) != 0)
+    {
+        throw std::runtime_error("open wav file buffer failed");
+    }
+
+    size_t pos = 12;
+    while (pos + 8 <= bytes_.size())
+    {
+        const uint8_t *chunk = bytes_.data() + pos;
+        const uint32_t chunk_size = Read32(chunk + 4);
+        if (std::memcmp(chunk, "data", 4) == 0)
+        {
+            if (!channels_)
+            {
+                throw std::runtime_error("open wav file buffer failed");
+            }
+            data_begin_ = pos + 8;
+            // a live recorder writes the header before it knows the length.
+            data_end_ = chunk_size == 0 || chunk_size == 0xFFFFFFFFu ? std::numeric_limits<size_t>::max()
+                                                                       : data_begin_ + chunk_size;
+            break;
+        }
+
+        if (pos + 8 + chunk_size > bytes_.size())
+        {
+            return false;
+        }
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16)
+        {
+            format_ = Read16(chunk + 8);
+            channels_ = Read16(chunk + 10);
+            rate_ = Read32(chunk + 12);
+            bits_ = Read16(chunk + 22);
+            if (format_ == kFormatExtensible && chunk_size >= 26)
+            {
+                format_ = Read16(chunk + 32);
+            }
+
+            const bool pcm = format_ == kFormatPcm && (bits_ == 8 || bits_ == 16 || bits_ == 24 || bits_ == 32);
+            const bool ieee = format_ == kFormatFloat && (bits_ == 32 || bits_ == 64);
+            if (!channels_ || !rate_ || !(pcm || ieee))
+            {
+                throw std::runtime_error("unsupported wav format " + std::to_string(format_)
+                                         + ", " + std::to_string(bits_) + " bits");
+            }
+        }
+        pos += 8 + chunk_size + (chunk_size & 1);
+    }
+    if (!data_begin_)
+    {
+        return false;
+    }
+
+    int err = 0;
+    if (!(src_ = src_new(SRC_SINC_BEST_QUALITY, 1, &err)))
+    {
+        throw std::runtime_error(std::string("libsamplerate error: ") + src_strerror(err));
+    }
+    ratio_ = static_cast<double>(sample_rate_) / static_cast<double>(rate_);
+    header_ = true;
+    return true;
+}
+
+void AudioStream::Decode()
+{
+    const size_t sample_bytes = bits_ / 8;
+    const size_t frame_bytes = sample_bytes * channels_;
+    const size_t available = std::min(bytes_.size(), data_end_) - data_begin_ - decoded_;
+    // a frame cut by the end of the upload is dropped as dr_wav does.
+    const size_t count = available / frame_bytes;
+
+    const uint8_t *p = bytes_.data() + data_begin_ + decoded_;
+    const size_t first = mono_.size();
+    mono_.resize(first + count);
+    for (size_t i = 0; i < count; ++i, p += frame_bytes)
+    {
+        if (channels_ == 1)
+        {
+            mono_[first + i] = ToFloat(p, format_, bits_);
+            continue;
+        }
+
+        float sum = 0.0f;
+        for (uint16_t c = 0; c < channels_; ++c)
+        {
+            sum += ToFloat(p + c * sample_bytes, format_, bits_);
+        }
+        mono_[first + i] = sum / static_cast<float>(channels_);
+    }
+    decoded_ += count * frame_bytes;
+    frames_ += count;
+}
+
+void AudioStream::Resample(bool end)
+{
+    SRC_DATA data{};
+    data.data_in = mono_.data();
+    data.input_frames = static_cast<long>(mono_.size());
+    data.src_ratio = ratio_;
+    data.end_of_input = end ? 1 : 0;
+
+    while (data.input_frames > 0 || end)
+    {
+        const auto room = static_cast<size_t>(std::ceil(data.input_frames * ratio_)) + 1024;
+        const size_t first = samples_.size();
+        samples_.resize(first + room);
+        data.data_out = samples_.data() + first;
+        data.output_frames = static_cast<long>(room);
+
+        int err = src_process(src_, &data);
+        if (err != 0)
+        {
+            throw std::runtime_error(std::string("libsamplerate error: ") + src_strerror(err));
+        }
+        samples_.resize(first + data.output_frames_gen);
+        data.data_in += data.input_frames_used;
+        data.input_frames -= data.input_frames_used;
+
+        if (!data.input_frames_used && !data.output_frames_gen)
+        {
+            break;
+        }
+    }
+    mono_.erase(mono_.begin(), mono_.end() - data.input_frames);
+
+    if (padded_size_ <= samples_.size())
+    {
+        throw std::runtime_error(std::to_string(samples_.size()) + "  is bigger then kPaddingMaxLength");
+    }
+}
+
+void AudioStream::Featurize()
+{
+    const size_t hop = front_end_.hop();
+    const size_t half = front_end_.n_fft() / 2;
+    const LogMelSpectrogram::Layout layout{chunk_, chunk_};
+
+    // the last sample may still be the end of the audio, which is zeroed then, so the windows stay clear of it.
+    while (windows_ < max_chunks_ && ((windows_ + 1) * chunk_ - 1) * hop + half < samples_.size())
+    {
+        const float max = front_end_.LogFrames(samples_.data(), samples_.size(), padded_size_,
+                                               windows_ * chunk_, (windows_ + 1) * chunk_, layout,
+                                               features_.data());
+        max_ = std::max(max_, max);
+        ++windows_;
+    }
+}
@@ -0,0 +1,91 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#ifndef AUDIO_STREAM_H
+#define AUDIO_STREAM_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <samplerate.h>
+
+#include "byte_buffer.h"
+#include "log_mel.h"
+
+/*
+ * The audio front end of a WAV which is uploaded in chunks while it is recorded.
+ * Every chunk is decoded to mono as soon as it arrives and fed to a streaming libsamplerate converter, and every
+ * window of `chunk` log-mel frames is computed once its samples are complete. When the upload ends only the
+ * resampler tail and the last window are left, the samples and features are the same as the one piece path
+ * (dr_wav, src_simple, LogMelSpectrogram::Compute) produces for the same file.
+ */
+class AudioStream
+{
+public:
+    AudioStream(const LogMelSpectrogram &front_end, int sample_rate, size_t padded_size,
+                size_t chunk, size_t max_chunks);
+
+    ~AudioStream();
+
+    AudioStream(const AudioStream &) = delete;
+
+    AudioStream &operator=(const AudioStream &) = delete;
+
+    void Append(const uint8_t *data, size_t size);
+
+    /*
+     * Flush the resampler and finish the features into `features`, laid out as the encoder input
+     * ({chunk, min(frames, chunk)}, max_chunks windows). Returns the frame count.
+     */
+    size_t Finish(std::vector<float> &features);
+
+    // the whole upload, the cache key hashes it like the same file sent in one piece.
+    ByteBuffer &bytes() { return bytes_; }
+
+    // the resampled samples, the last one zeroed as the encoder input expects.
+    std::vector<float> &samples() { return samples_; }
+
+    size_t windows() const { return windows_; }
+
+private:
+    bool ParseHeader();
+
+    void Decode();
+
+    void Resample(bool end);
+
+    void Featurize();
+
+    const LogMelSpectrogram &front_end_;
+    const int sample_rate_;
+    const size_t padded_size_;
+    const size_t chunk_;
+    const size_t max_chunks_;
+
+    ByteBuffer bytes_;
+    bool header_{};
+    uint16_t format_{};
+    uint16_t channels_{};
+    uint16_t bits_{};
+    uint32_t rate_{};
+    size_t data_begin_{};
+    size_t data_end_{};  // the end of the data chunk, the end of the upload when the recorder did not know it
+    size_t decoded_{};   // the data bytes already decoded
+
+    SRC_STATE *src_{};
+    double ratio_{};
+    uint64_t frames_{};        // the input frames, the one piece path sizes its output from them
+    std::vector<float> mono_;  // decoded but not yet taken by the resampler
+    std::vector<float> samples_;
+
+    std::vector<float> features_;  // the finished windows, layout {chunk, chunk}
+    size_t windows_{};
+    float max_{-std::numeric_limits<float>::infinity()};
+};
+
+#endif //AUDIO_STREAM_H
@@ -0,0 +1,554 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#include "log_mel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+constexpr float kMinEnergy = 1e-10f;
+constexpr float kDynamicRange = 8.0f;
+constexpr double kPi = 3.14159265358979323846;
+
+// the slaney mel scale of librosa
+constexpr float kMelStep = 200.0f / 3.0f;
+constexpr float kMinLogHz = 1000.0f;
+
+float HzToMel(float hz)
+{
+    static const float log_step = std::log(6.4f) / 27.0f;
+    float mel = hz / kMelStep;
+    if (hz >= kMinLogHz)
+    {
+        mel = kMinLogHz / kMelStep + std::log(hz / kMinLogHz) / log_step;
+    }
+    return mel;
+}
+
+float MelToHz(float mel)
+{
+    static const float log_step = std::log(6.4f) / 27.0f;
+    const float min_log_mel = kMinLogHz / kMelStep;
+    if (mel > min_log_mel)
+    {
+        return std::exp((mel - min_log_mel) * log_step) * kMinLogHz;
+    }
+    return mel * kMelStep;
+}
+}
+
+LogMelSpectrogram::LogMelSpectrogram(int sample_rate, int n_fft, int hop, int n_mels, float f_min, float f_max) :
+        n_fft_{n_fft}, hop_{hop}, n_mels_{n_mels}, half_{static_cast<size_t>(n_fft / 2)}
+{
+    if (n_fft < 4 || n_fft % 2 != 0 || hop <= 0 || n_mels <= 0)
+    {
+        throw std::invalid_argument("log mel: n_fft must be even and at least 4, hop and n_mels positive");
+    }
+
+    window_.resize(n_fft_);
+    for (int n = 0; n < n_fft_; ++n)
+    {
+        window_[n] = 0.5f * (1.0f - std::cos(static_cast<float>(n) * 2.0f * static_cast<float>(kPi) / n_fft_));
+    }
+
+    // the mixed radix plan of the packed complex FFT, the same factor order as kissfft.
+    size_t n = half_;
+    size_t p = 4;
+    while (n > 1)
+    {
+        while (n % p != 0)
+        {
+            p = p == 4 ? 2 : p == 2 ? 3 : p + 2;
+            if (p * p > n)
+            {
+                p = n;
+            }
+        }
+        n /= p;
+        stages_.push_back({p, n});
+    }
+
+    twiddle_re_.resize(half_);
+    twiddle_im_.resize(half_);
+    for (size_t k = 0; k < half_; ++k)
+    {
+        double phase = -2.0 * kPi * static_cast<double>(k) / static_cast<double>(half_);
+        twiddle_re_[k] = static_cast<float>(std::cos(phase));
+        twiddle_im_[k] = static_cast<float>(std::sin(phase));
+    }
+
+    split_re_.resize(half_ + 1);
+    split_im_.resize(half_ + 1);
+    for (size_t k = 0; k <= half_; ++k)
+    {
+        double phase = -2.0 * kPi * static_cast<double>(k) / static_cast<double>(n_fft_);
+        split_re_[k] = static_cast<float>(std::cos(phase));
+        split_im_[k] = static_cast<float>(std::sin(phase));
+    }
+
+    // triangular filters with the slaney area normalization, kept sparse since each covers a few bins.
+    const size_t bins = half_ + 1;
+    const float min_mel = HzToMel(f_min);
+    const float max_mel = HzToMel(f_max);
+    const float mel_step = (max_mel - min_mel) / static_cast<float>(n_mels_ + 1);
+    std::vector<float> mel_f(n_mels_ + 2);
+    for (int i = 0; i < n_mels_ + 2; ++i)
+    {
+        float mel = i == n_mels_ + 1 ? max_mel : min_mel + static_cast<float>(i) * mel_step;
+        mel_f[i] = MelToHz(mel);
+    }
+
+    mel_begin_.resize(n_mels_);
+    mel_end_.resize(n_mels_);
+    mel_offset_.resize(n_mels_);
+    for (int m = 0; m < n_mels_; ++m)
+    {
+        const float lower_diff = mel_f[m + 1] - mel_f[m];
+        const float upper_diff = mel_f[m + 2] - mel_f[m + 1];
+        const float enorm = 2.0f / (mel_f[m + 2] - mel_f[m]);
+        mel_begin_[m] = bins;
+        mel_end_[m] = 0;
+        mel_offset_[m] = mel_weights_.size();
+        std::vector<float> row(bins);
+        for (size_t k = 0; k < bins; ++k)
+        {
+            float freq = static_cast<float>(k) * static_cast<float>(sample_rate) / static_cast<float>(n_fft_);
+            float lower = -(mel_f[m] - freq) / lower_diff;
+            float upper = (mel_f[m + 2] - freq) / upper_diff;
+            row[k] = std::max(0.0f, std::min(lower, upper)) * enorm;
+            if (row[k] != 0.0f)
+            {
+                mel_begin_[m] = std::min(mel_begin_[m], k);
+                mel_end_[m] = k + 1;
+            }
+        }
+        if (mel_begin_[m] >= mel_end_[m])
+        {
+            mel_begin_[m] = mel_end_[m] = 0;
+        }
+        mel_weights_.insert(mel_weights_.end(), row.begin() + mel_begin_[m], row.begin() + mel_end_[m]);
+    }
+}
+
+size_t LogMelSpectrogram::Compute(const float *samples, size_t size, size_t padded_size,
+                                  const Layout &layout, float *out, size_t first, float first_max) const
+{
+    padded_size = std::max(padded_size, size);
+    const size_t total = (padded_size + 2 * (n_fft_ / 2) - n_fft_) / hop_;
+    const size_t frames = std::min((size + hop_ - 1) / hop_, total);
+
+    first = std::min(first, frames);
+    float max = std::max(first_max, LogFrames(samples, size, padded_size, first, frames, layout, out));
+
+    // the frames past the written ones still count for the max, those over the zero padding only are constant.
+    bool silent = false;
+    for (size_t t = frames; t < total;)
+    {
+        if (Silent(t, size, padded_size))
+        {
+            silent = true;
+            ++t;
+            continue;
+        }
+
+        size_t end = t + 1;
+        while (end < total && !Silent(end, size, padded_size))
+        {
+            ++end;
+        }
+        max = std::max(max, LogFrames(samples, size, padded_size, t, end, layout, nullptr));
+        t = end;
+    }
+    if (silent)
+    {
+        max = std::max(max, std::log10(kMinEnergy));
+    }
+
+    if (frames)
+    {
+        Normalize(frames, max, layout, out);
+    }
+    return frames;
+}
+
+float LogMelSpectrogram::LogFrames(const float *samples, size_t size, size_t padded_size,
+                                   size_t t0, size_t t1, const Layout &layout, float *out) const
+{
+    float max = -std::numeric_limits<float>::infinity();
+    if (t0 >= t1)
+    {
+        return max;
+    }
+
+    Batch batch;
+    batch.in_re.resize(half_ * kLanes);
+    batch.in_im.resize(half_ * kLanes);
+    batch.out_re.resize(half_ * kLanes);
+    batch.out_im.resize(half_ * kLanes);
+    batch.power.resize((half_ + 1) * kLanes);
+    size_t max_radix = 0;
+    for (const auto &stage: stages_)
+    {
+        max_radix = std::max(max_radix, stage.radix);
+    }
+    batch.scratch.resize(2 * max_radix * kLanes);
+
+    float acc[kLanes];
+    for (size_t t = t0; t < t1; t += kLanes)
+    {
+        const size_t count = std::min(kLanes, t1 - t);
+        for (size_t lane = 0; lane < kLanes; ++lane)
+        {
+            Gather(samples, size, padded_size, lane < count ? t + lane : t1, lane, batch);
+        }
+
+        Transform(batch.out_re.data(), batch.out_im.data(), batch.in_re.data(), batch.in_im.data(), 1, 0, batch);
+        Power(batch);
+
+        for (int m = 0; m < n_mels_; ++m)
+        {
+            std::fill_n(acc, kLanes, 0.0f);
+            const float *weights = mel_weights_.data() + mel_offset_[m];
+            for (size_t k = mel_begin_[m]; k < mel_end_[m]; ++k)
+            {
+                const float w = weights[k - mel_begin_[m]];
+                const float *power = batch.power.data() + k * kLanes;
+                for (size_t lane = 0; lane < kLanes; ++lane)
+                {
+                    acc[lane] += w * power[lane];
+                }
+            }
+
+            for (size_t lane = 0; lane < count; ++lane)
+            {
+                float v = acc[lane];
+                if (!std::isfinite(v) || v < kMinEnergy)
+                {
+                    v = kMinEnergy;
+                }
+                v = std::log10(v);
+                max = std::max(max, v);
+                if (out)
+                {
+                    out[Offset(t + lane, m, layout)] = v;
+                }
+            }
+        }
+    }
+    return max;
+}
+
+void LogMelSpectrogram::Normalize(size_t frames, float max, const Layout &layout, float *out) const
+{
+    const float floor = max - kDynamicRange;
+    for (size_t t0 = 0; t0 < frames; t0 += layout.chunk)
+    {
+        const size_t len = std::min(layout.chunk, frames - t0);
+        for (int m = 0; m < n_mels_; ++m)
+        {
+            float *row = out + Offset(t0, m, layout);
+            for (size_t k = 0; k < len; ++k)
+            {
+                float v = row[k] < floor ? floor : row[k];
+                row[k] = (v + 4.0f) / 4.0f;
+            }
+        }
+    }
+}
+
+bool LogMelSpectrogram::Silent(size_t t, size_t size, size_t padded_size) const
+{
+    const long long lo = static_cast<long long>(t) * hop_ - n_fft_ / 2;
+    const long long hi = lo + n_fft_ - 1;
+    const auto len = static_cast<long long>(size);
+    const auto padded = static_cast<long long>(padded_size);
+
+    // the left reflection, the signal itself and the right reflection
+    if (lo < 0 && len > 1)
+    {
+        return false;
+    }
+    if (std::max(lo, 0LL) < len)
+    {
+        return false;
+    }
+    return !(hi >= padded && 2 * (padded - 1) - hi < len);
+}
+
+void LogMelSpectrogram::Gather(const float *samples, size_t size, size_t padded_size, size_t t, size_t lane,
+                               Batch &batch) const
+{
+    float *re = batch.in_re.data() + lane;
+    float *im = batch.in_im.data() + lane;
+    const long long start = static_cast<long long>(t) * hop_ - n_fft_ / 2;
+
+    if (start >= 0 && start + n_fft_ <= static_cast<long long>(size))
+    {
+        const float *frame = samples + start;
+        for (size_t n = 0; n < half_; ++n)
+        {
+            re[n * kLanes] = window_[2 * n] * frame[2 * n];
+            im[n * kLanes] = window_[2 * n + 1] * frame[2 * n + 1];
+        }
+        return;
+    }
+
+    const auto padded = static_cast<long long>(padded_size);
+    auto sample = [&](long long j) -> float
+    {
+        if (j < 0)
+        {
+            j = -j;
+        }
+        if (j >= padded)
+        {
+            j = 2 * (padded - 1) - j;
+        }
+        return j >= 0 && j < static_cast<long long>(size) ? samples[j] : 0.0f;
+    };
+    for (size_t n = 0; n < half_; ++n)
+    {
+        re[n * kLanes] = window_[2 * n] * sample(start + static_cast<long long>(2 * n));
+        im[n * kLanes] = window_[2 * n + 1] * sample(start + static_cast<long long>(2 * n + 1));
+    }
+}
+
+// decimation in time over the stages, each level transforms `radix` interleaved sub sequences then merges them.
+void LogMelSpectrogram::Transform(float *out_re, float *out_im, const float *in_re, const float *in_im,
+                                  size_t fstride, size_t stage, Batch &batch) const
+{
+    const size_t radix = stages_[stage].radix;
+    const size_t rest = stages_[stage].rest;
+    if (rest == 1)
+    {
+        for (size_t q = 0; q < radix; ++q)
+        {
+            std::memcpy(out_re + q * kLanes, in_re + q * fstride * kLanes, kLanes * sizeof(float));
+            std::memcpy(out_im + q * kLanes, in_im + q * fstride * kLanes, kLanes * sizeof(float));
+        }
+    }
+    else
+    {
+        for (size_t q = 0; q < radix; ++q)
+        {
+            Transform(out_re + q * rest * kLanes, out_im + q * rest * kLanes,
+                      in_re + q * fstride * kLanes, in_im + q * fstride * kLanes,
+                      fstride * radix, stage + 1, batch);
+        }
+    }
+    Butterfly(out_re, out_im, fstride, stage, batch);
+}
+
+/*
+ * The radix 2, 4 and 5 butterflies of kissfft and its generic one for the other factors, over the lanes.
+ * The lanes are loaded into local arrays first, so the compiler keeps them in vector registers.
+ */
+void LogMelSpectrogram::Butterfly(float *re, float *im, size_t fstride, size_t stage, Batch &batch) const
+{
+    const size_t radix = stages_[stage].radix;
+    const size_t rest = stages_[stage].rest;
+    const float *tw_re = twiddle_re_.data();
+    const float *tw_im = twiddle_im_.data();
+    float x_re[5][kLanes], x_im[5][kLanes];
+
+    auto load = [&](size_t u, size_t count)
+    {
+        for (size_t q = 0; q < count; ++q)
+        {
+            std::memcpy(x_re[q], re + (u + q * rest) * kLanes, sizeof(x_re[q]));
+            std::memcpy(x_im[q], im + (u + q * rest) * kLanes, sizeof(x_im[q]));
+        }
+    };
+    auto store = [&](size_t u, size_t count)
+    {
+        for (size_t q = 0; q < count; ++q)
+        {
+            std::memcpy(re + (u + q * rest) * kLanes, x_re[q], sizeof(x_re[q]));
+            std::memcpy(im + (u + q * rest) * kLanes, x_im[q], sizeof(x_im[q]));
+        }
+    };
+    // x[q] *= w^(q * u * fstride)
+    auto rotate = [&](size_t u, size_t count)
+    {
+        for (size_t q = 1; q < count; ++q)
+        {
+            const float w_re = tw_re[q * u * fstride];
+            const float w_im = tw_im[q * u * fstride];
+            for (size_t lane = 0; lane < kLanes; ++lane)
+            {
+                const float r = x_re[q][lane] * w_re - x_im[q][lane] * w_im;
+                x_im[q][lane] = x_re[q][lane] * w_im + x_im[q][lane] * w_re;
+                x_re[q][lane] = r;
+            }
+        }
+    };
+
+    switch (radix)
+    {
+        case 2:
+            for (size_t u = 0; u < rest; ++u)
+            {
+                load(u, 2);
+                rotate(u, 2);
+                for (size_t lane = 0; lane < kLanes; ++lane)
+                {
+                    const float r = x_re[0][lane], i = x_im[0][lane];
+                    x_re[0][lane] = r + x_re[1][lane];
+                    x_im[0][lane] = i + x_im[1][lane];
+                    x_re[1][lane] = r - x_re[1][lane];
+                    x_im[1][lane] = i - x_im[1][lane];
+                }
+                store(u, 2);
+            }
+            return;
+        case 4:
+            for (size_t u = 0; u < rest; ++u)
+            {
+                load(u, 4);
+                rotate(u, 4);
+                for (size_t lane = 0; lane < kLanes; ++lane)
+                {
+                    const float d_re = x_re[0][lane] - x_re[2][lane];
+                    const float d_im = x_im[0][lane] - x_im[2][lane];
+                    const float e_re = x_re[0][lane] + x_re[2][lane];
+                    const float e_im = x_im[0][lane] + x_im[2][lane];
+                    const float s_re = x_re[1][lane] + x_re[3][lane];
+                    const float s_im = x_im[1][lane] + x_im[3][lane];
+                    const float t_re = x_re[1][lane] - x_re[3][lane];
+                    const float t_im = x_im[1][lane] - x_im[3][lane];
+                    x_re[0][lane] = e_re + s_re;
+                    x_im[0][lane] = e_im + s_im;
+                    x_re[2][lane] = e_re - s_re;
+                    x_im[2][lane] = e_im - s_im;
+                    x_re[1][lane] = d_re + t_im;
+                    x_im[1][lane] = d_im - t_re;
+                    x_re[3][lane] = d_re - t_im;
+                    x_im[3][lane] = d_im + t_re;
+                }
+                store(u, 4);
+            }
+            return;
+        case 5:
+        {
+            const float a_re = tw_re[fstride * rest], a_im = tw_im[fstride * rest];
+            const float b_re = tw_re[2 * fstride * rest], b_im = tw_im[2 * fstride * rest];
+            for (size_t u = 0; u < rest; ++u)
+            {
+                load(u, 5);
+                rotate(u, 5);
+                for (size_t lane = 0; lane < kLanes; ++lane)
+                {
+                    const float s0_re = x_re[0][lane], s0_im = x_im[0][lane];
+                    const float s7_re = x_re[1][lane] + x_re[4][lane], s7_im = x_im[1][lane] + x_im[4][lane];
+                    const float s10_re = x_re[1][lane] - x_re[4][lane], s10_im = x_im[1][lane] - x_im[4][lane];
+                    const float s8_re = x_re[2][lane] + x_re[3][lane], s8_im = x_im[2][lane] + x_im[3][lane];
+                    const float s9_re = x_re[2][lane] - x_re[3][lane], s9_im = x_im[2][lane] - x_im[3][lane];
+
+                    const float s5_re = s0_re + s7_re * a_re + s8_re * b_re;
+                    const float s5_im = s0_im + s7_im * a_re + s8_im * b_re;
+                    const float s6_re = s10_im * a_im + s9_im * b_im;
+                    const float s6_im = -s10_re * a_im - s9_re * b_im;
+                    const float s11_re = s0_re + s7_re * b_re + s8_re * a_re;
+                    const float s11_im = s0_im + s7_im * b_re + s8_im * a_re;
+                    const float s12_re = -s10_im * b_im + s9_im * a_im;
+                    const float s12_im = s10_re * b_im - s9_re * a_im;
+
+                    x_re[0][lane] = s0_re + s7_re + s8_re;
+                    x_im[0][lane] = s0_im + s7_im + s8_im;
+                    x_re[1][lane] = s5_re - s6_re;
+                    x_im[1][lane] = s5_im - s6_im;
+                    x_re[4][lane] = s5_re + s6_re;
+                    x_im[4][lane] = s5_im + s6_im;
+                    x_re[2][lane] = s11_re + s12_re;
+                    x_im[2][lane] = s11_im + s12_im;
+                    x_re[3][lane] = s11_re - s12_re;
+                    x_im[3][lane] = s11_im - s12_im;
+                }
+                store(u, 5);
+            }
+            return;
+        }
+        default:
+            break;
+    }
+
+    float *s_re = batch.scratch.data();
+    float *s_im = s_re + radix * kLanes;
+    float y_re[kLanes];
+    float y_im[kLanes];
+    for (size_t u = 0; u < rest; ++u)
+    {
+        for (size_t q = 0; q < radix; ++q)
+        {
+            std::memcpy(s_re + q * kLanes, re + (u + q * rest) * kLanes, kLanes * sizeof(float));
+            std::memcpy(s_im + q * kLanes, im + (u + q * rest) * kLanes, kLanes * sizeof(float));
+        }
+
+        for (size_t q1 = 0; q1 < radix; ++q1)
+        {
+            const size_t k = u + q1 * rest;
+            std::memcpy(y_re, s_re, sizeof(y_re));
+            std::memcpy(y_im, s_im, sizeof(y_im));
+
+            size_t index = 0;
+            for (size_t q = 1; q < radix; ++q)
+            {
+                index += fstride * k;
+                if (index >= half_)
+                {
+                    index -= half_;
+                }
+                const float w_re = tw_re[index];
+                const float w_im = tw_im[index];
+                const float *v_re = s_re + q * kLanes;
+                const float *v_im = s_im + q * kLanes;
+                for (size_t lane = 0; lane < kLanes; ++lane)
+                {
+                    y_re[lane] += v_re[lane] * w_re - v_im[lane] * w_im;
+                    y_im[lane] += v_re[lane] * w_im + v_im[lane] * w_re;
+                }
+            }
+
+            std::memcpy(re + k * kLanes, y_re, sizeof(y_re));
+            std::memcpy(im + k * kLanes, y_im, sizeof(y_im));
+        }
+    }
+}
+
+// split the spectrum of the packed even / odd samples into the spectrum of the real frame, then |X|^2.
+void LogMelSpectrogram::Power(Batch &batch) const
+{
+    float p[kLanes];
+    for (size_t k = 0; k <= half_; ++k)
+    {
+        const size_t a = k == half_ ? 0 : k;
+        const size_t b = k == 0 ? 0 : half_ - k;
+        const float *a_re = batch.out_re.data() + a * kLanes;
+        const float *a_im = batch.out_im.data() + a * kLanes;
+        const float *b_re = batch.out_re.data() + b * kLanes;
+        const float *b_im = batch.out_im.data() + b * kLanes;
+        const float w_re = split_re_[k];
+        const float w_im = split_im_[k];
+        for (size_t lane = 0; lane < kLanes; ++lane)
+        {
+            const float even_re = 0.5f * (a_re[lane] + b_re[lane]);
+            const float even_im = 0.5f * (a_im[lane] - b_im[lane]);
+            const float odd_re = 0.5f * (a_im[lane] + b_im[lane]);
+            const float odd_im = 0.5f * (b_re[lane] - a_re[lane]);
+            const float x_re = even_re + w_re * odd_re - w_im * odd_im;
+            const float x_im = even_im + w_re * odd_im + w_im * odd_re;
+            p[lane] = x_re * x_re + x_im * x_im;
+        }
+        std::memcpy(batch.power.data() + k * kLanes, p, sizeof(p));
+    }
+}
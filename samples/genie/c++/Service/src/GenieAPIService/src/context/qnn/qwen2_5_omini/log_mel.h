@@ -0,0 +1,106 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#ifndef LOG_MEL_H
+#define LOG_MEL_H
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+/*
+ * Whisper style log-mel front end of the audio encoder: centered STFT with reflect padding and a hann window,
+ * power spectrum, slaney mel filterbank, log10 clamped to 8 below the global max, then (x + 4) / 4.
+ * The same features as librosa::Feature::melspectrogram followed by the post processing the context did on it.
+ *
+ * The window, the FFT plan and the filterbank are built once. Frames are transformed in batches laid out frame
+ * minor, so every butterfly and filter loop runs over contiguous lanes and is vectorized by the compiler, and the
+ * features are written straight into the layout of the encoder input.
+ */
+class LogMelSpectrogram
+{
+public:
+    // frame t of mel m goes to out[(t / chunk) * n_mels * stride + m * stride + t % chunk]
+    struct Layout
+    {
+        size_t chunk;
+        size_t stride;
+    };
+
+    LogMelSpectrogram(int sample_rate, int n_fft, int hop, int n_mels, float f_min, float f_max);
+
+    int n_mels() const { return n_mels_; }
+
+    int n_fft() const { return n_fft_; }
+
+    int hop() const { return hop_; }
+
+    /*
+     * The signal is samples[0, size) followed by zeros up to padded_size. The frames are counted over the padded
+     * signal with the last one dropped, the frames starting inside `size` are written and their count is returned,
+     * the global max also covers the frames after them.
+     * The frames before `first` are already in `out` as LogFrames wrote them with `first_max` as their max, so a
+     * stream featurized while it arrives only finishes the tail here.
+     */
+    size_t Compute(const float *samples, size_t size, size_t padded_size, const Layout &layout, float *out,
+                   size_t first = 0, float first_max = -std::numeric_limits<float>::infinity()) const;
+
+    // log10 of the clamped mel energies of the frames [t0, t1), returns their max, `out` may be null.
+    float LogFrames(const float *samples, size_t size, size_t padded_size,
+                    size_t t0, size_t t1, const Layout &layout, float *out) const;
+
+    // clamp the first `frames` frames to 8 below `max` and scale them.
+    void Normalize(size_t frames, float max, const Layout &layout, float *out) const;
+
+private:
+    static constexpr size_t kLanes = 8;
+
+    struct Stage
+    {
+        size_t radix;
+        size_t rest;
+    };
+
+    struct Batch
+    {
+        std::vector<float> in_re, in_im, out_re, out_im, power, scratch;
+    };
+
+    size_t Offset(size_t t, size_t m, const Layout &layout) const
+    {
+        return (t / layout.chunk) * n_mels_ * layout.stride + m * layout.stride + t % layout.chunk;
+    }
+
+    bool Silent(size_t t, size_t size, size_t padded_size) const;
+
+    void Gather(const float *samples, size_t size, size_t padded_size, size_t t, size_t lane, Batch &batch) const;
+
+    void Transform(float *out_re, float *out_im, const float *in_re, const float *in_im,
+                   size_t fstride, size_t stage, Batch &batch) const;
+
+    void Butterfly(float *re, float *im, size_t fstride, size_t stage, Batch &batch) const;
+
+    void Power(Batch &batch) const;
+
+    int n_fft_;
+    int hop_;
+    int n_mels_;
+    size_t half_;                    // the complex FFT size, the real input is packed in pairs
+    std::vector<float> window_;
+    std::vector<Stage> stages_;
+    std::vector<float> twiddle_re_;  // exp(-2 pi i k / half)
+    std::vector<float> twiddle_im_;
+    std::vector<float> split_re_;    // exp(-2 pi i k / n_fft), to split the packed spectrum
+    std::vector<float> split_im_;
+    std::vector<size_t> mel_begin_;  // the non zero bins of every filter
+    std::vector<size_t> mel_end_;
+    std::vector<size_t> mel_offset_;
+    std::vector<float> mel_weights_;
+};
+
+#endif //LOG_MEL_H
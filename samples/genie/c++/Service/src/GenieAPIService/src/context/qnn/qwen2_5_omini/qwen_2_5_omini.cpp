@@ -7,7 +7,7 @@
 //==============================================================================
 
 #include "qwen_2_5_omini.h"
-#include <librosa/librosa.h>
+#include "log_mel.h"
 
 #define DR_WAV_IMPLEMENTATION
 
@@ -16,96 +16,15 @@
 #include <log.h>
 #include <utils.h>
 
-#include <stb_image.h>
-#include <stb_image_resize2.h>
-#include "../qwen2_5/qwen25_image_processor.hpp"
 #include "../../torch_helper/base.h"
 
-std::vector<std::vector<float>>
-QInterface::Qwen2_5OMINI::ProcessingMelSpec(std::vector<std::vector<float>> &&mel_spec)
-{
-    static const float min_val = 1e-10f;
-//    clamp_and_log10_mel_major
-    size_t n_mels = mel_spec.size();
-    size_t n_frames = mel_spec[0].size();
-    for (size_t m = 0; m < n_mels; ++m)
-    {
-        auto &row = mel_spec[m];
-        for (size_t t = 0; t < n_frames; ++t)
-        {
-            float v = row[t];
-            if (!std::isfinite(v) || v < min_val)
-                v = min_val;
-            row[t] = std::log10(v);
-        }
-    }
-
-//    clamp_by_max_mel_major
-    float gmax = -std::numeric_limits<float>::infinity();
-    for (const auto &row: mel_spec)
-    {
-        for (float v: row)
-        {
-            if (std::isfinite(v) && v > gmax)
-                gmax = v;
-        }
-    }
-
-    static const float offset = 8.0f;
-    float floor_val;
-    if (!std::isfinite(gmax))
-        goto ahead;
-    floor_val = gmax - offset;
-    for (auto &row: mel_spec)
-        for (float &v: row)
-            if (!std::isfinite(v) || v < floor_val)
-                v = floor_val;
-
-//    scale_shift_mel_major
-    ahead:
-    for (auto &row: mel_spec)
-    {
-        for (float &t: row)
-        {
-            t = (t + 4.0f) / 4.0f;
-        }
-    }
-    return mel_spec;
-}
+static const size_t kAudioChunk = 100 * 2;
+static const size_t kMaxAudioChunks = 10;
 
-std::vector<std::vector<float>>
-QInterface::Qwen2_5OMINI::ApplyMaskTimeMajorToMelMajor(std::vector<std::vector<float>> &&time_major_mel_spec,
-                                                       const std::vector<int32_t> &feature_attention_mask)
+static const LogMelSpectrogram &AudioFrontEnd()
 {
-    size_t T = time_major_mel_spec.size();
-    size_t M = time_major_mel_spec[0].size();
-    if (feature_attention_mask.size() != T)
-        throw std::invalid_argument("mask length != T");
-
-    // count selected frames K
-    size_t K = 0;
-    for (size_t t = 0; t < T; ++t)
-        if (feature_attention_mask[t])
-            ++K;
-
-    // prepare output [M][K]
-    std::vector<std::vector<float>> input_features(M, std::vector<float>(K));
-    if (K == 0)
-        return input_features;
-
-    size_t col = 0;
-    for (size_t t = 0; t < T; ++t)
-    {
-        if (!feature_attention_mask[t])
-            continue;
-        const auto &row = time_major_mel_spec[t]; // row is length M
-        for (size_t m = 0; m < M; ++m)
-        {
-            input_features[m][col] = row[m];
-        }
-        ++col;
-    }
-    return input_features;
+    static const LogMelSpectrogram front_end{16000, 400, 160, 128, 0, 8000};
+    return front_end;
 }
 
 std::vector<int64_t> QInterface::Qwen2_5OMINI::CreateChunkLengths(int64_t feature_len)
@@ -119,167 +38,6 @@ std::vector<int64_t> QInterface::Qwen2_5OMINI::CreateChunkLengths(int64_t featur
     return chunk_lengths;
 }
 
-std::vector<std::vector<std::vector<float>>>
-QInterface::Qwen2_5OMINI::SplitMelMajorByLengths(std::vector<std::vector<float>> &&input_features,
-                                                 const std::vector<int64_t> &chunk_lengths)
-{
-    size_t M = input_features.size();
-    size_t T = input_features[0].size();
-
-    // sanity: sum lengths == T
-    int64_t sum = 0;
-    for (auto l: chunk_lengths)
-        sum += l;
-    if (static_cast<size_t>(sum) != T)
-        throw std::runtime_error("chunk lengths do not sum to T");
-
-    std::vector<std::vector<std::vector<float>>> chunks;
-    chunks.reserve(chunk_lengths.size());
-
-    size_t t0 = 0;
-    for (auto len: chunk_lengths)
-    {
-        std::vector<std::vector<float>> block(M, std::vector<float>(len));
-        for (size_t m = 0; m < M; ++m)
-        {
-            // copy features[m][t0 .. t0+len-1] -> block[m][0..len-1]
-            for (size_t k = 0; k < static_cast<size_t>(len); ++k)
-                block[m][k] = input_features[m][t0 + k];
-        }
-        chunks.push_back(std::move(block));
-        t0 += len;
-    }
-    return chunks;
-}
-
-std::tuple<std::vector<float>, std::vector<float>>
-QInterface::Qwen2_5OMINI::MakePaddedAndMask(const std::vector<std::vector<std::vector<float>>> &tensor_list,
-                                            const std::vector<int64_t> &tensor_len)
-{
-
-    int dim = tensor_list[0].size();
-    int max_len = tensor_list[0][0].size();
-    size_t N = tensor_list.size();
-    if (tensor_len.size() != N)
-        throw std::runtime_error("tensor_len size mismatch");
-
-    // 验证每个块内部一致性
-    for (size_t i = 0; i < N; ++i)
-    {
-        if (tensor_list[i].size() != dim)
-            throw std::runtime_error("dim mismatch in chunk");
-        size_t len_i = tensor_list[i][0].size();
-        for (size_t m = 1; m < dim; ++m)
-            if (tensor_list[i][m].size() != len_i)
-                throw std::runtime_error("inconsistent row length inside chunk");
-        if (len_i != static_cast<size_t>(tensor_len[i]))
-            throw std::runtime_error("tensor_len mismatch actual len");
-        if (len_i > max_len)
-            throw std::runtime_error("len_i > max_len");
-    }
-
-    // allocate and init
-    std::vector<float> padded_flat;      // 输出: size N*dim*max_len
-    std::vector<float> batch_mask_flat; // 输出: size N*max_len
-    padded_flat.assign(N * dim * max_len, 0.0f);
-    batch_mask_flat.assign(N * max_len, 0);
-
-    auto padded_offset = [&](size_t i, size_t m, size_t k) -> size_t
-    {
-        // layout: (i, m, k) -> ((i * dim + m) * max_len + k)
-        return (i * dim + m) * max_len + k;
-    };
-    auto mask_offset = [&](size_t i, size_t k) -> size_t
-    {
-        return i * max_len + k;
-    };
-
-    for (size_t i = 0; i < N; ++i)
-    {
-        size_t len_i = static_cast<size_t>(tensor_len[i]);
-        // set mask 1 for first len_i positions
-        for (size_t k = 0; k < len_i; ++k)
-            batch_mask_flat[mask_offset(i, k)] = 1;
-
-        // copy each mel row: tensor_list[i][m][0..len_i-1] -> padded_flat[(i,m,0..len_i-1)]
-        for (size_t m = 0; m < dim; ++m)
-        {
-            const float *src = tensor_list[i][m].data();
-            float *dst = padded_flat.data() + padded_offset(i, m, 0);
-            std::memcpy(dst, src, len_i * sizeof(float));
-            // 剩余位置已为 padding_value
-        }
-    }
-
-    static int new_max_len = 10;
-    return make_tuple(std::move(PaddedInputFeatures(std::move(padded_flat), N, dim, max_len)),
-                      std::move(MakeUpdatedPaddedMaskFrom3D(
-                              MakeMask3DFromFlat(std::move(batch_mask_flat), N, max_len), new_max_len)
-                      ));
-}
-
-std::vector<float>
-QInterface::Qwen2_5OMINI::PaddedInputFeatures(std::vector<float> &&padded_feature_flat,
-                                              size_t N,
-                                              size_t C,
-                                              size_t T)
-{
-    static const size_t max_len_channels = 10;
-    static const float padding_value = 0.0f;
-    std::vector<float> padded_tensor_flat;
-    padded_tensor_flat.assign(max_len_channels * C * T, padding_value);
-
-    if (N > max_len_channels)
-        throw std::runtime_error("N > max_len_channels; cannot fit");
-
-    // copy padded_feature[:feature_len, :, :] -> out_padded_tensor[:feature_len, :, :]
-    for (size_t i = 0; i < N; ++i)
-    {
-        for (size_t c = 0; c < C; ++c)
-        {
-            const float *src = padded_feature_flat.data() + idx3(i, c, 0, C, T);
-            float *dst = padded_tensor_flat.data() + idx3(i, c, 0, C, T);
-            std::memcpy(dst, src, T * sizeof(float));
-        }
-    }
-    return padded_tensor_flat;
-}
-
-std::vector<std::vector<std::vector<float>>>
-QInterface::Qwen2_5OMINI::MakeMask3DFromFlat(std::vector<float> &&batch_mask_flat, size_t N, size_t L)
-{
-    std::vector<std::vector<std::vector<float>>> mask3d;
-    mask3d.resize(N);
-    for (size_t i = 0; i < N; ++i)
-    {
-        mask3d[i].resize(1);
-        mask3d[i][0].assign(batch_mask_flat.begin() + i * L,
-                            batch_mask_flat.begin() + i * L + L);
-    }
-    return mask3d;
-}
-
-std::vector<float>
-QInterface::Qwen2_5OMINI::MakeUpdatedPaddedMaskFrom3D(const std::vector<std::vector<std::vector<float>>> &padded_mask,
-                                                      size_t max_len)
-{
-    size_t N = padded_mask.size();
-    size_t B = padded_mask[0].size();
-    size_t T = padded_mask[0][0].size();
-
-    // allocate output (max_len * B * T), init 0.0f
-    std::vector<float> out(max_len * B * T, 0.0f);
-
-    // set first min(max_len, N) slices to 1.0f
-    size_t upto = std::min(max_len, N);
-    for (size_t i = 0; i < upto; ++i)
-    {
-        size_t base = (i * B + 0) * T;
-        std::fill_n(out.data() + base, T, 1.0f);
-    }
-    return out;
-}
-
 std::vector<std::vector<int32_t>>
 QInterface::Qwen2_5OMINI::MakeBatchMaskAfterCnn(const std::vector<int64_t> &tensor_len)
 {
@@ -485,10 +243,45 @@ IAudioEmbedding &QInterface::Qwen2_5OMINI::BuildAudioSamples()
         throw std::runtime_error(std::string("libsamplerate error: ") + src_strerror(err));
     }
 
-    uint32_t rescaled_length = (out_frames_est - 1) / 160 + 1;
+    SetAudioTokens(out_frames_est);
+    clean();
+    return *this;
+}
+
+void QInterface::Qwen2_5OMINI::SetAudioTokens(uint64_t samples)
+{
+    uint32_t rescaled_length = (samples - 1) / 160 + 1;
     uint32_t input_length = (rescaled_length - 1) / 2 + 1;
     IAudioEmbedding::token_index_ = (input_length - 2) / 2 + 1;
-    clean();
+}
+
+void QInterface::Qwen2_5OMINI::BeginAudioStream()
+{
+    stream_ = std::make_unique<AudioStream>(AudioFrontEnd(), 16000, kPaddingMaxLength, kAudioChunk, kMaxAudioChunks);
+}
+
+void QInterface::Qwen2_5OMINI::AppendAudio(const uint8_t *data, size_t size)
+{
+    if (!stream_)
+    {
+        throw std::runtime_error("audio stream is not started");
+    }
+    stream_->Append(data, size);
+}
+
+IAudioEmbedding &QInterface::Qwen2_5OMINI::FinishAudioStream()
+{
+    if (!stream_)
+    {
+        throw std::runtime_error("audio stream is not started");
+    }
+    std::unique_ptr<AudioStream> stream = std::move(stream_);
+    My_Log{} << "audio stream: " << stream->windows() << " of the feature windows were done while uploading\n";
+    stream->Finish(padded_feature_);
+    audio_buf_ = std::move(stream->bytes());
+    audio_sample_buf_ = std::move(stream->samples());
+    SetAudioTokens(audio_sample_buf_.size());
+    features_ready_ = true;
     return *this;
 }
 
@@ -496,61 +289,42 @@ IAudioEmbedding &QInterface::Qwen2_5OMINI::BuildAudioInferredInput()
 {
     static const int hop = 160;
     static const int mel = 128;
-    static constexpr int64_t CHUNK = 100 * 2;
+    static constexpr int64_t CHUNK = kAudioChunk;
+    static const size_t kMaxChunks = kMaxAudioChunks;
+    const LogMelSpectrogram &front_end = AudioFrontEnd();
 
-    int audio_sample_size = audio_sample_buf_.size();
-    audio_sample_buf_.resize(kPaddingMaxLength);
-    for (auto i = audio_sample_size - 1; i < audio_sample_buf_.size(); ++i)
+    // the zero padding to kPaddingMaxLength used to start at the last sample, keep it so the features match.
+    size_t audio_sample_size = audio_sample_buf_.size();
+    if (audio_sample_size == 0)
     {
-        audio_sample_buf_[i] = 0;
+        throw std::runtime_error("audio has no samples");
     }
+    audio_sample_buf_.back() = 0;
 
-    std::vector<int32_t> feature_attention_mask;
-    feature_attention_mask.reserve((kPaddingMaxLength / hop));
-    for (auto i = 0; i < audio_sample_buf_.size();)
+    // the frames starting inside the audio, in chunks of CHUNK frames.
+    int64_t frames = (audio_sample_size + hop - 1) / hop;
+    auto tensor_len = CreateChunkLengths(frames);
+    if (tensor_len.size() > kMaxChunks)
     {
-        if (i < audio_sample_size)
-        {
-            feature_attention_mask.push_back(1);
-        }
-        else
-        {
-            feature_attention_mask.push_back(0);
-        }
-        i += hop;
+        throw std::runtime_error("N > max_len_channels; cannot fit");
     }
 
-    // _torch_extract_fbank_features
-    std::vector<std::vector<float>> mel_spec = librosa::Feature::melspectrogram(audio_sample_buf_,
-                                                                                16000,
-                                                                                400,
-                                                                                hop,
-                                                                                "hann",
-                                                                                true,
-                                                                                "reflect",
-                                                                                2.0f,
-                                                                                mel,
-                                                                                0,
-                                                                                8000);
-    if (mel_spec.empty())
+    // (chunk, mel, time) with the time padded to the first chunk length, the tail of the buffer stays zero.
+    const size_t stride = tensor_len[0];
+    if (!features_ready_)
     {
-        throw std::runtime_error("librosa error: melspectrogram failed");
+        padded_feature_.assign(kMaxChunks * mel * CHUNK, 0.0f);
+        front_end.Compute(audio_sample_buf_.data(), audio_sample_size, kPaddingMaxLength,
+                          {static_cast<size_t>(CHUNK), stride}, padded_feature_.data());
     }
-    mel_spec.pop_back();
 
-    mel_spec = ProcessingMelSpec(std::move(mel_spec));
-    auto input_features = ApplyMaskTimeMajorToMelMajor(std::move(mel_spec), feature_attention_mask);
-    auto tensor_len = CreateChunkLengths(input_features[0].size());
-
-    size_t half = input_features[0].size() / 2;
-    auto tensor_list = SplitMelMajorByLengths(std::move(input_features), tensor_len);
-    std::tie(padded_feature_, padded_mask_) = MakePaddedAndMask(tensor_list, tensor_len);
+    padded_mask_.assign(kMaxChunks * CHUNK, 0.0f);
+    std::fill_n(padded_mask_.data(), tensor_len.size() * stride, 1.0f);
 
+    size_t half = frames / 2;
     std::vector<std::vector<int32_t>> padded_mask_after_cnn = MakeBatchMaskAfterCnn(tensor_len);
     std::vector<float> attention_mask(1 * half * half, -100.0f);
 
-    static const int max_attention_mask_dim = 1000;
-
     std::vector<int32_t> cu_seqlens = ComputeCuSeqlensFromMask(padded_mask_after_cnn);
     padded_attention_mask_ = AttentionToPadded(std::move(attention_mask), half, cu_seqlens);
     IAudioEmbedding::input_buffers_[0][0] = reinterpret_cast<uint8_t *>(padded_feature_.data());
@@ -561,12 +335,9 @@ IAudioEmbedding &QInterface::Qwen2_5OMINI::BuildAudioInferredInput()
 
 IVisionEmbedding &QInterface::Qwen2_5OMINI::BuildImgPixel()
 {
-    using namespace qwen2_5;
     int rows = 0, cols = 0;
-    Qwen25ImageProcessor proc;
-    proc.ProcessToBuffer(img_buf_.data(), img_buf_.size(), kHeight, kWidth, img_pixel_buf_, rows, cols);
+    image_processor_.ProcessToBuffer(img_buf_.data(), img_buf_.size(), kHeight, kWidth, img_pixel_buf_, rows, cols);
     img_buf_.clear();
-    File::WriteBinaryFile<float>(img_pixel_buf_, "img_pixel.raw");
     return *this;
 }
 
@@ -671,15 +442,10 @@ IEmbedding &QInterface::Qwen2_5OMINI::MergeEmbedding()
     static const uint32_t kAudioTokenIndex{151646};
     static const int32_t kVisionTokenIndex{151655};
 
-    FloatBufferView tmp_raw_fbuf{qnn_embedding_info_.embedded_raw_buf_};
-
     embedded_bin_.resize(prompt_token_size_ * cols_);
-    float *dest_ptr;
     for (uint32_t i = 0; i < prompt_token_size_; ++i)
     {
-        dest_ptr = &embedded_bin_[i * cols_];
-        float *src_ptr = &tmp_raw_fbuf.pointer_[prompt_token_[i] * cols_];
-        std::memcpy(dest_ptr, src_ptr, cols_ * sizeof(float));
+        EmbedToken(prompt_token_[i], &embedded_bin_[i * cols_], cols_);
     }
 
     if (!audio_inferred_buf_.empty())
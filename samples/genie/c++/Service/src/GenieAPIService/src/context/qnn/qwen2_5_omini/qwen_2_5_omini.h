@@ -10,6 +10,8 @@
 #define QWEN_2_5_OMINI_H
 
 #include "../genie_interface.h"
+#include "../qwen2_5/qwen25_image_processor.hpp"
+#include "audio_stream.h"
 
 struct FloatBufferView;
 
@@ -49,6 +51,15 @@ public:
 
     IAudioEmbedding &BuildAudioSamples() override;
 
+    void BeginAudioStream() override;
+
+    void AppendAudio(const uint8_t *data, size_t size) override;
+
+    IAudioEmbedding &FinishAudioStream() override;
+
+    void AbortAudioStream() override
+    { stream_.reset(); }
+
     IAudioEmbedding &BuildAudioInferredInput() override;
 
     void MergeImpl(int token_index, int standard_index, std::vector<uint8_t> &inferred_buf);
@@ -59,6 +70,7 @@ public:
         padded_feature_.clear();
         padded_mask_.clear();
         padded_attention_mask_.clear();
+        features_ready_ = false;
         return *this;
     }
 
@@ -71,37 +83,15 @@ private:
     std::vector<float> padded_feature_;
     std::vector<float> padded_mask_;
     std::vector<float> padded_attention_mask_;
+    bool features_ready_{};  // padded_feature_ was finished by the audio stream
+    std::unique_ptr<AudioStream> stream_;
+    // kept across requests, its decode / resize arenas are reused.
+    qwen2_5::Qwen25ImageProcessor image_processor_;
 
-    std::vector<std::vector<float>> ProcessingMelSpec(std::vector<std::vector<float>> &&mel_spec);
-
-    std::vector<std::vector<float>> ApplyMaskTimeMajorToMelMajor(
-            std::vector<std::vector<float>> &&time_major_mel_spec,
-            const std::vector<int32_t> &mask);
+    void SetAudioTokens(uint64_t samples);
 
     std::vector<int64_t> CreateChunkLengths(int64_t feature_len);
 
-    std::vector<std::vector<std::vector<float>>> SplitMelMajorByLengths(
-            std::vector<std::vector<float>> &&input_features,
-            const std::vector<int64_t> &chunk_lengths);
-
-    std::tuple<std::vector<float>, std::vector<float>> MakePaddedAndMask(
-            const std::vector<std::vector<std::vector<float>>> &tensor_list,
-            const std::vector<int64_t> &tensor_len
-    );
-
-    std::vector<float> PaddedInputFeatures(
-            std::vector<float> &&padded_feature_flat, // size == N * C * T, layout (N, C, T)
-            size_t N, size_t C, size_t T);
-
-    std::vector<std::vector<std::vector<float>>> MakeMask3DFromFlat(
-            std::vector<float> &&batch_mask_flat,
-            size_t N,
-            size_t L);
-
-    std::vector<float> MakeUpdatedPaddedMaskFrom3D(
-            const std::vector<std::vector<std::vector<float>>> &padded_mask, // [N][1][T]
-            size_t max_len);
-
     std::vector<std::vector<int32_t>> MakeBatchMaskAfterCnn(const std::vector<int64_t> &tensor_len);
 
     std::vector<int32_t> ComputeCuSeqlensFromMask(const std::vector<std::vector<int32_t>> &mask);
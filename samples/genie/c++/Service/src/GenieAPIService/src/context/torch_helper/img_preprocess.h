@@ -0,0 +1,232 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#ifndef IMG_PREPROCESS_H
+#define IMG_PREPROCESS_H
+
+/*
+ * Fused passes of the vision preprocessing.
+ * Every helper writes straight into the buffer the next stage consumes, with table lookups in place of the per
+ * pixel float math, and the results are bit identical to the unfused chains they replace
+ * (examples/tools/image_preprocess_check verifies it).
+ * stb_image.h must be included before this header, like the rest of the vision code.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace img_preprocess
+{
+    // over[a][v]: v composited with alpha a over white, the same float math as the per pixel reference.
+    inline const std::vector<uint8_t> &OverWhiteTable()
+    {
+        static const std::vector<uint8_t> table = []()
+        {
+            std::vector<uint8_t> t(256 * 256);
+            for (int a = 0; a < 256; ++a)
+            {
+                float af = static_cast<uint8_t>(a) / 255.0f;
+                for (int v = 0; v < 256; ++v)
+                {
+                    uint8_t r = static_cast<uint8_t>(v);
+                    t[a * 256 + v] = static_cast<uint8_t>(std::lround(r * af + 255.0f * (1.0f - af)));
+                }
+            }
+            return t;
+        }();
+        return table;
+    }
+
+    /*
+     * The decoded image as interleaved RGB, alpha is composited over white and gray is expanded.
+     * A 3 channel image is used in place from the decoder, the others are converted into `arena`.
+     */
+    class DecodedRGB
+    {
+    public:
+        DecodedRGB(const uint8_t *encoded, size_t size, std::vector<uint8_t> &arena)
+        {
+            int n = 0;
+            pixels_ = stbi_load_from_memory(encoded, static_cast<int>(size), &w, &h, &n, 0);
+            if (!pixels_)
+            {
+                throw std::runtime_error(std::string("stb_image: failed to load image: "));
+            }
+
+            if (n == 3)
+            {
+                data_ = pixels_;
+                return;
+            }
+
+            const size_t np = static_cast<size_t>(w) * h;
+            arena.resize(np * 3);
+            uint8_t *dst = arena.data();
+            const uint8_t *src = pixels_;
+            switch (n)
+            {
+                case 1:
+                    for (size_t i = 0; i < np; ++i, dst += 3)
+                    {
+                        dst[0] = dst[1] = dst[2] = src[i];
+                    }
+                    break;
+                case 2:
+                {
+                    const uint8_t *over = OverWhiteTable().data();
+                    for (size_t i = 0; i < np; ++i, src += 2, dst += 3)
+                    {
+                        dst[0] = dst[1] = dst[2] = over[src[1] * 256 + src[0]];
+                    }
+                    break;
+                }
+                case 4:
+                {
+                    const uint8_t *over = OverWhiteTable().data();
+                    for (size_t i = 0; i < np; ++i, src += 4, dst += 3)
+                    {
+                        const uint8_t *row = over + src[3] * 256;
+                        dst[0] = row[src[0]];
+                        dst[1] = row[src[1]];
+                        dst[2] = row[src[2]];
+                    }
+                    break;
+                }
+                default:
+                    stbi_image_free(pixels_);
+                    throw std::runtime_error("Unsupported channel count from stb_image");
+            }
+            data_ = arena.data();
+        }
+
+        ~DecodedRGB()
+        {
+            stbi_image_free(pixels_);
+        }
+
+        DecodedRGB(const DecodedRGB &) = delete;
+
+        DecodedRGB &operator=(const DecodedRGB &) = delete;
+
+        const uint8_t *data() const { return data_; }
+
+        int w{};
+        int h{};
+
+    private:
+        uint8_t *pixels_{};
+        const uint8_t *data_{};
+    };
+
+    /*
+     * CLIP normalize and flatten the patches of an RGB image in one pass, rows in the (ho, wo, mh, mw) order and
+     * columns in the (c, t, ph, pw) order of the Qwen2.5-VL processor, the temporal frames are the same image.
+     */
+    inline void NormalizePatchify(const uint8_t *rgb, int H, int W,
+                                  const float (&mean)[3], const float (&stdv)[3],
+                                  int patch, int merge, int temporal,
+                                  std::vector<float> &out, int &rows, int &cols)
+    {
+        if (H % patch != 0 || W % patch != 0)
+        {
+            throw std::runtime_error("H/W not divisible by patch_size");
+        }
+
+        std::array<float, 3 * 256> lut{};
+        for (int c = 0; c < 3; ++c)
+        {
+            for (int v = 0; v < 256; ++v)
+            {
+                uint8_t p = static_cast<uint8_t>(v);
+                lut[c * 256 + v] = (p * (1.0f / 255.0f) - mean[c]) / stdv[c];
+            }
+        }
+
+        const int grid_h = H / patch;
+        const int grid_w = W / patch;
+        const int area = patch * patch;
+        rows = grid_h * grid_w;
+        cols = 3 * temporal * area;
+        out.resize(static_cast<size_t>(rows) * cols);
+
+        float *dst = out.data();
+        for (int ho = 0; ho < grid_h / merge; ++ho)
+        {
+            for (int wo = 0; wo < grid_w / merge; ++wo)
+            {
+                for (int mh = 0; mh < merge; ++mh)
+                {
+                    for (int mw = 0; mw < merge; ++mw, dst += cols)
+                    {
+                        const int py0 = (ho * merge + mh) * patch;
+                        const int px0 = (wo * merge + mw) * patch;
+                        for (int c = 0; c < 3; ++c)
+                        {
+                            const float *table = lut.data() + c * 256;
+                            float *frame = dst + c * temporal * area;
+                            for (int ph = 0; ph < patch; ++ph)
+                            {
+                                const uint8_t *src = rgb + (static_cast<size_t>(py0 + ph) * W + px0) * 3 + c;
+                                float *line = frame + ph * patch;
+                                for (int pw = 0; pw < patch; ++pw)
+                                {
+                                    line[pw] = table[src[pw * 3]];
+                                }
+                            }
+                            for (int t = 1; t < temporal; ++t)
+                            {
+                                std::memcpy(frame + t * area, frame, area * sizeof(float));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // pad an interleaved float image on the right and the bottom, only the padding is filled.
+    inline void PadHWC(const float *src, int w, int h, int channels,
+                       int pad_right, int pad_bottom, float fill, float *dst)
+    {
+        const size_t src_row = static_cast<size_t>(w) * channels;
+        const size_t dst_row = static_cast<size_t>(w + pad_right) * channels;
+        for (int y = 0; y < h; ++y)
+        {
+            float *line = dst + y * dst_row;
+            std::memcpy(line, src + y * src_row, src_row * sizeof(float));
+            std::fill(line + src_row, line + dst_row, fill);
+        }
+        std::fill(dst + h * dst_row, dst + (h + pad_bottom) * dst_row, fill);
+    }
+
+    // the [x0, x0 + cw) x [y0, y0 + ch) region of an interleaved RGB float image as planar CHW.
+    inline void RegionToCHW(const float *hwc, int w, int x0, int y0, int cw, int ch, float *chw)
+    {
+        const size_t plane = static_cast<size_t>(cw) * ch;
+        float *r = chw;
+        float *g = chw + plane;
+        float *b = chw + 2 * plane;
+        for (int y = 0; y < ch; ++y)
+        {
+            const float *src = hwc + (static_cast<size_t>(y0 + y) * w + x0) * 3;
+            for (int x = 0; x < cw; ++x, src += 3)
+            {
+                *r++ = src[0];
+                *g++ = src[1];
+                *b++ = src[2];
+            }
+        }
+    }
+}
+
+#endif //IMG_PREPROCESS_H
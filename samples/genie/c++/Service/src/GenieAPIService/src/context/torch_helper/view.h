@@ -0,0 +1,370 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#ifndef TORCH_HELPER_VIEW_H
+#define TORCH_HELPER_VIEW_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+ * The scratch memory of one request. Alloc() bumps a pointer and leaves the memory uninitialized, Reset()
+ * hands everything back but keeps the memory, so once the arena has grown to the largest request a request
+ * allocates nothing. A pointer stays valid until Reset().
+ */
+class Arena
+{
+public:
+    template<typename T>
+    T *Alloc(size_t count)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "the arena does not run constructors");
+        const size_t bytes = (count * sizeof(T) + kAlign - 1) / kAlign * kAlign;
+        if (blocks_.empty() || used_ + bytes > blocks_.back().size)
+        {
+            Grow(bytes);
+        }
+        uint8_t *p = blocks_.back().data.get() + used_;
+        used_ += bytes;
+        return reinterpret_cast<T *>(p);
+    }
+
+    void Reset()
+    {
+        // a request which needed more than one block gets them as one the next time.
+        if (blocks_.size() > 1)
+        {
+            size_t total = 0;
+            for (const auto &block: blocks_)
+            {
+                total += block.size;
+            }
+            blocks_.clear();
+            Grow(total);
+        }
+        used_ = 0;
+    }
+
+private:
+    struct Deleter
+    {
+        void operator()(uint8_t *p) const
+        {
+            ::operator delete[](p, std::align_val_t{kAlign});
+        }
+    };
+
+    struct Block
+    {
+        std::unique_ptr<uint8_t[], Deleter> data;
+        size_t size;
+    };
+
+    void Grow(size_t bytes)
+    {
+        const size_t size = std::max({bytes, kMinBlock, blocks_.empty() ? size_t{0} : blocks_.back().size * 2});
+        auto *p = static_cast<uint8_t *>(::operator new[](size, std::align_val_t{kAlign}));
+        blocks_.push_back({std::unique_ptr<uint8_t[], Deleter>{p}, size});
+        used_ = 0;
+    }
+
+    static constexpr size_t kAlign = 64;
+    static constexpr size_t kMinBlock = 1 << 20;
+
+    std::vector<Block> blocks_;
+    size_t used_{};
+};
+
+/*
+ * A strided N-d view in the layout of torch, the data is not owned. Reshape (of a contiguous view), Unsqueeze,
+ * Select, Slice, Permute and Expand only make a new shape and new strides, an expanded axis has stride 0.
+ * The data moves only in CopyTo and Concat, a row of the last axis at a time, so a permute + reshape +
+ * concat chain of the Shape_ND helpers becomes one copy. A stack is a Concat of Unsqueeze(axis) views.
+ */
+template<typename T, int N>
+struct View
+{
+    static_assert(N > 0, "a view has at least one axis");
+
+    T *data{};
+    std::array<int, N> shape{};
+    std::array<ptrdiff_t, N> stride{};
+
+    static View Contiguous(T *data, const std::array<int, N> &shape)
+    {
+        View out{data, shape, {}};
+        ptrdiff_t stride = 1;
+        for (int i = N - 1; i >= 0; --i)
+        {
+            out.stride[i] = stride;
+            stride *= shape[i];
+        }
+        return out;
+    }
+
+    operator View<const T, N>() const
+    {
+        return {data, shape, stride};
+    }
+
+    size_t numel() const
+    {
+        size_t n = 1;
+        for (int d: shape)
+        {
+            n *= static_cast<size_t>(d);
+        }
+        return n;
+    }
+
+    bool IsContiguous() const
+    {
+        ptrdiff_t expected = 1;
+        for (int i = N - 1; i >= 0; --i)
+        {
+            if (shape[i] != 1 && stride[i] != expected)
+            {
+                return false;
+            }
+            expected *= shape[i];
+        }
+        return true;
+    }
+
+    // one axis of `to` may be -1, it is inferred from the element count.
+    template<int M>
+    View<T, M> Reshape(std::array<int, M> to) const
+    {
+        if (!IsContiguous())
+        {
+            throw std::invalid_argument("reshape of a non contiguous view, copy it first");
+        }
+        size_t known = 1;
+        int infer = -1;
+        for (int i = 0; i < M; ++i)
+        {
+            if (to[i] == -1)
+            {
+                infer = i;
+            }
+            else
+            {
+                known *= static_cast<size_t>(to[i]);
+            }
+        }
+        if (infer >= 0 && known != 0)
+        {
+            to[infer] = static_cast<int>(numel() / known);
+            known *= static_cast<size_t>(to[infer]);
+        }
+        if (known != numel())
+        {
+            throw std::invalid_argument("reshape changes the element count");
+        }
+        return View<T, M>::Contiguous(data, to);
+    }
+
+    View<T, N + 1> Unsqueeze(int axis) const
+    {
+        CheckAxis(axis, N + 1);
+        View<T, N + 1> out{data, {}, {}};
+        for (int i = 0, j = 0; i < N + 1; ++i)
+        {
+            if (i == axis)
+            {
+                out.shape[i] = 1;
+                out.stride[i] = j < N ? stride[j] * shape[j] : 1;
+            }
+            else
+            {
+                out.shape[i] = shape[j];
+                out.stride[i] = stride[j];
+                ++j;
+            }
+        }
+        return out;
+    }
+
+    View<T, N - 1> Select(int axis, int index) const
+    {
+        static_assert(N > 1, "select on the last axis gives a scalar");
+        CheckAxis(axis, N);
+        if (index < 0 || index >= shape[axis])
+        {
+            throw std::out_of_range("select index " + std::to_string(index) + " out of range");
+        }
+        View<T, N - 1> out{data + index * stride[axis], {}, {}};
+        for (int i = 0, j = 0; i < N; ++i)
+        {
+            if (i != axis)
+            {
+                out.shape[j] = shape[i];
+                out.stride[j] = stride[i];
+                ++j;
+            }
+        }
+        return out;
+    }
+
+    // [start, end) with step along axis.
+    View Slice(int axis, int start, int end, int step = 1) const
+    {
+        CheckAxis(axis, N);
+        if (step <= 0 || start < 0 || start > end || end > shape[axis])
+        {
+            throw std::out_of_range("slice [" + std::to_string(start) + ", " + std::to_string(end) +
+                                    ") of an axis of " + std::to_string(shape[axis]));
+        }
+        View out = *this;
+        out.data += start * stride[axis];
+        out.shape[axis] = (end - start + step - 1) / step;
+        out.stride[axis] *= step;
+        return out;
+    }
+
+    View Permute(const std::array<int, N> &order) const
+    {
+        View out = *this;
+        for (int i = 0; i < N; ++i)
+        {
+            CheckAxis(order[i], N);
+            out.shape[i] = shape[order[i]];
+            out.stride[i] = stride[order[i]];
+        }
+        return out;
+    }
+
+    // repeat an axis of size 1 `size` times without copying.
+    View Expand(int axis, int size) const
+    {
+        CheckAxis(axis, N);
+        if (shape[axis] != 1)
+        {
+            throw std::invalid_argument("only an axis of size 1 can be expanded");
+        }
+        View out = *this;
+        out.shape[axis] = size;
+        out.stride[axis] = 0;
+        return out;
+    }
+
+private:
+    static void CheckAxis(int axis, int rank)
+    {
+        if (axis < 0 || axis >= rank)
+        {
+            throw std::out_of_range("axis " + std::to_string(axis) + " out of range");
+        }
+    }
+};
+
+namespace view_detail
+{
+    template<int Axis, typename S, typename D, int N>
+    void CopyRows(const View<S, N> &src, const View<D, N> &dst, S *from, D *to)
+    {
+        if constexpr (Axis == N - 1)
+        {
+            if (src.stride[Axis] == 1 && dst.stride[Axis] == 1)
+            {
+                std::memcpy(to, from, src.shape[Axis] * sizeof(D));
+            }
+            else
+            {
+                for (int i = 0; i < src.shape[Axis]; ++i)
+                {
+                    to[i * dst.stride[Axis]] = from[i * src.stride[Axis]];
+                }
+            }
+        }
+        else
+        {
+            for (int i = 0; i < src.shape[Axis]; ++i)
+            {
+                CopyRows<Axis + 1>(src, dst, from + i * src.stride[Axis], to + i * dst.stride[Axis]);
+            }
+        }
+    }
+}
+
+// dst = src, the shapes must be equal, a stride 0 axis of src is a broadcast.
+template<typename S, typename D, int N>
+void CopyTo(const View<S, N> &src, const View<D, N> &dst)
+{
+    static_assert(std::is_same_v<std::remove_const_t<S>, D>, "copy between different types");
+    if (src.shape != dst.shape)
+    {
+        throw std::invalid_argument("copy between different shapes");
+    }
+    if (src.numel() == 0)
+    {
+        return;
+    }
+    view_detail::CopyRows<0>(src, dst, src.data, dst.data);
+}
+
+// the inputs, equal but along axis, one after another along axis into out.
+template<typename T, int N>
+void Concat(int axis, std::initializer_list<View<const T, N>> inputs, const View<T, N> &out)
+{
+    if (axis < 0 || axis >= N)
+    {
+        throw std::out_of_range("concat on axis " + std::to_string(axis));
+    }
+    int offset = 0;
+    for (const auto &in: inputs)
+    {
+        if (offset + in.shape[axis] > out.shape[axis])
+        {
+            throw std::invalid_argument("concat of more than the output holds");
+        }
+        CopyTo(in, out.Slice(axis, offset, offset + in.shape[axis]));
+        offset += in.shape[axis];
+    }
+    if (offset != out.shape[axis])
+    {
+        throw std::invalid_argument("concat of less than the output holds");
+    }
+}
+
+// the same into a contiguous tensor of the arena.
+template<typename T, int N>
+View<T, N> Concat(Arena &arena, int axis, std::initializer_list<View<const T, N>> inputs)
+{
+    if (inputs.size() == 0 || axis < 0 || axis >= N)
+    {
+        throw std::invalid_argument("concat of no inputs or on a wrong axis");
+    }
+    std::array<int, N> shape = inputs.begin()->shape;
+    shape[axis] = 0;
+    for (const auto &in: inputs)
+    {
+        shape[axis] += in.shape[axis];
+    }
+
+    size_t count = 1;
+    for (int d: shape)
+    {
+        count *= static_cast<size_t>(d);
+    }
+    auto out = View<T, N>::Contiguous(arena.Alloc<T>(count), shape);
+    Concat<T, N>(axis, inputs, out);
+    return out;
+}
+
+#endif //TORCH_HELPER_VIEW_H
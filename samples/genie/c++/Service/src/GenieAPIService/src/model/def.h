@@ -10,18 +10,60 @@
 #define MODEL_TYPE_H
 
 #include "base_enum.h"
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 const int DEFAULT_CONTEXT_SIZE = 4096;
 
+/*
+ * A base64 image or audio of a request. Usually a view into the request body, which outlives the query,
+ * it owns the payload only when the JSON parser had to unescape it.
+ */
+class Attachment
+{
+public:
+    std::string_view view() const { return owned_.empty() ? view_ : std::string_view{owned_}; }
+
+    bool empty() const { return view().empty(); }
+
+    void Refer(std::string_view payload)
+    {
+        owned_.clear();
+        view_ = payload;
+    }
+
+    void Own(std::string &&payload)
+    {
+        owned_ = std::move(payload);
+        view_ = {};
+    }
+
+    void clear()
+    {
+        owned_.clear();
+        view_ = {};
+    }
+
+private:
+    std::string owned_;
+    std::string_view view_;
+};
+
 struct ModelInput
 {
     std::string system_;
     std::string text_;
-    std::string image_;
-    std::string audio_;
+    Attachment image_;
+    Attachment audio_;
+    std::string audio_id_;  // a streamed audio, see the /audio/stream route
+    std::string session_;   // the X-Session-Id of the request, empty for the default session
+
+    // pre-tokenized prompt, when it is not empty the context queries with it and ignores text_
+    std::vector<int32_t> tokens_;
 };
 
 struct PromptType : public BaseEnum
@@ -147,18 +189,26 @@ struct QNNEmbeddingType : public BaseEnum
 };
 
 class LibAppBuilder;
+class EmbeddingTable;
 
 struct QNNEmbedding
 {
     ModelType model_types_{};
     QNNEmbeddingType embedding_type_{};
-    std::vector<uint8_t> embedded_raw_buf_;
+    // the token -> embedding LUT, mapped read-only so the service instances share its pages.
+    std::shared_ptr<EmbeddingTable> embedding_table_;
     struct InferResource
     {
         LibAppBuilder *app_builder_;
         std::string tag_;
         std::vector<std::vector<uint8_t>> bin_stacks_;
         std::vector<std::vector<uint8_t>> tails_bin_stacks_;
+
+        // the crops one execution takes, >1 when the graph inputs are compiled with a leading batch dim.
+        size_t batch_{1};
+        std::vector<size_t> input_row_bytes_;  // float bytes of one batch row of each graph input
+
+        void DetectBatch();
     };
 
     std::unordered_map<ModelType, InferResource> infer_resources_;
@@ -76,6 +76,26 @@ public:
         return loraAlpha;
     }
 
+    int getStreamFlushMs() const
+    {
+        return streamFlushMs;
+    }
+
+    int getEmbeddingCacheMb() const
+    {
+        return embeddingCacheMb;
+    }
+
+    const std::string &getEmbeddingCacheDir() const
+    {
+        return embeddingCacheDir;
+    }
+
+    int getEmbeddingCacheDirMb() const
+    {
+        return embeddingCacheDirMb;
+    }
+
     json get_model_list() const;
 
     const QNNEmbedding &get_qnn_embedding() const
@@ -121,6 +141,11 @@ public:
     int num_response_ = 30;
     int minOutputNum = 1024;
     float loraAlpha = 0.5;
+    int streamFlushMs = 0;  // coalesce the streamed tokens within this interval into one SSE event, 0 means per token
+    int modelBudgetMb = 0;  // memory budget of the resident models, 0 means only one model is resident
+    int embeddingCacheMb = 256;  // memory budget of the image / audio embedding cache, 0 disables it
+    std::string embeddingCacheDir;  // the evicted embeddings are spilled here when set
+    int embeddingCacheDirMb = 4096;  // cap of the spill directory, the oldest spilled files are removed beyond it
     QNNEmbedding qnn_embedding_;
 
 protected:
@@ -14,10 +14,16 @@
 #include "../context/llama_cpp.h"
 #include "def.h"
 #include <filesystem>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <unordered_set>
 
 namespace fs = std::filesystem;
 
 #include <LibAppBuilder.hpp>
+#include <EmbeddingTable.hpp>
 
 class ModelManager::QNNImpl
 {
@@ -80,6 +86,7 @@ class ModelManager::QNNImpl
                 infer_resource->bin_stacks_.reserve(files.bin_files_stack_.size());
                 infer_resource->app_builder_ = app_builder;
                 infer_resource->tag_ = model_type.to_string();
+                infer_resource->DetectBatch();
                 for (const auto &bin_file: files.bin_files_stack_)
                 {
                     infer_resource->bin_stacks_.emplace_back(File::ReadFile<uint8_t>(bin_file));
@@ -185,7 +192,12 @@ public:
             embedding = check.func_();
             if (embedding.embedding_type_ != QNNEmbeddingType::None)
             {
-                embedding.embedded_raw_buf_ = File::ReadFile<uint8_t>(raw_path);
+                std::string error;
+                embedding.embedding_table_ = std::make_shared<EmbeddingTable>();
+                if (!embedding.embedding_table_->open(raw_path, error))
+                {
+                    My_Log{My_Log::Level::kError} << error << "\n";
+                }
                 return embedding;
             }
         }
@@ -198,7 +210,7 @@ struct ModelManager::ModeVerifier
     class ModeVerifierImpl
     {
     public:
-        explicit ModeVerifierImpl(ModelManager *self) : self_{self} {}
+        explicit ModeVerifierImpl(IModelConfig *self) : self_{self} {}
 
         virtual ~ModeVerifierImpl() = default;
 
@@ -253,7 +265,7 @@ struct ModelManager::ModeVerifier
         }
 
     protected:
-        ModelManager *self_;
+        IModelConfig *self_;
         bool config_strict_{true};
         const char *ext_{};
 
@@ -263,7 +275,7 @@ struct ModelManager::ModeVerifier
 
     struct QnnVerifier : public ModeVerifierImpl
     {
-        explicit QnnVerifier(ModelManager *self) : ModeVerifierImpl(self) { ext_ = "bin"; }
+        explicit QnnVerifier(IModelConfig *self) : ModeVerifierImpl(self) { ext_ = "bin"; }
 
         std::shared_ptr<ContextBase> CreateIfVerifiedImpl() override
         {
@@ -347,7 +359,7 @@ struct ModelManager::ModeVerifier
 
     struct MnnVerifier : public ModeVerifierImpl
     {
-        explicit MnnVerifier(ModelManager *self) : ModeVerifierImpl(self) { ext_ = ".mnn"; }
+        explicit MnnVerifier(IModelConfig *self) : ModeVerifierImpl(self) { ext_ = ".mnn"; }
 
         std::shared_ptr<ContextBase> CreateIfVerifiedImpl() override
         {
@@ -357,7 +369,7 @@ struct ModelManager::ModeVerifier
 
     struct GGUFVerify : public ModeVerifierImpl
     {
-        explicit GGUFVerify(ModelManager *self) : ModeVerifierImpl(self)
+        explicit GGUFVerify(IModelConfig *self) : ModeVerifierImpl(self)
         {
             config_strict_ = false;
             ext_ = ".gguf";
@@ -369,7 +381,7 @@ struct ModelManager::ModeVerifier
         }
     };
 
-    static std::shared_ptr<ContextBase> TryCreate(ModelManager *self)
+    static std::shared_ptr<ContextBase> TryCreate(IModelConfig *self)
     {
         struct Checker
         {
@@ -423,8 +435,228 @@ struct ModelManager::ModeVerifier
     }
 };
 
+/*
+ * The loaded models, each one owns its IModelConfig since the contexts keep referring to it,
+ * ModelManager itself is the view of the active one.
+ * The models stay resident until the memory budget is exceeded, then the least recently used ones are evicted.
+ * Without a budget, only one model is resident like before.
+ */
+class ModelManager::Residency
+{
+public:
+    enum class State
+    {
+        Loading,
+        Resident
+    };
+
+    struct Entry
+    {
+        std::unique_ptr<IModelConfig> config;
+        State state{State::Loading};
+        size_t bytes{};
+        uint64_t last_used{};
+    };
+
+    explicit Residency(size_t budget) : budget_{budget} {}
+
+    ~Residency()
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            stopping_ = true;
+        }
+        preload_cond_.notify_all();
+        if (preloader_.joinable())
+        {
+            preloader_.join();
+        }
+
+        for (auto &entry: entries_)
+        {
+            Release(entry.second);
+        }
+    }
+
+    // approximate the resident size by the model files, the weights dominate it.
+    static size_t EstimateBytes(const std::string &model_path)
+    {
+        size_t bytes{0};
+        std::error_code ec;
+        for (auto it = fs::recursive_directory_iterator(model_path, ec);
+             !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+        {
+            if (it.depth() >= 1)
+            {
+                it.disable_recursion_pending();
+            }
+            if (it->is_regular_file(ec))
+            {
+                bytes += it->file_size(ec);
+            }
+        }
+        return bytes;
+    }
+
+    static void Release(Entry &entry)
+    {
+        if (!entry.config)
+        {
+            return;
+        }
+        entry.config->genieModelHandle = nullptr;
+        entry.config->qnn_embedding_.Clean();
+    }
+
+    size_t ResidentBytes() const
+    {
+        size_t total{0};
+        for (auto &entry: entries_)
+        {
+            total += entry.second.bytes;
+        }
+        return total;
+    }
+
+    /*
+     * evict the least recently used models until `incoming` bytes fit in the budget, the caller holds mutex_.
+     * keep_active is set when the active model is still serving, e.g. for a preload.
+     * nothing is evicted if the models which can't be evicted, e.g. the loading ones, leave no room anyway.
+     */
+    bool MakeRoom(ModelManager *self, size_t incoming, bool keep_active)
+    {
+        auto evictable = [&](const std::pair<const std::string, Entry> &entry)
+        {
+            return entry.second.state == State::Resident && !(keep_active && entry.first == active_);
+        };
+
+        size_t pinned_bytes{0};
+        size_t pinned{0};
+        for (auto &entry: entries_)
+        {
+            if (!evictable(entry))
+            {
+                pinned_bytes += entry.second.bytes;
+                ++pinned;
+            }
+        }
+        if (budget_ ? pinned_bytes + incoming > budget_ : pinned > 0)
+        {
+            return false;
+        }
+
+        auto fits = [&]() { return budget_ ? ResidentBytes() + incoming <= budget_ : entries_.empty(); };
+        while (!fits())
+        {
+            auto victim = entries_.end();
+            for (auto it = entries_.begin(); it != entries_.end(); ++it)
+            {
+                if (!evictable(*it))
+                {
+                    continue;
+                }
+                if (victim == entries_.end() || it->second.last_used < victim->second.last_used)
+                {
+                    victim = it;
+                }
+            }
+
+            if (victim == entries_.end())
+            {
+                return false;
+            }
+
+            My_Log{} << "evict resident model: " << victim->first << "\n";
+            if (victim->first == active_)
+            {
+                self->Clean();
+                self->loaded_ = false;
+                active_.clear();
+            }
+            Release(victim->second);
+            evicted_.insert(victim->first);
+            entries_.erase(victim);
+        }
+        return true;
+    }
+
+    // queue a preload, they run one after another on a single worker started by the first one.
+    void Post(std::function<void()> preload)
+    {
+        {
+            std::lock_guard<std::mutex> lock{mutex_};
+            preloads_.push_back(std::move(preload));
+            if (!preloader_.joinable())
+            {
+                preloader_ = std::thread{[this]() { RunPreloads(); }};
+            }
+        }
+        preload_cond_.notify_one();
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::unordered_set<std::string> evicted_;
+    std::string active_;
+    uint64_t clock_{0};
+    size_t budget_;
+
+private:
+    void RunPreloads()
+    {
+        std::unique_lock<std::mutex> lock{mutex_};
+        while (true)
+        {
+            preload_cond_.wait(lock, [this]() { return stopping_ || !preloads_.empty(); });
+            if (stopping_)
+            {
+                return;
+            }
+
+            auto preload = std::move(preloads_.front());
+            preloads_.pop_front();
+            lock.unlock();
+            preload();
+            lock.lock();
+        }
+    }
+
+    std::condition_variable preload_cond_;
+    std::deque<std::function<void()>> preloads_;
+    std::thread preloader_;
+    bool stopping_{false};
+};
+
 ModelManager::ModelManager(IModelConfig &&config) :
-        IModelConfig{std::move(config)} {}
+        IModelConfig{std::move(config)},
+        residency_{new Residency{static_cast<size_t>(modelBudgetMb) * 1024 * 1024}} {}
+
+ModelManager::~ModelManager()
+{
+    genieModelHandle = nullptr;
+    delete residency_;
+}
+
+bool ModelManager::ResolveModel(const std::string &new_model, std::string &name) const
+{
+    std::error_code ec;
+    for (const auto &entry: fs::directory_iterator(model_root_, ec))
+    {
+        if (!entry.is_directory())
+        {
+            continue;
+        }
+
+        auto candidate = entry.path().filename().generic_string();
+        if (ModelComparer(candidate, new_model, false))
+        {
+            name = candidate;
+            return true;
+        }
+    }
+    return false;
+}
 
 bool ModelManager::LoadModelByName(const std::string &new_model, bool &first_load)
 {
@@ -445,29 +677,110 @@ bool ModelManager::LoadModelByName(const std::string &new_model, bool &first_loa
     first_load = true;
 
     My_Log{} << "model name: " + new_model << " will be loaded" << std::endl;
-    UpdateModeList();
-    bool found{false};
-    for (const auto &name: model_list_)
+    std::string name;
+    if (!ResolveModel(new_model, name))
+    {
+        My_Log{My_Log::Level::kError} << "model name: " << new_model << " is not exist" << std::endl;
+        return false;
+    }
+
     {
-        if (ModelComparer(name, new_model, false))
+        std::unique_lock<std::mutex> lock{residency_->mutex_};
+        // a preload of this model may be in flight, it is cheaper to wait for it than to load again.
+        residency_->cond_.wait(lock, [this, &name]()
+        {
+            auto it = residency_->entries_.find(name);
+            return it == residency_->entries_.end() || it->second.state != Residency::State::Loading;
+        });
+
+        auto it = residency_->entries_.find(name);
+        if (it != residency_->entries_.end())
         {
-            found = true;
-            model_name_ = name;
-            model_path_ = model_root_ + "/" + name;
-            config_file_ = model_path_ + "/config.json";
-            break;
+            auto use_second = MeasureSeconds([this, &it]() { Activate(*it->second.config); });
+            it->second.last_used = ++residency_->clock_;
+            My_Log{} << GREEN << "switch to resident model: " << name << ", use ms: " << use_second * 1000
+                     << RESET << std::endl;
+            loaded_ = true;
+            return true;
         }
+
+        model_name_ = name;
+        model_path_ = model_root_ + "/" + name;
+        config_file_ = model_path_ + "/config.json";
     }
 
-    if (!found)
+    return LoadModel();
+}
+
+bool ModelManager::IsActive(const std::string &model) const
+{
+    std::lock_guard<std::mutex> lock{residency_->mutex_};
+    return loaded_ && genieModelHandle && !model.empty() && model_name_ == model;
+}
+
+bool ModelManager::PreloadModel(const std::string &new_model)
+{
+    std::string name;
+    if (!ResolveModel(new_model, name))
     {
-        My_Log{My_Log::Level::kError} << "model name: " << new_model << " is not exist" << std::endl;
+        My_Log{My_Log::Level::kError} << "preload model: " << new_model << " is not exist" << std::endl;
         return false;
     }
 
-    return LoadModel();
-}
+    IModelConfig *config;
+    {
+        std::lock_guard<std::mutex> lock{residency_->mutex_};
+        if (residency_->entries_.count(name))
+        {
+            return true;
+        }
+
+        if (!residency_->budget_)
+        {
+            My_Log{My_Log::Level::kError} << "preload needs a model memory budget, see --model_budget_mb\n";
+            return false;
+        }
+
+        auto bytes = Residency::EstimateBytes(model_root_ + "/" + name);
+        if (!residency_->MakeRoom(this, bytes, true))
+        {
+            My_Log{My_Log::Level::kError} << "no room to preload model: " << name << " with "
+                                          << (bytes >> 20) << " MB\n";
+            return false;
+        }
+
+        auto &entry = residency_->entries_[name];
+        entry.config = std::make_unique<IModelConfig>(static_cast<const IModelConfig &>(*this));
+        entry.bytes = bytes;
+        entry.last_used = ++residency_->clock_;
+        config = entry.config.get();
+        config->genieModelHandle = nullptr;
+        config->qnn_embedding_ = {};
+        config->sampler_ = json{};
+        config->known_model_path_.clear();
+        config->model_name_ = name;
+        config->model_path_ = model_root_ + "/" + name;
+        config->config_file_ = config->model_path_ + "/config.json";
+    }
 
+    My_Log{} << "start to preload model: " << name << "\n";
+    residency_->Post([this, name, config]()
+                     {
+                         bool loaded = LoadInto(*config);
+                         std::lock_guard<std::mutex> lock{residency_->mutex_};
+                         if (loaded)
+                         {
+                             residency_->entries_[name].state = Residency::State::Resident;
+                             residency_->evicted_.erase(name);
+                         }
+                         else
+                         {
+                             residency_->entries_.erase(name);
+                         }
+                         residency_->cond_.notify_all();
+                     });
+    return true;
+}
 bool ModelManager::InitializeConfig(bool load)
 {
 
@@ -536,47 +849,137 @@ bool ModelManager::InitializeConfig(bool load)
 
 bool ModelManager::LoadModel()
 {
-    Clean();
-    prompt_type_ = LoadPromptTemplates(model_path_ + "/prompt.json");
-    if (prompt_type_ == PromptType::Unknown)
+    std::unique_ptr<IModelConfig> config;
+    size_t bytes;
+    {
+        std::unique_lock<std::mutex> lock{residency_->mutex_};
+        residency_->cond_.wait(lock, [this]()
+        {
+            auto it = residency_->entries_.find(model_name_);
+            return it == residency_->entries_.end() || it->second.state != Residency::State::Loading;
+        });
+
+        // load again replaces the resident one, e.g. the json config has been changed.
+        auto it = residency_->entries_.find(model_name_);
+        if (it != residency_->entries_.end())
+        {
+            if (it->first == residency_->active_)
+            {
+                Clean();
+                residency_->active_.clear();
+            }
+            Residency::Release(it->second);
+            residency_->entries_.erase(it);
+        }
+
+        bytes = Residency::EstimateBytes(model_path_);
+        if (!residency_->MakeRoom(this, bytes, false))
+        {
+            // the room is held by models being preloaded, loading anyway would overrun the budget.
+            My_Log{My_Log::Level::kError} << "no room to load model: " << model_name_ << " with "
+                                          << (bytes >> 20) << " MB, the resident models are still loading\n";
+            Clean();
+            residency_->active_.clear();
+            model_name_.clear();
+            return false;
+        }
+
+        config = std::make_unique<IModelConfig>(static_cast<const IModelConfig &>(*this));
+        config->genieModelHandle = nullptr;
+        config->qnn_embedding_ = {};
+        config->sampler_ = json{};
+        config->known_model_path_.clear();
+    }
+
+    if (!LoadInto(*config))
+    {
+        std::lock_guard<std::mutex> lock{residency_->mutex_};
+        Clean();
+        residency_->active_.clear();
+        model_name_.clear();
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock{residency_->mutex_};
+    auto &entry = residency_->entries_[config->model_name_];
+    entry.bytes = bytes;
+    entry.state = Residency::State::Resident;
+    entry.last_used = ++residency_->clock_;
+    entry.config = std::move(config);
+    residency_->evicted_.erase(model_name_);
+    Activate(*entry.config);
+    loaded_ = true;
+    return true;
+}
+
+bool ModelManager::LoadInto(IModelConfig &target)
+{
+    target.prompt_type_ = LoadPromptTemplates(target, target.model_path_ + "/prompt.json");
+    if (target.prompt_type_ == PromptType::Unknown)
     {
         return false;
     }
 
-    My_Log{} << "check the prompt type: " << prompt_type_.to_string() << "\n";
+    My_Log{} << "check the prompt type: " << target.prompt_type_.to_string() << "\n";
 
-    thinking_model_ = [this]() -> bool
+    target.thinking_model_ = [&target]() -> bool
     {
-        return str_contains(model_name_, "Qwen3") ||
-               str_contains(model_name_, "DeepSeek") ||
-               str_contains(model_name_, "Hunyuan");
+        return str_contains(target.model_name_, "Qwen3") ||
+               str_contains(target.model_name_, "DeepSeek") ||
+               str_contains(target.model_name_, "Hunyuan");
     }();
-    My_Log{} << "check if is thinking model: " << thinking_model_ << "\n";
+    My_Log{} << "check if is thinking model: " << target.thinking_model_ << "\n";
 
 
-    genieModelHandle = ModeVerifier::TryCreate(this);
-    if (!genieModelHandle)
+    target.genieModelHandle = ModeVerifier::TryCreate(&target);
+    if (!target.genieModelHandle)
     {
-        My_Log{} << RED << "Load Model Failed, Model Name: " << model_name_ << RESET << std::endl;
-        model_name_.clear();
+        My_Log{} << RED << "Load Model Failed, Model Name: " << target.model_name_ << RESET << std::endl;
         return false;
     }
 
-    My_Log{} << GREEN << "Model load successfully: " << model_name_ << RESET << std::endl;
-    loaded_ = true;
+    My_Log{} << GREEN << "Model load successfully: " << target.model_name_ << RESET << std::endl;
     return true;
 }
 
+// the caller holds the residency mutex.
+void ModelManager::Activate(const IModelConfig &resident)
+{
+    model_name_ = resident.model_name_;
+    model_path_ = resident.model_path_;
+    config_file_ = resident.config_file_;
+    known_model_path_ = resident.known_model_path_;
+    prompt_ = resident.prompt_;
+    prompt_type_ = resident.prompt_type_;
+    thinking_model_ = resident.thinking_model_;
+    model_format_ = resident.model_format_;
+    context_size_ = resident.context_size_;
+    genieModelHandle = resident.genieModelHandle;
+    residency_->active_ = resident.model_name_;
+}
+
 void ModelManager::UnloadModel()
 {
     if (genieModelHandle == nullptr)
     {
         My_Log{My_Log::Level::kError} << "unload model without init" << std::endl;
     }
-    else
+
+    std::lock_guard<std::mutex> lock{residency_->mutex_};
+    Clean();
+    model_name_.clear();
+    loaded_ = false;
+    residency_->active_.clear();
+    for (auto it = residency_->entries_.begin(); it != residency_->entries_.end();)
     {
-        Clean();
-        model_name_.clear();
+        // the loading ones are still referred by their preloader.
+        if (it->second.state == Residency::State::Loading)
+        {
+            ++it;
+            continue;
+        }
+        Residency::Release(it->second);
+        it = residency_->entries_.erase(it);
     }
 }
 
@@ -584,7 +987,7 @@ void ModelManager::UnloadModel()
  * Determine model response processor
  * build prompt from chathistroy(TextQuery), add History
  * */
-PromptType ModelManager::LoadPromptTemplates(std::string &&prompt_path)
+PromptType ModelManager::LoadPromptTemplates(IModelConfig &target, std::string &&prompt_path)
 {
     PromptType pt{PromptType::Unknown};
     json j;
@@ -592,10 +995,10 @@ PromptType ModelManager::LoadPromptTemplates(std::string &&prompt_path)
     if (!File::IsFileExist(prompt_path) || File::IsFileEmpty(prompt_path))
     {
         std::string org_prompt_path = prompt_path;
-        known_model_path_ = ResolveKnownModelPath(model_name_, false);
-        if (!known_model_path_.empty())
+        target.known_model_path_ = ResolveKnownModelPath(target.model_name_, false);
+        if (!target.known_model_path_.empty())
         {
-            prompt_path = known_model_path_ + "/prompt.json";
+            prompt_path = target.known_model_path_ + "/prompt.json";
             My_Log{} << "get known model path successfully\n";
             goto ahead;
         }
@@ -617,7 +1020,7 @@ PromptType ModelManager::LoadPromptTemplates(std::string &&prompt_path)
         for (const auto &model_prefix: models_prefix)
         {
             // check if model match one of the prefix
-            if (ModelComparer(model_name_, model_prefix, true))
+            if (ModelComparer(target.model_name_, model_prefix, true))
             {
                 // one of them, such as qwen match qwen2.0-7b or qwen2.0-7b-ssd or qwen3
                 prompt_path = ResolveKnownModelPath(model_prefix, true);
@@ -651,7 +1054,7 @@ PromptType ModelManager::LoadPromptTemplates(std::string &&prompt_path)
     try
     {
         file >> j;
-        prompt_ = json{
+        target.prompt_ = json{
                 {"system",    j["prompt_system"].get<std::string>()},
                 {"user",      j["prompt_user"].get<std::string>()},
                 {"assistant", j["prompt_assistant"].get<std::string>()},
@@ -667,14 +1070,14 @@ PromptType ModelManager::LoadPromptTemplates(std::string &&prompt_path)
 
     try
     {
-        context_size_ = j["context_size"];
+        target.context_size_ = j["context_size"];
     }
     catch (const std::exception &/*e*/)
     {
-        context_size_ = DEFAULT_CONTEXT_SIZE;
+        target.context_size_ = DEFAULT_CONTEXT_SIZE;
     }
 
-    pt = str_contains(prompt_["assistant"], "<|channel|>");
+    pt = str_contains(target.prompt_["assistant"], "<|channel|>");
     return pt;
 }
 
@@ -698,6 +1101,50 @@ json IModelConfig::get_model_list() const
     return jsonData;
 }
 
+json ModelManager::get_model_list() const
+{
+    json jsonData;
+    std::vector<json> models;
+    std::lock_guard<std::mutex> lock{residency_->mutex_};
+    std::error_code ec;
+    for (const auto &entry: fs::directory_iterator(model_root_, ec))
+    {
+        if (!entry.is_directory())
+        {
+            continue;
+        }
+
+        auto mode_name = entry.path().filename().generic_string();
+        json model;
+        model["id"] = mode_name;
+        model["object"] = "model";
+        model["created"] = timer.GetSystemTime();
+        model["owned_by"] = "owner";
+        model["permission"] = json::array();
+
+        // unloaded -> loading -> resident / active -> evicted
+        std::string state{"unloaded"};
+        auto it = residency_->entries_.find(mode_name);
+        if (it != residency_->entries_.end())
+        {
+            state = it->second.state == Residency::State::Loading ? "loading" :
+                    mode_name == residency_->active_ ? "active" : "resident";
+            model["resident_mb"] = it->second.bytes >> 20;
+        }
+        else if (residency_->evicted_.count(mode_name))
+        {
+            state = "evicted";
+        }
+        model["state"] = state;
+        models.push_back(model);
+    }
+    jsonData["data"] = models;
+    jsonData["object"] = "list";
+    jsonData["memory_budget_mb"] = residency_->budget_ >> 20;
+    jsonData["resident_mb"] = residency_->ResidentBytes() >> 20;
+    return jsonData;
+}
+
 void IModelConfig::UpdateModeList() const
 {
     model_list_.clear();
@@ -776,7 +1223,7 @@ bool ModelManager::ModelComparer(const std::string &source, const std::string &t
 
 void QNNEmbedding::Clean()
 {
-    embedded_raw_buf_.clear();
+    embedding_table_.reset();
     for (auto &infer_resource: infer_resources_)
     {
         auto &app_builder = infer_resource.second.app_builder_;
@@ -792,6 +1239,35 @@ void QNNEmbedding::Clean()
     model_types_ = ModelType::Unknown;
 }
 
+void QNNEmbedding::InferResource::DetectBatch()
+{
+    batch_ = 1;
+    input_row_bytes_.clear();
+
+    auto shapes = app_builder_->getInputShapes(tag_);
+    if (shapes.empty() || shapes[0].size() < 2 || shapes[0][0] <= 1)
+    {
+        return;
+    }
+
+    const size_t batch = shapes[0][0];
+    for (const auto &shape: shapes)
+    {
+        if (shape.empty() || shape[0] != batch)
+        {
+            return;
+        }
+        size_t elements = 1;
+        for (auto dim: shape)
+        {
+            elements *= dim;
+        }
+        input_row_bytes_.push_back(elements / batch * sizeof(float));
+    }
+    batch_ = batch;
+    My_Log{} << tag_ << " encoder takes " << batch_ << " crops per execution\n";
+}
+
 LibAppBuilder *QNNEmbedding::LibAppbuilderCreator(const std::string &serialized_file,
                                                   const std::string &tag)
 {
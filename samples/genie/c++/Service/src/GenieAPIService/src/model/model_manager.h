@@ -16,8 +16,16 @@ class ModelManager : public IModelConfig
 public:
     explicit ModelManager(IModelConfig &&config);
 
+    ~ModelManager();
+
     bool LoadModelByName(const std::string &new_model, bool &first_load);
 
+    // load the model in the background while the active one keeps serving.
+    bool PreloadModel(const std::string &new_model);
+
+    // the model list with the residency state of each model.
+    json get_model_list() const;
+
     bool InitializeConfig(bool load);
 
     void UnloadModel();
@@ -25,11 +33,20 @@ public:
     bool IsLoaded()
     { return loaded_; }
 
+    // the model is the active one, a request of it needs no load.
+    bool IsActive(const std::string &model) const;
+
     bool LoadModel();
 
 private:
 
-    PromptType LoadPromptTemplates(std::string &&prompt_path);
+    bool ResolveModel(const std::string &new_model, std::string &name) const;
+
+    bool LoadInto(IModelConfig &target);
+
+    void Activate(const IModelConfig &resident);
+
+    PromptType LoadPromptTemplates(IModelConfig &target, std::string &&prompt_path);
 
     std::string ResolveKnownModelPath(const std::string& model_feature, bool only_prefix);
 
@@ -40,7 +57,11 @@ private:
     struct ModeVerifier;
 
     class QNNImpl;
-    
+
+    class Residency;
+
+    Residency *residency_;
+
     std::atomic<bool> loaded_{false};
 };
 
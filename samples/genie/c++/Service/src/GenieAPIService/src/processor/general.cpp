@@ -8,53 +8,36 @@
 
 #include "general.h"
 
-#include <nlohmann/json.hpp>
-#include "utils.h"
-
-using json = nlohmann::ordered_json;
-
-struct GeneralProcessor::Utils
-{
-    static inline const std::string FN_NAME = "<tool_call>";
-    static inline const char FN_FLAG = '<';
-};
-
 std::tuple<bool, std::string> GeneralProcessor::PreProcessStream(std::string &chunkText,
                                                                  bool isToolResponse,
                                                                  std::string &toolResponse)
 {
-    bool currentIsToolResponse = isToolResponse;
-    std::string keepChunk;
-
-    if (currentIsToolResponse)
+    if (isToolResponse)
     {
         toolResponse += chunkText;
+        return std::make_tuple(true, std::move(chunkText));
     }
-    else if (str_contains(chunkText, std::string{Utils::FN_FLAG}))
-    {
-        std::string result;
-        size_t pos = chunkText.find(Utils::FN_FLAG);
-        if (pos != std::string::npos)
-        {
-            result = chunkText.substr(pos);
-            keepChunk = chunkText.substr(0, pos);
-        }
 
-        currentIsToolResponse = true;
-        toolResponse += result;
-    }
-
-    if (!str_contains(toolResponse, Utils::FN_NAME))
+    // a '<' which does not grow into <tool_call> is released as soon as the scanner rules it out.
+    std::string keepChunk;
+    int tag;
+    size_t consumed = scanner_.Feed(chunkText, [&keepChunk](std::string_view text) { keepChunk += text; }, tag);
+    if (tag == TagScanner::kNoTag)
     {
-        currentIsToolResponse = false;
-        keepChunk = toolResponse;  // Since it's not tools call, add the content in toolResponse buffer to keepChunk and print it.
-        toolResponse.clear();
+        return std::make_tuple(false, keepChunk);
     }
 
-    if (keepChunk.empty())
-    {
-        keepChunk = std::move(chunkText);
-    }
+    // the rest of the chunk after the tag belongs to the tool call, and is forwarded like the chunks that follow.
+    toolResponse += scanner_.tag(tag);
+    toolResponse.append(chunkText, consumed, std::string::npos);
+    keepChunk += scanner_.tag(tag);
+    keepChunk.append(chunkText, consumed, std::string::npos);
+    return std::make_tuple(true, keepChunk);
+}
 
-    return std::make_tuple(currentIsToolResponse, keepChunk);
-}
\ No newline at end of file
+std::string GeneralProcessor::Flush()
+{
+    std::string rest;
+    scanner_.Flush([&rest](std::string_view text) { rest += text; });
+    return rest;
+}
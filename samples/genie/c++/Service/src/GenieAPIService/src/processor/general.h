@@ -10,6 +10,7 @@
 #define GENERAL_H
 
 #include "processor.h"
+#include "tag_scanner.h"
 
 class GeneralProcessor : public ModelProcessor
 {
@@ -17,10 +18,14 @@ public:
     std::tuple<bool, std::string>
     PreProcessStream(std::string &chunkText, bool isToolResponse, std::string &toolResponse) override;
 
+    std::string Flush() override;
+
     void Clean() final
-    {};
+    { scanner_.Reset(); };
 private:
     struct Utils;
+
+    TagScanner scanner_{{"<tool_call>"}};
 };
 
 #endif //GENERAL_H
@@ -15,29 +15,29 @@ class HarmonyProcessor::Impl
 public:
     explicit Impl(HarmonyProcessor *parent) :
         parent_{parent},
-        analysisCallback([this](const std::string& content) { handleAnalysis(content); }),
-        finalCallback([this](const std::string& content) { handleFinal(content); }),
-        commentaryCallback([this](const std::string& content) { handleCommentary(content);}),
-        functionsCallback([this](const std::string& content) { handleFunctions(content);})
+        analysisCallback([this](std::string_view content) { handleAnalysis(content); }),
+        finalCallback([this](std::string_view content) { handleFinal(content); }),
+        commentaryCallback([this](std::string_view content) { handleCommentary(content);}),
+        functionsCallback([this](std::string_view content) { handleFunctions(content);})
     {}
 
-    using AnalysisCallback = std::function<void(const std::string &)>;
-    using FinalCallback = std::function<void(const std::string &)>;
-    using CommentaryCallback = std::function<void(const std::string &)>;
-    using FunctionsCallback = std::function<void(const std::string &)>;
+    using AnalysisCallback = std::function<void(std::string_view)>;
+    using FinalCallback = std::function<void(std::string_view)>;
+    using CommentaryCallback = std::function<void(std::string_view)>;
+    using FunctionsCallback = std::function<void(std::string_view)>;
 
     AnalysisCallback analysisCallback;
     FinalCallback finalCallback;
     CommentaryCallback commentaryCallback;
     FunctionsCallback functionsCallback;
 
-    void handleAnalysis(const std::string &content);
+    void handleAnalysis(std::string_view content);
 
-    void handleFinal(const std::string &content);
+    void handleFinal(std::string_view content);
 
-    void handleCommentary(const std::string &content);
+    void handleCommentary(std::string_view content);
 
-    void handleFunctions(const std::string &content);
+    void handleFunctions(std::string_view content);
 
     static  ChannelType determineChannelType(const std::string &channelStr);
 
@@ -54,9 +54,26 @@ private:
 /* @formatter:on */
 
 
+namespace
+{
+const std::string startTag = "<|start|>assistant<|channel|>";
+const std::string startFunctionsTag = "<|start|>functions.";
+const std::string messageTag = "<|message|>";
+const std::string endTag = "<|end|>";
+const std::string returnTag = "<|return|>";
+const std::string callTag = "<|call|>";
+const std::string channelTag = "<|channel|>";
+
+enum InitTag { kStartTag, kStartFunctionsTag };
+}
+
 HarmonyProcessor::HarmonyProcessor() :
         impl_{new Impl{this}},
-        currentState(State::INIT)
+        currentState(State::INIT),
+        initScanner{{startTag, startFunctionsTag}},
+        channelScanner{{messageTag}},
+        messageScanner{{endTag, callTag}},
+        finalScanner{{returnTag}}
 {
 }
 
@@ -67,32 +84,38 @@ std::tuple<bool, std::string> HarmonyProcessor::PreProcessStream(std::string &ch
     m_analysisText.clear();
     m_finalText.clear();
 
-    if (start_tag_.empty())
-    {
-        goto ahead;
-    }
-
-    if (chunkText.find("<|channel|>") != std::string::npos)
+    // the model starts with a bare channel tag, feed the omitted header in front of it.
+    if (!start_tag_.empty() && chunkText.find(channelTag) != std::string::npos)
     {
-        chunkText = start_tag_ + chunkText;
+        processChunk(start_tag_);
         start_tag_.clear();
     }
 
-    ahead:
     processChunk(chunkText);
     chunkText = m_analysisText + m_finalText;
 
     return std::make_tuple(false, chunkText);
 }
 
-size_t HarmonyProcessor::findTag(const std::string &tag)
+std::string HarmonyProcessor::Flush()
 {
-    if (buffer.empty())
-        return std::string::npos;
+    m_analysisText.clear();
+    m_finalText.clear();
+    currentScanner().Flush([this](std::string_view text) { handleText(text); });
+    return m_analysisText + m_finalText;
+}
 
-    // return buffer.find(tag);
-    auto it = std::search(buffer.begin(), buffer.end(), tag.begin(), tag.end());
-    return it == buffer.end() ? std::string::npos : std::distance(buffer.begin(), it);
+TagScanner &HarmonyProcessor::currentScanner()
+{
+    switch (currentState)
+    {
+        case State::IN_CHANNEL:
+            return channelScanner;
+        case State::IN_MESSAGE:
+            return currentChannel == ChannelType::FINAL ? finalScanner : messageScanner;
+        default:
+            return initScanner;
+    }
 }
 
 void HarmonyProcessor::ResetState()
@@ -101,204 +124,81 @@ void HarmonyProcessor::ResetState()
     currentChannel = ChannelType::UNKNOWN;
     currentChannelStr.clear();
     currentMessage.clear();
-    outputtedLength = 0;
-    pendingBuffer.clear();
-    buffer.clear();
+    initScanner.Reset();
+    channelScanner.Reset();
+    messageScanner.Reset();
+    finalScanner.Reset();
 }
 
-void HarmonyProcessor::processChunk(const std::string &chunk)
+void HarmonyProcessor::handleText(std::string_view text)
 {
-    static const std::string startTag = "<|start|>assistant<|channel|>";
-    static const std::string startFunctionsTag = "<|start|>functions.";
-    static const std::string messageTag = "<|message|>";
-    static const std::string endTag = "<|end|>";
-    static const std::string returnTag = "<|return|>";
-    static const std::string callTag = "<|call|>";
+    switch (currentState)
+    {
+        case State::IN_CHANNEL:
+            currentChannelStr.append(text);
+            break;
+        case State::IN_MESSAGE:
+            // analysis and final are streamed, the others are delivered as a whole message.
+            if (currentChannel == ChannelType::ANALYSIS)
+            {
+                impl_->analysisCallback(text);
+            }
+            else if (currentChannel == ChannelType::FINAL)
+            {
+                impl_->finalCallback(text);
+            }
+            else
+            {
+                currentMessage.append(text);
+            }
+            break;
+        default:
+            // text outside of a message is dropped.
+            break;
+    }
+}
 
-    pendingBuffer += chunk;
-    buffer = pendingBuffer;
+void HarmonyProcessor::processChunk(std::string_view chunk)
+{
+    auto on_text = [this](std::string_view text) { handleText(text); };
 
-    while (true)
+    while (!chunk.empty())
     {
+        int tag;
+        chunk.remove_prefix(currentScanner().Feed(chunk, on_text, tag));
+        if (tag == TagScanner::kNoTag)
+        {
+            return;
+        }
+
         switch (currentState)
         {
             case State::INIT:
-            {
-                size_t startPos = findTag(startTag);
-                size_t funcPos = findTag(startFunctionsTag);
-
-                // 优先处理先出现的标签
-                if (startPos != std::string::npos && (funcPos == std::string::npos || startPos < funcPos))
-                {
-                    pendingBuffer = pendingBuffer.substr(startPos + startTag.length());
-                    buffer = pendingBuffer;
-                    currentState = State::IN_CHANNEL;
-                    currentChannelStr.clear();
-                }
-                else if (funcPos != std::string::npos)
-                {
-                    pendingBuffer = pendingBuffer.substr(funcPos + startFunctionsTag.length());
-                    buffer = pendingBuffer;
-                    currentState = State::IN_CHANNEL;
-                    currentChannelStr = "functions.";
-                }
-                else
-                {
-                    // 保留足够长的缓冲区以确保能识别标签
-                    if (pendingBuffer.length() > std::max(startTag.length(), startFunctionsTag.length()) * 2)
-                    {
-                        size_t keepLength = std::max(startTag.length(), startFunctionsTag.length());
-                        pendingBuffer = pendingBuffer.substr(pendingBuffer.length() - keepLength);
-                        buffer = pendingBuffer;
-                    }
-                    return;
-                }
+                currentState = State::IN_CHANNEL;
+                currentChannelStr = tag == kStartFunctionsTag ? "functions." : "";
                 break;
-            }
 
             case State::IN_CHANNEL:
-            {
-                size_t msgPos = findTag(messageTag);
-                if (msgPos != std::string::npos)
-                {
-                    currentChannelStr += buffer.substr(0, msgPos);
-                    currentChannel = Impl::determineChannelType(currentChannelStr);
-
-                    pendingBuffer = pendingBuffer.substr(msgPos + messageTag.length());
-                    buffer = pendingBuffer;
-                    currentState = State::IN_MESSAGE;
-                    currentMessage.clear();
-                    outputtedLength = 0;
-                }
-                else
-                {
-                    // 确保保留足够长度以识别messageTag
-                    if (pendingBuffer.length() > messageTag.length() * 2)
-                    {
-                        currentChannelStr += pendingBuffer.substr(0, pendingBuffer.length() - messageTag.length());
-                        pendingBuffer = pendingBuffer.substr(pendingBuffer.length() - messageTag.length());
-                        buffer = pendingBuffer;
-                    }
-                    return;
-                }
+                currentChannel = Impl::determineChannelType(currentChannelStr);
+                currentState = State::IN_MESSAGE;
+                currentMessage.clear();
                 break;
-            }
 
             case State::IN_MESSAGE:
-            {
-                std::string endMarker;
-                if (currentChannel == ChannelType::FINAL)
+                if (currentChannel == ChannelType::COMMENTARY)
                 {
-                    endMarker = returnTag;
+                    impl_->commentaryCallback(currentMessage);
                 }
-                else
+                else if (currentChannel == ChannelType::FUNCTIONS)
                 {
-                    size_t callPos = findTag(callTag);
-                    size_t endPos = findTag(endTag);
-
-                    if (callPos != std::string::npos && (endPos == std::string::npos || callPos < endPos))
-                    {
-                        endMarker = callTag;
-                    }
-                    else
-                    {
-                        endMarker = endTag;
-                    }
+                    impl_->functionsCallback(currentMessage);
                 }
 
-                size_t endPos = findTag(endMarker);
-                if (endPos != std::string::npos)
-                {
-                    currentMessage = buffer.substr(0, endPos);
-                    // std::cout << "\n buffer: " << buffer << std::endl;
-
-                    // 处理所有通道的完整消息
-                    switch (currentChannel)
-                    {
-                        case ChannelType::ANALYSIS:
-                            if (currentMessage.length() > outputtedLength)
-                            {
-                                impl_->analysisCallback(currentMessage.substr(outputtedLength));
-                                outputtedLength = currentMessage.length();
-                            }
-                            break;
-                        case ChannelType::FINAL:
-                            if (currentMessage.length() > outputtedLength)
-                            {
-                                impl_->finalCallback(currentMessage.substr(outputtedLength));
-                                outputtedLength = currentMessage.length();
-                            }
-                            break;
-                        case ChannelType::COMMENTARY:
-                            impl_->commentaryCallback(currentMessage);
-                            break;
-                        case ChannelType::FUNCTIONS:
-                            impl_->functionsCallback(currentMessage);
-                            break;
-                        default:
-                            break;
-                    }
-
-                    pendingBuffer = pendingBuffer.substr(endPos + endMarker.length());
-                    buffer = pendingBuffer;
-
-                    // 不在这里调用 resetState()，而是手动重置必要的状态
-                    currentState = State::INIT;
-                    currentChannel = ChannelType::UNKNOWN;
-                    currentChannelStr.clear();
-                    currentMessage.clear();
-                    outputtedLength = 0;
-                }
-                else
-                {
-                    // 处理部分消息，只输出新增内容
-                    std::string newContent = buffer;
-
-                    // 检查是否有标签片段，避免输出标签内容
-                    size_t maxSafeLength = newContent.length();
-                    for (const auto &tag: {endMarker, callTag, returnTag})
-                    {
-                        // 只检查以`<|`开头的前缀，避免单独`<`被误判
-                        if (tag.substr(0, 2) == "<|")
-                        {  // 确保是标签格式
-                            for (size_t i = 2; i < tag.length(); ++i)
-                            {  // 从`<|`之后开始检查
-                                std::string prefix = tag.substr(0, i);
-                                size_t pos = newContent.find(prefix);
-                                if (pos != std::string::npos && pos < maxSafeLength)
-                                {
-                                    maxSafeLength = pos;
-                                }
-                            }
-                        }
-                    }
-
-                    // 确保至少有一些内容可以输出
-                    if (maxSafeLength > outputtedLength)
-                    {
-                        std::string newOutput = newContent.substr(outputtedLength, maxSafeLength - outputtedLength);
-                        outputtedLength = maxSafeLength;
-
-                        if (currentChannel == ChannelType::ANALYSIS)
-                        {
-                            impl_->analysisCallback(newOutput);
-                        }
-                        else if (currentChannel == ChannelType::FINAL)
-                        {
-                            impl_->finalCallback(newOutput);
-                        }
-                    }
-
-                    // 限制缓冲区大小，防止内存溢出
-                    if (pendingBuffer.length() > 1024 * 1024)
-                    {  // 1MB上限
-                        pendingBuffer = pendingBuffer.substr(pendingBuffer.length() - (endMarker.length() * 2));
-                        buffer = pendingBuffer;
-                    }
-                    return;
-                }
+                currentState = State::INIT;
+                currentChannel = ChannelType::UNKNOWN;
+                currentChannelStr.clear();
+                currentMessage.clear();
                 break;
-            }
 
             default:
                 ResetState();
@@ -319,7 +219,7 @@ void HarmonyProcessor::Clean()
     ResetState();
 }
 
-void HarmonyProcessor::Impl::handleAnalysis(const std::string &content)
+void HarmonyProcessor::Impl::handleAnalysis(std::string_view content)
 {
     if (!m_isAnalysis)
     {
@@ -329,7 +229,7 @@ void HarmonyProcessor::Impl::handleAnalysis(const std::string &content)
     parent_->m_analysisText += content;
 }
 
-void HarmonyProcessor::Impl::handleFinal(const std::string &content)
+void HarmonyProcessor::Impl::handleFinal(std::string_view content)
 {
     if (!m_isFinal)
     {
@@ -339,13 +239,13 @@ void HarmonyProcessor::Impl::handleFinal(const std::string &content)
     parent_->m_finalText += content;
 }
 
-void HarmonyProcessor::Impl::handleCommentary(const std::string &content)
+void HarmonyProcessor::Impl::handleCommentary(std::string_view content)
 {
     // 对commentary进行特殊处理，这里只是记录到日志
     // std::cout << "[Commentary] " << content << std::endl;
 }
 
-void HarmonyProcessor::Impl::handleFunctions(const std::string &content)
+void HarmonyProcessor::Impl::handleFunctions(std::string_view content)
 {
     // 对函数调用结果进行特殊处理
     // std::cout << "[Functions] " << content << std::endl;
@@ -10,6 +10,7 @@
 #define HS_PROCESSOR_H
 
 #include "processor.h"
+#include "tag_scanner.h"
 
 class HarmonyProcessor : public ModelProcessor
 {
@@ -22,6 +23,8 @@ public:
                                                    bool isToolResponse,
                                                    std::string &toolResponse) override;
 
+    std::string Flush() override;
+
     void Clean() final;
 
 private:
@@ -32,7 +35,7 @@ private:
     std::string m_analysisText;
     std::string m_finalText;
 
-    void processChunk(const std::string &chunk);
+    void processChunk(std::string_view chunk);
 
     enum class State
     {
@@ -53,13 +56,18 @@ private:
 
     State currentState;
     ChannelType currentChannel{ChannelType::UNKNOWN};
-    std::string buffer;             // 用于累积输入
     std::string currentMessage;     // 当前消息内容
     std::string currentChannelStr;  // 当前通道字符串
-    size_t outputtedLength = 0;     // 记录已输出的长度，用于计算新增内容
-    std::string pendingBuffer;      // 用于暂存未完成标签的内容
 
-    size_t findTag(const std::string &tag);
+    // one scanner per state, each only knows the tags which can move the state forward.
+    TagScanner initScanner;
+    TagScanner channelScanner;
+    TagScanner messageScanner;
+    TagScanner finalScanner;
+
+    TagScanner &currentScanner();
+
+    void handleText(std::string_view text);
 
     void ResetState();
 };
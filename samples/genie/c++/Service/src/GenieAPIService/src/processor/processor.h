@@ -10,6 +10,8 @@
 #define MODEL_PROCESSING_H
 
 #include <string>
+#include <tuple>
+
 class ModelProcessor
 {
 public:
@@ -21,6 +23,9 @@ public:
                                                            bool isToolResponse,
                                                            std::string &toolResponse) = 0;
 
+    // text held back while waiting for a possible tag, called once the generation is done.
+    virtual std::string Flush() { return {}; }
+
     std::string start_tag_;
 };
 
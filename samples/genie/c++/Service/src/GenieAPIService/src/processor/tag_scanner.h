@@ -0,0 +1,165 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#ifndef TAG_SCANNER_H
+#define TAG_SCANNER_H
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ * Resumable multi-tag matcher for streamed text.
+ * Every byte is fed once into a KMP automaton per tag, only the bytes which may still turn into a tag
+ * (at most the longest tag length) are held back between chunks, so tags straddling chunk boundaries
+ * are recognized without re-scanning or re-buffering the whole stream.
+ */
+class TagScanner
+{
+public:
+    static constexpr int kNoTag = -1;
+
+    explicit TagScanner(std::vector<std::string> tags) : tags_{std::move(tags)}
+    {
+        fail_.resize(tags_.size());
+        for (size_t t = 0; t < tags_.size(); ++t)
+        {
+            const auto &tag = tags_[t];
+            auto &fail = fail_[t];
+            fail.assign(tag.size() + 1, 0);
+            for (size_t i = 1, k = 0; i < tag.size(); ++i)
+            {
+                while (k && tag[i] != tag[k])
+                {
+                    k = fail[k];
+                }
+                if (tag[i] == tag[k])
+                {
+                    ++k;
+                }
+                fail[i + 1] = k;
+            }
+        }
+        state_.assign(tags_.size(), 0);
+    }
+
+    /*
+     * Scan the chunk until the first complete tag.
+     * on_text(std::string_view) receives the plain text before it, possibly in two pieces.
+     * return the bytes consumed from the chunk, `tag` is set to the tag index or kNoTag.
+     */
+    template<typename OnText>
+    size_t Feed(std::string_view chunk, OnText &&on_text, int &tag)
+    {
+        tag = kNoTag;
+        for (size_t i = 0; i < chunk.size(); ++i)
+        {
+            const char c = chunk[i];
+            size_t matched = 0;
+            for (size_t t = 0; t < tags_.size(); ++t)
+            {
+                size_t k = state_[t];
+                const auto &pattern = tags_[t];
+                while (k && pattern[k] != c)
+                {
+                    k = fail_[t][k];
+                }
+                if (pattern[k] == c)
+                {
+                    ++k;
+                }
+                state_[t] = k;
+
+                // the longest one wins if several tags end at this byte.
+                if (k == pattern.size() && k > matched)
+                {
+                    matched = k;
+                    tag = static_cast<int>(t);
+                }
+            }
+
+            if (tag != kNoTag)
+            {
+                Emit(chunk.substr(0, i + 1), held_.size() + i + 1 - matched, on_text);
+                held_.clear();
+                std::fill(state_.begin(), state_.end(), 0);
+                return i + 1;
+            }
+        }
+
+        size_t keep = 0;
+        for (auto k: state_)
+        {
+            keep = std::max(keep, k);
+        }
+
+        const size_t total = held_.size() + chunk.size();
+        Emit(chunk, total - keep, on_text);
+        if (keep <= chunk.size())
+        {
+            held_.assign(chunk.substr(chunk.size() - keep));
+        }
+        else
+        {
+            held_.erase(0, held_.size() - (keep - chunk.size()));
+            held_.append(chunk);
+        }
+        return chunk.size();
+    }
+
+    // hand out the bytes held as a possible tag prefix, used once the stream ends.
+    template<typename OnText>
+    void Flush(OnText &&on_text)
+    {
+        if (!held_.empty())
+        {
+            on_text(std::string_view{held_});
+        }
+        Reset();
+    }
+
+    void Reset()
+    {
+        held_.clear();
+        std::fill(state_.begin(), state_.end(), 0);
+    }
+
+    const std::string &tag(int index) const
+    {
+        return tags_[index];
+    }
+
+private:
+    // emit the first `length` bytes of held_ + chunk as text.
+    template<typename OnText>
+    void Emit(std::string_view chunk, size_t length, OnText &&on_text)
+    {
+        if (!length)
+        {
+            return;
+        }
+
+        const size_t from_held = std::min(length, held_.size());
+        if (from_held)
+        {
+            on_text(std::string_view{held_.data(), from_held});
+        }
+        if (length > from_held)
+        {
+            on_text(chunk.substr(0, length - from_held));
+        }
+    }
+
+    std::vector<std::string> tags_;
+    std::vector<std::vector<size_t>> fail_;
+    std::vector<size_t> state_;
+    std::string held_;
+};
+
+#endif //TAG_SCANNER_H
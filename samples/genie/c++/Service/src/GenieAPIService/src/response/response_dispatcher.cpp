@@ -9,6 +9,7 @@
 #include "response_dispatcher.h"
 #include "../chat_request_handler/model_input_builder.h"
 #include "response_tools.h"
+#include "sse_writer.h"
 
 #include "log.h"
 #include "../processor/general.h"
@@ -19,10 +20,16 @@ ResponseDispatcher::ResponseDispatcher(IModelConfig &model_mgr,
         chatHistory(chatHistory),
         model_config_(model_mgr)
 {
-    ResetProcessor();
+    CreateProcessor();
 }
 
 void ResponseDispatcher::ResetProcessor()
+{
+    CreateProcessor();
+    chatHistory.Clear();
+}
+
+void ResponseDispatcher::CreateProcessor()
 {
     if (proc_)
     {
@@ -38,8 +45,6 @@ void ResponseDispatcher::ResetProcessor()
         default:
             proc_ = new GeneralProcessor{};
     }
-
-    chatHistory.Clear();
 }
 
 void ResponseDispatcher::Prepare(ModelInput &model_input,
@@ -57,7 +62,7 @@ void ResponseDispatcher::Prepare(ModelInput &model_input,
         this->req_ = &const_cast<httplib::Request &>(req);
     }
 
-    this->model_input_ = model_input;
+    this->model_input_ = std::move(model_input);
     is_stream_ = is_stream;
     is_tool_ = is_tool;
     proc_->Clean();
@@ -80,12 +85,25 @@ bool ResponseDispatcher::SendResponse(size_t, httplib::DataSink *sink, httplib::
     response_buffer.reserve(kAllocSize * alloc_time);
     bool isToolResponse = false;
 
+    SseChunkWriter<httplib::DataSink> writer{sink, std::chrono::milliseconds{model_config_.getStreamFlushMs()}};
+    // without the chunk envelope every delta would be dropped, end the stream with an error event instead.
+    if (is_stream_ && !writer.Begin(ResponseTools::responseDataJson("", "", true)))
+    {
+        My_Log{My_Log::Level::kError} << "build the stream chunk envelope failed" << std::endl;
+        ResponseTools::post_stream_data(*sink, R"({"error": "Stream response unavailable"})", true);
+        return false;
+    }
+
     auto genie_callback = [&](std::string &chunk)
     {
         My_Log{}.original(true) << chunk;
         if (!isConnectionAlive())
         {
-            handle->Stop();
+            // returning false cancels this query of a batching context, Stop() would end the others as well.
+            if (!handle->SupportConcurrentQuery())
+            {
+                handle->Stop();
+            }
             return false;
         }
 
@@ -104,7 +122,7 @@ bool ResponseDispatcher::SendResponse(size_t, httplib::DataSink *sink, httplib::
             return true;
 
         if (is_stream_)
-            ResponseTools::post_stream_data(*sink, ResponseTools::responseDataJson(keepChunk, "", true));
+            writer.Write(keepChunk);
 
         return true;
     };
@@ -116,7 +134,10 @@ bool ResponseDispatcher::SendResponse(size_t, httplib::DataSink *sink, httplib::
         {
             constexpr char *err = R"({"error": "Model query unavailable"})";
             if (is_stream_)
+            {
+                writer.Flush(true);
                 ResponseTools::post_stream_data(*sink, err, true);
+            }
             else
                 res->set_content(err, MIMETYPE_JSON);
             My_Log{} << "~~~~~~~~~~~~~~~Query Context Failed~~~~~~~~~~~~~~~~~~~\n" << std::endl;
@@ -125,6 +146,15 @@ bool ResponseDispatcher::SendResponse(size_t, httplib::DataSink *sink, httplib::
         My_Log{}.original(true) << "\n";
         My_Log{} << "~~~~~~~~~~~~~~~Query Context End~~~~~~~~~~~~~~~~~~~\n" << std::endl;
 
+        // release the tail the processor held back as a possible tag prefix.
+        std::string tail = proc_->Flush();
+        if (is_stream_)
+        {
+            if (!tail.empty() && !(is_tool_ && isToolResponse && !model_config_.getisOutputAllText()))
+                writer.Write(tail);
+            writer.Flush(true);
+        }
+
         // If there is a tool call, return the processed characters to the client.
         if (isToolResponse)
         {
@@ -169,6 +199,7 @@ bool ResponseDispatcher::SendResponse(size_t, httplib::DataSink *sink, httplib::
             throw;
         My_Log{My_Log::Level::kError} << "raise the exception while processing stream response: \n"
                                       << e.what() << "\n";
+        writer.Flush(true);
         if (dynamic_cast<const ReportError *>(&e))
         {
             ResponseTools::post_stream_data(*sink, e.what(), true);
@@ -194,7 +225,7 @@ bool ResponseDispatcher::isConnectionAlive() const
     auto closed = req_->is_connection_closed();
     if (closed)
     {
-        http_busy_ = false;
+        ReleaseHttpBusy();
         My_Log{My_Log::Level::kError} << "connection has been broken\n" << std::endl;
     }
     return !closed;
@@ -244,6 +275,24 @@ void ResponseDispatcher::PrintProfile(const std::string &response_buffer)
                  << std::setprecision(2)
                  << json_str.at("token_generation_rate").get<std::string>()
                  << " toks/sec" << std::endl;
+
+        if (json_str.contains("draft_acceptance_rate"))
+        {
+            My_Log{} << "Num Draft Tokens: "
+                     << json_str.at("num_draft_tokens")
+                     << ", Accepted: " << json_str.at("num_accepted_draft_tokens")
+                     << ", Acceptance Rate: " << json_str.at("draft_acceptance_rate").get<std::string>()
+                     << " %" << std::endl;
+        }
+
+        if (json_str.contains("engine_prefill_rate"))
+        {
+            My_Log{} << "Engine Prefill Rate: "
+                     << json_str.at("engine_prefill_rate").get<std::string>()
+                     << " toks/sec (" << json_str.at("prefill_threads") << " threads)"
+                     << ", Engine Decode Rate: " << json_str.at("engine_decode_rate").get<std::string>()
+                     << " toks/sec (" << json_str.at("decode_threads") << " threads)" << std::endl;
+        }
     }
     catch (std::exception &e)
     {
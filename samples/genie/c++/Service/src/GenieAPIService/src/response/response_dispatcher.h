@@ -34,6 +34,7 @@ public:
 
     ~ResponseDispatcher();
 
+    // a new model was loaded, its processor replaces the one of the previous model and the history is cleared.
     void ResetProcessor();
 
     void Prepare(ModelInput &model_input,
@@ -47,6 +48,8 @@ public:
     static inline std::string MIMETYPE_JSON = "application/json; charset=utf-8";
 
 private:
+    void CreateProcessor();
+
     void PrintProfile(const std::string &response_buffer);
 
     bool isConnectionAlive() const;
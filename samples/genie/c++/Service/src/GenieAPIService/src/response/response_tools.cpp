@@ -7,6 +7,8 @@
 //==============================================================================
 
 #include "response_tools.h"
+
+#include <cctype>
 #include "log.h"
 #include "utils.h"
 
@@ -136,19 +138,90 @@ std::string ResponseTools::convertToolCallJson(const std::string &input)
     return wrapJsonInToolCall(root.dump());
 }
 
+namespace
+{
+inline bool is_space(char c)
+{
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+inline size_t skip_space(const std::string &s, size_t pos)
+{
+    while (pos < s.size() && is_space(s[pos]))
+    {
+        ++pos;
+    }
+    return pos;
+}
+}
+
+/*
+ * single pass equivalents of the former regexes:
+ *   <tool_call>[\s\S]*?</tool_call>\s*  and  \s*\{ *"name": [^\n]*\n?
+ */
 std::string ResponseTools::remove_tool_call_content(const std::string &input)
 {
-    static std::regex tool_call_block(R"(<tool_call>[\s\S]*?<\/tool_call>\s*)");
-    static std::regex name_line(R"((\s*\{ *"name": [^\n]*\n?))");
-    std::string result = std::regex_replace(input, tool_call_block, "");
-    result = std::regex_replace(result, name_line, "");
-    result = remove_empty_lines(result);
-    return result;
+    static const std::string open_tag = "<tool_call>";
+    static const std::string close_tag = "</tool_call>";
+    static const std::string name_key = "\"name\": ";
+
+    std::string stripped;
+    stripped.reserve(input.size());
+    size_t pos = 0;
+    while (pos < input.size())
+    {
+        size_t open = input.find(open_tag, pos);
+        size_t close = open == std::string::npos ? open : input.find(close_tag, open + open_tag.size());
+        if (close == std::string::npos)
+        {
+            break;
+        }
+        stripped.append(input, pos, open - pos);
+        pos = skip_space(input, close + close_tag.size());
+    }
+    stripped.append(input, pos, std::string::npos);
+
+    std::string result;
+    result.reserve(stripped.size());
+    pos = 0;
+    while (pos < stripped.size())
+    {
+        // a failed match inside a whitespace run fails for the rest of the run as well.
+        size_t brace = skip_space(stripped, pos);
+        size_t key = brace;
+        if (key < stripped.size() && stripped[key] == '{')
+        {
+            ++key;
+            while (key < stripped.size() && stripped[key] == ' ')
+            {
+                ++key;
+            }
+        }
+        if (key == brace || stripped.compare(key, name_key.size(), name_key) != 0)
+        {
+            size_t next = brace > pos ? brace : pos + 1;
+            result.append(stripped, pos, next - pos);
+            pos = next;
+            continue;
+        }
+
+        size_t eol = stripped.find('\n', key + name_key.size());
+        pos = eol == std::string::npos ? stripped.size() : eol + 1;
+    }
+
+    return remove_empty_lines(result);
 }
 
 std::string ResponseTools::remove_empty_lines(const std::string &input)
 {
-    return std::regex_replace(input, std::regex(R"((^\s*\n)+)"), "");
+    // drop the leading blank lines, up to the last newline of the leading whitespace.
+    size_t end = skip_space(input, 0);
+    size_t newline = input.rfind('\n', end == 0 ? 0 : end - 1);
+    if (end == 0 || newline == std::string::npos)
+    {
+        return input;
+    }
+    return input.substr(newline + 1);
 }
 
 std::string ResponseTools::json_to_str(const json &data)
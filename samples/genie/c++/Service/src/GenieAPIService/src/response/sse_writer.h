@@ -0,0 +1,246 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#ifndef SSE_WRITER_H
+#define SSE_WRITER_H
+
+#include <chrono>
+#include <string>
+#include <string_view>
+
+/*
+ * Writes the streamed delta text as SSE chunk events.
+ * The envelope of the chunk (id, model, choices ...) is the same for the whole request, so it is rendered once
+ * and split around the delta content, only the delta text is JSON-escaped per token, into a reused buffer.
+ * With a flush interval, the deltas produced within the interval are coalesced into one event.
+ * Sink is anything with `bool write(const char *, size_t)`, e.g. httplib::DataSink.
+ */
+template<typename Sink>
+class SseChunkWriter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    SseChunkWriter(Sink *sink, std::chrono::milliseconds flush_interval) :
+            sink_{sink}, flush_interval_{flush_interval}
+    {}
+
+    /*
+     * envelope is a whole chunk event whose delta content is empty,
+     * the text before and after that empty content becomes the constant prefix and suffix.
+     */
+    bool Begin(const std::string &envelope)
+    {
+        static const std::string content_key = R"("content":"")";
+        size_t pos = envelope.find(content_key);
+        if (pos == std::string::npos)
+        {
+            return false;
+        }
+
+        pos += content_key.size() - 1;
+        buffer_.assign("data: ").append(envelope, 0, pos);
+        prefix_size_ = buffer_.size();
+        suffix_.assign(envelope, pos, std::string::npos).append("\n\n");
+        utf8_tail_.clear();
+        last_flush_ = Clock::now();
+        return true;
+    }
+
+    bool Write(std::string_view text)
+    {
+        if (text.empty() || !prefix_size_)
+        {
+            return true;
+        }
+
+        // finish the UTF-8 sequence split by the previous token first.
+        if (!utf8_tail_.empty())
+        {
+            while (!text.empty() && utf8_tail_.size() < Utf8Length(utf8_tail_[0]) && IsContinuation(text[0]))
+            {
+                utf8_tail_ += text[0];
+                text.remove_prefix(1);
+            }
+            if (utf8_tail_.size() < Utf8Length(utf8_tail_[0]) && text.empty())
+            {
+                return true;
+            }
+            EscapeTo(utf8_tail_, buffer_);
+            utf8_tail_.clear();
+        }
+
+        size_t complete = CompleteLength(text);
+        EscapeTo(text.substr(0, complete), buffer_);
+        utf8_tail_.assign(text.substr(complete));
+
+        if (flush_interval_.count() > 0 && Clock::now() - last_flush_ < flush_interval_)
+        {
+            return true;
+        }
+        return Flush();
+    }
+
+    // send the coalesced text, `end` also releases a dangling partial UTF-8 sequence.
+    bool Flush(bool end = false)
+    {
+        if (end && !utf8_tail_.empty())
+        {
+            EscapeTo(utf8_tail_, buffer_);
+            utf8_tail_.clear();
+        }
+        if (buffer_.size() == prefix_size_)
+        {
+            return true;
+        }
+
+        buffer_ += suffix_;
+        bool ok = sink_->write(buffer_.data(), buffer_.size());
+        buffer_.resize(prefix_size_);
+        last_flush_ = Clock::now();
+        return ok;
+    }
+
+    // escape text as the content of a JSON string, invalid UTF-8 is replaced by U+FFFD like json::dump does.
+    static void EscapeTo(std::string_view text, std::string &out)
+    {
+        static const char hex[] = "0123456789abcdef";
+        size_t i = 0;
+        while (i < text.size())
+        {
+            auto c = static_cast<unsigned char>(text[i]);
+            if (c >= 0x80)
+            {
+                size_t len = ValidLength(text.substr(i));
+                if (len)
+                {
+                    out.append(text, i, len);
+                    i += len;
+                }
+                else
+                {
+                    out += "\xEF\xBF\xBD";
+                    ++i;
+                }
+                continue;
+            }
+
+            switch (c)
+            {
+                case '"':
+                    out += "\\\"";
+                    break;
+                case '\\':
+                    out += "\\\\";
+                    break;
+                case '\b':
+                    out += "\\b";
+                    break;
+                case '\f':
+                    out += "\\f";
+                    break;
+                case '\n':
+                    out += "\\n";
+                    break;
+                case '\r':
+                    out += "\\r";
+                    break;
+                case '\t':
+                    out += "\\t";
+                    break;
+                default:
+                    if (c < 0x20)
+                    {
+                        out += "\\u00";
+                        out += hex[c >> 4];
+                        out += hex[c & 0xf];
+                    }
+                    else
+                    {
+                        out += static_cast<char>(c);
+                    }
+                    break;
+            }
+            ++i;
+        }
+    }
+
+private:
+    static bool IsContinuation(char c)
+    {
+        return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+    }
+
+    static size_t Utf8Length(char lead)
+    {
+        auto c = static_cast<unsigned char>(lead);
+        return c < 0x80 ? 1 : c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+    }
+
+    // length of the well-formed sequence at the front of text, 0 if it's not one.
+    static size_t ValidLength(std::string_view text)
+    {
+        auto c = static_cast<unsigned char>(text[0]);
+        if (c < 0xC2 || c > 0xF4)
+        {
+            return 0;
+        }
+
+        size_t len = Utf8Length(text[0]);
+        if (text.size() < len)
+        {
+            return 0;
+        }
+
+        auto c1 = static_cast<unsigned char>(text[1]);
+        unsigned char lo = 0x80, hi = 0xBF;
+        if (c == 0xE0) lo = 0xA0;
+        else if (c == 0xED) hi = 0x9F;
+        else if (c == 0xF0) lo = 0x90;
+        else if (c == 0xF4) hi = 0x8F;
+        if (c1 < lo || c1 > hi)
+        {
+            return 0;
+        }
+        for (size_t k = 2; k < len; ++k)
+        {
+            if (!IsContinuation(text[k]))
+            {
+                return 0;
+            }
+        }
+        return len;
+    }
+
+    // the text length without a trailing multibyte sequence which may be completed by the next token.
+    static size_t CompleteLength(std::string_view text)
+    {
+        size_t n = text.size();
+        for (size_t back = 1; back <= 3 && back <= n; ++back)
+        {
+            char c = text[n - back];
+            if (IsContinuation(c))
+            {
+                continue;
+            }
+            auto lead = static_cast<unsigned char>(c);
+            return lead >= 0xC2 && lead <= 0xF4 && Utf8Length(c) > back ? n - back : n;
+        }
+        return n;
+    }
+
+    Sink *sink_;
+    std::chrono::milliseconds flush_interval_;
+    Clock::time_point last_flush_{};
+    std::string buffer_;       // prefix + escaped deltas, reused for every event
+    size_t prefix_size_{};
+    std::string suffix_;
+    std::string utf8_tail_;
+};
+
+#endif //SSE_WRITER_H
@@ -9,6 +9,8 @@
 #ifndef BASE64_H
 #define BASE64_H
 
+#include <cstddef>
+
 #define BASE64_ENCODE_OUT_SIZE(s) ((unsigned int)((((s) + 2) / 3) * 4 + 1))
 #define BASE64_DECODE_OUT_SIZE(s) ((unsigned int)(((s) / 4) * 3))
 
@@ -133,12 +135,11 @@ unsigned int Base64Encode(const char *in, unsigned int inlen, char *out)
 }
 
 /*
- * return values is out length
+ * decode in[i, inlen) to out + j, i is a multiple of 4 and in[0, i) was decoded to out[0, j).
+ * return values is out length, 0 if the input is not base64.
  */
-unsigned int Base64Decode(const char *in, unsigned int inlen, unsigned char *out)
+inline size_t Base64DecodeFrom(const char *in, size_t inlen, unsigned char *out, size_t i, size_t j)
 {
-    unsigned int i;
-    unsigned int j;
     unsigned char c;
 
     if (inlen & 0x3)
@@ -146,7 +147,7 @@ unsigned int Base64Decode(const char *in, unsigned int inlen, unsigned char *out
         return 0;
     }
 
-    for (i = j = 0; i < inlen; i++)
+    for (; i < inlen; i++)
     {
         if (in[i] == BASE64_PAD)
         {
@@ -185,4 +186,227 @@ unsigned int Base64Decode(const char *in, unsigned int inlen, unsigned char *out
     return j;
 }
 
+/*
+ * return values is out length
+ */
+unsigned int Base64Decode(const char *in, unsigned int inlen, unsigned char *out)
+{
+    return (unsigned int) Base64DecodeFrom(in, inlen, out, 0, 0);
+}
+
+/*
+ * The vector decoders below take whole blocks of plain base64 characters, a block with anything else in it
+ * (the padding, a line break, an invalid character) stops them and Base64DecodeFrom finishes the input from
+ * that block on. So the result, including the error cases, is always the one Base64Decode gives.
+ * They never write past BASE64_DECODE_OUT_SIZE(inlen) bytes of out.
+ */
+#if defined(__aarch64__) || defined(_M_ARM64)
+
+#include <arm_neon.h>
+
+/*
+ * 64 characters -> 48 bytes: vld4q_u8 splits the characters by their position in the quantum, the table
+ * lookups map them to 6 bits values and vst3q_u8 interleaves the packed bytes back.
+ * return values is the number of characters decoded, j is advanced.
+ */
+inline size_t Base64DecodeNeon(const char *in, size_t inlen, unsigned char *out, size_t &j)
+{
+    uint8x16x4_t lo_table;
+    uint8x16x4_t hi_table;
+    for (int k = 0; k < 4; ++k)
+    {
+        lo_table.val[k] = vld1q_u8(kBase64de + 16 * k);
+        hi_table.val[k] = vld1q_u8(kBase64de + 64 + 16 * k);
+    }
+    const uint8x16_t offset = vdupq_n_u8(64);
+
+    size_t i = 0;
+    for (; i + 64 <= inlen; i += 64, j += 48)
+    {
+        const uint8x16x4_t chars = vld4q_u8(reinterpret_cast<const uint8_t *>(in + i));
+        uint8x16_t values[4];
+        uint8x16_t error = vdupq_n_u8(0);
+        for (int k = 0; k < 4; ++k)
+        {
+            // characters >= 64 are out of range of the first lookup (0) and looked up in the second one,
+            // characters >= 128 are out of range of both and kept in `error` by their top bit.
+            values[k] = vqtbx4q_u8(vqtbl4q_u8(lo_table, chars.val[k]), hi_table, vsubq_u8(chars.val[k], offset));
+            error = vorrq_u8(error, vorrq_u8(values[k], chars.val[k]));
+        }
+        if (vmaxvq_u8(error) & 0x80)
+        {
+            break;
+        }
+
+        uint8x16x3_t bytes;
+        bytes.val[0] = vorrq_u8(vshlq_n_u8(values[0], 2), vshrq_n_u8(values[1], 4));
+        bytes.val[1] = vorrq_u8(vshlq_n_u8(values[1], 4), vshrq_n_u8(values[2], 2));
+        bytes.val[2] = vorrq_u8(vshlq_n_u8(values[2], 6), values[3]);
+        vst3q_u8(out + j, bytes);
+    }
+    return i;
+}
+
+#elif defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#define BASE64_X86
+#include <immintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BASE64_TARGET(x) __attribute__((target(x)))
+#else
+#include <intrin.h>
+#define BASE64_TARGET(x)
+#endif
+
+/*
+ * 0: scalar, 1: SSSE3, 2: AVX2. the service binary is built for the baseline x86-64, so the vector
+ * decoders are picked at run time.
+ */
+inline int Base64SimdLevel()
+{
+    static const int level = []
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? 2 : __builtin_cpu_supports("ssse3") ? 1 : 0;
+#else
+        int regs[4];
+        __cpuid(regs, 0);
+        const int max_leaf = regs[0];
+        __cpuid(regs, 1);
+        int result = (regs[2] & (1 << 9)) ? 1 : 0;
+        const bool os_avx = (regs[2] & (1 << 27)) && (regs[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+        if (max_leaf >= 7 && os_avx)
+        {
+            __cpuidex(regs, 7, 0);
+            result = (regs[1] & (1 << 5)) ? 2 : result;
+        }
+        return result;
+#endif
+    }();
+    return level;
+}
+
+/*
+ * The classification and the packing follow W. Mula and D. Lemire, "Faster Base64 Encoding and Decoding
+ * using AVX2 Instructions": the low and high nibble of every character select a bit set from lut_lo and
+ * lut_hi, the character is invalid if both sets share a bit, otherwise the high nibble selects the offset
+ * to its 6 bits value from lut_roll ('/' is the one character that needs its own offset).
+ */
+// 16 characters -> 12 bytes, a block stores 16 bytes so the loop stops 8 characters before the end.
+BASE64_TARGET("ssse3")
+inline size_t Base64DecodeSsse3(const char *in, size_t inlen, unsigned char *out, size_t &j)
+{
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f = _mm_set1_epi8(0x2F);
+    const __m128i pack_shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    size_t i = 0;
+    for (; i + 24 <= inlen; i += 16, j += 12)
+    {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(chars, 4), mask_2f);
+        const __m128i lo_nibbles = _mm_and_si128(chars, mask_2f);
+        const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+        const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0)
+        {
+            break;
+        }
+
+        const __m128i eq_2f = _mm_cmpeq_epi8(chars, mask_2f);
+        const __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+        __m128i values = _mm_add_epi8(chars, roll);
+        values = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        values = _mm_madd_epi16(values, _mm_set1_epi32(0x00011000));
+        values = _mm_shuffle_epi8(values, pack_shuffle);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + j), values);
+    }
+    return i;
+}
+
+// 32 characters -> 24 bytes, a block stores 32 bytes so the loop stops 16 characters before the end.
+BASE64_TARGET("avx2")
+inline size_t Base64DecodeAvx2(const char *in, size_t inlen, unsigned char *out, size_t &j)
+{
+    const __m256i lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                              0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2F);
+    const __m256i pack_shuffle = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                  2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i pack_permute = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+
+    size_t i = 0;
+    for (; i + 48 <= inlen; i += 32, j += 24)
+    {
+        const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(chars, 4), mask_2f);
+        const __m256i lo_nibbles = _mm256_and_si256(chars, mask_2f);
+        const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        if (!_mm256_testz_si256(lo, hi))
+        {
+            break;
+        }
+
+        const __m256i eq_2f = _mm256_cmpeq_epi8(chars, mask_2f);
+        const __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+        __m256i values = _mm256_add_epi8(chars, roll);
+        values = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        values = _mm256_madd_epi16(values, _mm256_set1_epi32(0x00011000));
+        values = _mm256_shuffle_epi8(values, pack_shuffle);
+        values = _mm256_permutevar8x32_epi32(values, pack_permute);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + j), values);
+    }
+    return i;
+}
+
+#endif
+
+/*
+ * Base64Decode with the vector decoder of the CPU, for the multi MB images and audios of the requests.
+ * return values is out length, 0 if the input is not base64.
+ */
+inline size_t Base64DecodeFast(const char *in, size_t inlen, unsigned char *out)
+{
+    size_t i = 0;
+    size_t j = 0;
+
+    if (inlen & 0x3)
+    {
+        return 0;
+    }
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+    i = Base64DecodeNeon(in, inlen, out, j);
+#elif defined(BASE64_X86)
+    switch (Base64SimdLevel())
+    {
+        case 2:
+            i = Base64DecodeAvx2(in, inlen, out, j);
+            break;
+        case 1:
+            i = Base64DecodeSsse3(in, inlen, out, j);
+            break;
+        default:
+            break;
+    }
+#endif
+
+    return Base64DecodeFrom(in, inlen, out, i, j);
+}
+
 #endif /* BASE64_H */
\ No newline at end of file
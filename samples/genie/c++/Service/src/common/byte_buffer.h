@@ -0,0 +1,56 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#ifndef BYTE_BUFFER_H
+#define BYTE_BUFFER_H
+
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * An allocator whose value construction leaves the memory uninitialized, resize() on a vector of it only
+ * moves the end. For the buffers which are overwritten right after they are sized, e.g. a base64 decode.
+ */
+template<typename T>
+struct UninitializedAllocator : std::allocator<T>
+{
+    template<typename U>
+    struct rebind
+    {
+        using other = UninitializedAllocator<U>;
+    };
+
+    UninitializedAllocator() noexcept = default;
+
+    template<typename U>
+    UninitializedAllocator(const UninitializedAllocator<U> &) noexcept {}
+
+    template<typename U>
+    void construct(U *p) noexcept(std::is_nothrow_default_constructible_v<U>)
+    {
+        ::new(static_cast<void *>(p)) U;
+    }
+
+    template<typename U, typename... Args>
+    void construct(U *p, Args &&... args)
+    {
+        ::new(static_cast<void *>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+/*
+ * The decoded image / audio of a request. The owner keeps it across requests and only clear()s it, so
+ * once it has grown to the largest attachment a decode costs neither an allocation nor a zero fill.
+ */
+using ByteBuffer = std::vector<uint8_t, UninitializedAllocator<uint8_t>>;
+
+#endif //BYTE_BUFFER_H
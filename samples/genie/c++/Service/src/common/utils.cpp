@@ -55,6 +55,28 @@ bool isPortAvailable(int port){return true;}
 
 std::atomic<bool> http_busy_{false};
 
+// a request is served by one thread from the handler to the logger, which releases the gate.
+static thread_local bool http_busy_held_{false};
+
+bool AcquireHttpBusy()
+{
+    if (http_busy_.exchange(true))
+    {
+        return false;
+    }
+    http_busy_held_ = true;
+    return true;
+}
+
+void ReleaseHttpBusy()
+{
+    if (http_busy_held_)
+    {
+        http_busy_held_ = false;
+        http_busy_ = false;
+    }
+}
+
 struct Timer::Impl
 {
     std::chrono::steady_clock::time_point time_start;
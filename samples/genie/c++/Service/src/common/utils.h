@@ -20,6 +20,12 @@ inline std::string RootDir;
 
 extern std::atomic<bool> http_busy_;
 
+// take http_busy_ for the request served by this thread, false when another request holds it.
+bool AcquireHttpBusy();
+
+// release http_busy_ if the request served by this thread holds it.
+void ReleaseHttpBusy();
+
 struct ReportError : public std::exception
 {
     ReportError(std::string &&msg) : msg_{std::move(msg)} {}
@@ -40,13 +40,15 @@ class GenieContext:
             string: query response.
         """
         return self.m_context.QueryByEmbedding(embedding, callback)
-    def SetEmbeddingTable(self, embedding_table):
-        """Set the embedding table for retrieval.
+    def SetEmbeddingTable(self, embedding_table, prefetch=False):
+        """Set the token to embedding lookup table used by QueryByEmbedding.
 
         Args:
-            embedding_table (list[dict]): List of dicts with 'id' and 'embedding' keys.
+            embedding_table (str): Path of the table file, raw or fp16/int8 compressed. It is memory-mapped,
+                so processes which load the same file share one copy.
+            prefetch (bool): Read the whole table in now instead of on first use.
         """
-        return self.m_context.SetEmbeddingTable(embedding_table)
+        return self.m_context.SetEmbeddingTable(embedding_table, prefetch)
 
     def Stop(self):
         return self.m_context.Stop()
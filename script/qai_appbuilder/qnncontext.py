@@ -130,8 +130,25 @@ class QNNConfig():
                runtime: str = Runtime.HTP,
                log_level: int = LogLevel.ERROR,
                profiling_level: int = ProfilingLevel.OFF,
-               log_path: str = "None"
+               log_path: str = "None",
+               tensor_sets: int = 1,
+               lazy_graphs: bool = False,
+               context_cache_dir: str = "",
+               context_cache_max_bytes: int = 0
                ):
+        """
+        tensor_sets: I/O tensor sets per graph of the models created afterwards. With N sets, up to N
+        Inference() calls on one model from different threads overlap their input / output conversion
+        with each other's execution, at N times the host memory for the I/O tensors.
+        lazy_graphs: the context binaries of the models created afterwards are only parsed at creation,
+        the context is created by the first Inference() and the I/O tensors of a graph by the first
+        Inference() on it. Graphs never used cost no I/O memory, see QNNContext.ReleaseIdleTensors().
+        context_cache_dir: where the compiled contexts of .dlc models are cached, next to each DLC if empty,
+        "None" for no cache. A DLC is finalized once per content, QNN backend build and device config, later
+        loads take the cached context.
+        context_cache_max_bytes: size limit of the cache directory, the least recently used entries are removed
+        beyond it. 0 for no limit.
+        """
         global g_backend_lib_path, g_system_lib_path
         if not os.path.exists(qnn_lib_path):
             base_path = os.path.dirname(os.path.abspath(__file__))
@@ -153,6 +170,9 @@ class QNNConfig():
 
         LogLevel.SetLogLevel(log_level, log_path)
         ProfilingLevel.SetProfilingLevel(profiling_level)
+        appbuilder.set_tensor_sets(tensor_sets)
+        appbuilder.set_lazy_graphs(lazy_graphs)
+        appbuilder.set_context_cache(context_cache_dir, context_cache_max_bytes)
 
 
 class _QNNContextBase:
@@ -209,11 +229,31 @@ class _QNNContextBase:
     def getProfilingEvent(self, eventType):
         return self.m_context.getProfilingEvent(eventType)
 
+    def ReleaseIdleTensors(self):
+        """Free the I/O tensors of the graphs no inference is running on, returns the bytes freed."""
+        return self.m_context.ReleaseIdleTensors()
+
+    def getGraphResidentBytes(self):
+        """Host bytes of the I/O tensors per graph, 0 for the graphs not used yet or released."""
+        return self.m_context.getGraphResidentBytes()
+
+    def InferenceInto(self, input, output, perf_profile=PerfProfile.DEFAULT, graphIndex=0):
+        """
+        Zero-copy inference: the outputs are written into the caller's `output` arrays / tensors.
+        input, output: lists of numpy arrays or CPU torch tensors (buffer protocol or DLPack), C-contiguous,
+        with the dtype the model was created for (float32 for DataType.FLOAT, the native dtype for NATIVE).
+        Every buffer must hold the tensor of graph `graphIndex`, a smaller one raises. Returns None.
+        Reusing the same arrays every call allocates no tensor memory. Not supported by QNNContextProc.
+        """
+        self.m_context.InferenceInto(input, output, perf_profile, graphIndex)
+
     def _inference_and_reshape(self, input, infer_fn):
         input = reshape_input(input)
         output = infer_fn(input)
-        outputshape_list = self.getOutputShapes()
-        output = reshape_output(output, outputshape_list)
+        # The outputs of graph 0 already come in their shapes, the shapes are fetched once for the others.
+        if getattr(self, "_output_shapes", None) is None:
+            self._output_shapes = self.getOutputShapes()
+        output = reshape_output(output, self._output_shapes)
         return output
 
     def __del__(self):
@@ -0,0 +1,361 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+/*
+ * End to end latency of LibAppBuilder against the mock backend (Mock/QnnMockBackend.cpp): the model is a
+ * mock context binary written from the options, so the whole path of an inference (input conversion, copies,
+ * perf votes, graphExecute, profiling, output conversion, locking, logging) runs without a device.
+ * The simulated execute time is subtracted from each latency, what is left is the host overhead to optimize.
+ *
+ * Every model is initialized by the main thread, then driven by --threads threads of its own, all at once.
+ * With --tensor-sets above 1 the threads of one model overlap their conversions with each other's execution.
+ * The output is one CSV line per run, init is the ModelInitialize time of the first model and resident the
+ * host bytes of its I/O tensors after the run. With --lazy 1 the models are initialized with SetLazyGraphs().
+ *
+ * usage: appbuilder_e2e_bench [--backend <libQnnMockBackend.so>] [--inputs float32:1,3,224,224;...]
+ *                             [--outputs float32:1,1000;...] [--execute-us 1000] [--vote-us 0]
+ *                             [--graphs 1] [--models 1] [--threads 1] [--tensor-sets 1] [--lazy 0|1]
+ *                             [--iterations 1000] [--warmup 10]
+ *                             [--io float|native] [--api into|alloc] [--perf default|burst|high_performance]
+ *                             [--profiling 0|1|2] [--log-level 1]
+ * The tensor dtypes are those of the mock backend. --api alloc uses ModelInference, which allocates the
+ * outputs on every call, into ModelInferenceInto with buffers allocated once.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "LibAppBuilder.hpp"
+#include "QnnLog.h"
+
+namespace fs = std::filesystem;
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct TensorSpec {
+  std::string dataType;
+  std::string dimensions;  // "d0,d1,..."
+  size_t elements = 1;
+  size_t bytes    = 0;  // native
+};
+
+struct Options {
+  std::string backend;
+  std::vector<TensorSpec> inputs;
+  std::vector<TensorSpec> outputs;
+  uint64_t executeUs = 1000;
+  uint64_t voteUs    = 0;
+  size_t graphs      = 1;
+  size_t models      = 1;
+  size_t threads     = 1;  // per model
+  size_t tensorSets  = 1;
+  bool lazy          = false;
+  size_t iterations  = 1000;
+  size_t warmup      = 10;
+  std::string io     = "float";
+  std::string api    = "into";
+  std::string perf   = "default";
+  int profiling      = 0;
+  int logLevel       = QNN_LOG_LEVEL_ERROR;
+};
+
+size_t dataTypeBytes(const std::string& dataType) {
+  if (dataType == "float32" || dataType == "uint32" || dataType == "int32") {
+    return 4;
+  }
+  if (dataType == "float16" || dataType == "ufixed16" || dataType == "uint16" || dataType == "int16") {
+    return 2;
+  }
+  if (dataType == "int64") {
+    return 8;
+  }
+  if (dataType == "ufixed8" || dataType == "uint8" || dataType == "int8" || dataType == "bool8") {
+    return 1;
+  }
+  return 0;
+}
+
+// "float32:1,3,224,224;int32:1,128"
+bool parseTensors(const std::string& list, std::vector<TensorSpec>& tensors) {
+  tensors.clear();
+  std::istringstream specs(list);
+  std::string spec;
+  while (std::getline(specs, spec, ';')) {
+    const size_t colon = spec.find(':');
+    if (colon == std::string::npos) {
+      return false;
+    }
+    TensorSpec tensor;
+    tensor.dataType   = spec.substr(0, colon);
+    tensor.dimensions = spec.substr(colon + 1);
+    std::istringstream dims(tensor.dimensions);
+    std::string dim;
+    while (std::getline(dims, dim, ',')) {
+      const size_t value = std::strtoull(dim.c_str(), nullptr, 10);
+      if (0 == value) {
+        return false;
+      }
+      tensor.elements *= value;
+    }
+    tensor.bytes = tensor.elements * dataTypeBytes(tensor.dataType);
+    if (0 == tensor.bytes) {
+      return false;
+    }
+    tensors.push_back(tensor);
+  }
+  return !tensors.empty();
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+  const std::string self{argv[0]};
+  const size_t slash  = self.find_last_of('/');
+  options.backend     = (slash == std::string::npos ? std::string(".") : self.substr(0, slash)) +
+                        "/libQnnMockBackend.so";
+  parseTensors("float32:1,3,224,224", options.inputs);
+  parseTensors("float32:1,1000", options.outputs);
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string name{argv[i]};
+    const std::string value{argv[i + 1]};
+    if (name == "--backend") {
+      options.backend = value;
+    } else if (name == "--inputs") {
+      if (!parseTensors(value, options.inputs)) {
+        return false;
+      }
+    } else if (name == "--outputs") {
+      if (!parseTensors(value, options.outputs)) {
+        return false;
+      }
+    } else if (name == "--execute-us") {
+      options.executeUs = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (name == "--vote-us") {
+      options.voteUs = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (name == "--graphs") {
+      options.graphs = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+    } else if (name == "--models") {
+      options.models = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+    } else if (name == "--threads") {
+      options.threads = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+    } else if (name == "--tensor-sets") {
+      options.tensorSets = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+    } else if (name == "--lazy") {
+      options.lazy = std::atoi(value.c_str()) != 0;
+    } else if (name == "--iterations") {
+      options.iterations = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+    } else if (name == "--warmup") {
+      options.warmup = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (name == "--io") {
+      options.io = value;
+    } else if (name == "--api") {
+      options.api = value;
+    } else if (name == "--perf") {
+      options.perf = value;
+    } else if (name == "--profiling") {
+      options.profiling = std::atoi(value.c_str());
+    } else if (name == "--log-level") {
+      options.logLevel = std::atoi(value.c_str());
+    } else {
+      return false;
+    }
+  }
+  return argc % 2 == 1 && (options.io == "float" || options.io == "native") &&
+         (options.api == "into" || options.api == "alloc");
+}
+
+void writeTensors(std::ofstream& out, const char* kind, const std::vector<TensorSpec>& tensors) {
+  for (size_t i = 0; i < tensors.size(); i++) {
+    out << kind << " " << kind << "_" << i << " " << tensors[i].dataType << " " << tensors[i].dimensions
+        << "\n";
+  }
+}
+
+bool writeModel(const Options& options, const std::string& path) {
+  std::ofstream out(path, std::ios::trunc);
+  out << "qnn_mock 1\n"
+      << "execute_us " << options.executeUs << "\n"
+      << "vote_us " << options.voteUs << "\n";
+  for (size_t g = 0; g < options.graphs; g++) {
+    out << "graph graph_" << g << "\n";
+    writeTensors(out, "input", options.inputs);
+    writeTensors(out, "output", options.outputs);
+  }
+  return static_cast<bool>(out);
+}
+
+size_t ioBytes(const Options& options, const TensorSpec& tensor) {
+  return options.io == "float" ? tensor.elements * sizeof(float) : tensor.bytes;
+}
+
+// One thread on a model, iterations inferences round robin over its graphs. Latencies in microseconds.
+bool run(LibAppBuilder& builder,
+         const Options& options,
+         const std::string& modelName,
+         const std::atomic<bool>& start,
+         std::vector<double>& latencies) {
+  std::vector<std::vector<uint8_t>> inputs;
+  std::vector<uint8_t*> inputBuffers;
+  std::vector<size_t> inputSize;
+  for (const auto& input : options.inputs) {
+    inputs.emplace_back(ioBytes(options, input), uint8_t{1});
+    inputBuffers.push_back(inputs.back().data());
+    inputSize.push_back(inputs.back().size());
+  }
+  std::vector<std::vector<uint8_t>> outputs;
+  for (const auto& output : options.outputs) {
+    outputs.emplace_back(ioBytes(options, output));
+  }
+
+  std::string perfProfile = options.perf;
+  while (!start.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+  latencies.reserve(options.iterations);
+  for (size_t i = 0; i < options.warmup + options.iterations; i++) {
+    const size_t graphIndex = i % options.graphs;
+    std::vector<uint8_t*> outputBuffers;
+    std::vector<size_t> outputSize;
+    if (options.api == "into") {
+      for (auto& output : outputs) {
+        outputBuffers.push_back(output.data());
+        outputSize.push_back(output.size());
+      }
+    }
+    const auto begin = Clock::now();
+    bool ok;
+    if (options.api == "into") {
+      ok = builder.ModelInferenceInto(modelName, inputBuffers, inputSize, outputBuffers, outputSize, perfProfile,
+                                      graphIndex);
+    } else {
+      ok = builder.ModelInference(modelName, inputBuffers, outputBuffers, outputSize, perfProfile,
+                                  graphIndex);
+    }
+    const double micros = std::chrono::duration<double, std::micro>(Clock::now() - begin).count();
+    if (options.api == "alloc") {
+      for (auto buffer : outputBuffers) {
+        free(buffer);
+      }
+    }
+    if (!ok) {
+      std::cerr << modelName << ": inference " << i << " failed\n";
+      return false;
+    }
+    if (i >= options.warmup) {
+      latencies.push_back(micros);
+    }
+  }
+  return true;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+  const size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    std::cerr << "usage: " << argv[0]
+              << " [--backend <libQnnMockBackend.so>] [--inputs float32:1,3,224,224;...]"
+                 " [--outputs float32:1,1000;...] [--execute-us 1000] [--vote-us 0] [--graphs 1]"
+                 " [--models 1] [--threads 1] [--tensor-sets 1] [--lazy 0|1] [--iterations 1000] [--warmup 10] [--io float|native] [--api into|alloc]"
+                 " [--perf default|burst|high_performance] [--profiling 0|1|2] [--log-level 1]\n";
+    return 1;
+  }
+  SetLogLevel(options.logLevel);
+  SetProfilingLevel(options.profiling);
+  SetTensorSets(static_cast<int32_t>(options.tensorSets));
+  SetLazyGraphs(options.lazy);
+
+  const std::string modelPath =
+      (fs::temp_directory_path() / ("appbuilder_e2e_bench_" + std::to_string(getpid()) + ".bin")).string();
+  if (!writeModel(options, modelPath)) {
+    std::cerr << "failed to write " << modelPath << "\n";
+    return 1;
+  }
+
+  std::vector<LibAppBuilder> builders(options.models);
+  std::vector<std::string> modelNames;
+  double initMs = 0;
+  for (size_t m = 0; m < options.models; m++) {
+    modelNames.push_back("e2e_bench_" + std::to_string(m));
+    const auto begin = Clock::now();
+    if (!builders[m].ModelInitialize(modelNames[m], modelPath, options.backend, options.backend, false,
+                                     options.io, options.io)) {
+      std::cerr << "ModelInitialize of " << modelPath << " with " << options.backend << " failed\n";
+      fs::remove(modelPath);
+      return 1;
+    }
+    if (0 == m) {
+      initMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+    }
+  }
+
+  std::atomic<bool> start{false};
+  std::atomic<bool> failed{false};
+  std::vector<std::vector<double>> latencies(options.models * options.threads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < latencies.size(); t++) {
+    const size_t m = t / options.threads;
+    threads.emplace_back([&, m, t]() {
+      if (!run(builders[m], options, modelNames[m], start, latencies[t])) {
+        failed = true;
+      }
+    });
+  }
+  const auto begin = Clock::now();
+  start.store(true, std::memory_order_release);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+
+  size_t residentBytes = 0;
+  for (size_t bytes : builders[0].getGraphResidentBytes(modelNames[0])) {
+    residentBytes += bytes;
+  }
+  for (size_t m = 0; m < options.models; m++) {
+    builders[m].ModelDestroy(modelNames[m]);
+  }
+  fs::remove(modelPath);
+  if (failed) {
+    return 1;
+  }
+
+  std::vector<double> all;
+  for (const auto& thread : latencies) {
+    all.insert(all.end(), thread.begin(), thread.end());
+  }
+  std::sort(all.begin(), all.end());
+  const double executeUs = static_cast<double>(options.executeUs);
+  std::cout << "models,threads,tensor_sets,lazy,graphs,io,api,perf,profiling,execute_us,init_ms,resident_bytes,"
+               "p50_us,p90_us,p99_us,max_us,overhead_p50_us,overhead_p99_us,inferences/s\n";
+  std::cout << options.models << "," << options.threads << "," << options.tensorSets << "," << options.lazy << ","
+            << options.graphs << "," << options.io << "," << options.api << "," << options.perf << ","
+            << options.profiling << "," << options.executeUs << "," << initMs << "," << residentBytes << ","
+            << percentile(all, 0.5) << "," << percentile(all, 0.9) << "," << percentile(all, 0.99) << ","
+            << all.back() << "," << percentile(all, 0.5) - executeUs << ","
+            << percentile(all, 0.99) - executeUs << "," << all.size() / seconds << "\n";
+  return 0;
+}
@@ -0,0 +1,608 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+/*
+ * Throughput and accuracy of the host side tensor conversions, offline: no QNN backend is loaded, the
+ * tensors are synthetic Qnn_Tensor_t descriptors over plain buffers.
+ *   datautil: floatToTfN / tfNToFloat, castFromFloat / castToFloat, float32ToFloatN / floatNToFloat32.
+ *   iotensor: the same through IOTensor::populateInputTensors (copyFromFloatToNative) and
+ *             IOTensor::convertToFloat, which is what an inference with float input / output runs.
+ *   memcpy:   a plain copy of the float32 side, the bandwidth the conversions compete with.
+ *
+ * A tensor is split into one slice per thread. GB/s counts the bytes read plus written, best of the rounds,
+ * thread start included as it would be for a per-call split. max_err is against a double precision
+ * reference: in LSB for quantize, relative for fp16 encode, absolute for the rest. The output is CSV so
+ * two runs can be diffed for regressions.
+ *
+ * usage: tensor_conversion_bench [--sizes 4K,64K,1M,16M,256M] [--threads 1,2,4,8] [--offsets 0,4]
+ *                                [--rounds 5] [--filter <substring of "layer,op,dtype">]
+ * sizes are of the float32 side (K, M, G suffixes), offsets are bytes past a 64 byte aligned address.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DataUtil.hpp"
+#include "IOTensor.hpp"
+#include "LibAppBuilder.hpp"
+#include "QnnLog.h"
+#include "QnnTypeMacros.hpp"
+
+using namespace qnn::tools;
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct DataType {
+  Qnn_DataType_t type;
+  const char* name;
+  size_t bytes;
+  bool quantized;
+  double minValue;  // range of the float32 data converted to this type
+  double maxValue;
+};
+
+const DataType kDataTypes[] = {
+    {QNN_DATATYPE_FLOAT_16, "fp16", 2, false, -8.0, 8.0},
+    {QNN_DATATYPE_UFIXED_POINT_8, "ufixed8", 1, true, -1.0, 1.0},
+    {QNN_DATATYPE_UFIXED_POINT_16, "ufixed16", 2, true, -1.0, 1.0},
+    {QNN_DATATYPE_UINT_8, "uint8", 1, false, 0.0, 255.0},
+    {QNN_DATATYPE_INT_8, "int8", 1, false, -128.0, 127.0},
+    {QNN_DATATYPE_UINT_16, "uint16", 2, false, 0.0, 65535.0},
+    {QNN_DATATYPE_INT_16, "int16", 2, false, -32768.0, 32767.0},
+    {QNN_DATATYPE_INT_32, "int32", 4, false, -1e6, 1e6},
+    {QNN_DATATYPE_INT_64, "int64", 8, false, -1e6, 1e6},
+};
+
+struct Options {
+  std::vector<size_t> sizes{4 << 10, 64 << 10, 1 << 20, 16 << 20, 256 << 20};
+  std::vector<size_t> threads{1, 2, 4, 8};
+  std::vector<size_t> offsets{0, 4};
+  int rounds = 5;
+  std::string filter;
+};
+
+// A buffer `offset` bytes past a 64 byte boundary, zero filled so the pages are in before timing.
+class Buffer {
+ public:
+  Buffer(size_t bytes, size_t offset) : m_storage(bytes + offset + 64) {
+    const auto base = reinterpret_cast<uintptr_t>(m_storage.data());
+    m_data          = m_storage.data() + (64 - base % 64) % 64 + offset;
+  }
+  uint8_t* data() { return m_data; }
+  float* floats() { return reinterpret_cast<float*>(m_data); }
+
+ private:
+  std::vector<uint8_t> m_storage;
+  uint8_t* m_data;
+};
+
+struct Slice {
+  size_t begin;
+  size_t count;
+};
+
+std::vector<Slice> split(size_t elements, size_t threads) {
+  std::vector<Slice> slices;
+  const size_t step = (elements + threads - 1) / threads;
+  for (size_t begin = 0; begin < elements; begin += step) {
+    slices.push_back({begin, std::min(step, elements - begin)});
+  }
+  return slices;
+}
+
+// Best time of the rounds, negative if a conversion reported a failure.
+template <typename Convert>
+double timeBest(const std::vector<Slice>& slices, int rounds, Convert&& convert) {
+  double best = std::numeric_limits<double>::max();
+  for (int r = 0; r < rounds; r++) {
+    std::atomic<bool> ok{true};
+    const auto begin = Clock::now();
+    if (slices.size() == 1) {
+      ok = convert(size_t{0}, slices[0]);
+    } else {
+      std::vector<std::thread> workers;
+      for (size_t i = 0; i < slices.size(); i++) {
+        workers.emplace_back([&, i]() {
+          if (!convert(i, slices[i])) {
+            ok = false;
+          }
+        });
+      }
+      for (auto& worker : workers) {
+        worker.join();
+      }
+    }
+    best = std::min(best, std::chrono::duration<double>(Clock::now() - begin).count());
+    if (!ok) {
+      return -1.0;
+    }
+  }
+  return best;
+}
+
+// QNN encoding of [minValue, maxValue]: value = (q + offset) * scale.
+void quantizeParams(const DataType& type, float& scale, int32_t& offset) {
+  const double levels = std::pow(2.0, 8.0 * type.bytes) - 1.0;
+  scale               = static_cast<float>((type.maxValue - type.minValue) / levels);
+  offset              = static_cast<int32_t>(std::round(type.minValue / scale));
+}
+
+double referenceHalfToFloat(uint16_t h) {
+  const int exponent = (h >> 10) & 0x1f;
+  const int mantissa = h & 0x3ff;
+  double value;
+  if (exponent == 0) {
+    value = std::ldexp(mantissa, -24);
+  } else if (exponent == 31) {
+    value = mantissa ? std::numeric_limits<double>::quiet_NaN() : std::numeric_limits<double>::infinity();
+  } else {
+    value = std::ldexp(mantissa + 1024, exponent - 25);
+  }
+  return (h & 0x8000) ? -value : value;
+}
+
+// Element i of a native buffer as a double, the raw level for quantized types.
+double nativeValue(const DataType& type, const uint8_t* data, size_t i) {
+  const uint8_t* p = data + i * type.bytes;
+  switch (type.type) {
+    case QNN_DATATYPE_FLOAT_16: {
+      uint16_t v;
+      std::memcpy(&v, p, sizeof(v));
+      return referenceHalfToFloat(v);
+    }
+    case QNN_DATATYPE_UFIXED_POINT_8:
+    case QNN_DATATYPE_UINT_8:
+      return *p;
+    case QNN_DATATYPE_INT_8:
+      return static_cast<int8_t>(*p);
+    case QNN_DATATYPE_UFIXED_POINT_16:
+    case QNN_DATATYPE_UINT_16: {
+      uint16_t v;
+      std::memcpy(&v, p, sizeof(v));
+      return v;
+    }
+    case QNN_DATATYPE_INT_16: {
+      int16_t v;
+      std::memcpy(&v, p, sizeof(v));
+      return v;
+    }
+    case QNN_DATATYPE_INT_32: {
+      int32_t v;
+      std::memcpy(&v, p, sizeof(v));
+      return v;
+    }
+    case QNN_DATATYPE_INT_64: {
+      int64_t v;
+      std::memcpy(&v, p, sizeof(v));
+      return static_cast<double>(v);
+    }
+    default:
+      return 0.0;
+  }
+}
+
+// Random but valid native data for the to-float direction.
+void fillNative(const DataType& type, uint8_t* data, size_t elements, std::mt19937& rng) {
+  std::uniform_int_distribution<uint32_t> bits;
+  std::uniform_real_distribution<double> value{type.minValue, type.maxValue};
+  for (size_t i = 0; i < elements; i++) {
+    uint8_t* p = data + i * type.bytes;
+    if (type.type == QNN_DATATYPE_FLOAT_16) {
+      uint16_t h = static_cast<uint16_t>(bits(rng));
+      if (((h >> 10) & 0x1f) == 0x1f) {
+        h ^= 0x4000;  // no Inf / NaN
+      }
+      std::memcpy(p, &h, sizeof(h));
+    } else if (type.quantized) {
+      const uint32_t level = bits(rng);
+      std::memcpy(p, &level, type.bytes);  // little endian: the low bytes
+    } else if (type.type == QNN_DATATYPE_INT_64) {
+      const int64_t v = static_cast<int64_t>(value(rng));
+      std::memcpy(p, &v, sizeof(v));
+    } else {
+      const int32_t v = static_cast<int32_t>(value(rng));
+      std::memcpy(p, &v, type.bytes);
+    }
+  }
+}
+
+template <typename T>
+bool castFrom(uint8_t* out, float* in, size_t count) {
+  return datautil::StatusCode::SUCCESS ==
+         datautil::castFromFloat<T>(reinterpret_cast<T*>(out), in, count);
+}
+
+template <typename T>
+bool castTo(float* out, uint8_t* in, size_t count) {
+  return datautil::StatusCode::SUCCESS ==
+         datautil::castToFloat<T>(out, reinterpret_cast<T*>(in), count);
+}
+
+bool datautilFromFloat(
+    const DataType& type, uint8_t* out, float* in, size_t count, int32_t offset, float scale) {
+  switch (type.type) {
+    case QNN_DATATYPE_FLOAT_16:
+      return datautil::float32ToFloatN(out, in, count, 16);
+    case QNN_DATATYPE_UFIXED_POINT_8:
+      return datautil::StatusCode::SUCCESS ==
+             datautil::floatToTfN<uint8_t>(out, in, offset, scale, count);
+    case QNN_DATATYPE_UFIXED_POINT_16:
+      return datautil::StatusCode::SUCCESS ==
+             datautil::floatToTfN<uint16_t>(
+                 reinterpret_cast<uint16_t*>(out), in, offset, scale, count);
+    case QNN_DATATYPE_UINT_8:
+      return castFrom<uint8_t>(out, in, count);
+    case QNN_DATATYPE_INT_8:
+      return castFrom<int8_t>(out, in, count);
+    case QNN_DATATYPE_UINT_16:
+      return castFrom<uint16_t>(out, in, count);
+    case QNN_DATATYPE_INT_16:
+      return castFrom<int16_t>(out, in, count);
+    case QNN_DATATYPE_INT_32:
+      return castFrom<int32_t>(out, in, count);
+    case QNN_DATATYPE_INT_64:
+      return castFrom<int64_t>(out, in, count);
+    default:
+      return false;
+  }
+}
+
+bool datautilToFloat(
+    const DataType& type, float* out, uint8_t* in, size_t count, int32_t offset, float scale) {
+  switch (type.type) {
+    case QNN_DATATYPE_FLOAT_16:
+      return datautil::floatNToFloat32(out, in, count, 16);
+    case QNN_DATATYPE_UFIXED_POINT_8:
+      return datautil::StatusCode::SUCCESS ==
+             datautil::tfNToFloat<uint8_t>(out, in, offset, scale, count);
+    case QNN_DATATYPE_UFIXED_POINT_16:
+      return datautil::StatusCode::SUCCESS ==
+             datautil::tfNToFloat<uint16_t>(
+                 out, reinterpret_cast<uint16_t*>(in), offset, scale, count);
+    case QNN_DATATYPE_UINT_8:
+      return castTo<uint8_t>(out, in, count);
+    case QNN_DATATYPE_INT_8:
+      return castTo<int8_t>(out, in, count);
+    case QNN_DATATYPE_UINT_16:
+      return castTo<uint16_t>(out, in, count);
+    case QNN_DATATYPE_INT_16:
+      return castTo<int16_t>(out, in, count);
+    case QNN_DATATYPE_INT_32:
+      return castTo<int32_t>(out, in, count);
+    case QNN_DATATYPE_INT_64:
+      return castTo<int64_t>(out, in, count);
+    default:
+      return false;
+  }
+}
+
+const char* datautilOp(const DataType& type, bool toNative) {
+  if (type.type == QNN_DATATYPE_FLOAT_16) {
+    return toNative ? "float32ToFloatN" : "floatNToFloat32";
+  }
+  if (type.quantized) {
+    return toNative ? "floatToTfN" : "tfNToFloat";
+  }
+  return toNative ? "castFromFloat" : "castToFloat";
+}
+
+// A rank 1 descriptor over `data`, as setupTensors() would leave it for a graph tensor.
+Qnn_Tensor_t makeTensor(
+    const DataType& type, uint8_t* data, uint32_t* dimensions, int32_t offset, float scale) {
+  Qnn_Tensor_t tensor = QNN_TENSOR_INIT;
+  QNN_TENSOR_SET_DATA_TYPE(tensor, type.type);
+  QNN_TENSOR_SET_RANK(tensor, 1);
+  QNN_TENSOR_SET_DIMENSIONS(tensor, dimensions);
+  QNN_TENSOR_SET_MEM_TYPE(tensor, QNN_TENSORMEMTYPE_RAW);
+
+  Qnn_QuantizeParams_t quantizeParams = QNN_QUANTIZE_PARAMS_INIT;
+  if (type.quantized) {
+    quantizeParams.encodingDefinition         = QNN_DEFINITION_DEFINED;
+    quantizeParams.quantizationEncoding       = QNN_QUANTIZATION_ENCODING_SCALE_OFFSET;
+    quantizeParams.scaleOffsetEncoding.scale  = scale;
+    quantizeParams.scaleOffsetEncoding.offset = offset;
+  }
+  QNN_TENSOR_SET_QUANT_PARAMS(tensor, quantizeParams);
+
+  Qnn_ClientBuffer_t clientBuffer = QNN_CLIENT_BUFFER_INIT;
+  clientBuffer.data               = data;
+  clientBuffer.dataSize           = static_cast<uint32_t>(dimensions[0] * type.bytes);
+  QNN_TENSOR_SET_CLIENT_BUF(tensor, clientBuffer);
+  return tensor;
+}
+
+// Worst error of the converted data against the double precision reference.
+double toNativeError(const DataType& type,
+                     const float* in,
+                     const uint8_t* out,
+                     size_t elements,
+                     int32_t offset,
+                     float scale) {
+  const double levels = std::pow(2.0, 8.0 * type.bytes) - 1.0;
+  double maxError     = 0.0;
+  for (size_t i = 0; i < elements; i++) {
+    const double x      = in[i];
+    const double actual = nativeValue(type, out, i);
+    double error;
+    if (type.type == QNN_DATATYPE_FLOAT_16) {
+      error = std::fabs(actual - x) / std::max(std::fabs(x), std::ldexp(1.0, -14));
+    } else if (type.quantized) {
+      const double level = std::clamp(std::round(x / scale - offset), 0.0, levels);
+      error              = std::fabs(actual - level);
+    } else {
+      error = std::fabs(actual - std::trunc(x));
+    }
+    maxError = std::max(maxError, error);
+  }
+  return maxError;
+}
+
+double toFloatError(const DataType& type,
+                    const uint8_t* in,
+                    const float* out,
+                    size_t elements,
+                    int32_t offset,
+                    float scale) {
+  double maxError = 0.0;
+  for (size_t i = 0; i < elements; i++) {
+    double expected = nativeValue(type, in, i);
+    if (type.quantized) {
+      expected = (expected + offset) * static_cast<double>(scale);
+    }
+    maxError = std::max(maxError, std::fabs(static_cast<double>(out[i]) - expected));
+  }
+  return maxError;
+}
+
+void report(const std::string& layer,
+            const std::string& op,
+            const std::string& dtype,
+            size_t bytes,
+            size_t threads,
+            size_t offset,
+            size_t movedBytes,
+            double seconds,
+            double maxError) {
+  std::cout << layer << "," << op << "," << dtype << "," << bytes << "," << threads << "," << offset
+            << ",";
+  if (seconds < 0) {
+    std::cout << "failed,\n";
+    return;
+  }
+  std::cout << movedBytes / seconds / 1e9 << "," << maxError << "\n";
+}
+
+bool selected(const Options& options,
+              const std::string& layer,
+              const std::string& op,
+              const std::string& dtype) {
+  return options.filter.empty() ||
+         (layer + "," + op + "," + dtype).find(options.filter) != std::string::npos;
+}
+
+std::vector<size_t> parseList(const std::string& list) {
+  std::vector<size_t> values;
+  size_t begin = 0;
+  while (begin <= list.size()) {
+    size_t end = list.find(',', begin);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    const std::string item = list.substr(begin, end - begin);
+    if (!item.empty()) {
+      char* suffix = nullptr;
+      size_t value = std::strtoull(item.c_str(), &suffix, 10);
+      switch (std::toupper(static_cast<unsigned char>(*suffix))) {
+        case 'K':
+          value <<= 10;
+          break;
+        case 'M':
+          value <<= 20;
+          break;
+        case 'G':
+          value <<= 30;
+          break;
+      }
+      values.push_back(value);
+    }
+    begin = end + 1;
+  }
+  return values;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string name{argv[i]};
+    const std::string value{argv[i + 1]};
+    if (name == "--sizes") {
+      options.sizes = parseList(value);
+    } else if (name == "--threads") {
+      options.threads = parseList(value);
+    } else if (name == "--offsets") {
+      options.offsets = parseList(value);
+    } else if (name == "--rounds") {
+      options.rounds = std::max(1, std::atoi(value.c_str()));
+    } else if (name == "--filter") {
+      options.filter = value;
+    } else {
+      return false;
+    }
+  }
+  if (argc % 2 == 0) {
+    return false;
+  }
+  for (size_t offset : options.offsets) {
+    if (offset % sizeof(float) != 0) {
+      std::cerr << "offsets must be multiples of " << sizeof(float) << ", the element alignment\n";
+      return false;
+    }
+  }
+  options.threads.erase(std::remove(options.threads.begin(), options.threads.end(), 0),
+                        options.threads.end());
+  return !options.sizes.empty() && !options.threads.empty() && !options.offsets.empty();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    std::cerr << "usage: " << argv[0]
+              << " [--sizes 4K,64K,1M,16M,256M] [--threads 1,2,4,8] [--offsets 0,4]"
+                 " [--rounds 5] [--filter <substring of \"layer,op,dtype\">]\n";
+    return 1;
+  }
+  // populateInputTensor() times itself at warning level, keep that out of the report.
+  SetLogLevel(QNN_LOG_LEVEL_ERROR);
+
+  iotensor::IOTensor ioTensor;
+  std::mt19937 rng{7};
+  std::cout << "layer,op,dtype,bytes,threads,offset,GB/s,max_err\n";
+
+  for (size_t bytes : options.sizes) {
+    const size_t elements = std::max<size_t>(1, bytes / sizeof(float));
+    for (size_t alignOffset : options.offsets) {
+      Buffer floatIn(elements * sizeof(float), alignOffset);
+      Buffer floatOut(elements * sizeof(float), alignOffset);
+
+      for (size_t threads : options.threads) {
+        if (!selected(options, "memcpy", "memcpy", "fp32")) {
+          break;
+        }
+        const auto slices   = split(elements, threads);
+        const double seconds = timeBest(slices, options.rounds, [&](size_t, const Slice& slice) {
+          std::memcpy(floatOut.floats() + slice.begin,
+                      floatIn.floats() + slice.begin,
+                      slice.count * sizeof(float));
+          return true;
+        });
+        report("memcpy", "memcpy", "fp32", bytes, threads, alignOffset,
+               2 * elements * sizeof(float), seconds, 0.0);
+      }
+
+      for (const DataType& type : kDataTypes) {
+        const bool anyToNative = selected(options, "datautil", datautilOp(type, true), type.name) ||
+                                 selected(options, "iotensor", "copyFromFloatToNative", type.name);
+        const bool anyToFloat = selected(options, "datautil", datautilOp(type, false), type.name) ||
+                                selected(options, "iotensor", "convertToFloat", type.name);
+        if (!anyToNative && !anyToFloat) {
+          continue;
+        }
+
+        float scale    = 1.0f;
+        int32_t offset = 0;
+        quantizeParams(type, scale, offset);
+        Buffer native(elements * type.bytes, alignOffset);
+        const size_t movedBytes = elements * (sizeof(float) + type.bytes);
+
+        if (anyToNative) {
+          std::uniform_real_distribution<float> value{static_cast<float>(type.minValue),
+                                                      static_cast<float>(type.maxValue)};
+          std::generate(floatIn.floats(), floatIn.floats() + elements, [&]() { return value(rng); });
+        }
+        if (anyToFloat) {
+          fillNative(type, native.data(), elements, rng);
+        }
+
+        for (size_t threads : options.threads) {
+          const auto slices = split(elements, threads);
+          std::vector<uint32_t> dimensions(slices.size());
+          std::vector<Qnn_Tensor_t> toNativeTensors;
+          std::vector<Qnn_Tensor_t> toFloatTensors;
+          for (size_t i = 0; i < slices.size(); i++) {
+            dimensions[i] = static_cast<uint32_t>(slices[i].count);
+            uint8_t* data = native.data() + slices[i].begin * type.bytes;
+            toNativeTensors.push_back(makeTensor(type, data, &dimensions[i], offset, scale));
+          }
+          toFloatTensors = toNativeTensors;
+          // fillNative() data must survive the to-native runs, give them their own output.
+          Buffer nativeOut(anyToNative ? elements * type.bytes : 0, alignOffset);
+          for (size_t i = 0; i < slices.size(); i++) {
+            Qnn_ClientBuffer_t clientBuffer = QNN_TENSOR_GET_CLIENT_BUF(toNativeTensors[i]);
+            clientBuffer.data               = nativeOut.data() + slices[i].begin * type.bytes;
+            QNN_TENSOR_SET_CLIENT_BUF(toNativeTensors[i], clientBuffer);
+          }
+
+          if (selected(options, "datautil", datautilOp(type, true), type.name)) {
+            const double seconds = timeBest(slices, options.rounds, [&](size_t, const Slice& slice) {
+              return datautilFromFloat(type,
+                                       nativeOut.data() + slice.begin * type.bytes,
+                                       floatIn.floats() + slice.begin,
+                                       slice.count,
+                                       offset,
+                                       scale);
+            });
+            report("datautil", datautilOp(type, true), type.name, bytes, threads,
+                   alignOffset, movedBytes, seconds,
+                   toNativeError(type, floatIn.floats(), nativeOut.data(), elements, offset, scale));
+          }
+
+          if (selected(options, "iotensor", "copyFromFloatToNative", type.name)) {
+            std::memset(nativeOut.data(), 0, elements * type.bytes);
+            const double seconds = timeBest(slices, options.rounds, [&](size_t i, const Slice& slice) {
+              qnn_wrapper_api::GraphInfo_t graphInfo{};
+              graphInfo.inputTensors    = &toNativeTensors[i];
+              graphInfo.numInputTensors = 1;
+              std::vector<uint8_t*> inputBuffers{
+                  reinterpret_cast<uint8_t*>(floatIn.floats() + slice.begin)};
+              return iotensor::StatusCode::SUCCESS ==
+                     ioTensor.populateInputTensors(0,
+                                                   inputBuffers,
+                                                   &toNativeTensors[i],
+                                                   graphInfo,
+                                                   iotensor::InputDataType::FLOAT);
+            });
+            report("iotensor", "copyFromFloatToNative", type.name, bytes, threads,
+                   alignOffset, movedBytes, seconds,
+                   toNativeError(type, floatIn.floats(), nativeOut.data(), elements, offset, scale));
+          }
+
+          if (selected(options, "datautil", datautilOp(type, false), type.name)) {
+            const double seconds = timeBest(slices, options.rounds, [&](size_t, const Slice& slice) {
+              return datautilToFloat(type,
+                                     floatOut.floats() + slice.begin,
+                                     native.data() + slice.begin * type.bytes,
+                                     slice.count,
+                                     offset,
+                                     scale);
+            });
+            report("datautil", datautilOp(type, false), type.name, bytes, threads,
+                   alignOffset, movedBytes, seconds,
+                   toFloatError(type, native.data(), floatOut.floats(), elements, offset, scale));
+          }
+
+          if (selected(options, "iotensor", "convertToFloat", type.name)) {
+            std::memset(floatOut.data(), 0, elements * sizeof(float));
+            const double seconds = timeBest(slices, options.rounds, [&](size_t i, const Slice& slice) {
+              // a non null *out is converted into in place, as for the shared memory outputs.
+              float* out = floatOut.floats() + slice.begin;
+              return iotensor::StatusCode::SUCCESS == ioTensor.convertToFloat(&out, &toFloatTensors[i]);
+            });
+            report("iotensor", "convertToFloat", type.name, bytes, threads, alignOffset,
+                   movedBytes, seconds,
+                   toFloatError(type, native.data(), floatOut.floats(), elements, offset, scale));
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
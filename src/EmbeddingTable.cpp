@@ -0,0 +1,310 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#include "EmbeddingTable.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char kMagic[8] = {'Q', 'A', 'I', 'E', 'L', 'U', 'T', '1'};
+
+static inline uint32_t floatBits(float f) {
+  uint32_t u;
+  std::memcpy(&u, &f, sizeof(u));
+  return u;
+}
+
+static inline float bitsFloat(uint32_t u) {
+  float f;
+  std::memcpy(&f, &u, sizeof(f));
+  return f;
+}
+
+// IEEE half <-> float without F16C/NEON, so the table reads the same on every target.
+static inline float halfToFloat(uint16_t h) {
+  const uint32_t shifted = static_cast<uint32_t>(h & 0x7fffu) << 13;
+  const uint32_t exponent = shifted & 0x0f800000u;
+  uint32_t bits = shifted + ((127u - 15u) << 23);
+  if (exponent == 0x0f800000u) {  // Inf / NaN
+    bits += (128u - 16u) << 23;
+  } else if (exponent == 0) {  // zero / subnormal, renormalized by the FPU
+    bits = floatBits(bitsFloat(bits + (1u << 23)) - bitsFloat(113u << 23));
+  }
+  return bitsFloat(bits | (static_cast<uint32_t>(h & 0x8000u) << 16));
+}
+
+// round to nearest even.
+static inline uint16_t floatToHalf(float f) {
+  const uint32_t f32Infinity = 255u << 23;
+  const uint32_t f16Max      = (127u + 16u) << 23;
+  const uint32_t denormMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+  uint32_t bits       = floatBits(f);
+  const uint32_t sign = bits & 0x80000000u;
+  bits ^= sign;
+
+  uint32_t half;
+  if (bits >= f16Max) {
+    half = bits > f32Infinity ? 0x7e00u : 0x7c00u;
+  } else if (bits < (113u << 23)) {
+    half = floatBits(bitsFloat(bits) + bitsFloat(denormMagic)) - denormMagic;
+  } else {
+    const uint32_t mantissaOdd = (bits >> 13) & 1u;
+    bits += ((15u - 127u) << 23) + 0xfffu;
+    bits += mantissaOdd;
+    half = bits >> 13;
+  }
+  return static_cast<uint16_t>(half | (sign >> 16));
+}
+
+EmbeddingTable::~EmbeddingTable() { close(); }
+
+bool EmbeddingTable::open(const std::string& path, std::string& error, bool prefetch) {
+  close();
+
+#ifdef _WIN32
+  // FILE_FLAG_RANDOM_ACCESS turns the read-ahead of the cache manager down, a prompt touches scattered rows.
+  HANDLE file = CreateFileA(path.c_str(),
+                            GENERIC_READ,
+                            FILE_SHARE_READ,
+                            nullptr,
+                            OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | (prefetch ? 0 : FILE_FLAG_RANDOM_ACCESS),
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    error = "failed to open embedding table file: " + path;
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+    CloseHandle(file);
+    error = "embedding table file is empty: " + path;
+    return false;
+  }
+  // a named section is not needed to share the pages, all mappings of one file use the same section.
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  void* base     = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+  if (nullptr == base) {
+    if (mapping) {
+      CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    error = "failed to map embedding table file: " + path;
+    return false;
+  }
+  m_file    = file;
+  m_mapping = mapping;
+  m_size    = static_cast<size_t>(fileSize.QuadPart);
+  m_base    = static_cast<const uint8_t*>(base);
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+  if (prefetch) {
+    WIN32_MEMORY_RANGE_ENTRY range{base, m_size};
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+  }
+#endif
+  // large pages can't back a file view on Windows, the mapping stays on 4K pages.
+#else
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    error = "failed to open embedding table file: " + path;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    error = "embedding table file is empty: " + path;
+    return false;
+  }
+  void* base = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    error = "failed to map embedding table file: " + path;
+    return false;
+  }
+  m_size = static_cast<size_t>(st.st_size);
+  m_base = static_cast<const uint8_t*>(base);
+#ifdef MADV_HUGEPAGE
+  // honored for files with CONFIG_READ_ONLY_THP_FOR_FS, ignored otherwise.
+  madvise(base, m_size, MADV_HUGEPAGE);
+#endif
+  madvise(base, m_size, prefetch ? MADV_WILLNEED : MADV_RANDOM);
+#endif
+
+  m_format = Format::Raw;
+  m_data   = m_base;
+  if (m_size < sizeof(Header) || std::memcmp(m_base, kMagic, sizeof(kMagic)) != 0) {
+    return true;
+  }
+
+  Header header;
+  std::memcpy(&header, m_base, sizeof(header));
+  size_t elementBytes = 0;
+  size_t scaleBytes   = 0;
+  if (header.format == static_cast<uint32_t>(Format::Float16)) {
+    elementBytes = sizeof(uint16_t);
+  } else if (header.format == static_cast<uint32_t>(Format::Int8)) {
+    elementBytes = sizeof(int8_t);
+    scaleBytes   = static_cast<size_t>(header.rows) * sizeof(float);
+  } else {
+    close();
+    error = "embedding table has an unknown format " + std::to_string(header.format) + ": " + path;
+    return false;
+  }
+  const size_t expected =
+      sizeof(Header) + scaleBytes + static_cast<size_t>(header.rows) * header.cols * elementBytes;
+  if (expected != m_size) {
+    close();
+    error = "embedding table size " + std::to_string(m_size) + " does not match its header (" +
+            std::to_string(expected) + "): " + path;
+    return false;
+  }
+
+  m_format = static_cast<Format>(header.format);
+  m_rows   = header.rows;
+  m_cols   = header.cols;
+  m_scales = scaleBytes ? reinterpret_cast<const float*>(m_base + sizeof(Header)) : nullptr;
+  m_data   = m_base + sizeof(Header) + scaleBytes;
+  return true;
+}
+
+void EmbeddingTable::close() {
+  if (m_base) {
+#ifdef _WIN32
+    UnmapViewOfFile(m_base);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file    = nullptr;
+#else
+    munmap(const_cast<uint8_t*>(m_base), m_size);
+#endif
+  }
+  m_base   = nullptr;
+  m_size   = 0;
+  m_data   = nullptr;
+  m_scales = nullptr;
+  m_format = Format::Raw;
+  m_rows   = 0;
+  m_cols   = 0;
+}
+
+bool EmbeddingTable::lookup(int32_t token, void* dst, size_t dstBytes) const {
+  if (nullptr == m_base || token < 0 || 0 == dstBytes) {
+    return false;
+  }
+
+  const size_t row = static_cast<size_t>(token);
+  if (m_format == Format::Raw) {
+    if ((row + 1) * dstBytes > m_size) {
+      return false;
+    }
+    std::memcpy(dst, m_data + row * dstBytes, dstBytes);
+    return true;
+  }
+
+  if (row >= m_rows || dstBytes != m_cols * sizeof(float)) {
+    return false;
+  }
+  float* out = static_cast<float*>(dst);
+  if (m_format == Format::Float16) {
+    const uint8_t* src = m_data + row * m_cols * sizeof(uint16_t);
+    for (size_t i = 0; i < m_cols; i++) {
+      uint16_t h;
+      std::memcpy(&h, src + i * sizeof(uint16_t), sizeof(h));
+      out[i] = halfToFloat(h);
+    }
+  } else {
+    const int8_t* src = reinterpret_cast<const int8_t*>(m_data) + row * m_cols;
+    float scale;
+    std::memcpy(&scale, m_scales + row, sizeof(scale));
+    for (size_t i = 0; i < m_cols; i++) {
+      out[i] = scale * static_cast<float>(src[i]);
+    }
+  }
+  return true;
+}
+
+bool EmbeddingTable::compress(const float* table,
+                              size_t rows,
+                              size_t cols,
+                              Format format,
+                              const std::string& path,
+                              std::string& error) {
+  if (format == Format::Raw || rows == 0 || cols == 0 || rows > UINT32_MAX || cols > UINT32_MAX) {
+    error = "compress needs Float16 or Int8 and a non empty table";
+    return false;
+  }
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    error = "failed to create embedding table file: " + path;
+    return false;
+  }
+
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.format = static_cast<uint32_t>(format);
+  header.rows   = static_cast<uint32_t>(rows);
+  header.cols   = static_cast<uint32_t>(cols);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  if (format == Format::Float16) {
+    std::vector<uint16_t> half(cols);
+    for (size_t r = 0; r < rows; r++) {
+      const float* src = table + r * cols;
+      std::transform(src, src + cols, half.begin(), floatToHalf);
+      out.write(reinterpret_cast<const char*>(half.data()), cols * sizeof(uint16_t));
+    }
+  } else {
+    // symmetric, one scale per row: the rows of an embedding table differ a lot in magnitude.
+    std::vector<float> scales(rows);
+    for (size_t r = 0; r < rows; r++) {
+      const float* src = table + r * cols;
+      float maxAbs     = 0.0f;
+      for (size_t i = 0; i < cols; i++) {
+        maxAbs = std::max(maxAbs, std::fabs(src[i]));
+      }
+      scales[r] = maxAbs / 127.0f;
+    }
+    out.write(reinterpret_cast<const char*>(scales.data()), rows * sizeof(float));
+
+    std::vector<int8_t> quantized(cols);
+    for (size_t r = 0; r < rows; r++) {
+      const float* src  = table + r * cols;
+      const float scale = scales[r];
+      for (size_t i = 0; i < cols; i++) {
+        const float q = scale > 0.0f ? std::round(src[i] / scale) : 0.0f;
+        quantized[i]  = static_cast<int8_t>(std::min(127.0f, std::max(-127.0f, q)));
+      }
+      out.write(reinterpret_cast<const char*>(quantized.data()), cols);
+    }
+  }
+
+  if (!out) {
+    error = "failed to write embedding table file: " + path;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,79 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*
+ * The token -> embedding lookup table (LUT) of a model, mapped read-only from its file.
+ * The mapping is backed by the page cache, so every process which opens the same file shares one copy
+ * and only the rows a prompt touches have to be resident.
+ *
+ * Two file formats are accepted:
+ *   raw:        the rows of the LUT back to back, in whatever element type the model takes. A lookup copies
+ *               the row as is, the row width is the size of the destination.
+ *   compressed: a Header, for Int8 one float scale per row, then rows * cols elements (fp16 or int8).
+ *               A lookup dequantizes the row into float32, so it serves models which take float32
+ *               embeddings. compress() writes such a file from a float32 table.
+ */
+class EmbeddingTable {
+public:
+  enum class Format : uint32_t { Raw = 0, Float16 = 1, Int8 = 2 };
+
+  struct Header {
+    char magic[8];    // "QAIELUT1"
+    uint32_t format;  // Format::Float16 or Format::Int8
+    uint32_t rows;
+    uint32_t cols;
+    uint32_t reserved;
+  };
+
+  EmbeddingTable() = default;
+  ~EmbeddingTable();
+  EmbeddingTable(const EmbeddingTable&)            = delete;
+  EmbeddingTable& operator=(const EmbeddingTable&) = delete;
+
+  // prefetch reads the whole file in ahead of the first prompt (MADV_WILLNEED / PrefetchVirtualMemory),
+  // otherwise the pages come in on first touch. Huge pages are requested where the OS maps files with them.
+  bool open(const std::string& path, std::string& error, bool prefetch = false);
+  void close();
+
+  // Row `token` into dst, which holds dstBytes: the raw row of dstBytes bytes, or the cols float32 of a
+  // compressed row (dstBytes must be cols * sizeof(float)). False if the token or the size doesn't fit.
+  // Safe to call from several threads.
+  bool lookup(int32_t token, void* dst, size_t dstBytes) const;
+
+  bool isOpen() const { return m_base != nullptr; }
+  Format format() const { return m_format; }
+  size_t rows() const { return m_rows; }  // 0 for a raw table, its row width is not in the file
+  size_t cols() const { return m_cols; }
+  size_t mappedBytes() const { return m_size; }
+
+  static bool compress(const float* table,
+                       size_t rows,
+                       size_t cols,
+                       Format format,
+                       const std::string& path,
+                       std::string& error);
+
+private:
+  const uint8_t* m_base = nullptr;  // the mapping
+  size_t m_size         = 0;
+  const uint8_t* m_data = nullptr;  // the first row
+  const float* m_scales = nullptr;  // Int8 only
+  Format m_format       = Format::Raw;
+  size_t m_rows         = 0;
+  size_t m_cols         = 0;
+#ifdef _WIN32
+  void* m_file    = nullptr;
+  void* m_mapping = nullptr;
+#endif
+};
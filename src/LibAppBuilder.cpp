@@ -16,10 +16,14 @@
 #include <stdlib.h>
 #include <fcntl.h>
 #include <algorithm>
+#include <cctype>
 #include <vector>
 #include <fstream>
+#include <mutex>
+#include <shared_mutex>
 
 #include "BuildId.hpp"
+#include "ContextCache.hpp"
 #include "DynamicLoadUtil.hpp"
 #include "Logger.hpp"
 #include "LogUtils.hpp"
@@ -42,17 +46,126 @@ using namespace qnn;
 using namespace qnn::log;
 using namespace qnn::tools;
 
-static void* sg_backendHandle{nullptr};
-static void* sg_modelHandle{nullptr};
-static void* sg_systemLibraryHandle{nullptr};
-
-static QNN_INTERFACE_VER_TYPE sg_qnnInterface;
+// The QNN libraries (backends, QnnSystem, model .so) by path. Each one is loaded once and shared by all the
+// models which use it, so models on different backends (e.g. CPU and HTP) run side by side in one process and
+// a model on an already loaded backend initializes without loading it again. The last model unloads it.
+struct QnnLibrary {
+  void* handle{nullptr};
+  sample_app::QnnFunctionPointers functions{};
+  uint32_t refs{0};
+  bool isBackend{false};
+};
+static std::unordered_map<std::string, QnnLibrary> sg_libraries;
+static std::mutex sg_libraries_lock;
 
+// Global perf votes go to the HTP backend, sg_htpInfraBackend is the library gs_htpInfra came from.
+// Both are guarded by sg_libraries_lock.
 QnnHtpDevice_Infrastructure_t *gs_htpInfra(nullptr);
+static void* sg_htpInfraBackend{nullptr};
 static bool sg_perf_global = false;
 
-std::unordered_map<std::string, std::unique_ptr<sample_app::QnnSampleApp>> sg_model_map;
+enum class LibraryKind { Backend, System, Model };
+
+// Called with sg_libraries_lock held.
+static void unloadLibrary(QnnLibrary& library) {
+  if (library.isBackend) {
+    // the devices of the backend outlive the apps which created them, they go with the backend.
+    sample_app::QnnSampleApp::freeSharedDevices(library.handle, library.functions.qnnInterface);
+    if (sg_htpInfraBackend == library.handle) {
+      gs_htpInfra        = nullptr;
+      sg_htpInfraBackend = nullptr;
+      sg_perf_global     = false;
+    }
+  }
+  pal::dynamicloading::dlClose(library.handle);
+}
+
+// A reference on one library of sg_libraries, released with its owner.
+class LibraryRef {
+public:
+  LibraryRef() = default;
+  ~LibraryRef() { release(); }
+  LibraryRef(const LibraryRef&)            = delete;
+  LibraryRef& operator=(const LibraryRef&) = delete;
+
+  dynamicloadutil::StatusCode acquire(const std::string& path, LibraryKind kind) {
+    release();
+    std::lock_guard<std::mutex> lk(sg_libraries_lock);
+    auto it = sg_libraries.find(path);
+    if (it == sg_libraries.end()) {
+      QnnLibrary library;
+      dynamicloadutil::StatusCode status;
+      if (LibraryKind::Backend == kind) {
+        status = dynamicloadutil::getQnnFunctionPointers(path, "", &library.functions, &library.handle, false, nullptr);
+      } else if (LibraryKind::System == kind) {
+        status = dynamicloadutil::getQnnSystemFunctionPointers(path, &library.functions, &library.handle);
+      } else {
+        status = dynamicloadutil::getQnnModelFunctionPointers(path, &library.functions, &library.handle);
+      }
+      if (dynamicloadutil::StatusCode::SUCCESS != status) {
+        if (nullptr != library.handle) {
+          pal::dynamicloading::dlClose(library.handle);
+        }
+        return status;
+      }
+      library.isBackend = (LibraryKind::Backend == kind);
+      it = sg_libraries.emplace(path, library).first;
+      QNN_INF("Loaded QNN library %s\n", path.c_str());
+    }
+    it->second.refs += 1;
+    m_path    = path;
+    m_library = &it->second;  // the nodes of an unordered_map don't move
+    return dynamicloadutil::StatusCode::SUCCESS;
+  }
+
+  void release() {
+    if (nullptr == m_library) {
+      return;
+    }
+    std::lock_guard<std::mutex> lk(sg_libraries_lock);
+    if (0 == --m_library->refs) {
+      QNN_INF("Unloading QNN library %s\n", m_path.c_str());
+      unloadLibrary(*m_library);
+      sg_libraries.erase(m_path);
+    }
+    m_library = nullptr;
+    m_path.clear();
+  }
+
+  const sample_app::QnnFunctionPointers& functions() const { return m_library->functions; }
+  void* handle() const { return nullptr != m_library ? m_library->handle : nullptr; }
+
+private:
+  std::string m_path;
+  QnnLibrary* m_library{nullptr};
+};
+
+// The libraries one model runs on.
+struct ModelLibraries {
+  LibraryRef backend;
+  LibraryRef system;  // models loaded from a context binary / DLC
+  LibraryRef model;   // models loaded from a model .so / .dll
+};
+
+// A model and the lock its graphs run under. Different models run in parallel. Inferences on one model take
+// the lock shared and overlap as far as the app has tensor sets (SetTensorSets()), everything else on the
+// model takes it exclusively.
+// libraries is declared first so that it is released after the app is gone.
+struct ModelEntry {
+  ModelLibraries libraries;
+  std::unique_ptr<sample_app::QnnSampleApp> app;
+  std::shared_mutex lock;
+};
+
+// sg_model_map_lock is held only to look up, add or remove an entry, never while a model runs.
+static std::unordered_map<std::string, std::shared_ptr<ModelEntry>> sg_model_map;
+static std::mutex sg_model_map_lock;
 static sample_app::ProfilingLevel sg_parsedProfilingLevel = sample_app::ProfilingLevel::OFF;
+static size_t sg_tensorSets = 1;
+static bool sg_lazyGraphs = false;
+// compiled contexts of DLC models, see SetContextCache().
+static std::string sg_contextCacheDir;
+static uint64_t sg_contextCacheMaxBytes = 0;
 
 namespace qnn {
 namespace tools {
@@ -83,13 +196,15 @@ void warmup_parallel_stl()
 
 std::unique_ptr<sample_app::QnnSampleApp> initQnnSampleApp(std::string cachedBinaryPath, std::string backEndPath, std::string systemLibraryPath,
                                                            bool loadFromCachedBinary, std::vector<LoraAdapter>& lora_adapters,
-                                                           const std::string& input_data_type, const std::string& output_data_type, sample_app::MultiCoreDeviceConfig_t multiCoreDeviceConfig) {
+                                                           const std::string& input_data_type, const std::string& output_data_type, sample_app::MultiCoreDeviceConfig_t multiCoreDeviceConfig,
+                                                           ModelLibraries& libraries) {
   // Just keep blank for below paths.
   std::string modelPath;
   std::string cachedBinaryPath2;
   std::string opPackagePaths;
   std::string saveBinaryName;
-  if (!cachedBinaryPath.empty()){
+  // a DLC is saved through the context cache, see ModelInitializeEx().
+  if (!cachedBinaryPath.empty() && cachedBinaryPath.substr(cachedBinaryPath.find_last_of('.') + 1) != "dlc"){
     saveBinaryName = getFileNameFromPath(cachedBinaryPath);
     QNN_DEBUG("initQnnSampleApp saveBinaryName=%s\n", saveBinaryName.c_str());
   }
@@ -109,14 +224,11 @@ std::unique_ptr<sample_app::QnnSampleApp> initQnnSampleApp(std::string cachedBin
   bool dumpOutputs                                = true;
   bool debug                                      = false;
   
-  sample_app::QnnFunctionPointers qnnFunctionPointers;
-  // Load backend and model .so and validate all the required function symbols are resolved
-  auto statusCode = dynamicloadutil::getQnnFunctionPointers(backEndPath,
-                                                            modelPath,
-                                                            &qnnFunctionPointers,
-                                                            &sg_backendHandle,
-                                                            !loadFromCachedBinary,
-                                                            &sg_modelHandle);
+  // Load backend and model .so (or take them from sg_libraries) and validate all the required function symbols are resolved
+  auto statusCode = libraries.backend.acquire(backEndPath, LibraryKind::Backend);
+  if (dynamicloadutil::StatusCode::SUCCESS == statusCode && !loadFromCachedBinary) {
+    statusCode = libraries.model.acquire(modelPath, LibraryKind::Model);
+  }
   if (dynamicloadutil::StatusCode::SUCCESS != statusCode) {
     if (dynamicloadutil::StatusCode::FAIL_LOAD_BACKEND == statusCode) {
       sample_app::exitWithMessage(
@@ -130,19 +242,29 @@ std::unique_ptr<sample_app::QnnSampleApp> initQnnSampleApp(std::string cachedBin
   }
 
   if (loadFromCachedBinary) {
-    statusCode = dynamicloadutil::getQnnSystemFunctionPointers(systemLibraryPath, &qnnFunctionPointers, &sg_systemLibraryHandle);
+    statusCode = libraries.system.acquire(systemLibraryPath, LibraryKind::System);
     if (dynamicloadutil::StatusCode::SUCCESS != statusCode) {
       sample_app::exitWithMessage("Error initializing QNN System Function Pointers", EXIT_FAILURE);
     }
   }
 
+  sample_app::QnnFunctionPointers qnnFunctionPointers{};
+  qnnFunctionPointers.qnnInterface       = libraries.backend.functions().qnnInterface;
+  qnnFunctionPointers.qnnInterfaceHandle = libraries.backend.functions().qnnInterfaceHandle;
+  if (loadFromCachedBinary) {
+    qnnFunctionPointers.qnnSystemInterface       = libraries.system.functions().qnnSystemInterface;
+    qnnFunctionPointers.qnnSystemInterfaceHandle = libraries.system.functions().qnnSystemInterfaceHandle;
+  } else {
+    qnnFunctionPointers.composeGraphsFnHandle = libraries.model.functions().composeGraphsFnHandle;
+    qnnFunctionPointers.freeGraphInfoFnHandle = libraries.model.functions().freeGraphInfoFnHandle;
+  }
+
 #if !defined(__ANDROID__) && !defined(__linux__)
   if ((input_data_type == "float") || (output_data_type == "float")) // We need 'std::transform' only for �float� mode. It need data conversation.
       warmup_parallel_stl();
 #endif
 
-  sg_qnnInterface = qnnFunctionPointers.qnnInterface;
-  std::unique_ptr<sample_app::QnnSampleApp> app(new sample_app::QnnSampleApp(qnnFunctionPointers, "null", opPackagePaths, sg_backendHandle, "null",
+  std::unique_ptr<sample_app::QnnSampleApp> app(new sample_app::QnnSampleApp(qnnFunctionPointers, "null", opPackagePaths, libraries.backend.handle(), "null",
                                                                              debug, parsedOutputDataType, parsedInputDataType, sg_parsedProfilingLevel,
                                                                              dumpOutputs, cachedBinaryPath2, saveBinaryName, lora_adapters, cachedBinaryPath2, multiCoreDeviceConfig));
     return app;
@@ -153,18 +275,44 @@ std::unique_ptr<sample_app::QnnSampleApp> initQnnSampleApp(std::string cachedBin
 }  // namespace qnn
 
 
-std::unique_ptr<sample_app::QnnSampleApp> getQnnSampleApp(std::string model_name) {
+// The entry stays alive while the caller holds it, even if the model is destroyed meanwhile.
+std::shared_ptr<ModelEntry> findModel(const std::string& model_name) {
+  std::lock_guard<std::mutex> lk(sg_model_map_lock);
   auto it = sg_model_map.find(model_name);
   if (it != sg_model_map.end()) {
-    if (it->second) {
-      auto app = std::move(it->second);
-      sg_model_map.erase(it);
-      return app;
-    }
+    return it->second;
   }
   return nullptr;
 }
 
+std::shared_ptr<ModelEntry> takeModel(const std::string& model_name) {
+  std::lock_guard<std::mutex> lk(sg_model_map_lock);
+  auto it = sg_model_map.find(model_name);
+  if (it == sg_model_map.end()) {
+    return nullptr;
+  }
+  auto entry = std::move(it->second);
+  sg_model_map.erase(it);
+  return entry;
+}
+
+// Run func(app) under the lock of the model, a default R if there is no such model.
+// Lock is std::shared_lock for an inference, which the app runs in parallel with others.
+template <typename R, typename Lock = std::unique_lock<std::shared_mutex>, typename Func>
+R withModel(const std::string& model_name, Func&& func) {
+  std::shared_ptr<ModelEntry> entry = findModel(model_name);
+  if (nullptr == entry) {
+    QNN_ERR("Can't find the model with model_name: %s\n", model_name.c_str());
+    return R{};
+  }
+  Lock lk(entry->lock);
+  if (nullptr == entry->app) {  // destroyed while we waited for the lock
+    QNN_ERR("Can't find the model with model_name: %s\n", model_name.c_str());
+    return R{};
+  }
+  return func(*entry->app);
+}
+
 void SetProcInfo(std::string proc_name, uint64_t epoch) {
     setEpoch(epoch);
 #ifdef _WIN32
@@ -180,6 +328,26 @@ bool SetProfilingLevel(int32_t profiling_level) {
     return true;
 }
 
+bool SetTensorSets(int32_t tensor_sets) {
+    if (tensor_sets < 1) {
+        QNN_ERR("SetTensorSets::tensor_sets must be at least 1, got %d\n", tensor_sets);
+        return false;
+    }
+    sg_tensorSets = static_cast<size_t>(tensor_sets);
+    return true;
+}
+
+bool SetLazyGraphs(bool lazy_graphs) {
+    sg_lazyGraphs = lazy_graphs;
+    return true;
+}
+
+bool SetContextCache(const std::string& cache_dir, uint64_t max_bytes) {
+    sg_contextCacheDir      = cache_dir;
+    sg_contextCacheMaxBytes = max_bytes;
+    return true;
+}
+
 bool SetLogLevel(int32_t log_level, const std::string log_path) {
 #ifdef _WIN32
   if(log_path != "" && log_path != "None") {
@@ -216,21 +384,44 @@ bool SetLogLevel(int32_t log_level, const std::string log_path) {
   return true;
 }
 
-bool SetPerfProfileGlobal(const std::string& perf_profile) {
-    if (nullptr == sg_backendHandle) {
-        QNN_ERR("SetPerfProfileGlobal::initialize one model before set perf profile!\n");
-        return false;
+// The HTP backend among the loaded ones: the library named like QnnHtp, or the only backend loaded.
+// Called with sg_libraries_lock held.
+static QnnLibrary* findHtpBackend() {
+    QnnLibrary* only = nullptr;
+    size_t backends = 0;
+    for (auto& library : sg_libraries) {
+        if (!library.second.isBackend) {
+            continue;
+        }
+        std::string name = libappbuilder::getFileNameFromPath(library.first);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        if (name.find("htp") != std::string::npos) {
+            return &library.second;
+        }
+        only = &library.second;
+        backends++;
     }
+    return 1 == backends ? only : nullptr;
+}
 
+bool SetPerfProfileGlobal(const std::string& perf_profile) {
+    std::lock_guard<std::mutex> lk(sg_libraries_lock);
     if (nullptr == gs_htpInfra) {
+        QnnLibrary* backend = findHtpBackend();
+        if (nullptr == backend) {
+            QNN_ERR("SetPerfProfileGlobal::initialize one model on the HTP backend before set perf profile!\n");
+            return false;
+        }
+
         QnnDevice_Infrastructure_t deviceInfra = nullptr;
-        Qnn_ErrorHandle_t devErr = sg_qnnInterface.deviceGetInfrastructure(&deviceInfra);
+        Qnn_ErrorHandle_t devErr = backend->functions.qnnInterface.deviceGetInfrastructure(&deviceInfra);
 
         if (devErr != QNN_SUCCESS) {
             QNN_ERR("SetPerfProfileGlobal::device error");
             return false;
         }
-        gs_htpInfra = static_cast<QnnHtpDevice_Infrastructure_t *>(deviceInfra);
+        gs_htpInfra        = static_cast<QnnHtpDevice_Infrastructure_t *>(deviceInfra);
+        sg_htpInfraBackend = backend->handle;
     }
 
     QnnHtpDevice_PerfInfrastructure_t perfInfra = gs_htpInfra->perfInfra;
@@ -241,6 +432,7 @@ bool SetPerfProfileGlobal(const std::string& perf_profile) {
 }
 
 bool RelPerfProfileGlobal() {
+    std::lock_guard<std::mutex> lk(sg_libraries_lock);
     if (false == sg_perf_global) {
       QNN_ERR("You should set perf profile before you release it!\n");
       return false;
@@ -385,10 +577,6 @@ bool DeleteShareMemory(std::string share_memory_name) {
 #endif
 }
 
-bool fileExists(const std::string& path) { 
-    std::ifstream f(path.c_str()); 
-    return f.good(); 
-}
 std::string stripWhitespace(std::string &str) {
   const std::string whitespace{" \t\n\v\f\r"};
   if (!str.empty()) {
@@ -440,12 +628,7 @@ bool ModelInitializeEx(const std::string& model_name, const std::string& proc_na
   if (suffix_mode_path == "bin") {  // *.bin
       QNN_INFO("cachedBinaryPath: %s", cachedBinaryPath.c_str());
   } else if (suffix_mode_path == "dlc"){
-      std::string dlcBinPath = cachedBinaryPath + ".bin";
-      if (fileExists(dlcBinPath)) { 
-          cachedBinaryPath = dlcBinPath; 
-          suffix_mode_path = "bin";
-          QNN_INFO("Found dlc.bin, updated cachedBinaryPath: %s\n", cachedBinaryPath.c_str()); 
-      }
+      QNN_INFO("dlcPath: %s", cachedBinaryPath.c_str());
   } else {    // *.dll
       loadFromCachedBinary = false;
       QNN_INFO("modelPath: %s", cachedBinaryPath.c_str());
@@ -484,7 +667,9 @@ bool ModelInitializeEx(const std::string& model_name, const std::string& proc_na
   }
 
   {
-    std::unique_ptr<sample_app::QnnSampleApp> app = libappbuilder::initQnnSampleApp(cachedBinaryPath, backEndPath, systemLibraryPath, loadFromCachedBinary, lora_adapters, input_data_type, output_data_type, multiCoreDevCfg_global);
+    // the entry holds the libraries from here on, so a failed initialization releases them after the app.
+    auto entry = std::make_shared<ModelEntry>();
+    std::unique_ptr<sample_app::QnnSampleApp> app = libappbuilder::initQnnSampleApp(cachedBinaryPath, backEndPath, systemLibraryPath, loadFromCachedBinary, lora_adapters, input_data_type, output_data_type, multiCoreDevCfg_global, entry->libraries);
 
     if (nullptr == app) {
       return false;
@@ -494,6 +679,7 @@ bool ModelInitializeEx(const std::string& model_name, const std::string& proc_na
     QNN_INFO("Backend        build version: %s", app->getBackendBuildId().c_str());
 
     app->initializeLog();
+    app->setLazyGraphs(sg_lazyGraphs);
 
     if (sample_app::StatusCode::SUCCESS != app->initializeBackend()) {
       app->reportError("Backend Initialization failure");
@@ -519,7 +705,34 @@ bool ModelInitializeEx(const std::string& model_name, const std::string& proc_na
       return false;
     }
 
-    if (!loadFromCachedBinary ||  (suffix_mode_path == "dlc")) { //issue#23
+    // A DLC is composed and finalized once per key (content, backend build, device config), later loads take the
+    // context saved in the cache. sg_contextCacheDir "None" turns the cache off.
+    std::string contextCacheEntry;
+    bool contextCacheHit = false;
+    if (suffix_mode_path == "dlc" && sg_contextCacheDir != "None") {
+      const std::string deviceConfig = "device=" + std::to_string(deviceID) + ";cores=" + coreIdsStr;
+      sample_app::context_cache::Key key;
+      if (sample_app::context_cache::contextKey(cachedBinaryPath, app->getBackendBuildId(), deviceConfig, key)) {
+        contextCacheEntry = sample_app::context_cache::entryPath(sg_contextCacheDir, cachedBinaryPath, key);
+        contextCacheHit   = sample_app::context_cache::findEntry(contextCacheEntry);
+        app->setContextCacheEntry(contextCacheEntry, contextCacheHit);
+      }
+    }
+    if (contextCacheHit) {
+      QNN_INFO("Loading %s from context cache entry %s\n", cachedBinaryPath.c_str(), contextCacheEntry.c_str());
+      if (sample_app::StatusCode::SUCCESS != app->createFromBinary()) {
+        // e.g. a damaged entry: compose the DLC and save it again.
+        QNN_WAR("Context cache entry %s failed to load, composing %s\n", contextCacheEntry.c_str(), cachedBinaryPath.c_str());
+        app->discardContext();
+        sample_app::context_cache::removeEntry(contextCacheEntry);
+        app->setContextCacheEntry(contextCacheEntry, false);
+        contextCacheHit = false;
+      }
+    }
+
+    if (contextCacheHit) {
+      // loaded from the cache.
+    } else if (!loadFromCachedBinary ||  (suffix_mode_path == "dlc")) { //issue#23
       if (sample_app::StatusCode::SUCCESS != app->createContext()) {
         app->reportError("Context Creation failure");
         return false;
@@ -538,9 +751,12 @@ bool ModelInitializeEx(const std::string& model_name, const std::string& proc_na
         return false;
       }
     }
+    if (!contextCacheEntry.empty()) {
+      sample_app::context_cache::evict(contextCacheEntry, sg_contextCacheMaxBytes);
+    }
 
     // improve performance.
-    if (sample_app::StatusCode::SUCCESS != app->setupInputAndOutputTensors()) {
+    if (sample_app::StatusCode::SUCCESS != app->setupInputAndOutputTensors(sg_tensorSets)) {
       app->reportError("Setup Input and Output Tensors failure");
       return false;
     }
@@ -560,7 +776,12 @@ bool ModelInitializeEx(const std::string& model_name, const std::string& proc_na
 
     timerHelper.Print("model_initialize " + model_name);
 
-    sg_model_map.insert(std::make_pair(model_name, std::move(app)));
+    entry->app = std::move(app);
+    std::lock_guard<std::mutex> lk(sg_model_map_lock);
+    if (!sg_model_map.emplace(model_name, std::move(entry)).second) {
+      QNN_ERR("A model named %s is already initialized\n", model_name.c_str());
+      return false;
+    }
 
     return true;
   }
@@ -586,19 +807,13 @@ bool ModelInferenceEx(std::string model_name, std::string proc_name, std::string
 
     TimerHelper timerHelper;
 
-    std::unique_ptr<sample_app::QnnSampleApp> app = getQnnSampleApp(model_name);
-
-    if (result && nullptr == app) {
-        app->reportError("Inference failure");
-        result = false;
-    }
-
-    if (result && sample_app::StatusCode::SUCCESS != app->executeGraphsBuffers(inputBuffers, outputBuffers, outputSize, perfProfile, graphIndex, share_memory_size)) {
-        app->reportError("Graph Execution failure");
-        result = false;
-    }
-
-    sg_model_map.insert(std::make_pair(model_name, std::move(app)));
+    result = withModel<bool, std::shared_lock<std::shared_mutex>>(model_name, [&](sample_app::QnnSampleApp& app) {
+        if (sample_app::StatusCode::SUCCESS != app.executeGraphsBuffers(inputBuffers, outputBuffers, outputSize, perfProfile, graphIndex, share_memory_size)) {
+            app.reportError("Graph Execution failure");
+            return false;
+        }
+        return true;
+    });
 
     timerHelper.Print("model_inference " + model_name);
 
@@ -620,12 +835,16 @@ bool ModelDestroyEx(std::string model_name, std::string proc_name) {
 
     TimerHelper timerHelper;
 
-    std::unique_ptr<sample_app::QnnSampleApp> app = getQnnSampleApp(model_name);
-    if (nullptr == app) {
-        app->reportError("Can't find the model with model_name: " + model_name);
+    std::shared_ptr<ModelEntry> entry = takeModel(model_name);
+    if (nullptr == entry) {
+        QNN_ERR("Can't find the model with model_name: %s\n", model_name.c_str());
         return false;
     }
 
+    // wait for the calls still running on the model.
+    std::lock_guard<std::shared_mutex> lk(entry->lock);
+    std::unique_ptr<sample_app::QnnSampleApp> app = std::move(entry->app);
+
     // improve performance.
     if (sample_app::StatusCode::SUCCESS != app->tearDownInputAndOutputTensors()) {
         app->reportError("Input and Output Tensors destroy failure");
@@ -709,31 +928,38 @@ bool LibAppBuilder::ModelInference(std::string model_name, std::vector<uint8_t*>
     return ModelInferenceEx(model_name, "", "", inputBuffers, inputSize, outputBuffers, outputSize, perfProfile, graphIndex, share_memory_size);
 }
 
-bool LibAppBuilder::ModelApplyBinaryUpdate(const std::string model_name, std::vector<LoraAdapter>& lora_adapters) {
-    bool result = true;
-    std::unique_ptr<sample_app::QnnSampleApp> app = getQnnSampleApp(model_name);
-    if (nullptr == app) {
-        app->reportError("Apply binary update failure: " + model_name);
-        result = false;
-    }
-    
-    if (result) {
-        app->update_m_lora_adapters(lora_adapters);
-
-        QNN_INFO("Applying Binary update on the graph");
+bool LibAppBuilder::ModelInferenceInto(std::string model_name, std::vector<uint8_t*>& inputBuffers, const std::vector<size_t>& inputSize,
+                                       std::vector<uint8_t*>& outputBuffers, std::vector<size_t>& outputSize,
+                                       std::string& perfProfile, size_t graphIndex) {
+    TimerHelper timerHelper;
 
-        if (sample_app::StatusCode::SUCCESS != app->contextApplyBinarySection(QNN_CONTEXT_SECTION_UPDATABLE)) {
-            app->reportError("Binary update failure");
-            result = false;
+    bool result = withModel<bool, std::shared_lock<std::shared_mutex>>(model_name, [&](sample_app::QnnSampleApp& app) {
+        if (sample_app::StatusCode::SUCCESS != app.executeGraphsBuffers(inputBuffers, outputBuffers, outputSize, perfProfile, graphIndex, 0, true, &inputSize)) {
+            app.reportError("Graph Execution failure");
+            return false;
         }
-    
-    }
+        return true;
+    });
 
-    sg_model_map.insert(std::make_pair(model_name, std::move(app)));
+    timerHelper.Print("model_inference " + model_name);
 
     return result;
 }
 
+bool LibAppBuilder::ModelApplyBinaryUpdate(const std::string model_name, std::vector<LoraAdapter>& lora_adapters) {
+    return withModel<bool>(model_name, [&](sample_app::QnnSampleApp& app) {
+        app.update_m_lora_adapters(lora_adapters);
+
+        QNN_INFO("Applying Binary update on the graph");
+
+        if (sample_app::StatusCode::SUCCESS != app.contextApplyBinarySection(QNN_CONTEXT_SECTION_UPDATABLE)) {
+            app.reportError("Binary update failure");
+            return false;
+        }
+        return true;
+    });
+}
+
 bool LibAppBuilder::ModelDestroy(std::string model_name, std::string proc_name) {
 #ifdef _WIN32
     if (!proc_name.empty()) {   // If proc_name, desctroy the model in that process.
@@ -765,52 +991,31 @@ bool LibAppBuilder::DeleteShareMemory(std::string share_memory_name) {
 
 // issue#24
 std::vector<std::vector<size_t>> LibAppBuilder::getOutputShapes(std::string model_name){
-    std::unique_ptr<sample_app::QnnSampleApp> app = getQnnSampleApp(model_name);
-    m_outputShapes = app->getOutputShapes();
-    sg_model_map.insert(std::make_pair(model_name, std::move(app)));
-    return m_outputShapes;
+    return withModel<std::vector<std::vector<size_t>>>(model_name, [](sample_app::QnnSampleApp& app) { return app.getOutputShapes(); });
 };
 
 std::vector<std::vector<size_t>> LibAppBuilder::getInputShapes(std::string model_name){
-    std::unique_ptr<sample_app::QnnSampleApp> app = getQnnSampleApp(model_name);
-    m_inputShapes = app->getInputShapes();
-    sg_model_map.insert(std::make_pair(model_name, std::move(app)));
-    return m_inputShapes;
+    return withModel<std::vector<std::vector<size_t>>>(model_name, [](sample_app::QnnSampleApp& app) { return app.getInputShapes(); });
 };
 
 std::vector<std::string> LibAppBuilder::getInputDataType(std::string model_name){
-    std::unique_ptr<sample_app::QnnSampleApp> app = getQnnSampleApp(model_name);
-    m_inputDataType = app->getInputDataType();
-    sg_model_map.insert(std::make_pair(model_name, std::move(app)));
-    return m_inputDataType;
+    return withModel<std::vector<std::string>>(model_name, [](sample_app::QnnSampleApp& app) { return app.getInputDataType(); });
 };
 
 std::vector<std::string> LibAppBuilder::getOutputDataType(std::string model_name){
-    std::unique_ptr<sample_app::QnnSampleApp> app = getQnnSampleApp(model_name);
-    m_outputDataType = app->getOutputDataType();
-    sg_model_map.insert(std::make_pair(model_name, std::move(app)));
-    return m_outputDataType;
+    return withModel<std::vector<std::string>>(model_name, [](sample_app::QnnSampleApp& app) { return app.getOutputDataType(); });
 };
 
 std::string LibAppBuilder::getGraphName(std::string model_name){
-    std::unique_ptr<sample_app::QnnSampleApp> app = getQnnSampleApp(model_name);
-    m_graphName = app->getGraphName();
-    sg_model_map.insert(std::make_pair(model_name, std::move(app)));
-    return m_graphName;
+    return withModel<std::string>(model_name, [](sample_app::QnnSampleApp& app) { return app.getGraphName(); });
 };
 
 std::vector<std::string> LibAppBuilder::getInputName(std::string model_name){
-    std::unique_ptr<sample_app::QnnSampleApp> app = getQnnSampleApp(model_name);
-    m_inputName = app->getInputName();
-    sg_model_map.insert(std::make_pair(model_name, std::move(app)));
-    return m_inputName;
+    return withModel<std::vector<std::string>>(model_name, [](sample_app::QnnSampleApp& app) { return app.getInputName(); });
 };
 
 std::vector<std::string> LibAppBuilder::getOutputName(std::string model_name){
-    std::unique_ptr<sample_app::QnnSampleApp> app = getQnnSampleApp(model_name);
-    m_outputName = app->getOutputName();
-    sg_model_map.insert(std::make_pair(model_name, std::move(app)));
-    return m_outputName;
+    return withModel<std::vector<std::string>>(model_name, [](sample_app::QnnSampleApp& app) { return app.getOutputName(); });
 };
 //proc
 std::vector<std::vector<size_t>> LibAppBuilder::getOutputShapes(std::string model_name, std::string proc_name){
@@ -863,46 +1068,41 @@ ModelInfo_t LibAppBuilder::getModelInfo(std::string model_name, std::string inpu
     return getModelInfoExt(model_name, input);
 }
 ModelInfo_t LibAppBuilder::getModelInfoExt(std::string model_name, std::string input) {
-    bool result = true;
-    ModelInfo_t info;
-
-    std::unique_ptr<sample_app::QnnSampleApp> app = getQnnSampleApp(model_name);
-    if (nullptr == app) {
-        app->reportError("getModelInfoExt failure");
-        result = false;
-    }
-    if(result){
+    return withModel<ModelInfo_t>(model_name, [&](sample_app::QnnSampleApp& app) {
+        ModelInfo_t info;
         if (input == "is") {
-            info.inputShapes = app->getInputShapes();
+            info.inputShapes = app.getInputShapes();
         } else if (input == "id") {
-            info.inputDataType = app->getInputDataType();
+            info.inputDataType = app.getInputDataType();
         } else if (input == "os") {
-            info.outputShapes = app->getOutputShapes();
+            info.outputShapes = app.getOutputShapes();
         } else if (input == "od") {
-            info.outputDataType = app->getOutputDataType();
+            info.outputDataType = app.getOutputDataType();
         } else if (input == "in") {
-            info.inputName = app->getInputName();
+            info.inputName = app.getInputName();
         } else if (input == "on") {
-            info.outputName = app->getOutputName();
+            info.outputName = app.getOutputName();
         } else if (input == "gn") {
-            info.graphName = app->getGraphName();
+            info.graphName = app.getGraphName();
         } else {
             printf("wrong input in LibAppBuilder::getModelInfoExt: %s\n", input.c_str());
-            app->reportError("getModelInfoExt failure");
-            return info;
+            app.reportError("getModelInfoExt failure");
         }
-    }
-    sg_model_map.insert(std::make_pair(model_name, std::move(app)));
-
-    return info;
+        return info;
+    });
 }
 
 uint64_t LibAppBuilder::getProfilingEvent(std::string model_name, uint32_t eventType){
-    uint64_t eventValue;
-    std::unique_ptr<sample_app::QnnSampleApp> app = getQnnSampleApp(model_name);
-    eventValue = app->getProfilingEvent(eventType);
-    sg_model_map.insert(std::make_pair(model_name, std::move(app)));
-    return eventValue;
+    return withModel<uint64_t>(model_name, [&](sample_app::QnnSampleApp& app) { return app.getProfilingEvent(eventType); });
+}
+
+// Inferences keep running meanwhile, the graphs they use are not released.
+size_t LibAppBuilder::ModelReleaseIdleTensors(std::string model_name){
+    return withModel<size_t, std::shared_lock<std::shared_mutex>>(model_name, [](sample_app::QnnSampleApp& app) { return app.releaseIdleTensors(); });
+}
+
+std::vector<size_t> LibAppBuilder::getGraphResidentBytes(std::string model_name){
+    return withModel<std::vector<size_t>, std::shared_lock<std::shared_mutex>>(model_name, [](sample_app::QnnSampleApp& app) { return app.getGraphResidentBytes(); });
 }
 
 int main(int argc, char** argv) {
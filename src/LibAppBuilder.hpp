@@ -30,6 +30,17 @@ extern "C" LIBAPPBUILDER_API void QNN_VEB(const char* fmt, ...);
 extern "C" LIBAPPBUILDER_API void QNN_DBG(const char* fmt, ...);
 extern "C" LIBAPPBUILDER_API bool SetLogLevel(int32_t log_level, const std::string log_path = "None");
 extern "C" LIBAPPBUILDER_API bool SetProfilingLevel(int32_t profiling_level);
+// I/O tensor sets per graph of the models initialized from now on, 1 by default. With N sets, N inferences
+// on one model from different threads overlap their input / output conversion with each other's execution.
+extern "C" LIBAPPBUILDER_API bool SetTensorSets(int32_t tensor_sets);
+// Lazy graphs for the models initialized from now on, off by default. A context binary is only parsed at
+// initialization, its context is created by the first inference and the I/O tensors of a graph on its first use.
+extern "C" LIBAPPBUILDER_API bool SetLazyGraphs(bool lazy_graphs);
+// Cache of the compiled contexts of *.dlc models. The first initialization of a DLC composes and finalizes it and
+// saves the context in cache_dir (next to the DLC if empty, "None" for no cache), later ones load the context
+// like a *.bin. An entry is keyed by the DLC content, the backend build id and the device config, entries that
+// can't hit anymore are removed, then the least recently used ones beyond max_bytes (0 for no limit).
+extern "C" LIBAPPBUILDER_API bool SetContextCache(const std::string& cache_dir, uint64_t max_bytes = 0);
 extern "C" LIBAPPBUILDER_API bool SetPerfProfileGlobal(const std::string& perf_profile);
 extern "C" LIBAPPBUILDER_API bool RelPerfProfileGlobal();
 
@@ -74,6 +85,13 @@ public:
                         std::vector<uint8_t*>& outputBuffers, std::vector<size_t>& outputSize,
                         std::string& perfProfile, size_t graphIndex = 0);
 
+    // Like ModelInference, but the outputs are written into outputBuffers, one caller buffer per output
+    // whose capacity in bytes is in outputSize. outputSize gets the bytes written. inputSize holds the
+    // capacity of each input buffer, a buffer smaller than its tensor of the graph fails the call.
+    bool ModelInferenceInto(std::string model_name, std::vector<uint8_t*>& inputBuffers, const std::vector<size_t>& inputSize,
+                            std::vector<uint8_t*>& outputBuffers, std::vector<size_t>& outputSize,
+                            std::string& perfProfile, size_t graphIndex = 0);
+
     bool ModelApplyBinaryUpdate(const std::string model_name, std::vector<LoraAdapter>& lora_adapters);
 
     bool ModelDestroy(std::string model_name);
@@ -103,6 +121,12 @@ public:
     ModelInfo_t getModelInfoExt(std::string model_name, std::string input);  
     uint64_t getProfilingEvent(std::string model_name, uint32_t eventType);
 
+    // Frees the I/O tensors of the graphs no inference is running on, e.g. under memory pressure. They are set
+    // up again by the next inference on the graph. Returns the host bytes freed.
+    size_t ModelReleaseIdleTensors(std::string model_name);
+    // Host bytes of the I/O tensors per graph, 0 for the graphs not used yet or released.
+    std::vector<size_t> getGraphResidentBytes(std::string model_name);
+
     std::vector<std::vector<size_t>> m_inputShapes;
     std::vector<std::string> m_inputDataType;
     std::vector<std::vector<size_t>> m_outputShapes;
@@ -0,0 +1,753 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+/*
+ * A QNN backend without hardware, for measuring the host side of an inference (tensor conversion, copies,
+ * locking, logging) on any Linux box. The library exports both QnnInterface_getProviders and
+ * QnnSystemInterface_getProviders, so it is passed as backend and as system library alike.
+ *
+ * Only the context binary path is implemented: the "context binary" is a text file which describes the
+ * graphs, one directive per line ('#' starts a comment):
+ *   qnn_mock 1
+ *   execute_us <microseconds>      simulated time of one graphExecute, 0 by default
+ *   vote_us <microseconds>         simulated time of one setPowerConfig, 0 by default
+ *   fill_outputs <0|1>             write a fixed pattern into the outputs, 1 by default
+ *   profile_event <type> <value> [identifier]
+ *                                  an event reported after each execute, QnnProfile_EventType_t values.
+ *                                  Without any, EXECUTE is reported with execute_us.
+ *   graph <name>
+ *   input <name> <dtype> <d0,d1,...> [scale offset]
+ *   output <name> <dtype> <d0,d1,...> [scale offset]
+ * dtype is one of float32, float16, ufixed8, ufixed16, uint8, int8, uint16, int16, uint32, int32, int64,
+ * bool8. graphExecute checks the tensors it gets against the description, waits execute_us and leaves the
+ * outputs filled.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HTP/QnnHtpDevice.h"
+#include "QnnInterface.h"
+#include "QnnTypeMacros.hpp"
+#include "System/QnnSystemInterface.h"
+
+#if defined(_WIN32)
+#define QNN_MOCK_API __declspec(dllexport)
+#else
+#define QNN_MOCK_API __attribute__((visibility("default")))
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct MockDataType {
+  const char* name;
+  Qnn_DataType_t type;
+  size_t bytes;
+  bool quantized;
+};
+
+const MockDataType kDataTypes[] = {
+    {"float32", QNN_DATATYPE_FLOAT_32, 4, false},
+    {"float16", QNN_DATATYPE_FLOAT_16, 2, false},
+    {"ufixed8", QNN_DATATYPE_UFIXED_POINT_8, 1, true},
+    {"ufixed16", QNN_DATATYPE_UFIXED_POINT_16, 2, true},
+    {"uint8", QNN_DATATYPE_UINT_8, 1, false},
+    {"int8", QNN_DATATYPE_INT_8, 1, false},
+    {"uint16", QNN_DATATYPE_UINT_16, 2, false},
+    {"int16", QNN_DATATYPE_INT_16, 2, false},
+    {"uint32", QNN_DATATYPE_UINT_32, 4, false},
+    {"int32", QNN_DATATYPE_INT_32, 4, false},
+    {"int64", QNN_DATATYPE_INT_64, 8, false},
+    {"bool8", QNN_DATATYPE_BOOL_8, 1, false},
+};
+
+struct MockTensor {
+  std::string name;
+  const MockDataType* dataType = nullptr;
+  std::vector<uint32_t> dimensions;
+  float scale    = 0.0f;
+  int32_t offset = 0;
+  size_t bytes   = 0;
+  std::vector<uint8_t> pattern;  // outputs only, what an execute leaves in the buffer
+};
+
+struct MockModel;
+
+struct MockGraph {
+  std::string name;
+  std::vector<MockTensor> inputs;
+  std::vector<MockTensor> outputs;
+  const MockModel* model = nullptr;
+};
+
+struct MockEvent {
+  QnnProfile_EventType_t type;
+  uint64_t value;
+  std::string identifier;
+};
+
+struct MockModel {
+  uint64_t executeUs = 0;
+  uint64_t voteUs    = 0;
+  bool fillOutputs   = true;
+  std::vector<MockEvent> events;
+  std::vector<MockGraph> graphs;
+  std::string text;  // the binary, handed back by contextGetBinary
+};
+
+struct MockContext {
+  MockModel model;
+};
+
+struct MockSystemContext {
+  MockModel model;
+  std::vector<std::vector<Qnn_Tensor_t>> inputs;
+  std::vector<std::vector<Qnn_Tensor_t>> outputs;
+  std::vector<QnnSystemContext_GraphInfo_t> graphs;
+  QnnSystemContext_BinaryInfo_t binaryInfo;
+};
+
+// The events of the last execute (or context creation), replaced by the next one. An event id is the
+// address of its data, valid until then like the ids of a real backend.
+struct MockProfile {
+  QnnProfile_Level_t level;
+  std::mutex lock;
+  std::vector<QnnProfile_EventData_t> data;
+  std::vector<std::string> identifiers;
+  std::vector<QnnProfile_EventId_t> ids;
+};
+
+struct MockLog {
+  QnnLog_Callback_t callback;
+  QnnLog_Level_t level;
+};
+
+std::atomic<uint32_t> sg_nextPowerConfigId{1};
+std::atomic<uint64_t> sg_powerConfigVotes{0};
+// vote_us of the first model loaded, the perf infrastructure is process wide like the real one.
+std::atomic<uint64_t> sg_voteUs{0};
+
+// sleep most of the way, spin the rest: a sleep alone overshoots by the scheduler tick.
+void waitUntil(Clock::time_point deadline) {
+  const auto slack = std::chrono::microseconds(100);
+  auto now         = Clock::now();
+  if (deadline - now > slack) {
+    std::this_thread::sleep_for(deadline - now - slack);
+  }
+  while (Clock::now() < deadline) {
+  }
+}
+
+const MockDataType* findDataType(const std::string& name) {
+  for (const auto& type : kDataTypes) {
+    if (name == type.name) {
+      return &type;
+    }
+  }
+  return nullptr;
+}
+
+// Valid data for the type, so the float conversions of the app take their common path.
+void makePattern(MockTensor& tensor, std::mt19937& rng) {
+  tensor.pattern.resize(tensor.bytes);
+  std::uniform_int_distribution<uint32_t> bits;
+  const size_t elements = tensor.bytes / tensor.dataType->bytes;
+  for (size_t i = 0; i < elements; i++) {
+    uint8_t* p = tensor.pattern.data() + i * tensor.dataType->bytes;
+    if (tensor.dataType->type == QNN_DATATYPE_FLOAT_32) {
+      const float f = static_cast<float>(bits(rng) % 2001) / 1000.0f - 1.0f;
+      std::memcpy(p, &f, sizeof(f));
+    } else if (tensor.dataType->type == QNN_DATATYPE_FLOAT_16) {
+      const uint16_t h = static_cast<uint16_t>((bits(rng) & 0x83ffu) | 0x3800u);  // +-[0.5, 1)
+      std::memcpy(p, &h, sizeof(h));
+    } else if (tensor.dataType->type == QNN_DATATYPE_BOOL_8) {
+      *p = static_cast<uint8_t>(bits(rng) & 1u);
+    } else {
+      const uint64_t v = (static_cast<uint64_t>(bits(rng)) << 32) | bits(rng);
+      std::memcpy(p, &v, tensor.dataType->bytes);
+    }
+  }
+}
+
+bool parseTensor(std::istringstream& line, MockTensor& tensor) {
+  std::string dataType, dimensions;
+  if (!(line >> tensor.name >> dataType >> dimensions)) {
+    return false;
+  }
+  tensor.dataType = findDataType(dataType);
+  if (nullptr == tensor.dataType) {
+    return false;
+  }
+  std::istringstream dims(dimensions);
+  std::string dim;
+  size_t elements = 1;
+  while (std::getline(dims, dim, ',')) {
+    const uint32_t value = static_cast<uint32_t>(std::strtoul(dim.c_str(), nullptr, 10));
+    if (0 == value) {
+      return false;
+    }
+    tensor.dimensions.push_back(value);
+    elements *= value;
+  }
+  if (tensor.dimensions.empty()) {
+    return false;
+  }
+  tensor.bytes = elements * tensor.dataType->bytes;
+  if (tensor.dataType->quantized) {
+    tensor.scale  = 1.0f / 255.0f;
+    tensor.offset = 0;
+    line >> tensor.scale >> tensor.offset;
+  }
+  return true;
+}
+
+bool parseModel(const void* buffer, uint64_t size, MockModel& model) {
+  if (nullptr == buffer || 0 == size) {
+    return false;
+  }
+  model.text.assign(static_cast<const char*>(buffer), static_cast<size_t>(size));
+  std::istringstream text(model.text);
+  std::string line;
+  bool haveMagic = false;
+  while (std::getline(text, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    std::string directive;
+    if (!(fields >> directive)) {
+      continue;
+    }
+    if (!haveMagic) {
+      int version = 0;
+      if (directive != "qnn_mock" || !(fields >> version) || version != 1) {
+        return false;
+      }
+      haveMagic = true;
+    } else if (directive == "execute_us") {
+      fields >> model.executeUs;
+    } else if (directive == "vote_us") {
+      fields >> model.voteUs;
+    } else if (directive == "fill_outputs") {
+      fields >> model.fillOutputs;
+    } else if (directive == "profile_event") {
+      MockEvent event{};
+      uint32_t type = 0;
+      if (!(fields >> type >> event.value)) {
+        return false;
+      }
+      event.type = type;
+      fields >> event.identifier;
+      model.events.push_back(event);
+    } else if (directive == "graph") {
+      model.graphs.emplace_back();
+      if (!(fields >> model.graphs.back().name)) {
+        return false;
+      }
+    } else if (directive == "input" || directive == "output") {
+      if (model.graphs.empty()) {
+        return false;
+      }
+      auto& tensors = directive == "input" ? model.graphs.back().inputs : model.graphs.back().outputs;
+      tensors.emplace_back();
+      if (!parseTensor(fields, tensors.back())) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  if (!haveMagic || model.graphs.empty()) {
+    return false;
+  }
+  if (model.events.empty()) {
+    model.events.push_back({QNN_PROFILE_EVENTTYPE_EXECUTE, model.executeUs, "EXECUTE"});
+  }
+  std::mt19937 rng{7};
+  for (auto& graph : model.graphs) {
+    graph.model = &model;
+    for (auto& output : graph.outputs) {
+      makePattern(output, rng);
+    }
+  }
+  return true;
+}
+
+Qnn_Tensor_t describeTensor(const MockTensor& tensor, Qnn_TensorType_t type) {
+  Qnn_Tensor_t description = QNN_TENSOR_INIT;
+  setQnnTensorName(description, tensor.name.c_str());
+  setQnnTensorType(description, type);
+  setQnnTensorDataType(description, tensor.dataType->type);
+  Qnn_QuantizeParams_t quantizeParams = QNN_QUANTIZE_PARAMS_INIT;
+  if (tensor.dataType->quantized) {
+    quantizeParams.encodingDefinition         = QNN_DEFINITION_DEFINED;
+    quantizeParams.quantizationEncoding       = QNN_QUANTIZATION_ENCODING_SCALE_OFFSET;
+    quantizeParams.scaleOffsetEncoding.scale  = tensor.scale;
+    quantizeParams.scaleOffsetEncoding.offset = tensor.offset;
+  }
+  setQnnTensorQuantParams(description, quantizeParams);
+  setQnnTensorRank(description, static_cast<uint32_t>(tensor.dimensions.size()));
+  setQnnTensorDimensions(description, const_cast<uint32_t*>(tensor.dimensions.data()));
+  setQnnTensorMemType(description, QNN_TENSORMEMTYPE_RAW);
+  return description;
+}
+
+void recordEvents(Qnn_ProfileHandle_t profileHandle, const std::vector<MockEvent>& events) {
+  if (nullptr == profileHandle) {
+    return;
+  }
+  auto profile = reinterpret_cast<MockProfile*>(profileHandle);
+  std::lock_guard<std::mutex> lock(profile->lock);
+  profile->data.resize(events.size());
+  profile->identifiers.resize(events.size());
+  profile->ids.resize(events.size());
+  for (size_t i = 0; i < events.size(); i++) {
+    profile->identifiers[i] = events[i].identifier;
+    auto& data              = profile->data[i];
+    data.type               = events[i].type;
+    data.value              = events[i].value;
+    data.identifier         = profile->identifiers[i].c_str();
+    data.unit               = QNN_PROFILE_EVENTUNIT_MICROSEC;
+    profile->ids[i]         = reinterpret_cast<QnnProfile_EventId_t>(&data);
+  }
+}
+
+bool checkTensors(const std::vector<MockTensor>& expected, const Qnn_Tensor_t* tensors, uint32_t count) {
+  if (count != expected.size() || (count > 0 && nullptr == tensors)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    const Qnn_ClientBuffer_t buffer = getQnnTensorClientBuf(tensors[i]);
+    if (nullptr == buffer.data || buffer.dataSize < expected[i].bytes) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// ---- QnnInterface ----
+
+Qnn_ErrorHandle_t mockPropertyHasCapability(QnnProperty_Key_t key) {
+  return key == QNN_PROPERTY_GROUP_DEVICE ? QNN_PROPERTY_SUPPORTED : QNN_PROPERTY_NOT_SUPPORTED;
+}
+
+Qnn_ErrorHandle_t mockBackendCreate(Qnn_LogHandle_t,
+                                    const QnnBackend_Config_t**,
+                                    Qnn_BackendHandle_t* backend) {
+  static int backendInstance;
+  if (nullptr == backend) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  *backend = reinterpret_cast<Qnn_BackendHandle_t>(&backendInstance);
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockBackendFree(Qnn_BackendHandle_t) { return QNN_SUCCESS; }
+
+Qnn_ErrorHandle_t mockBackendGetBuildId(const char** id) {
+  if (nullptr == id) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  *id = "qnn-mock-backend";
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockLogCreate(QnnLog_Callback_t callback,
+                                QnnLog_Level_t maxLogLevel,
+                                Qnn_LogHandle_t* logger) {
+  if (nullptr == logger) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  *logger = reinterpret_cast<Qnn_LogHandle_t>(new MockLog{callback, maxLogLevel});
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockLogSetLogLevel(Qnn_LogHandle_t logger, QnnLog_Level_t maxLogLevel) {
+  if (nullptr == logger) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  reinterpret_cast<MockLog*>(logger)->level = maxLogLevel;
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockLogFree(Qnn_LogHandle_t logger) {
+  delete reinterpret_cast<MockLog*>(logger);
+  return QNN_SUCCESS;
+}
+
+// One device with four cores, enough for every deviceID 0 / coreIds the app accepts.
+Qnn_ErrorHandle_t mockDeviceGetPlatformInfo(Qnn_LogHandle_t, const QnnDevice_PlatformInfo_t** platformInfo) {
+  static QnnDevice_CoreInfo_t cores[4];
+  static QnnDevice_HardwareDeviceInfo_t device;
+  static QnnDevice_PlatformInfo_t platform;
+  static std::once_flag once;
+  if (nullptr == platformInfo) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  std::call_once(once, []() {
+    for (uint32_t i = 0; i < 4; i++) {
+      cores[i].version     = QNN_DEVICE_CORE_INFO_VERSION_1;
+      cores[i].v1.coreId   = i;
+      cores[i].v1.coreType = 0;
+    }
+    device.version           = QNN_DEVICE_HARDWARE_DEVICE_INFO_VERSION_1;
+    device.v1.deviceId       = 0;
+    device.v1.deviceType     = 0;
+    device.v1.numCores       = 4;
+    device.v1.cores          = cores;
+    platform.version         = QNN_DEVICE_PLATFORM_INFO_VERSION_1;
+    platform.v1.numHwDevices = 1;
+    platform.v1.hwDevices    = &device;
+  });
+  *platformInfo = &platform;
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockDeviceFreePlatformInfo(Qnn_LogHandle_t, const QnnDevice_PlatformInfo_t*) {
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockDeviceCreate(Qnn_LogHandle_t,
+                                   const QnnDevice_Config_t**,
+                                   Qnn_DeviceHandle_t* device) {
+  static int deviceInstance;
+  if (nullptr == device) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  *device = reinterpret_cast<Qnn_DeviceHandle_t>(&deviceInstance);
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockDeviceFree(Qnn_DeviceHandle_t) { return QNN_SUCCESS; }
+
+Qnn_ErrorHandle_t mockCreatePowerConfigId(uint32_t, uint32_t, uint32_t* powerConfigId) {
+  if (nullptr == powerConfigId) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  *powerConfigId = sg_nextPowerConfigId++;
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockDestroyPowerConfigId(uint32_t) { return QNN_SUCCESS; }
+
+Qnn_ErrorHandle_t mockSetPowerConfig(uint32_t, const QnnHtpPerfInfrastructure_PowerConfig_t** config) {
+  if (nullptr == config) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  sg_powerConfigVotes++;
+  waitUntil(Clock::now() + std::chrono::microseconds(sg_voteUs.load()));
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockDeviceGetInfrastructure(const QnnDevice_Infrastructure_t* deviceInfra) {
+  static QnnHtpDevice_Infrastructure_t infrastructure;
+  static std::once_flag once;
+  if (nullptr == deviceInfra) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  std::call_once(once, []() {
+    infrastructure.infraType                      = QNN_HTP_DEVICE_INFRASTRUCTURE_TYPE_PERF;
+    infrastructure.perfInfra.createPowerConfigId  = mockCreatePowerConfigId;
+    infrastructure.perfInfra.destroyPowerConfigId = mockDestroyPowerConfigId;
+    infrastructure.perfInfra.setPowerConfig       = mockSetPowerConfig;
+  });
+  *const_cast<QnnDevice_Infrastructure_t*>(deviceInfra) = &infrastructure;
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockContextCreate(Qnn_BackendHandle_t,
+                                    Qnn_DeviceHandle_t,
+                                    const QnnContext_Config_t**,
+                                    Qnn_ContextHandle_t*) {
+  return QNN_COMMON_ERROR_NOT_SUPPORTED;  // graphs only come from a context binary
+}
+
+Qnn_ErrorHandle_t mockContextCreateFromBinary(Qnn_BackendHandle_t,
+                                              Qnn_DeviceHandle_t,
+                                              const QnnContext_Config_t**,
+                                              const void* binaryBuffer,
+                                              Qnn_ContextBinarySize_t binaryBufferSize,
+                                              Qnn_ContextHandle_t* context,
+                                              Qnn_ProfileHandle_t profile) {
+  if (nullptr == context) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  const auto begin = Clock::now();
+  auto mockContext = new MockContext;
+  if (!parseModel(binaryBuffer, binaryBufferSize, mockContext->model)) {
+    delete mockContext;
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  uint64_t expected = 0;
+  sg_voteUs.compare_exchange_strong(expected, mockContext->model.voteUs);
+  const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - begin);
+  recordEvents(profile, {{QNN_PROFILE_EVENTTYPE_INIT, static_cast<uint64_t>(elapsed.count()), "INIT"}});
+  *context = reinterpret_cast<Qnn_ContextHandle_t>(mockContext);
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockContextGetBinarySize(Qnn_ContextHandle_t context,
+                                           Qnn_ContextBinarySize_t* binaryBufferSize) {
+  if (nullptr == context || nullptr == binaryBufferSize) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  *binaryBufferSize = reinterpret_cast<MockContext*>(context)->model.text.size();
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockContextGetBinary(Qnn_ContextHandle_t context,
+                                       void* binaryBuffer,
+                                       Qnn_ContextBinarySize_t binaryBufferSize,
+                                       Qnn_ContextBinarySize_t* writtenBufferSize) {
+  if (nullptr == context || nullptr == binaryBuffer || nullptr == writtenBufferSize) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  const std::string& text = reinterpret_cast<MockContext*>(context)->model.text;
+  if (binaryBufferSize < text.size()) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  std::memcpy(binaryBuffer, text.data(), text.size());
+  *writtenBufferSize = text.size();
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockContextFree(Qnn_ContextHandle_t context, Qnn_ProfileHandle_t) {
+  delete reinterpret_cast<MockContext*>(context);
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockGraphRetrieve(Qnn_ContextHandle_t context,
+                                    const char* graphName,
+                                    Qnn_GraphHandle_t* graph) {
+  if (nullptr == context || nullptr == graphName || nullptr == graph) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  for (auto& mockGraph : reinterpret_cast<MockContext*>(context)->model.graphs) {
+    if (mockGraph.name == graphName) {
+      *graph = reinterpret_cast<Qnn_GraphHandle_t>(&mockGraph);
+      return QNN_SUCCESS;
+    }
+  }
+  return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+}
+
+Qnn_ErrorHandle_t mockGraphExecute(Qnn_GraphHandle_t graph,
+                                   const Qnn_Tensor_t* inputs,
+                                   uint32_t numInputs,
+                                   Qnn_Tensor_t* outputs,
+                                   uint32_t numOutputs,
+                                   Qnn_ProfileHandle_t profile,
+                                   Qnn_SignalHandle_t) {
+  const auto begin = Clock::now();
+  auto mockGraph   = reinterpret_cast<const MockGraph*>(graph);
+  if (nullptr == mockGraph || !checkTensors(mockGraph->inputs, inputs, numInputs) ||
+      !checkTensors(mockGraph->outputs, outputs, numOutputs)) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  const MockModel& model = *mockGraph->model;
+  if (model.fillOutputs) {
+    for (uint32_t i = 0; i < numOutputs; i++) {
+      const auto& pattern = mockGraph->outputs[i].pattern;
+      std::memcpy(getQnnTensorClientBuf(outputs[i]).data, pattern.data(), pattern.size());
+    }
+  }
+  waitUntil(begin + std::chrono::microseconds(model.executeUs));
+  recordEvents(profile, model.events);
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockProfileCreate(Qnn_BackendHandle_t,
+                                    QnnProfile_Level_t level,
+                                    Qnn_ProfileHandle_t* profile) {
+  if (nullptr == profile) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  auto mockProfile   = new MockProfile;
+  mockProfile->level = level;
+  *profile           = reinterpret_cast<Qnn_ProfileHandle_t>(mockProfile);
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockProfileGetEvents(Qnn_ProfileHandle_t profile,
+                                       const QnnProfile_EventId_t** events,
+                                       uint32_t* numEvents) {
+  if (nullptr == profile || nullptr == events || nullptr == numEvents) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  auto mockProfile = reinterpret_cast<MockProfile*>(profile);
+  std::lock_guard<std::mutex> lock(mockProfile->lock);
+  *events    = mockProfile->ids.data();
+  *numEvents = static_cast<uint32_t>(mockProfile->ids.size());
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockProfileGetSubEvents(QnnProfile_EventId_t,
+                                          const QnnProfile_EventId_t** subEvents,
+                                          uint32_t* numSubEvents) {
+  if (nullptr == subEvents || nullptr == numSubEvents) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  *subEvents    = nullptr;
+  *numSubEvents = 0;
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockProfileGetEventData(QnnProfile_EventId_t eventId, QnnProfile_EventData_t* eventData) {
+  if (0 == eventId || nullptr == eventData) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  *eventData = *reinterpret_cast<const QnnProfile_EventData_t*>(eventId);
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockProfileFree(Qnn_ProfileHandle_t profile) {
+  delete reinterpret_cast<MockProfile*>(profile);
+  return QNN_SUCCESS;
+}
+
+// ---- QnnSystemInterface ----
+
+Qnn_ErrorHandle_t mockSystemContextCreate(QnnSystemContext_Handle_t* sysCtxHandle) {
+  if (nullptr == sysCtxHandle) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  *sysCtxHandle = reinterpret_cast<QnnSystemContext_Handle_t>(new MockSystemContext);
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockSystemContextGetBinaryInfo(QnnSystemContext_Handle_t sysCtxHandle,
+                                                 void* binaryBuffer,
+                                                 uint64_t binaryBufferSize,
+                                                 const QnnSystemContext_BinaryInfo_t** binaryInfo,
+                                                 Qnn_ContextBinarySize_t* binaryInfoSize) {
+  auto sysCtx = reinterpret_cast<MockSystemContext*>(sysCtxHandle);
+  if (nullptr == sysCtx || nullptr == binaryInfo || !parseModel(binaryBuffer, binaryBufferSize, sysCtx->model)) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  const auto& graphs = sysCtx->model.graphs;
+  sysCtx->inputs.resize(graphs.size());
+  sysCtx->outputs.resize(graphs.size());
+  sysCtx->graphs.resize(graphs.size());
+  for (size_t g = 0; g < graphs.size(); g++) {
+    for (const auto& input : graphs[g].inputs) {
+      sysCtx->inputs[g].push_back(describeTensor(input, QNN_TENSOR_TYPE_APP_WRITE));
+    }
+    for (const auto& output : graphs[g].outputs) {
+      sysCtx->outputs[g].push_back(describeTensor(output, QNN_TENSOR_TYPE_APP_READ));
+    }
+    auto& info                       = sysCtx->graphs[g];
+    info                             = QnnSystemContext_GraphInfo_t{};
+    info.version                     = QNN_SYSTEM_CONTEXT_GRAPH_INFO_VERSION_1;
+    info.graphInfoV1.graphName       = graphs[g].name.c_str();
+    info.graphInfoV1.numGraphInputs  = static_cast<uint32_t>(sysCtx->inputs[g].size());
+    info.graphInfoV1.graphInputs     = sysCtx->inputs[g].data();
+    info.graphInfoV1.numGraphOutputs = static_cast<uint32_t>(sysCtx->outputs[g].size());
+    info.graphInfoV1.graphOutputs    = sysCtx->outputs[g].data();
+  }
+  sysCtx->binaryInfo                               = QnnSystemContext_BinaryInfo_t{};
+  sysCtx->binaryInfo.version                       = QNN_SYSTEM_CONTEXT_BINARY_INFO_VERSION_1;
+  sysCtx->binaryInfo.contextBinaryInfoV1.numGraphs = static_cast<uint32_t>(sysCtx->graphs.size());
+  sysCtx->binaryInfo.contextBinaryInfoV1.graphs    = sysCtx->graphs.data();
+  *binaryInfo = &sysCtx->binaryInfo;
+  if (nullptr != binaryInfoSize) {
+    *binaryInfoSize = sizeof(sysCtx->binaryInfo);
+  }
+  return QNN_SUCCESS;
+}
+
+Qnn_ErrorHandle_t mockSystemContextFree(QnnSystemContext_Handle_t sysCtxHandle) {
+  delete reinterpret_cast<MockSystemContext*>(sysCtxHandle);
+  return QNN_SUCCESS;
+}
+
+QnnInterface_t makeInterface() {
+  QnnInterface_t provider{};
+  provider.providerName                    = "QnnMockBackend";
+  provider.apiVersion.coreApiVersion.major = QNN_API_VERSION_MAJOR;
+  provider.apiVersion.coreApiVersion.minor = QNN_API_VERSION_MINOR;
+  provider.apiVersion.coreApiVersion.patch = QNN_API_VERSION_PATCH;
+
+  auto& api                   = provider.QNN_INTERFACE_VER_NAME;
+  api.propertyHasCapability   = mockPropertyHasCapability;
+  api.backendCreate           = mockBackendCreate;
+  api.backendFree             = mockBackendFree;
+  api.backendGetBuildId       = mockBackendGetBuildId;
+  api.logCreate               = mockLogCreate;
+  api.logSetLogLevel          = mockLogSetLogLevel;
+  api.logFree                 = mockLogFree;
+  api.deviceGetPlatformInfo   = mockDeviceGetPlatformInfo;
+  api.deviceFreePlatformInfo  = mockDeviceFreePlatformInfo;
+  api.deviceCreate            = mockDeviceCreate;
+  api.deviceFree              = mockDeviceFree;
+  api.deviceGetInfrastructure = mockDeviceGetInfrastructure;
+  api.contextCreate           = mockContextCreate;
+  api.contextCreateFromBinary = mockContextCreateFromBinary;
+  api.contextGetBinarySize    = mockContextGetBinarySize;
+  api.contextGetBinary        = mockContextGetBinary;
+  api.contextFree             = mockContextFree;
+  api.graphRetrieve           = mockGraphRetrieve;
+  api.graphExecute            = mockGraphExecute;
+  api.profileCreate           = mockProfileCreate;
+  api.profileGetEvents        = mockProfileGetEvents;
+  api.profileGetSubEvents     = mockProfileGetSubEvents;
+  api.profileGetEventData     = mockProfileGetEventData;
+  api.profileFree             = mockProfileFree;
+  return provider;
+}
+
+QnnSystemInterface_t makeSystemInterface() {
+  QnnSystemInterface_t provider{};
+  provider.providerName           = "QnnMockBackend";
+  provider.systemApiVersion.major = QNN_SYSTEM_API_VERSION_MAJOR;
+  provider.systemApiVersion.minor = QNN_SYSTEM_API_VERSION_MINOR;
+  provider.systemApiVersion.patch = QNN_SYSTEM_API_VERSION_PATCH;
+
+  auto& api                      = provider.QNN_SYSTEM_INTERFACE_VER_NAME;
+  api.systemContextCreate        = mockSystemContextCreate;
+  api.systemContextGetBinaryInfo = mockSystemContextGetBinaryInfo;
+  api.systemContextFree          = mockSystemContextFree;
+  return provider;
+}
+
+}  // namespace
+
+extern "C" QNN_MOCK_API Qnn_ErrorHandle_t QnnInterface_getProviders(const QnnInterface_t*** providerList,
+                                                                    uint32_t* numProviders) {
+  static const QnnInterface_t provider           = makeInterface();
+  static const QnnInterface_t* const providers[] = {&provider};
+  if (nullptr == providerList || nullptr == numProviders) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  *providerList = const_cast<const QnnInterface_t**>(providers);
+  *numProviders = 1;
+  return QNN_SUCCESS;
+}
+
+extern "C" QNN_MOCK_API Qnn_ErrorHandle_t QnnSystemInterface_getProviders(
+    const QnnSystemInterface_t*** providerList, uint32_t* numProviders) {
+  static const QnnSystemInterface_t provider           = makeSystemInterface();
+  static const QnnSystemInterface_t* const providers[] = {&provider};
+  if (nullptr == providerList || nullptr == numProviders) {
+    return QNN_COMMON_ERROR_INVALID_ARGUMENT;
+  }
+  *providerList = const_cast<const QnnSystemInterface_t**>(providers);
+  *numProviders = 1;
+  return QNN_SUCCESS;
+}
+
+// setPowerConfig calls so far, for a harness which loads the library itself.
+extern "C" QNN_MOCK_API uint64_t QnnMock_getPowerConfigVotes() { return sg_powerConfigVotes.load(); }
@@ -12,6 +12,7 @@
 #include <fstream>
 #include <iostream>
 
+#include "ContextCache.hpp"
 #include "DataUtil.hpp"
 #include "Logger.hpp"
 #include "PAL/Directory.hpp"
@@ -46,8 +47,10 @@ static const int sg_lowerLatency  = 40;    // Should be used on V66 and above on
 static const int sg_lowLatency    = 100;   // This will limit sleep modes available while running
 static const int sg_highLatency   = 2000;
 static std::set<uint32_t> sg_powerConfigIds = {};
+static std::mutex sg_powerConfigIdsMutex;  // perf votes of one model race with the init/destroy of another
 
 uint32_t getPowerConfigId() {
+  std::lock_guard<std::mutex> lk(sg_powerConfigIdsMutex);
   if (sg_powerConfigIds.size() > 0) {
     return *sg_powerConfigIds.begin();
   }
@@ -212,6 +215,7 @@ sample_app::QnnSampleApp::QnnSampleApp(QnnFunctionPointers qnnFunctionPointers,
       m_dumpOutputs(dumpOutputs),
       m_isBackendInitialized(false),
       m_isContextCreated(false),
+      m_backendLibraryHandle(backendLibraryHandle),
 	  m_dlcPath(dlcPath),
 	  m_multiCoreDeviceConfig(multiCoreDeviceConfig)
 {
@@ -447,6 +451,9 @@ sample_app::StatusCode sample_app::QnnSampleApp::freeContext() {
   free(m_graphsInfo);
   m_graphsInfo = nullptr;
 
+  if (!m_isContextCreated) {  // a lazy model never executed
+    return StatusCode::SUCCESS;
+  }
   if (QNN_CONTEXT_NO_ERROR !=
       m_qnnFunctionPointers.qnnInterface.contextFree(m_context, m_profileBackendHandle)) {
     QNN_ERROR("Could not free context");
@@ -508,7 +515,7 @@ sample_app::StatusCode sample_app::QnnSampleApp::finalizeGraphs() {
     extractBackendProfilingInfo(m_profileBackendHandle);
   }
   auto returnStatus = StatusCode::SUCCESS;
-  if (!m_saveBinaryName.empty()) {
+  if (!m_contextCachePath.empty() || !m_saveBinaryName.empty()) {
     QNN_INFO("Before saveBinary(): saving context and metadata.");
     returnStatus = saveBinary();
   } else {
@@ -518,7 +525,10 @@ sample_app::StatusCode sample_app::QnnSampleApp::finalizeGraphs() {
 }
 
 sample_app::StatusCode sample_app::QnnSampleApp::contextApplyBinarySection(QnnContext_SectionType_t section) {
-    sample_app::StatusCode returnStatus = sample_app::StatusCode::SUCCESS;
+    sample_app::StatusCode returnStatus = ensureContext();
+    if (returnStatus != sample_app::StatusCode::SUCCESS) {
+        return returnStatus;
+    }
       for(auto loraadapter = m_lora_adapters.begin(); loraadapter != m_lora_adapters.end(); ++loraadapter){
         std::string model_name = loraadapter->m_graph_name;  
         std::vector<std::string> bin_paths = loraadapter->m_bin_paths;  
@@ -923,8 +933,9 @@ sample_app::StatusCode sample_app::QnnSampleApp::createFromBinary() {
     returnStatus = StatusCode::FAILURE;
   }
 
-  // fill GraphInfo_t based on binary info
-  if (StatusCode::SUCCESS == returnStatus &&
+  // fill GraphInfo_t based on binary info, a lazy model has it since its initialization.
+  const bool contextPending = m_contextPending.load();
+  if (StatusCode::SUCCESS == returnStatus && !contextPending &&
       !copyMetadataToGraphsInfo(binaryInfo, m_graphsInfo, m_graphsCount)) {
     QNN_ERROR("Failed to copy metadata.");
     returnStatus = StatusCode::FAILURE;
@@ -932,11 +943,24 @@ sample_app::StatusCode sample_app::QnnSampleApp::createFromBinary() {
   m_qnnFunctionPointers.qnnSystemInterface.systemContextFree(sysCtxHandle);
   sysCtxHandle = nullptr;
 
-  if (StatusCode::SUCCESS != addGraphsToContext(m_graphsInfo, m_graphsCount)) {
+  if (!contextPending && StatusCode::SUCCESS != addGraphsToContext(m_graphsInfo, m_graphsCount)) {
       QNN_ERROR("Unable to add the retrieved Graphs into ContextWrapper");
       returnStatus = StatusCode::FAILURE;
   }
 
+  // lazy graphs: the metadata is all the getters and the tensor setup need, the context waits for the
+  // first execution, see ensureContext(). A context cache entry is checked here instead, a damaged one would
+  // otherwise only fail at the first execution, after the model could still compose its DLC.
+  if (StatusCode::SUCCESS == returnStatus && m_lazyGraphs && !contextPending && !m_contextCacheHit) {
+    QNN_INFO("lazy graphs, context of %u graph(s) created on first use\n", m_graphsCount);
+    m_contextPending = true;
+#ifdef MMAP_FILE
+    cleanupWinMmap();
+#endif
+    QNN_FUNCTION_EXIT_LOG;
+    return StatusCode::SUCCESS;
+  }
+
   if (StatusCode::SUCCESS == returnStatus &&
       nullptr == m_qnnFunctionPointers.qnnInterface.contextCreateFromBinary) {
     QNN_ERROR("contextCreateFromBinaryFnHandle is nullptr.");
@@ -977,7 +1001,8 @@ sample_app::StatusCode sample_app::QnnSampleApp::createFromBinary() {
       }
     }
   }
-  if (StatusCode::SUCCESS != returnStatus) {
+  // the metadata of a lazy model stays for its getters and tensors, it is freed with the model.
+  if (StatusCode::SUCCESS != returnStatus && !contextPending) {
     QNN_DEBUG("Cleaning up graph Info structures.");
     qnn_wrapper_api::freeGraphsInfo(&m_graphsInfo, m_graphsCount);
   }
@@ -995,8 +1020,47 @@ QNN_FUNCTION_EXIT_LOG;
   return returnStatus;
 }
 
+// The context of a lazy model, created by the first call that needs it. Every later call returns how that went.
+sample_app::StatusCode sample_app::QnnSampleApp::ensureContext() {
+  if (!m_contextPending.load(std::memory_order_acquire)) {
+    return m_contextStatus;
+  }
+  std::lock_guard<std::mutex> lk(m_contextLock);
+  if (m_contextPending.load(std::memory_order_relaxed)) {
+    m_contextStatus = createFromBinary();
+    if (StatusCode::SUCCESS != m_contextStatus) {
+      QNN_ERROR("Could not create the context of the lazy graphs.");
+    }
+    m_contextPending.store(false, std::memory_order_release);
+  }
+  return m_contextStatus;
+}
+
+void sample_app::QnnSampleApp::setContextCacheEntry(const std::string& entryPath, bool hit) {
+  m_contextCachePath = entryPath;
+  m_contextCacheHit  = hit;
+  if (hit) {
+    m_cachedBinaryPath = entryPath;
+  }
+}
+
+void sample_app::QnnSampleApp::discardContext() {
+  if (m_isContextCreated && nullptr != m_context &&
+      QNN_CONTEXT_NO_ERROR != m_qnnFunctionPointers.qnnInterface.contextFree(m_context, nullptr)) {
+    QNN_WARN("Could not free the context being discarded");
+  }
+  m_context          = nullptr;
+  m_isContextCreated = false;
+  m_contextPending   = false;
+  if (nullptr != m_graphsInfo) {
+    qnn_wrapper_api::freeGraphsInfo(&m_graphsInfo, m_graphsCount);
+  }
+  m_graphsCount = 0;
+  m_graphInfoPtrList.clear();
+}
+
 sample_app::StatusCode sample_app::QnnSampleApp::saveBinary() {
-  if (m_saveBinaryName.empty()) {
+  if (m_contextCachePath.empty() && m_saveBinaryName.empty()) {
     QNN_ERROR("No name provided to save binary file.");
     return StatusCode::FAILURE;
   }
@@ -1032,6 +1096,13 @@ sample_app::StatusCode sample_app::QnnSampleApp::saveBinary() {
         requiredBufferSize);
     return StatusCode::FAILURE;
   }
+  if (!m_contextCachePath.empty()) {
+    // a cache that can't be written costs the next start its finalization, not this one.
+    if (!context_cache::writeEntry(m_contextCachePath, saveBuffer.get(), writtenBufferSize)) {
+      QNN_WARN("Could not save the context to cache entry %s", m_contextCachePath.c_str());
+    }
+    return StatusCode::SUCCESS;
+  }
 #ifndef __hexagon__
   auto dataUtilStatus = tools::datautil::writeBinaryToFile(
       m_outputPath, m_saveBinaryName + ".bin", (uint8_t*)saveBuffer.get(), writtenBufferSize);
@@ -1317,17 +1388,25 @@ sample_app::StatusCode sample_app::QnnSampleApp::setupDeviceConfig(
 }
 
 //hst
+// The devices by backend library and device config. A device handle belongs to the backend which
+// created it, so models on different backends (e.g. CPU and HTP) in one process never share one.
 static std::unordered_map<std::string, Qnn_DeviceHandle_t> devicesHandles;
 static std::unordered_map<std::string, uint32_t> devicesRefCounts;
 static std::mutex devicesHandlesMutex;
 
-static std::string makeDeviceKey(uint32_t deviceId, const std::vector<uint32_t>& coreIdVecIn) {
+static std::string makeBackendKey(void* backendLibraryHandle) {
+  std::ostringstream oss;
+  oss << "b" << backendLibraryHandle << "-";
+  return oss.str();
+}
+
+static std::string makeDeviceKey(void* backendLibraryHandle, uint32_t deviceId, const std::vector<uint32_t>& coreIdVecIn) {
   std::vector<uint32_t> cores = coreIdVecIn;
   if (cores.empty()) { cores.push_back(0); } 
   std::sort(cores.begin(), cores.end());
   cores.erase(std::unique(cores.begin(), cores.end()), cores.end());
   std::ostringstream oss;
-  oss << "d" << deviceId << "-c";
+  oss << makeBackendKey(backendLibraryHandle) << "d" << deviceId << "-c";
   for (size_t i = 0; i < cores.size(); ++i) {
     if (i) oss << ",";
     oss << cores[i];
@@ -1335,24 +1414,54 @@ static std::string makeDeviceKey(uint32_t deviceId, const std::vector<uint32_t>&
   return oss.str();
 }
 
+void sample_app::QnnSampleApp::freeSharedDevices(void* backendLibraryHandle, const QNN_INTERFACE_VER_TYPE& qnnInterface) {
+  const std::string prefix = makeBackendKey(backendLibraryHandle);
+  std::lock_guard<std::mutex> lk(devicesHandlesMutex);
+  for (auto it = devicesHandles.begin(); it != devicesHandles.end();) {
+    if (it->first.compare(0, prefix.size(), prefix) != 0) {
+      ++it;
+      continue;
+    }
+    if (nullptr != it->second && nullptr != qnnInterface.deviceFree) {
+      auto qnnStatus = qnnInterface.deviceFree(it->second);
+      if (QNN_SUCCESS != qnnStatus && QNN_DEVICE_ERROR_UNSUPPORTED_FEATURE != qnnStatus) {
+        QNN_ERROR("Failed to free device %s", it->first.c_str());
+      }
+    }
+    devicesRefCounts.erase(it->first);
+    it = devicesHandles.erase(it);
+  }
+}
+
 sample_app::StatusCode sample_app::QnnSampleApp::createDevice() {
   auto returnStatus = StatusCode::SUCCESS;
 //add begin, no need to call setupDeviceConfig and getDevicePlatformInfo for cpu 
   if (true == m_runInCpu){
-    if (nullptr != m_qnnFunctionPointers.qnnInterface.deviceCreate && nullptr == m_deviceHandle) {
-        auto qnnStatus =
-          m_qnnFunctionPointers.qnnInterface.deviceCreate(m_logHandle, nullptr, &m_deviceHandle);
-      if (QNN_SUCCESS != qnnStatus && QNN_DEVICE_ERROR_UNSUPPORTED_FEATURE != qnnStatus) {
-        QNN_ERROR("Failed to create device");
-        return verifyFailReturnStatus(qnnStatus);
-      }
-	  }
+    if (nullptr == m_qnnFunctionPointers.qnnInterface.deviceCreate) {
+      return returnStatus;
+    }
+    const std::string devKey = makeBackendKey(m_backendLibraryHandle) + "cpu";
+    std::lock_guard<std::mutex> lk(devicesHandlesMutex);
+    auto it = devicesHandles.find(devKey);
+    if (it != devicesHandles.end()) {
+      m_deviceHandle = it->second;
+      devicesRefCounts[devKey] += 1;
+      return returnStatus;
+    }
+    auto qnnStatus =
+        m_qnnFunctionPointers.qnnInterface.deviceCreate(m_logHandle, nullptr, &m_deviceHandle);
+    if (QNN_SUCCESS != qnnStatus && QNN_DEVICE_ERROR_UNSUPPORTED_FEATURE != qnnStatus) {
+      QNN_ERROR("Failed to create device");
+      return verifyFailReturnStatus(qnnStatus);
+    }
+    devicesHandles[devKey]   = m_deviceHandle;
+    devicesRefCounts[devKey] = 1;
 	  return returnStatus;
   }
 //add end 20260309
 
   const uint32_t deviceId = m_multiCoreDeviceConfig.deviceId;
-  std::string devKey = makeDeviceKey(deviceId, m_multiCoreDeviceConfig.coreIdVec);
+  std::string devKey = makeDeviceKey(m_backendLibraryHandle, deviceId, m_multiCoreDeviceConfig.coreIdVec);
   {
     std::lock_guard<std::mutex> lk(devicesHandlesMutex);
     auto it = devicesHandles.find(devKey);
@@ -1399,7 +1508,7 @@ sample_app::StatusCode sample_app::QnnSampleApp::freeDevice() {
   return StatusCode::SUCCESS;
 
   const uint32_t deviceId = m_multiCoreDeviceConfig.deviceId;
-  std::string devKey = makeDeviceKey(deviceId, m_multiCoreDeviceConfig.coreIdVec);
+  std::string devKey = makeDeviceKey(m_backendLibraryHandle, deviceId, m_multiCoreDeviceConfig.coreIdVec);
 
   bool needRealFree = true; 
   std::lock_guard<std::mutex> lk(devicesHandlesMutex);
@@ -1571,47 +1680,144 @@ void printArrayOfVector(std::vector<std::vector<size_t>> arrayOfVectors){
 #endif
 
 // improve performance.
-sample_app::StatusCode sample_app::QnnSampleApp::setupInputAndOutputTensors()
+sample_app::StatusCode sample_app::QnnSampleApp::setupInputAndOutputTensors(size_t numTensorSets)
 {
-  auto returnStatus = qnn::tools::iotensor::StatusCode::SUCCESS;
+  m_numTensorSets = std::max<size_t>(1, numTensorSets);
+  m_inputTensors.resize(m_graphsCount);
+  m_outputTensors.resize(m_graphsCount);
+  m_tensorSetBusy.resize(m_graphsCount);
+  m_tensorSetWaiters.assign(m_graphsCount, 0);
+  if (m_lazyGraphs) {
+    QNN_INFO("lazy graphs, tensors of %u graph(s) set up on first use\n", m_graphsCount);
+    return StatusCode::SUCCESS;
+  }
 
   for (size_t graphIdx = 0; graphIdx < m_graphsCount; graphIdx++) {
-    auto& graphInfo = (*m_graphsInfo)[graphIdx];
+    if (StatusCode::SUCCESS != setupTensorSets(graphIdx)) {
+      return StatusCode::FAILURE;
+    }
+  }
+
+  return StatusCode::SUCCESS;
+}
+
+// The tensor sets of one graph, m_tensorSetsLock is held unless no other thread can see the app yet.
+sample_app::StatusCode sample_app::QnnSampleApp::setupTensorSets(size_t graphIdx) {
+  auto& graphInfo = (*m_graphsInfo)[graphIdx];
+  for (size_t tensorSet = 0; tensorSet < m_numTensorSets; tensorSet++) {
     Qnn_Tensor_t* inputs  = nullptr;
     Qnn_Tensor_t* outputs = nullptr;
-    returnStatus = m_ioTensor.setupInputAndOutputTensors(&inputs, &outputs, graphInfo);
-    if (qnn::tools::iotensor::StatusCode::SUCCESS != returnStatus) {
-      QNN_ERROR("Error in setting up Input and output Tensors for graphIdx: %d\n", graphIdx);
-      break;
-    }else{
-      m_inputTensors.push_back(inputs);
-      m_outputTensors.push_back(outputs);
-      QNN_INFO("setup tensors success\n");
+    if (iotensor::StatusCode::SUCCESS != m_ioTensor.setupInputAndOutputTensors(&inputs, &outputs, graphInfo)) {
+      QNN_ERROR("Error in setting up Input and output Tensors for graphIdx: %zu, set: %zu\n", graphIdx, tensorSet);
+      tearDownTensorSets(graphIdx);
+      return StatusCode::FAILURE;
+    }
+    m_inputTensors[graphIdx].push_back(inputs);
+    m_outputTensors[graphIdx].push_back(outputs);
+  }
+  m_tensorSetBusy[graphIdx].assign(m_numTensorSets, false);
+  QNN_INFO("setup tensors success for graphIdx: %zu, %zu set(s), %zu bytes\n", graphIdx, m_numTensorSets,
+           tensorSetsBytes(graphIdx));
+
+  return StatusCode::SUCCESS;
+}
+
+size_t sample_app::QnnSampleApp::tensorSetsBytes(size_t graphIdx) {
+  auto& graphInfo = (*m_graphsInfo)[graphIdx];
+  size_t bytes    = 0;
+  for (size_t tensorSet = 0; tensorSet < m_inputTensors[graphIdx].size(); tensorSet++) {
+    for (size_t inputIdx = 0; inputIdx < graphInfo.numInputTensors; inputIdx++) {
+      bytes += QNN_TENSOR_GET_CLIENT_BUF(m_inputTensors[graphIdx][tensorSet][inputIdx]).dataSize;
+    }
+    for (size_t outputIdx = 0; outputIdx < graphInfo.numOutputTensors; outputIdx++) {
+      bytes += QNN_TENSOR_GET_CLIENT_BUF(m_outputTensors[graphIdx][tensorSet][outputIdx]).dataSize;
+    }
+  }
+  return bytes;
+}
+
+void sample_app::QnnSampleApp::tearDownTensorSets(size_t graphIdx) {
+  auto& graphInfo = (*m_graphsInfo)[graphIdx];
+  for (size_t tensorSet = 0; tensorSet < m_inputTensors[graphIdx].size(); tensorSet++) {
+    if (iotensor::StatusCode::SUCCESS !=
+        m_ioTensor.tearDownInputAndOutputTensors(m_inputTensors[graphIdx][tensorSet],
+                                                 m_outputTensors[graphIdx][tensorSet],
+                                                 graphInfo.numInputTensors,
+                                                 graphInfo.numOutputTensors)) {
+      QNN_ERROR("Error in tear down Input and output Tensors for graphIdx: %zu, set: %zu", graphIdx, tensorSet);
+    }
+  }
+  m_inputTensors[graphIdx].clear();
+  m_outputTensors[graphIdx].clear();
+  m_tensorSetBusy[graphIdx].clear();
+}
+
+// A free tensor set of the graph, waits until a call on another thread releases one.
+// The sets of a lazy graph are set up here on its first use, or on the first use after releaseIdleTensors().
+sample_app::StatusCode sample_app::QnnSampleApp::acquireTensorSet(size_t graphIdx, size_t& tensorSet) {
+  std::unique_lock<std::mutex> lk(m_tensorSetsLock);
+  if (m_tensorSetBusy[graphIdx].empty() && StatusCode::SUCCESS != setupTensorSets(graphIdx)) {
+    return StatusCode::FAILURE;
+  }
+  auto& busy = m_tensorSetBusy[graphIdx];
+  // releaseIdleTensors() leaves the sets of the graph alone while someone waits for one of them.
+  m_tensorSetWaiters[graphIdx]++;
+  m_tensorSetReleased.wait(lk, [&]() {
+    for (tensorSet = 0; tensorSet < busy.size(); tensorSet++) {
+      if (!busy[tensorSet]) {
+        return true;
+      }
     }
+    return false;
+  });
+  m_tensorSetWaiters[graphIdx]--;
+  busy[tensorSet] = true;
+  return StatusCode::SUCCESS;
+}
+
+void sample_app::QnnSampleApp::releaseTensorSet(size_t graphIdx, size_t tensorSet) {
+  {
+    std::lock_guard<std::mutex> lk(m_tensorSetsLock);
+    m_tensorSetBusy[graphIdx][tensorSet] = false;
   }
+  m_tensorSetReleased.notify_all();
+}
+
+size_t sample_app::QnnSampleApp::releaseIdleTensors() {
+  std::lock_guard<std::mutex> lk(m_tensorSetsLock);
+  size_t released = 0;
+  for (size_t graphIdx = 0; graphIdx < m_tensorSetBusy.size(); graphIdx++) {
+    const auto& busy = m_tensorSetBusy[graphIdx];
+    if (busy.empty() || m_tensorSetWaiters[graphIdx] != 0 || std::find(busy.begin(), busy.end(), true) != busy.end()) {
+      continue;
+    }
+    released += tensorSetsBytes(graphIdx);
+    tearDownTensorSets(graphIdx);
+  }
+  QNN_INFO("released %zu bytes of idle tensors\n", released);
+  return released;
+}
 
-  return static_cast<sample_app::StatusCode>(returnStatus);
+std::vector<size_t> sample_app::QnnSampleApp::getGraphResidentBytes() {
+  std::lock_guard<std::mutex> lk(m_tensorSetsLock);
+  std::vector<size_t> residentBytes(m_inputTensors.size(), 0);
+  for (size_t graphIdx = 0; graphIdx < m_inputTensors.size(); graphIdx++) {
+    residentBytes[graphIdx] = tensorSetsBytes(graphIdx);
+  }
+  return residentBytes;
 }
 
 // improve performance.
 sample_app::StatusCode sample_app::QnnSampleApp::tearDownInputAndOutputTensors()
 {
-  auto returnStatus = qnn::tools::iotensor::StatusCode::SUCCESS;
-
-  for (size_t graphIdx = 0; graphIdx < m_graphsCount; graphIdx++) {
-    auto& graphInfo = (*m_graphsInfo)[graphIdx];
-    Qnn_Tensor_t* inputs  = m_inputTensors[graphIdx];
-    Qnn_Tensor_t* outputs = m_outputTensors[graphIdx];
-    returnStatus = m_ioTensor.tearDownInputAndOutputTensors(inputs, outputs, graphInfo.numInputTensors, graphInfo.numOutputTensors);
-    m_inputTensors[graphIdx]  = nullptr;
-    m_outputTensors[graphIdx]  = nullptr;
-    if (qnn::tools::iotensor::StatusCode::SUCCESS != returnStatus) {
-      QNN_ERROR("Error in tear down Input and output Tensors for graphIdx: %d", graphIdx);
-      break;
-    }
+  for (size_t graphIdx = 0; graphIdx < m_inputTensors.size(); graphIdx++) {
+    tearDownTensorSets(graphIdx);
   }
+  m_inputTensors.clear();
+  m_outputTensors.clear();
+  m_tensorSetBusy.clear();
 
-  return static_cast<sample_app::StatusCode>(returnStatus);
+  return StatusCode::SUCCESS;
 }
 
 // issue#24
@@ -1647,7 +1853,7 @@ std::vector<std::vector<size_t>> sample_app::QnnSampleApp::getInputShapes(){
 	if(m_inputShapes.empty()){
  		size_t graphIdx = 0;
  		auto graphInfo = (*m_graphsInfo)[graphIdx];
- 		Qnn_Tensor_t* inputs  = m_inputTensors[graphIdx];
+ 		Qnn_Tensor_t* inputs  = graphInfo.inputTensors;
 		for (size_t inputIdx = 0; inputIdx < graphInfo.numInputTensors; inputIdx++) {
 			if (QNN_TENSOR_GET_DIMENSIONS(inputs[inputIdx]) == nullptr || QNN_TENSOR_GET_RANK(inputs[inputIdx]) == 0) {
 				//printf("[ERROR] input tensor %zu has nullptr dimensions or rank == 0\n", inputIdx);
@@ -1677,7 +1883,7 @@ std::vector<std::string> sample_app::QnnSampleApp::getInputName(){
 	if(m_inputName.empty()){
  		size_t graphIdx = 0;
  		auto graphInfo = (*m_graphsInfo)[graphIdx];
- 		Qnn_Tensor_t* inputs  = m_inputTensors[graphIdx];
+ 		Qnn_Tensor_t* inputs  = graphInfo.inputTensors;
  		for (size_t inputIdx = 0; inputIdx < graphInfo.numInputTensors; inputIdx++) {
 			std::string inputName = QNN_TENSOR_GET_NAME(inputs[inputIdx]);
 			m_inputName.push_back(inputName);
@@ -1691,7 +1897,7 @@ std::vector<std::string> sample_app::QnnSampleApp::getOutputName(){
 	if(m_outputName.empty()){
  		size_t graphIdx = 0;
  		auto graphInfo = (*m_graphsInfo)[graphIdx];
- 		Qnn_Tensor_t* outputs  = m_outputTensors[graphIdx];
+ 		Qnn_Tensor_t* outputs  = graphInfo.outputTensors;
 		for (size_t outputIdx = 0; outputIdx < graphInfo.numOutputTensors; outputIdx++) {
 			std::string outputName = QNN_TENSOR_GET_NAME(outputs[outputIdx]);
 			m_outputName.push_back(outputName);
@@ -1704,7 +1910,7 @@ std::vector<std::string> sample_app::QnnSampleApp::getInputDataType(){
 	if(m_inputDataType_s.empty()){
  		size_t graphIdx = 0;
  		auto graphInfo = (*m_graphsInfo)[graphIdx];
- 		Qnn_Tensor_t* inputs  = m_inputTensors[graphIdx];
+ 		Qnn_Tensor_t* inputs  = graphInfo.inputTensors;
 		for (size_t inputIdx = 0; inputIdx < graphInfo.numInputTensors; inputIdx++) {
 			Qnn_DataType_t dims_inputDataType = QNN_TENSOR_GET_DATA_TYPE(inputs[inputIdx]);
 			m_inputDataType_s.push_back(dataTypeToString(dims_inputDataType));
@@ -1721,7 +1927,7 @@ std::vector<std::vector<size_t>> sample_app::QnnSampleApp::getOutputShapes(){
 	if(m_outputShapes.empty()){
  		size_t graphIdx = 0;
  		auto graphInfo = (*m_graphsInfo)[graphIdx];
- 		Qnn_Tensor_t* outputs  = m_outputTensors[graphIdx];
+ 		Qnn_Tensor_t* outputs  = graphInfo.outputTensors;
 		for (size_t outputIdx = 0; outputIdx < graphInfo.numOutputTensors; outputIdx++) {
 			if (QNN_TENSOR_GET_DIMENSIONS(outputs[outputIdx]) == nullptr || QNN_TENSOR_GET_RANK(outputs[outputIdx]) == 0) {
 				//printf("[ERROR] Output tensor %zu has nullptr dimensions or rank == 0\n", outputIdx);
@@ -1743,7 +1949,7 @@ std::vector<std::string> sample_app::QnnSampleApp::getOutputDataType(){
 	if(m_outputDataType_s.empty()){
  		size_t graphIdx = 0;
  		auto graphInfo = (*m_graphsInfo)[graphIdx];
- 		Qnn_Tensor_t* outputs  = m_outputTensors[graphIdx];
+ 		Qnn_Tensor_t* outputs  = graphInfo.outputTensors;
 		for (size_t outputIdx = 0; outputIdx < graphInfo.numOutputTensors; outputIdx++) {
 			Qnn_DataType_t dims_outputDataType = QNN_TENSOR_GET_DATA_TYPE(outputs[outputIdx]);
 			m_outputDataType_s.push_back(dataTypeToString(dims_outputDataType));
@@ -1758,7 +1964,9 @@ std::vector<std::string> sample_app::QnnSampleApp::getOutputDataType(){
 
 sample_app::StatusCode sample_app::QnnSampleApp::executeGraphsBuffers(std::vector<uint8_t*>& inputBuffers, 
                                                                       std::vector<uint8_t*>& outputBuffers, std::vector<size_t>& outputSize,
-                                                                      std::string perfProfile, size_t graphIndex, size_t share_memory_size) {
+                                                                      std::string perfProfile, size_t graphIndex, size_t share_memory_size,
+                                                                      bool intoOutputBuffers,
+                                                                      const std::vector<size_t>* inputCapacity) {
   auto returnStatus = StatusCode::SUCCESS;
   
   if (nullptr == m_graphsInfo || nullptr == (*m_graphsInfo)) {
@@ -1777,7 +1985,7 @@ sample_app::StatusCode sample_app::QnnSampleApp::executeGraphsBuffers(std::vecto
   // We push '12345' to 'outputSize' in function 'ModelRun@main.cpp@SvcQNNHelpper.exe'. In this case, share memory will not be freed, we can use the share memory as output buffer directly.
   bool shareMemory = false;
   uint8_t* pShareBuffer = inputBuffers[0];
-  if (outputSize.size() == 1 && outputSize[0] == 12345) {
+  if (!intoOutputBuffers && outputSize.size() == 1 && outputSize[0] == 12345) {
       shareMemory = true;
       outputSize.clear();
 
@@ -1788,6 +1996,11 @@ sample_app::StatusCode sample_app::QnnSampleApp::executeGraphsBuffers(std::vecto
       }
   }
 
+  if (intoOutputBuffers && outputBuffers.size() != outputSize.size()) {
+    QNN_ERROR("Output buffers need one capacity each");
+    return StatusCode::FAILURE;
+  }
+
   // printf("m_graphsCount = %d\n", m_graphsCount);
   
   size_t graphIdx = graphIndex; // Only run one graph at a time.
@@ -1802,9 +2015,30 @@ sample_app::StatusCode sample_app::QnnSampleApp::executeGraphsBuffers(std::vecto
     //}
 
     // improve performance.
+  if (graphIdx >= m_inputTensors.size()) {
+    QNN_ERROR("No input/output tensors for graphIdx: %zu", graphIdx);
+    return StatusCode::FAILURE;
+  }
+
+  if (StatusCode::SUCCESS != ensureContext()) {
+    QNN_ERROR("No context to execute graphIdx: %zu", graphIdx);
+    return StatusCode::FAILURE;
+  }
+
+  size_t tensorSet = 0;
+  if (StatusCode::SUCCESS != acquireTensorSet(graphIdx, tensorSet)) {
+    return StatusCode::FAILURE;
+  }
+  // the set is ours until we return, calls on other threads use the other sets meanwhile.
+  struct TensorSetGuard {
+    QnnSampleApp* app;
+    size_t graphIdx;
+    size_t tensorSet;
+    ~TensorSetGuard() { app->releaseTensorSet(graphIdx, tensorSet); }
+  } tensorSetGuard{this, graphIdx, tensorSet};
 
-    Qnn_Tensor_t* inputs = m_inputTensors[graphIdx];
-    Qnn_Tensor_t* outputs = m_outputTensors[graphIdx];
+    Qnn_Tensor_t* inputs = m_inputTensors[graphIdx][tensorSetGuard.tensorSet];
+    Qnn_Tensor_t* outputs = m_outputTensors[graphIdx][tensorSetGuard.tensorSet];
 
   auto graphInfo = (*m_graphsInfo)[graphIdx];
 
@@ -1813,6 +2047,50 @@ sample_app::StatusCode sample_app::QnnSampleApp::executeGraphsBuffers(std::vecto
     return StatusCode::FAILURE;
   }
 
+  // The bytes populateInputTensors() reads from the caller's buffer of an input.
+  auto inputBytesNeeded = [&](size_t inputIdx, size_t& bytesNeeded) {
+    std::vector<size_t> dims;
+    if (QNN_TENSOR_GET_DIMENSIONS(inputs[inputIdx]) == nullptr ||
+      QNN_TENSOR_GET_RANK(inputs[inputIdx]) == 0) {
+      QNN_ERROR("Input tensor %zu has nullptr dimensions or rank == 0", inputIdx);
+      return false;
+    }
+    m_ioTensor.fillDims(dims, QNN_TENSOR_GET_DIMENSIONS(inputs[inputIdx]), QNN_TENSOR_GET_RANK(inputs[inputIdx]));
+
+    const Qnn_DataType_t inDtype = QNN_TENSOR_GET_DATA_TYPE(inputs[inputIdx]);
+    if (m_inputDataType == InputDataType::FLOAT && inDtype != QNN_DATATYPE_FLOAT_32) {
+      // Caller provides float32 input when model expects non-float input (conversion path).
+      bytesNeeded = datautil::calculateElementCount(dims) * sizeof(float);
+    } else {
+      datautil::StatusCode duStatus;
+      std::tie(duStatus, bytesNeeded) = datautil::calculateLength(dims, inDtype);
+      if (datautil::StatusCode::SUCCESS != duStatus ||
+      bytesNeeded == 0) {
+        QNN_ERROR("Failed to calculate native input size for inputIdx: %zu", inputIdx);
+        return false;
+      }
+    }
+    return true;
+  };
+
+  // Caller buffers of known capacity, e.g. InferenceInto(): each must hold what the graph reads from it.
+  if (inputCapacity) {
+    if (inputBuffers.size() != graphInfo.numInputTensors || inputCapacity->size() != inputBuffers.size()) {
+      QNN_ERROR("Incorrect amount of Input Buffers for graphIdx: %zu. Expected: %d, received: %zu", graphIdx, graphInfo.numInputTensors, inputBuffers.size());
+      return StatusCode::FAILURE;
+    }
+    for (size_t inputIdx = 0; inputIdx < graphInfo.numInputTensors; inputIdx++) {
+      size_t bytesNeeded = 0;
+      if (!inputBytesNeeded(inputIdx, bytesNeeded)) {
+        return StatusCode::FAILURE;
+      }
+      if (nullptr == inputBuffers[inputIdx] || (*inputCapacity)[inputIdx] < bytesNeeded) {
+        QNN_ERROR("Input buffer %zu holds %zu bytes, required=%zu bytes, graphIdx=%zu", inputIdx, (*inputCapacity)[inputIdx], bytesNeeded, graphIdx);
+        return StatusCode::FAILURE;
+      }
+    }
+  }
+
   // When using shared memory, validate share_memory_size is sufficient for the provided input buffers.
   // NOTE: Only validate when share_memory_size > 0. If share_memory_size == 0, treat it as "unknown/unlimited".
   if (shareMemory && share_memory_size > 0) {
@@ -1823,27 +2101,9 @@ sample_app::StatusCode sample_app::QnnSampleApp::executeGraphsBuffers(std::vecto
 
     size_t requiredInputBytesTotal = 0;
     for (size_t inputIdx = 0; inputIdx < graphInfo.numInputTensors; inputIdx++) {
-      std::vector<size_t> dims;
-      if (QNN_TENSOR_GET_DIMENSIONS(inputs[inputIdx]) == nullptr ||
-        QNN_TENSOR_GET_RANK(inputs[inputIdx]) == 0) {
-        QNN_ERROR("Input tensor %zu has nullptr dimensions or rank == 0", inputIdx);
-        return StatusCode::FAILURE;
-      }
-      m_ioTensor.fillDims(dims, QNN_TENSOR_GET_DIMENSIONS(inputs[inputIdx]), QNN_TENSOR_GET_RANK(inputs[inputIdx]));
-
       size_t bytesNeeded = 0;
-      const Qnn_DataType_t inDtype = QNN_TENSOR_GET_DATA_TYPE(inputs[inputIdx]);
-      if (m_inputDataType == InputDataType::FLOAT && inDtype != QNN_DATATYPE_FLOAT_32) {
-        // Caller provides float32 input when model expects non-float input (conversion path).
-        bytesNeeded = datautil::calculateElementCount(dims) * sizeof(float);
-      } else {
-        datautil::StatusCode duStatus;
-        std::tie(duStatus, bytesNeeded) = datautil::calculateLength(dims, inDtype);
-        if (datautil::StatusCode::SUCCESS != duStatus ||
-        bytesNeeded == 0) {
-          QNN_ERROR("Failed to calculate native input size for inputIdx: %zu", inputIdx);
-          return StatusCode::FAILURE;
-        }
+      if (!inputBytesNeeded(inputIdx, bytesNeeded)) {
+        return StatusCode::FAILURE;
       }
 
       // Compute the span end offset (relative to shared memory base) for this input buffer.
@@ -1900,25 +2160,29 @@ sample_app::StatusCode sample_app::QnnSampleApp::executeGraphsBuffers(std::vecto
           QNN_DEBUG("Successfully populated input tensors for graphIdx: %d", graphIdx);
           Qnn_ErrorHandle_t executeStatus = QNN_GRAPH_NO_ERROR;
 
-          if (false == m_runInCpu && "default" != perfProfile && false == boostPerformance(m_perfInfra, perfProfile)) {
-            QNN_ERROR("Performance boost failure");
-          }
+          {
+            std::lock_guard<std::mutex> executeLock(m_executeLock);
 
-          executeStatus =
-              m_qnnFunctionPointers.qnnInterface.graphExecute(graphInfo.graph,
-                                                              inputs,
-                                                              graphInfo.numInputTensors,
-                                                              outputs,
-                                                              graphInfo.numOutputTensors,
-                                                              m_profileBackendHandle,
-                                                              nullptr);
+            if (false == m_runInCpu && "default" != perfProfile && false == boostPerformance(m_perfInfra, perfProfile)) {
+              QNN_ERROR("Performance boost failure");
+            }
 
-          if (false == m_runInCpu && "default" != perfProfile && false == resetPerformance(m_perfInfra)) {
-            QNN_ERROR("Performance reset failure");
-          }
+            executeStatus =
+                m_qnnFunctionPointers.qnnInterface.graphExecute(graphInfo.graph,
+                                                                inputs,
+                                                                graphInfo.numInputTensors,
+                                                                outputs,
+                                                                graphInfo.numOutputTensors,
+                                                                m_profileBackendHandle,
+                                                                nullptr);
+
+            if (false == m_runInCpu && "default" != perfProfile && false == resetPerformance(m_perfInfra)) {
+              QNN_ERROR("Performance reset failure");
+            }
 
-          if (ProfilingLevel::OFF != m_profilingLevel) {
-            extractBackendProfilingInfo(m_profileBackendHandle);
+            if (ProfilingLevel::OFF != m_profilingLevel) {
+              extractBackendProfilingInfo(m_profileBackendHandle);
+            }
           }
 
           if (QNN_GRAPH_NO_ERROR != executeStatus) {
@@ -1976,6 +2240,20 @@ sample_app::StatusCode sample_app::QnnSampleApp::executeGraphsBuffers(std::vecto
               QNN_WARN("share memory size(%zu) is enough for outputs. required=%zu bytes, graphIdx=%zu", share_memory_size, requiredBytesTotal, graphIdx);
             }
 
+            // Caller buffers: validate all of them before writing any output.
+            if (intoOutputBuffers) {
+              if (outputBuffers.size() != graphInfo.numOutputTensors) {
+                QNN_ERROR("Incorrect amount of Output Buffers for graphIdx: %zu. Expected: %d, received: %zu", graphIdx, graphInfo.numOutputTensors, outputBuffers.size());
+                return StatusCode::FAILURE;
+              }
+              for (size_t outputIdx = 0; outputIdx < graphInfo.numOutputTensors; outputIdx++) {
+                if (nullptr == outputBuffers[outputIdx] || outputSize[outputIdx] < outBytesToWrite[outputIdx]) {
+                  QNN_ERROR("Output buffer %zu holds %zu bytes, required=%zu bytes", outputIdx, outputSize[outputIdx], outBytesToWrite[outputIdx]);
+                  return StatusCode::FAILURE;
+                }
+              }
+            }
+
             // populate output buffer directly
             size_t offset = 0;
             for (size_t outputIdx = 0; outputIdx < graphInfo.numOutputTensors; outputIdx++) {
@@ -1999,6 +2277,8 @@ sample_app::StatusCode sample_app::QnnSampleApp::executeGraphsBuffers(std::vecto
                     // For float output tensor, outputDataType has no effect (same behavior as IOTensor::writeOutputTensors). 
                     if (shareMemory) {
                       buffer = pShareBuffer + offset;
+                    } else if (intoOutputBuffers) {
+                      buffer = outputBuffers[outputIdx];
                     } else {
                       buffer = static_cast<uint8_t*>(malloc(nativeBytes));
                       if (!buffer) {
@@ -2014,6 +2294,8 @@ sample_app::StatusCode sample_app::QnnSampleApp::executeGraphsBuffers(std::vecto
                     QNN_DEBUG("Writing in output->dataType == OutputDataType::FLOAT_ONLY");
                     if (shareMemory) {
                       floatBuffer = reinterpret_cast<float*>(pShareBuffer + offset);
+                    } else if (intoOutputBuffers) {
+                      floatBuffer = reinterpret_cast<float*>(outputBuffers[outputIdx]);
                     }
                     auto ioReturnStatus = m_ioTensor.convertToFloat(&floatBuffer, &outputs[outputIdx]);
                     if (iotensor::StatusCode::SUCCESS != ioReturnStatus) {
@@ -2028,6 +2310,8 @@ sample_app::StatusCode sample_app::QnnSampleApp::executeGraphsBuffers(std::vecto
                     // Native-only: write as-is (no convertToFloat), equivalent to IOTensor::writeOutputTensor(). 
                     if (shareMemory) {
                       buffer = pShareBuffer + offset;
+                    } else if (intoOutputBuffers) {
+                      buffer = outputBuffers[outputIdx];
                     } else {
                       buffer = static_cast<uint8_t*>(malloc(nativeBytes));
                       if (!buffer) {
@@ -2048,14 +2332,18 @@ sample_app::StatusCode sample_app::QnnSampleApp::executeGraphsBuffers(std::vecto
                 }
 
                 if (buffer) {
-                    outputBuffers.push_back(buffer);
                     // Report the exact bytes of this output buffer.
                     // - FLOAT_ONLY: floatBytes
                     // - NATIVE_ONLY / float32 tensor: nativeBytes
                     size_t reportedBytes = (m_outputDataType == OutputDataType::FLOAT_ONLY && outDtype != QNN_DATATYPE_FLOAT_32)
                                             ? floatBytes
                                             : nativeBytes;
-                    outputSize.push_back(reportedBytes);
+                    if (intoOutputBuffers) {
+                      outputSize[outputIdx] = reportedBytes;
+                    } else {
+                      outputBuffers.push_back(buffer);
+                      outputSize.push_back(reportedBytes);
+                    }
                 }
             }
             // QNN_ERROR("output buffer size: %d\n", outputBuffers.size());
@@ -2126,6 +2414,7 @@ sample_app::StatusCode sample_app::QnnSampleApp::initializePerformance() {
         QNN_ERROR("Failure in createPowerConfigId()");
         return StatusCode::FAILURE;
     }
+    std::lock_guard<std::mutex> lk(sg_powerConfigIdsMutex);
     sg_powerConfigIds.insert(m_powerConfigId);
     return StatusCode::SUCCESS;
 }
@@ -2138,6 +2427,7 @@ sample_app::StatusCode sample_app::QnnSampleApp::destroyPerformance() {
         QNN_ERROR("Failure in destroyPowerConfigId()");
         return StatusCode::FAILURE;
     }
+    std::lock_guard<std::mutex> lk(sg_powerConfigIdsMutex);
     sg_powerConfigIds.erase(m_powerConfigId);
     return StatusCode::SUCCESS;
 }
@@ -7,7 +7,10 @@
 //==============================================================================
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <queue>
 
 #include "IOTensor.hpp"
@@ -142,16 +145,44 @@ class QnnSampleApp {
 
   StatusCode freeDevice();
 
+  // Devices are shared by the apps of one backend library and freed with it, see createDevice().
+  static void freeSharedDevices(void* backendLibraryHandle, const QNN_INTERFACE_VER_TYPE& qnnInterface);
+
   StatusCode verifyFailReturnStatus(Qnn_ErrorHandle_t errCode);
 
 // improve performance.
-  StatusCode setupInputAndOutputTensors();
+  // numTensorSets sets of I/O tensors are allocated per graph. With more than one, executeGraphsBuffers()
+  // calls from several threads overlap: while one executes with its set, others populate their inputs or
+  // drain their outputs. The host memory of the I/O tensors grows by the same factor.
+  StatusCode setupInputAndOutputTensors(size_t numTensorSets = 1);
   StatusCode tearDownInputAndOutputTensors();
 
+  // Context cache entry of a DLC model, see ContextCache.hpp. On a hit createFromBinary() loads the entry in
+  // place of composing the DLC, on a miss finalizeGraphs() saves the context there. A hit creates the context
+  // even with lazy graphs, so a damaged entry fails createFromBinary() and the DLC is composed instead.
+  void setContextCacheEntry(const std::string& entryPath, bool hit);
+  // Undoes a failed createFromBinary(), so that the model can be composed instead.
+  void discardContext();
+
+  // Lazy graphs, set before createFromBinary(): it only reads the graph metadata of the binary, the context
+  // is created by the first execution (not for a context cache hit) and the I/O tensors of a graph are set up
+  // on its first use.
+  void setLazyGraphs(bool lazyGraphs) { m_lazyGraphs = lazyGraphs; }
+  // Frees the I/O tensors of the graphs with no execution in flight, they are set up again on next use.
+  // Returns the host bytes freed.
+  size_t releaseIdleTensors();
+  // Host bytes of the I/O tensors set up per graph, 0 for a graph not used yet or released.
+  std::vector<size_t> getGraphResidentBytes();
+
 // zw.
+  // intoOutputBuffers: outputBuffers/outputSize hold one caller buffer and its capacity per output, the outputs
+  // are written there and outputSize gets the bytes written. Otherwise the output buffers are allocated.
+  // inputCapacity: the bytes each input buffer holds, checked against what the graph reads before any is read.
+  // Safe to call from several threads, see setupInputAndOutputTensors().
   StatusCode executeGraphsBuffers(std::vector<uint8_t*>& inputBuffers,
                                   std::vector<uint8_t*>& outputBuffers, std::vector<size_t>& outputSize,
-                                  std::string perfProfile, size_t graphIndex = 0, size_t share_memory_size = 0);
+                                  std::string perfProfile, size_t graphIndex = 0, size_t share_memory_size = 0,
+                                  bool intoOutputBuffers = false, const std::vector<size_t>* inputCapacity = nullptr);
   // issue#24
   std::vector<std::vector<size_t>> getInputShapes();
   std::vector<std::string> getInputDataType();
@@ -161,8 +192,8 @@ class QnnSampleApp {
   std::vector<std::string> getInputName();
   std::vector<std::string> getOutputName();
   uint64_t getProfilingEvent(uint32_t eventType);
-  qnn_wrapper_api::GraphInfo_t **m_graphsInfo;
-  uint32_t m_graphsCount;
+  qnn_wrapper_api::GraphInfo_t **m_graphsInfo = nullptr;
+  uint32_t m_graphsCount = 0;
 
   StatusCode initializeLog();
   StatusCode setLogLevel(QnnLog_Level_t logLevel);
@@ -180,6 +211,12 @@ class QnnSampleApp {
   StatusCode extractProfilingEvent(QnnProfile_EventId_t profileEventId);
   
   StatusCode composeGraphsFromDlc();
+  StatusCode ensureContext();
+  StatusCode setupTensorSets(size_t graphIdx);
+  size_t tensorSetsBytes(size_t graphIdx);
+  void tearDownTensorSets(size_t graphIdx);
+  StatusCode acquireTensorSet(size_t graphIdx, size_t& tensorSet);
+  void releaseTensorSet(size_t graphIdx, size_t tensorSet);
   StatusCode getDevicePlatformInfo(const QnnDevice_PlatformInfo_t *&platformInfoPtr);
   StatusCode setupDeviceConfig(QnnDevice_Config_t* devConfigPtr, MultiCoreDeviceConfig_t* multicoreConfigPtr);
   static const std::string s_defaultOutputPath;
@@ -192,6 +229,8 @@ class QnnSampleApp {
   std::string m_outputPath;
   std::string m_saveBinaryName;
   std::string m_cachedBinaryPath;
+  std::string m_contextCachePath;
+  bool m_contextCacheHit = false;
 
   std::vector<LoraAdapter> m_lora_adapters;
 
@@ -213,7 +252,8 @@ class QnnSampleApp {
   uint32_t m_graphConfigsInfoCount;
   Qnn_LogHandle_t m_logHandle         = nullptr;
   Qnn_BackendHandle_t m_backendHandle = nullptr;
-  inline static Qnn_DeviceHandle_t m_deviceHandle   = nullptr;
+  Qnn_DeviceHandle_t m_deviceHandle  = nullptr;
+  void* m_backendLibraryHandle       = nullptr;
   RunTimeAppKeys m_runTimeAppKeys;
   uint64_t m_numMaxEvents = std::numeric_limits<uint64_t>::max();
   std::vector<qnn_wrapper_api::GraphInfo_t*> m_graphInfoPtrList;
@@ -238,8 +278,22 @@ class QnnSampleApp {
   QnnSystemDlc_Handle_t m_dlcHandle = nullptr;
   Qnn_LogHandle_t m_dlcLogHandle = nullptr;
 
-  std::vector<Qnn_Tensor_t*> m_inputTensors;
-  std::vector<Qnn_Tensor_t*> m_outputTensors;
+  bool m_lazyGraphs = false;
+  // a lazy model between createFromBinary() and its first execution, see ensureContext().
+  std::atomic<bool> m_contextPending{false};
+  StatusCode m_contextStatus = StatusCode::SUCCESS;
+  std::mutex m_contextLock;
+
+  // [graphIdx][tensorSet], the sets of a graph are empty until it is used in lazy mode.
+  size_t m_numTensorSets = 1;
+  std::vector<std::vector<Qnn_Tensor_t*>> m_inputTensors;
+  std::vector<std::vector<Qnn_Tensor_t*>> m_outputTensors;
+  std::vector<std::vector<bool>> m_tensorSetBusy;
+  std::vector<size_t> m_tensorSetWaiters;  // [graphIdx], threads in acquireTensorSet() waiting for a set
+  std::mutex m_tensorSetsLock;
+  std::condition_variable m_tensorSetReleased;
+  // graphExecute, the perf votes around it and the profile handle: one execution at a time.
+  std::mutex m_executeLock;
   MultiCoreDeviceConfig_t m_multiCoreDeviceConfig = {};
 };
 }  // namespace sample_app
@@ -0,0 +1,248 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#include "ContextCache.hpp"
+#include "Hash.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "Logger.hpp"
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+using namespace qnn;
+using namespace qnn::tools;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// bump when the entry layout or the key changes, old entries then miss and get evicted.
+constexpr char kKeyVersion[] = "context_cache 2";
+
+// .<location>-<content>-<config>.bin
+constexpr size_t kKeySuffix     = 1 + 16 + 1 + 16 + 1 + 16 + 4;
+constexpr size_t kContentSuffix = 1 + 16 + 1 + 16 + 4;
+constexpr size_t kConfigSuffix  = 1 + 16 + 4;
+
+// a temporary file older than this was left by a writer that died, evict() removes it.
+constexpr auto kStaleTmpAge = std::chrono::hours(1);
+
+std::atomic<uint64_t> g_tmpSeq{0};
+
+bool isHex(std::string::const_iterator begin, std::string::const_iterator end) {
+  return std::all_of(begin, end, [](char c) { return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'); });
+}
+
+// <dlc file name>.<location>-<content>-<config>.bin, nothing else in the directory is touched.
+bool isEntry(const std::string& name) {
+  if (name.size() <= kKeySuffix + 4 || 0 != name.compare(name.size() - 4, 4, ".bin")) {
+    return false;
+  }
+  const size_t dot     = name.size() - kKeySuffix;
+  const size_t content = name.size() - kContentSuffix;
+  const size_t config  = name.size() - kConfigSuffix;
+  if (name[dot] != '.' || name[content] != '-' || name[config] != '-' || 0 != name.compare(dot - 4, 4, ".dlc")) {
+    return false;
+  }
+  return isHex(name.begin() + dot + 1, name.begin() + content) &&
+         isHex(name.begin() + content + 1, name.begin() + config) &&
+         isHex(name.begin() + config + 1, name.end() - 4);
+}
+
+// <dlc file name>.<content>-<config>.bin of context_cache 1, which can't hit anymore.
+bool isLegacyEntry(const std::string& name, const std::string& dlcName) {
+  if (name.size() != dlcName.size() + kContentSuffix || 0 != name.compare(0, dlcName.size(), dlcName) ||
+      name[dlcName.size()] != '.' || 0 != name.compare(name.size() - 4, 4, ".bin")) {
+    return false;
+  }
+  const size_t dash = name.size() - kConfigSuffix;
+  return name[dash] == '-' && isHex(name.begin() + dlcName.size() + 1, name.begin() + dash) &&
+         isHex(name.begin() + dash + 1, name.end() - 4);
+}
+
+}  // namespace
+
+bool sample_app::context_cache::contextKey(const std::string& dlcPath,
+                                           const std::string& backendBuildId,
+                                           const std::string& deviceConfig,
+                                           Key& key) {
+  std::ifstream in(dlcPath, std::ios::binary);
+  if (!in) {
+    QNN_ERROR("Failed to open DLC %s to compute its context cache key.", dlcPath.c_str());
+    return false;
+  }
+  std::error_code ec;
+  fs::path location = fs::weakly_canonical(dlcPath, ec);
+  if (ec) {
+    location = fs::absolute(dlcPath, ec);
+  }
+  const std::string locationStr = location.string();
+  // the DLC in 4 MB chunks, each seeded with the hash so far.
+  uint64_t hash = hashBytes(kKeyVersion, sizeof(kKeyVersion) - 1);
+  std::vector<char> chunk(4 << 20);
+  while (in) {
+    in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    const size_t read = static_cast<size_t>(in.gcount());
+    if (0 == read) {
+      break;
+    }
+    hash = hashBytes(chunk.data(), read, hash);
+  }
+  if (in.bad()) {
+    QNN_ERROR("Failed to read DLC %s to compute its context cache key.", dlcPath.c_str());
+    return false;
+  }
+  key.content  = hash;
+  hash         = hashBytes(kKeyVersion, sizeof(kKeyVersion) - 1);
+  hash         = hashBytes(backendBuildId.data(), backendBuildId.size(), hash);
+  key.config   = hashBytes(deviceConfig.data(), deviceConfig.size(), hash);
+  key.location = hashBytes(locationStr.data(), locationStr.size());
+  return true;
+}
+
+std::string sample_app::context_cache::entryPath(const std::string& cacheDir,
+                                                 const std::string& dlcPath,
+                                                 const Key& key) {
+  const fs::path dlc{dlcPath};
+  const fs::path dir = cacheDir.empty() ? dlc.parent_path() : fs::path{cacheDir};
+  char hex[16 + 1 + 16 + 1 + 16 + 1];
+  snprintf(hex,
+           sizeof(hex),
+           "%016llx-%016llx-%016llx",
+           static_cast<unsigned long long>(key.location),
+           static_cast<unsigned long long>(key.content),
+           static_cast<unsigned long long>(key.config));
+  return (dir / (dlc.filename().string() + "." + hex + ".bin")).string();
+}
+
+bool sample_app::context_cache::findEntry(const std::string& path) {
+  std::error_code ec;
+  if (!fs::is_regular_file(path, ec) || 0 == fs::file_size(path, ec) || ec) {
+    return false;
+  }
+  // a read-only cache still hits, it just doesn't keep the order of use.
+  fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+  return true;
+}
+
+bool sample_app::context_cache::writeEntry(const std::string& path, const uint8_t* data, size_t size) {
+  std::error_code ec;
+  const fs::path entry{path};
+  if (entry.has_parent_path()) {
+    fs::create_directories(entry.parent_path(), ec);
+  }
+  // one temporary file per writer, processes sharing the cache directory may write the same entry at once.
+  const fs::path tmp = entry.string() + "." + std::to_string(getpid()) + "-" + std::to_string(g_tmpSeq.fetch_add(1)) + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    if (!out.flush()) {
+      QNN_WARN("Failed to write context cache entry %s.", tmp.string().c_str());
+      out.close();
+      fs::remove(tmp, ec);
+      return false;
+    }
+  }
+  fs::rename(tmp, entry, ec);
+  if (ec) {
+    QNN_WARN("Failed to rename context cache entry %s: %s", path.c_str(), ec.message().c_str());
+    fs::remove(tmp, ec);
+    return false;
+  }
+  return true;
+}
+
+void sample_app::context_cache::removeEntry(const std::string& path) {
+  std::error_code ec;
+  fs::remove(path, ec);
+}
+
+void sample_app::context_cache::evict(const std::string& keep, uint64_t maxBytes) {
+  const fs::path kept{keep};
+  const std::string keptName = kept.filename().string();
+  if (!isEntry(keptName)) {
+    return;
+  }
+  // <dlc file name>, <dlc file name>.<location>- and <dlc file name>.<location>-<content>
+  const std::string dlcName       = keptName.substr(0, keptName.size() - kKeySuffix);
+  const std::string dlcPrefix     = keptName.substr(0, keptName.size() - kContentSuffix + 1);
+  const std::string contentPrefix = keptName.substr(0, keptName.size() - kConfigSuffix);
+
+  struct Entry {
+    fs::path path;
+    uint64_t bytes;
+    fs::file_time_type used;
+  };
+  std::vector<Entry> entries;
+  uint64_t total = 0;
+  std::error_code ec;      // of the directory walk
+  std::error_code entryEc; // of one entry, an entry in use by another process may fail and is skipped
+  const fs::path dir = kept.has_parent_path() ? kept.parent_path() : fs::path{"."};
+  for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+    const std::string name = it->path().filename().string();
+    if (name.size() > 4 && 0 == name.compare(name.size() - 4, 4, ".tmp") && 0 == name.compare(0, dlcName.size() + 1, dlcName + ".") &&
+        it->is_regular_file(entryEc)) {
+      const auto written = it->last_write_time(entryEc);
+      if (!entryEc && fs::file_time_type::clock::now() - written > kStaleTmpAge) {
+        QNN_INFO("Removing stale context cache temporary file %s", it->path().string().c_str());
+        fs::remove(it->path(), entryEc);
+      }
+      continue;
+    }
+    if (isLegacyEntry(name, dlcName) && it->is_regular_file(entryEc)) {
+      QNN_INFO("Evicting stale context cache entry %s", it->path().string().c_str());
+      fs::remove(it->path(), entryEc);
+      continue;
+    }
+    if (name == keptName || !isEntry(name) || !it->is_regular_file(entryEc)) {
+      continue;
+    }
+    if (name.size() == keptName.size() && 0 == name.compare(0, dlcPrefix.size(), dlcPrefix) &&
+        0 != name.compare(0, contentPrefix.size(), contentPrefix)) {
+      QNN_INFO("Evicting stale context cache entry %s", it->path().string().c_str());
+      fs::remove(it->path(), entryEc);
+      continue;
+    }
+    Entry entry{it->path(), it->file_size(entryEc), it->last_write_time(entryEc)};
+    if (entryEc) {
+      continue;
+    }
+    total += entry.bytes;
+    entries.push_back(std::move(entry));
+  }
+  if (0 == maxBytes) {
+    return;
+  }
+
+  const uint64_t keptBytes = fs::file_size(kept, entryEc);
+  if (!entryEc) {
+    total += keptBytes;
+  }
+  std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+  for (const auto& entry : entries) {
+    if (total <= maxBytes) {
+      break;
+    }
+    QNN_INFO("Evicting least recently used context cache entry %s", entry.path.string().c_str());
+    if (fs::remove(entry.path, entryEc)) {
+      total -= entry.bytes;
+    }
+  }
+}
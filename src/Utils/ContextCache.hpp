@@ -0,0 +1,101 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace qnn {
+namespace tools {
+namespace sample_app {
+namespace context_cache {
+
+// Compiled contexts of DLC models, one file per DLC and key:
+//   <cache dir>/<dlc file name>.<location hash>-<content hash>-<config hash>.bin
+// The key hashes the DLC content and what the compiled context depends on besides it (backend build id, device
+// config), so a changed DLC, SDK or device config misses instead of loading a stale context. The location hash
+// of the canonical DLC path keeps apart same-named DLCs of different directories sharing a cache directory.
+// One DLC can have entries for several configs, an entry of an older content of the same DLC is stale.
+// Entries are written to a temporary file of the writing process and renamed, a reader never sees a partial
+// one, and processes sharing the directory never write into each other's temporary file.
+
+struct Key {
+  uint64_t location = 0;
+  uint64_t content  = 0;
+  uint64_t config  = 0;
+};
+
+/**
+ * @brief Key of the compiled context of a DLC
+ *
+ * @param dlcPath Path to the DLC file, its canonical path and its content are hashed
+ * @param backendBuildId Build id of the backend that compiles the context
+ * @param deviceConfig Device and cores the context is compiled for
+ * @param key Output parameter for the key
+ * @return false if the DLC can't be read
+ */
+bool contextKey(const std::string& dlcPath,
+                const std::string& backendBuildId,
+                const std::string& deviceConfig,
+                Key& key);
+
+/**
+ * @brief Path of the cache entry of a DLC
+ *
+ * @param cacheDir Cache directory, the directory of the DLC if empty
+ * @param dlcPath Path to the DLC file
+ * @param key Key from contextKey()
+ * @return The entry path
+ */
+std::string entryPath(const std::string& cacheDir, const std::string& dlcPath, const Key& key);
+
+/**
+ * @brief Look up an entry, a hit is an existing non empty file
+ *
+ * The modification time of a hit is updated, evict() removes the least recently used entries first.
+ *
+ * @param path Path from entryPath()
+ * @return true on a hit
+ */
+bool findEntry(const std::string& path);
+
+/**
+ * @brief Write an entry through a temporary file renamed over it, creating the cache directory
+ *
+ * @param path Path from entryPath()
+ * @param data Serialized context
+ * @param size Size of the serialized context
+ * @return false if the entry could not be written, the cache is left as it was
+ */
+bool writeEntry(const std::string& path, const uint8_t* data, size_t size);
+
+/**
+ * @brief Remove an entry, e.g. one QNN refused to deserialize
+ *
+ * @param path Path from entryPath()
+ */
+void removeEntry(const std::string& path);
+
+/**
+ * @brief Evict the entries of a cache directory
+ *
+ * Removes the entries of older contents of the DLC of keep, which can't hit anymore, and the entries of its file
+ * name written before the location hash was part of the name, and the temporary files of its file name left
+ * by a writer that died, then the least recently used entries of the directory until they fit in maxBytes.
+ * keep itself is never removed.
+ *
+ * @param keep Path of the entry just used or written
+ * @param maxBytes Size limit of the entries of the directory, 0 for none
+ */
+void evict(const std::string& keep, uint64_t maxBytes);
+
+}  // namespace context_cache
+}  // namespace sample_app
+}  // namespace tools
+}  // namespace qnn
@@ -88,35 +88,42 @@ dynamicloadutil::StatusCode dynamicloadutil::getQnnFunctionPointers(
   }
 
   if (true == loadModelLib) {
-    QNN_INFO("Loading model shared library ([model].so)");
-    void* libModelHandle = pal::dynamicloading::dlOpen(
-        modelPath.c_str(), pal::dynamicloading::DL_NOW | pal::dynamicloading::DL_LOCAL);
-    if (nullptr == libModelHandle) {
-      QNN_ERROR("Unable to load model. pal::dynamicloading::dlError(): %s",
-                pal::dynamicloading::dlError());
-      return StatusCode::FAIL_LOAD_MODEL;
-    }
-    if (nullptr != modelHandleRtn) {
-      *modelHandleRtn = libModelHandle;
-    }
+    return getQnnModelFunctionPointers(modelPath, qnnFunctionPointers, modelHandleRtn);
+  }
+  QNN_INFO("Model wasn't loaded from a shared library.");
+  return StatusCode::SUCCESS;
+}
 
-    std::string modelPrepareFunc = "QnnModel_composeGraphs";
-    qnnFunctionPointers->composeGraphsFnHandle =
-        resolveSymbol<sample_app::ComposeGraphsFnHandleType_t>(libModelHandle,
-                                                               modelPrepareFunc.c_str());
-    if (nullptr == qnnFunctionPointers->composeGraphsFnHandle) {
-      return StatusCode::FAIL_SYM_FUNCTION;
-    }
+dynamicloadutil::StatusCode dynamicloadutil::getQnnModelFunctionPointers(
+    std::string modelPath,
+    sample_app::QnnFunctionPointers* qnnFunctionPointers,
+    void** modelHandleRtn) {
+  QNN_INFO("Loading model shared library ([model].so)");
+  void* libModelHandle = pal::dynamicloading::dlOpen(
+      modelPath.c_str(), pal::dynamicloading::DL_NOW | pal::dynamicloading::DL_LOCAL);
+  if (nullptr == libModelHandle) {
+    QNN_ERROR("Unable to load model. pal::dynamicloading::dlError(): %s",
+              pal::dynamicloading::dlError());
+    return StatusCode::FAIL_LOAD_MODEL;
+  }
+  if (nullptr != modelHandleRtn) {
+    *modelHandleRtn = libModelHandle;
+  }
 
-    std::string modelFreeFunc = "QnnModel_freeGraphsInfo";
-    qnnFunctionPointers->freeGraphInfoFnHandle =
-        resolveSymbol<sample_app::FreeGraphInfoFnHandleType_t>(libModelHandle,
-                                                               modelFreeFunc.c_str());
-    if (nullptr == qnnFunctionPointers->freeGraphInfoFnHandle) {
-      return StatusCode::FAIL_SYM_FUNCTION;
-    }
-  } else {
-    QNN_INFO("Model wasn't loaded from a shared library.");
+  std::string modelPrepareFunc = "QnnModel_composeGraphs";
+  qnnFunctionPointers->composeGraphsFnHandle =
+      resolveSymbol<sample_app::ComposeGraphsFnHandleType_t>(libModelHandle,
+                                                             modelPrepareFunc.c_str());
+  if (nullptr == qnnFunctionPointers->composeGraphsFnHandle) {
+    return StatusCode::FAIL_SYM_FUNCTION;
+  }
+
+  std::string modelFreeFunc = "QnnModel_freeGraphsInfo";
+  qnnFunctionPointers->freeGraphInfoFnHandle =
+      resolveSymbol<sample_app::FreeGraphInfoFnHandleType_t>(libModelHandle,
+                                                             modelFreeFunc.c_str());
+  if (nullptr == qnnFunctionPointers->freeGraphInfoFnHandle) {
+    return StatusCode::FAIL_SYM_FUNCTION;
   }
   return StatusCode::SUCCESS;
 }
@@ -29,6 +29,10 @@ StatusCode getQnnFunctionPointers(std::string backendPath,
                                   void** backendHandle,
                                   bool loadModelLib,
                                   void** modelHandleRtn);
+// Load only the model library ([model].so) and resolve its compose/free functions.
+StatusCode getQnnModelFunctionPointers(std::string modelPath,
+                                       sample_app::QnnFunctionPointers* qnnFunctionPointers,
+                                       void** modelHandleRtn);
 StatusCode getQnnSystemFunctionPointers(std::string systemLibraryPath,
                                         sample_app::QnnFunctionPointers* qnnFunctionPointers,
                                         void** systemLibraryHandleRtn);  // zw. Save systemHandle for free later.
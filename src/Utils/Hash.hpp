@@ -0,0 +1,105 @@
+//==============================================================================
+//
+// Copyright (c) 2025, Qualcomm Innovation Center, Inc. All rights reserved.
+//
+// SPDX-License-Identifier: BSD-3-Clause
+//
+//==============================================================================
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace qnn {
+namespace tools {
+
+namespace hash_detail {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t read64(const uint8_t* p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t mixRound(uint64_t acc, uint64_t input) {
+  acc += input * kPrime2;
+  acc = rotl(acc, 31);
+  return acc * kPrime1;
+}
+
+inline uint64_t mergeRound(uint64_t acc, uint64_t val) {
+  acc ^= mixRound(0, val);
+  return acc * kPrime1 + kPrime4;
+}
+
+}  // namespace hash_detail
+
+/**
+ * @brief 64 bit hash, xxHash64 style: four independent lanes over 8 byte words, so a buffer of a few MB
+ * is hashed at memory speed. Used for cache keys (context cache, the service's embedding cache), not
+ * for anything security related.
+ *
+ * @param data Bytes to hash
+ * @param size Number of bytes
+ * @param seed Previous hash when hashing several pieces
+ * @return The hash
+ */
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0) {
+  using namespace hash_detail;
+  const uint8_t* p         = static_cast<const uint8_t*>(data);
+  const uint8_t* const end = p + size;
+  uint64_t h;
+
+  if (size >= 32) {
+    uint64_t v1 = seed + kPrime1 + kPrime2;
+    uint64_t v2 = seed + kPrime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - kPrime1;
+    const uint8_t* const limit = end - 32;
+    do {
+      v1 = mixRound(v1, read64(p));
+      v2 = mixRound(v2, read64(p + 8));
+      v3 = mixRound(v3, read64(p + 16));
+      v4 = mixRound(v4, read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+
+    h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    h = mergeRound(h, v1);
+    h = mergeRound(h, v2);
+    h = mergeRound(h, v3);
+    h = mergeRound(h, v4);
+  } else {
+    h = seed + kPrime5;
+  }
+
+  h += static_cast<uint64_t>(size);
+  for (; p + 8 <= end; p += 8) {
+    h ^= mixRound(0, read64(p));
+    h = rotl(h, 27) * kPrime1 + kPrime4;
+  }
+  for (; p < end; ++p) {
+    h ^= static_cast<uint64_t>(*p) * kPrime5;
+    h = rotl(h, 11) * kPrime1;
+  }
+
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
+}  // namespace tools
+}  // namespace qnn
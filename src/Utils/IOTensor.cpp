@@ -27,7 +27,7 @@ using namespace qnn;
 using namespace qnn::tools;
 
 #include "LibAppBuilder.hpp"
-TimerHelper timerHelper;
+static thread_local TimerHelper timerHelper;  // populateInputTensor() runs on several threads at once.
 
 // Helper method to read data from files to a buffer.
 iotensor::PopulateInputTensorsRetType_t iotensor::IOTensor::readDataAndAllocateBuffer(